@@ -265,6 +265,40 @@ extern JIT_EXPORT uint32_t jit_llvm_vector_width();
 /// Specify the number of threads that are used to parallelize the computation
 extern JIT_EXPORT void jit_llvm_set_thread_count(uint32_t size);
 
+/**
+ * \brief Enable or disable the NUMA mode of the LLVM backend (off by default)
+ *
+ * On machines with several NUMA nodes (e.g. dual-socket systems), this mode
+ * partitions large host-asynchronous allocations across the nodes in 2 MiB
+ * chunks, pins the worker threads of the thread pool to the nodes (evenly
+ * distributed), and schedules the blocks of LLVM kernels so that each block
+ * preferably runs on the node that owns its output range. Partitioned
+ * allocations are cached separately from other memory.
+ *
+ * The mode is only supported on Linux and has no effect on machines with a
+ * single NUMA node. Worker threads remain pinned once the mode was used.
+ */
+extern JIT_EXPORT void jit_llvm_set_numa(int enable);
+
+/// Is the NUMA mode of the LLVM backend enabled? (see \ref jit_llvm_set_numa())
+extern JIT_EXPORT int jit_llvm_numa();
+
+/// Return the number of NUMA nodes of the machine (1 if unavailable)
+extern JIT_EXPORT uint32_t jit_llvm_numa_node_count();
+
+/**
+ * \brief Set the distance (in packets) of software prefetches issued for
+ * gathers when \c JitFlag::GatherPrefetch is active (default: 8)
+ *
+ * The best value depends on the memory latency of the machine and on the
+ * amount of work per packet; the benchmark suite (\c drjit-core-bench)
+ * determines it empirically. A value of zero disables prefetching.
+ */
+extern JIT_EXPORT void jit_llvm_set_prefetch_distance(uint32_t packets);
+
+/// Return the distance of gather prefetches (see \ref jit_llvm_set_prefetch_distance())
+extern JIT_EXPORT uint32_t jit_llvm_prefetch_distance();
+
 // ====================================================================
 //                        Logging infrastructure
 // ====================================================================
@@ -430,6 +464,87 @@ extern JIT_EXPORT void jit_flush_malloc_cache();
 /// Clear the peak memory usage statistics
 extern JIT_EXPORT void jit_malloc_clear_statistics();
 
+/**
+ * \brief Limit the memory footprint of an allocation type
+ *
+ * Dr.Jit keeps released memory in a cache for later reuse, which is normally
+ * only cleared when an allocation fails. When a budget (in bytes) is set, the
+ * sum of used and cached memory of type \c type is monitored instead. Once
+ * a new allocation would exceed the budget, the least recently used cache
+ * entries are released until the footprint drops below 75% of the budget.
+ * Large cached host allocations stay in the cache, but their pages are
+ * released via <tt>madvise(MADV_FREE)</tt> so that the operating system can
+ * reclaim them under memory pressure.
+ *
+ * The budget is soft: allocations still succeed when the memory in use
+ * exceeds it. Specify \c 0 to remove the budget (the default).
+ */
+extern JIT_EXPORT void jit_malloc_set_budget(JIT_ENUM AllocType type,
+                                             size_t budget);
+
+/// Return the memory budget of an allocation type (see \ref jit_malloc_set_budget())
+extern JIT_EXPORT size_t jit_malloc_budget(JIT_ENUM AllocType type);
+
+/**
+ * \brief Start attributing memory allocations to the code that requested them
+ *
+ * While the allocation profiler is active, every allocation made via \ref
+ * jit_malloc() is tagged with the current prefix of the calling thread (see
+ * \ref jit_prefix_push()), or with the hash of the kernel when it stores the
+ * output of a kernel launch. The profiler tracks the live and peak bytes per
+ * tag, the amount of memory held by the allocation cache (i.e., released
+ * memory that is kept for reuse), and a timeline of the most recent 65536
+ * allocator events. Allocations made before the profiler was started are
+ * not attributed.
+ */
+extern JIT_EXPORT void jit_alloc_profile_start();
+
+/// Stop attributing memory allocations (the collected statistics are retained)
+extern JIT_EXPORT void jit_alloc_profile_stop();
+
+/// Reset the statistics and the timeline of the allocation profiler
+extern JIT_EXPORT void jit_alloc_profile_clear();
+
+/// Memory usage attributed to a tag, see \ref jit_alloc_profile()
+struct AllocProfileEntry {
+    /// Prefix label or kernel name (owned by Dr.Jit)
+    const char *tag;
+
+    /// Does the tag refer to the outputs of a kernel?
+    int kernel;
+
+    /// Number of allocations
+    uint64_t count;
+
+    /// Total, currently live, and peak number of allocated bytes
+    size_t total, live, peak;
+};
+
+/**
+ * \brief Return the memory usage per tag collected by the allocation profiler
+ *
+ * The function returns an array with one entry per tag and writes its size to
+ * \c count. The caller is responsible for releasing the array via \c free().
+ */
+extern JIT_EXPORT struct AllocProfileEntry *jit_alloc_profile(size_t *count);
+
+/**
+ * \brief Query the number of bytes held by the allocation cache and its peak
+ * while the allocation profiler was active
+ *
+ * A cache that is large compared to the live memory indicates that memory is
+ * fragmented across many allocation sizes, and \ref jit_flush_malloc_cache()
+ * may help to reduce the memory footprint. Released host-pinned memory is not
+ * included here, \ref jit_alloc_profile_dump() reports it separately.
+ */
+extern JIT_EXPORT void jit_alloc_profile_cache(size_t *current, size_t *peak);
+
+/**
+ * \brief Write the statistics and the timeline of the allocation profiler to
+ * \c filename in JSON format. Returns \c 1 on success.
+ */
+extern JIT_EXPORT int jit_alloc_profile_dump(const char *filename);
+
 /// Flush internal kernel cache
 extern JIT_EXPORT void jit_flush_kernel_cache();
 
@@ -602,6 +717,10 @@ extern JIT_EXPORT const void *jit_registry_attr_data(JIT_ENUM JitBackend backend
  *
  * A type promotion routine in the Dr.Jit Python bindings depends on on this
  * exact ordering, so please don't change.
+ *
+ * \c Float16 variables are stored in IEEE 754 half precision. Host-side
+ * reductions (\ref jit_reduce(), \ref jit_var_reduce()) accumulate them in
+ * single precision.
  */
 enum class VarType : uint32_t {
     Void, Bool, Int8, UInt8, Int16, UInt16, Int32, UInt32,
@@ -687,7 +806,7 @@ enum class JitOp : uint32_t {
     // Fast approximations
     Rcp, Rsqrt,
 
-    // Multi-function generator (CUDA)
+    // Transcendental functions (CUDA: multi-function generator)
     Sin, Cos, Exp2, Log2,
 
     // Total number of operations
@@ -1005,6 +1124,92 @@ extern JIT_EXPORT uint32_t jit_var_mem_copy(JIT_ENUM JitBackend backend,
                                             const void *ptr,
                                             size_t size);
 
+#if defined(__cplusplus)
+/// Access modes of \ref jit_var_map_file()
+enum class JitFileMode : uint32_t {
+    /// The mapping is read-only
+    Read,
+
+    /// Writes to the mapping are private and never reach the file
+    CopyOnWrite,
+
+    /// Writes to the mapping are propagated to the file
+    ReadWrite
+};
+#else
+enum JitFileMode {
+    JitFileModeRead, JitFileModeCopyOnWrite, JitFileModeReadWrite
+};
+#endif
+
+/**
+ * \brief Map a region of a file into memory and expose it as a variable
+ *
+ * On the LLVM backend, the region starting at byte \c offset of the file \c
+ * path is mapped via <tt>mmap()</tt> and directly referenced by the returned
+ * variable without making a copy. The file is extended if \c mode is \ref
+ * JitFileMode::ReadWrite and too small to hold \c size entries. The mapping
+ * is released when the variable is freed (after previously launched kernels
+ * have finished).
+ *
+ * Kernels accessing the mapping advise the operating system about their
+ * access pattern: sequential read-ahead for elementwise accesses, and random
+ * accesses when the variable is the source of a gather operation.
+ *
+ * On the CUDA backend, the region is mapped temporarily and copied to the
+ * device. \ref JitFileMode::ReadWrite is unsupported in this case.
+ *
+ * \param size
+ *    Number of elements (and *not* the size in bytes)
+ *
+ * The reference count of the returned variable is initialized to \c 1.
+ */
+extern JIT_EXPORT uint32_t jit_var_map_file(JIT_ENUM JitBackend backend,
+                                            JIT_ENUM VarType type,
+                                            const char *path, size_t offset,
+                                            size_t size,
+                                            JIT_ENUM JitFileMode mode);
+
+/**
+ * \brief Evaluate a variable directly into a file
+ *
+ * The file \c path is created or extended as needed, and the bytes starting
+ * at \c offset (which must be a multiple of 64) are mapped into memory. When
+ * the variable \c index is unevaluated, the kernel computing it writes its
+ * output directly to the mapping. Otherwise, the existing contents are copied
+ * once. Afterwards, the variable refers to the mapping, which is released
+ * when the variable is freed.
+ *
+ * The kernel may still be running when this function returns. Call \ref
+ * jit_sync_thread() before accessing the file by other means. This operation
+ * is only supported by the LLVM backend.
+ */
+extern JIT_EXPORT void jit_var_eval_to_file(uint32_t index, const char *path,
+                                            size_t offset);
+
+/**
+ * \brief Serialize the contents of a variable to a file descriptor
+ *
+ * The variable is evaluated if needed and written to the file descriptor \c
+ * fd (at its current position) in a compact binary format. The array is
+ * split into chunks that are compressed in parallel using LZ4 when \c
+ * compress is nonzero. Uncompressed chunks are written directly from the
+ * memory of the variable (on the CUDA backend, following a copy to the host).
+ *
+ * Multiple arrays can be written to the same file descriptor and read back
+ * in the same order via \ref jit_var_load().
+ */
+extern JIT_EXPORT void jit_var_save(uint32_t index, int fd, int compress);
+
+/**
+ * \brief Load an array written by \ref jit_var_save() from a file descriptor
+ *
+ * The contents are read (and decompressed in parallel) directly into a fresh
+ * memory allocation, which is then handed to the requested backend. The
+ * reference count of the returned variable is initialized to \c 1.
+ */
+extern JIT_EXPORT uint32_t jit_var_load(JIT_ENUM JitBackend backend, int fd);
+
 /// Increase the reference count of a given variable
 extern JIT_EXPORT void jit_var_inc_ref_impl(uint32_t index) JIT_NOEXCEPT;
 
@@ -1120,6 +1325,35 @@ extern JIT_EXPORT const char *jit_var_str(uint32_t index);
 extern JIT_EXPORT void jit_var_read(uint32_t index, size_t offset,
                                     void *dst);
 
+/**
+ * \brief Read a single element of each of the \c n variables \c indices
+ *
+ * Entry \c offsets[i] (or entry zero, if \c offsets is \c nullptr) of the
+ * variable \c indices[i] is written to \c dst[i]. In contrast to \ref
+ * jit_var_read(), unevaluated variables are computed in a single call to \ref
+ * jit_eval(), and the host CPU & device are synchronized only once. All
+ * variables must use the same backend.
+ */
+extern JIT_EXPORT void jit_var_read_many(uint32_t n, const uint32_t *indices,
+                                         const size_t *offsets, void **dst);
+
+/**
+ * \brief Asynchronous version of \ref jit_var_read_many()
+ *
+ * This function evaluates the variables and enqueues the copy operations,
+ * but it does not wait for them to finish. The output buffers \c dst are
+ * only guaranteed to contain the requested entries after a call to \ref
+ * jit_read_future_wait() with the returned handle, which must take place
+ * exactly once. The buffers must remain valid until then, while the variables
+ * themselves may be released right away.
+ */
+extern JIT_EXPORT struct JitReadFuture *
+jit_var_read_many_async(uint32_t n, const uint32_t *indices,
+                        const size_t *offsets, void **dst);
+
+/// Wait for an asynchronous read to finish and release the handle
+extern JIT_EXPORT void jit_read_future_wait(struct JitReadFuture *future);
+
 /**
  * \brief Copy 'dst' to a single element of a variable
  *
@@ -1187,6 +1421,49 @@ extern JIT_EXPORT int jit_var_eval(uint32_t index);
 /// Evaluate all scheduled computation
 extern JIT_EXPORT void jit_eval();
 
+/**
+ * \brief Limit the number of operations per generated kernel
+ *
+ * Traces with hundreds of thousands of operations (e.g. AD graphs or unrolled
+ * loops) are expensive to compile, and the resulting kernels often suffer
+ * from register spilling. When a nonzero budget is specified, \ref jit_eval()
+ * splits kernels with more operations into a sequence of smaller kernels that
+ * pass intermediate values via temporary arrays. Cut points are chosen to
+ * minimize the number of such temporaries, and kernel regions that cannot be
+ * separated (e.g., recorded loops and virtual function calls) are kept
+ * intact, hence kernels may exceed the budget in some cases.
+ *
+ * The default value of zero disables this feature.
+ */
+extern JIT_EXPORT void jit_set_kernel_op_budget(uint32_t ops);
+
+/// Return the operation budget of kernels (see \ref jit_set_kernel_op_budget())
+extern JIT_EXPORT uint32_t jit_kernel_op_budget();
+
+/**
+ * \brief Automatically evaluate traces that grow beyond a given number of
+ * unevaluated operations
+ *
+ * Without periodic calls to \ref jit_eval(), traces can grow without bound,
+ * which bloats internal data structures and eventually produces huge kernels.
+ * When a nonzero threshold is specified, Dr.Jit monitors the number of
+ * unevaluated operations that each thread appends to the trace of a backend.
+ * Once this number exceeds the threshold, it evaluates the largest subgraphs
+ * of that thread that are still referenced by the application, until its
+ * trace shrinks to a quarter of the threshold. Operations created before the
+ * threshold was set are not taken into account.
+ *
+ * This never happens while recording computation (\ref JitFlag::Recording)
+ * and never affects placeholder variables of recorded loops and calls.
+ * Decisions are logged at the \ref LogLevel::Info level.
+ *
+ * The default value of zero disables this feature.
+ */
+extern JIT_EXPORT void jit_set_auto_eval_threshold(uint32_t ops);
+
+/// Return the automatic evaluation threshold (see \ref jit_set_auto_eval_threshold())
+extern JIT_EXPORT uint32_t jit_auto_eval_threshold();
+
 /**
  * \brief Assign a callback function that is invoked when the variable is
  * evaluated or freed.
@@ -1334,6 +1611,57 @@ enum class JitFlag : uint32_t {
     /// Perform a intra-warp/SIMD register reduction before issuing global atomics
     AtomicReduceLocal = 16384,
 
+    /**
+     * \brief Refill SIMD lanes of recorded loops with pending work (LLVM, off
+     * by default). Lanes whose loop condition becomes false store their
+     * outputs and continue with the next element of the kernel's index range,
+     * which helps loops with strongly divergent trip counts.
+     */
+    LoopRefill = 32768,
+
+    /**
+     * \brief Compile LLVM kernels that use the default mask into an unmasked
+     * main loop over full packets and a masked tail for the remaining elements
+     * (off by default, this doubles the size of the generated code).
+     */
+    PacketSplit = 65536,
+
+    /**
+     * \brief Compile LLVM kernels for several vector widths (e.g. AVX-512,
+     * AVX2, and SSE4.2 packet sizes), time the first launches of each variant,
+     * and pin the fastest one. The choice is persisted in the kernel cache
+     * directory (off by default).
+     */
+    KernelAutotune = 131072,
+
+    /**
+     * \brief Maintain aggregate statistics of every launched kernel (launch
+     * count, cache hits, runtime percentiles, etc.) that can be queried via
+     * \ref jit_kernel_stats(). Unlike \c KernelHistory, this never waits for
+     * kernels to finish and uses a fixed amount of memory per kernel, which
+     * makes it suitable for long-running applications (off by default).
+     */
+    KernelStats = 262144,
+
+    /**
+     * \brief Use faster but less accurate implementations of transcendental
+     * functions (sin, cos, exp2, log2) in the LLVM backend. They skip the
+     * handling of infinities, NaNs, and denormals, and double precision
+     * variants only achieve single precision accuracy (off by default).
+     */
+    FastMath = 524288,
+
+    /**
+     * \brief Emit software prefetches for gathers in LLVM kernels (off by
+     * default). When the index of a gather can be computed from the kernel's
+     * inputs using simple integer arithmetic, the kernel additionally computes
+     * the index of the packet that is processed a certain number of iterations
+     * later (see \ref jit_llvm_set_prefetch_distance()) and prefetches the
+     * referenced memory. This hides DRAM latency in kernels that access large
+     * tables irregularly.
+     */
+    GatherPrefetch = 1048576,
+
     /// Default flags
     Default = (uint32_t) ConstProp | (uint32_t) ValueNumbering |
               (uint32_t) LoopRecord | (uint32_t) LoopOptimize |
@@ -1357,7 +1685,13 @@ enum JitFlag {
     JitFlagKernelHistory       = 2048,
     JitFlagLaunchBlocking      = 4096,
     JitFlagADOptimize          = 8192,
-    JitFlagAtomicReduceLocal = 16384
+    JitFlagAtomicReduceLocal = 16384,
+    JitFlagLoopRefill        = 32768,
+    JitFlagPacketSplit       = 65536,
+    JitFlagKernelAutotune    = 131072,
+    JitFlagKernelStats       = 262144,
+    JitFlagFastMath          = 524288,
+    JitFlagGatherPrefetch    = 1048576
 };
 #endif
 
@@ -1558,6 +1892,49 @@ extern JIT_EXPORT int jit_var_any(uint32_t index);
 /// Reduce a variable to a single value
 extern JIT_EXPORT uint32_t jit_var_reduce(uint32_t index, JIT_ENUM ReduceOp reduce_op);
 
+/**
+ * \brief Callback that receives the tiles produced by \ref jit_var_eval_tiled()
+ *
+ * The tile covers the entries <tt>[offset, offset + size)</tt> of the
+ * original variables, and \c tiles contains one evaluated variable of size \c
+ * size (or 1, for scalar inputs) per requested variable. The variables are
+ * only borrowed and released after the callback returns.
+ */
+typedef void (*JitTileSink)(void *payload, uint32_t offset, uint32_t size,
+                            const uint32_t *tiles);
+
+/**
+ * \brief Evaluate a set of variables tile by tile without materializing them
+ *
+ * This function evaluates the \c n variables \c indices (which must have
+ * the same size or be scalars) in tiles of \c tile_size entries (rounded up
+ * to a multiple of 64, or a default of 4M entries when zero is specified),
+ * and passes each tile to \c sink. Only tile-sized memory is allocated for
+ * the outputs and for intermediate results, which enables computations that
+ * are larger than the available memory.
+ *
+ * This requires that the variables depend elementwise on their inputs, i.e.,
+ * their computation graph consists of arithmetic, casts, gathers (the
+ * gathered array itself is evaluated in full), literals, counters, and
+ * evaluated arrays. This is detected automatically: other computation (e.g.
+ * involving pending scatters, loops, or virtual function calls) is evaluated
+ * at full size and passed to \c sink as a single tile.
+ *
+ * Tiling is never applied implicitly: \ref jit_eval() and \ref
+ * jit_var_eval() always materialize their outputs at full size.
+ */
+extern JIT_EXPORT void jit_var_eval_tiled(uint32_t n, const uint32_t *indices,
+                                          uint32_t tile_size, JitTileSink sink,
+                                          void *payload);
+
+/**
+ * \brief Reduce a variable to a single value, while only materializing tiles
+ * of \c tile_size entries (see \ref jit_var_eval_tiled())
+ */
+extern JIT_EXPORT uint32_t jit_var_reduce_tiled(uint32_t index,
+                                                JIT_ENUM ReduceOp reduce_op,
+                                                uint32_t tile_size);
+
 // ====================================================================
 //  Assortment of tuned kernels for initialization, reductions, etc.
 // ====================================================================
@@ -1604,6 +1981,12 @@ extern JIT_EXPORT void jit_reduce(JIT_ENUM JitBackend backend, JIT_ENUM VarType
  * ``VarType::Int32``, ``VarType::UInt32``, ``VarType::UInt64``,
  * ``VarType::Float32``, and ``VarType::Float64``.
  *
+ * The LLVM backend scans blocks of the input in parallel, and each block adds
+ * the sums of its predecessors in whatever grouping their progress permits at
+ * that moment. Floating point prefix sums are therefore not deterministic:
+ * the result can differ in the last bits from one run to the next. Integer
+ * prefix sums are exact.
+ *
  * Note that the CUDA implementation may round \c size to the maximum of the
  * following three values for performance and implementation-related reasons
  * (the prefix sum uses a tree-based parallelization scheme).
@@ -1678,6 +2061,42 @@ extern JIT_EXPORT uint32_t jit_mkperm(JIT_ENUM JitBackend backend, const uint32_
                                       uint32_t size, uint32_t bucket_count,
                                       uint32_t *perm, uint32_t *offsets);
 
+/**
+ * \brief Sort an array of keys, optionally along with a payload
+ *
+ * This function sorts the \c size keys of type \c type found at \c keys_in
+ * into ascending order and writes them to \c keys_out (which may equal \c
+ * keys_in). The sort is stable. Signed and unsigned 8/16/32/64 bit integers
+ * as well as single and double precision keys are supported. Floating point
+ * keys are ordered by value, with negative zero preceding positive zero and
+ * NaNs with a cleared sign bit following positive infinity.
+ *
+ * When \c values_out is non-NULL, the 32 bit payload \c values_in is
+ * reordered in the same way and written to \c values_out (which may equal \c
+ * values_in). When \c values_in is NULL, the payload consists of the indices
+ * <tt>0, 1, ..., size - 1</tt>, i.e., \c values_out receives the sorting
+ * permutation.
+ *
+ * The implementation is a parallel LSD radix sort that skips digits shared by
+ * all keys. It runs asynchronously and is currently only supported by the
+ * LLVM backend.
+ */
+extern JIT_EXPORT void jit_sort(JIT_ENUM JitBackend backend,
+                                JIT_ENUM VarType type, const void *keys_in,
+                                void *keys_out, const uint32_t *values_in,
+                                uint32_t *values_out, uint32_t size);
+
+/**
+ * \brief Compute a stable permutation that sorts an array of keys
+ *
+ * Writes the indices of the \c size keys at \c keys into \c perm so that
+ * <tt>keys[perm[0]] <= keys[perm[1]] <= ...</tt>. See \ref jit_sort() for
+ * details on the supported key types and their ordering.
+ */
+extern JIT_EXPORT void jit_argsort(JIT_ENUM JitBackend backend,
+                                   JIT_ENUM VarType type, const void *keys,
+                                   uint32_t size, uint32_t *perm);
+
 /// Helper data structure for vector method calls, see \ref jit_var_vcall()
 struct VCallBucket {
     /// Resolved pointer address associated with this bucket
@@ -1730,7 +2149,8 @@ jit_var_vcall_reduce(JIT_ENUM JitBackend backend, const char *domain,
  * block of size \c block_size in the output array \c out. For example, <tt>a,
  * b, c</tt> turns into <tt>a, a, b, b, c, c</tt> when the \c block_size is set
  * to \c 2. The input array must contain <tt>size</tt> elements, and the output
- * array must have space for <tt>size * block_size</tt> elements.
+ * array must have space for <tt>size * block_size</tt> elements. The CUDA
+ * backend requires <tt>size * block_size < 2^32</tt>.
  */
 extern JIT_EXPORT void jit_block_copy(JIT_ENUM JitBackend backend, JIT_ENUM VarType type,
                                       const void *in, void *out,
@@ -1743,11 +2163,55 @@ extern JIT_EXPORT void jit_block_copy(JIT_ENUM JitBackend backend, JIT_ENUM VarT
  * in the input array \c in and writes them to \c out. For example, <tt>a, b,
  * c, d, e, f</tt> turns into <tt>a+b, c+d, e+f</tt> when the \c block_size is
  * set to \c 2. The input array must contain <tt>size * block_size</tt> elements,
- * and the output array must have space for <tt>size</tt> elements.
+ * and the output array must have space for <tt>size</tt> elements. The CUDA
+ * backend requires <tt>size * block_size < 2^32</tt>.
  */
 extern JIT_EXPORT void jit_block_sum(JIT_ENUM JitBackend backend, JIT_ENUM VarType type,
                                      const void *in, void *out, uint32_t size,
                                      uint32_t block_size);
+
+/**
+ * \brief Reduce variable-length segments of an array
+ *
+ * Segment \c i consists of the elements <tt>in[offsets[i]], ...,
+ * in[offsets[i + 1] - 1]</tt>, hence \c offsets must be a nondecreasing
+ * array with <tt>segment_count + 1</tt> entries residing in host memory. The
+ * reduction of each segment is written to <tt>out[i]</tt>, where empty
+ * segments produce the identity element of the reduction \c op. The
+ * implementation splits the elements into equal-sized parts, which balances
+ * the work across threads irrespective of how the segment lengths are
+ * distributed. The operation runs asynchronously and is currently only
+ * supported by the LLVM backend. The \c offsets array is only read by the
+ * asynchronous computation, hence it may be produced by preceding
+ * asynchronous operations.
+ *
+ * The offsets written by \ref jit_mkperm() are quadruples. To reduce its
+ * buckets, copy their \c start fields into an array, append the total size,
+ * and reduce the array permuted by \c perm.
+ */
+extern JIT_EXPORT void jit_segmented_reduce(JIT_ENUM JitBackend backend,
+                                            JIT_ENUM VarType type,
+                                            JIT_ENUM ReduceOp op,
+                                            const void *in,
+                                            const uint32_t *offsets,
+                                            uint32_t segment_count, void *out);
+
+/**
+ * \brief Scan variable-length segments of an array
+ *
+ * Computes an exclusive or inclusive scan with respect to the reduction \c op
+ * that restarts at the beginning of every segment. The segments are specified
+ * as in \ref jit_segmented_reduce(). Elements outside of the range
+ * <tt>[offsets[0], offsets[segment_count])</tt> are not written. The scan
+ * can be performed in-place (i.e., <tt>out == in</tt>).
+ */
+extern JIT_EXPORT void jit_segmented_prefix_sum(JIT_ENUM JitBackend backend,
+                                                JIT_ENUM VarType type,
+                                                JIT_ENUM ReduceOp op,
+                                                int exclusive, const void *in,
+                                                const uint32_t *offsets,
+                                                uint32_t segment_count,
+                                                void *out);
 /**
  * \brief Insert a function call to a ray tracing functor into the LLVM program
  *
@@ -1895,6 +2359,114 @@ extern JIT_EXPORT void jit_kernel_history_clear();
  */
 extern JIT_EXPORT struct KernelHistoryEntry *jit_kernel_history();
 
+/**
+ * \brief Configure the storage of the kernel history
+ *
+ * When \c limit is nonzero, the history turns into a ring buffer that only
+ * retains the \c limit most recent launches. When \c store_ir is zero,
+ * entries don't include a copy of the kernel IR (the \c ir field is \c NULL),
+ * and the end of the list returned by \ref jit_kernel_history() must be
+ * detected using the \c backend field. The default is an unbounded history
+ * with IR. Reducing the limit clears the history.
+ */
+extern JIT_EXPORT void jit_kernel_history_configure(size_t limit, int store_ir);
+
+/// Aggregated statistics of a kernel, see \ref jit_kernel_stats()
+struct KernelStats {
+    /// Jit backend, for which the kernel was compiled
+    JitBackend backend;
+
+    /// Kernel type
+    KernelType type;
+
+    /// 128-bit hash of JIT kernels (zero for other kernel types, which are
+    /// aggregated per backend and type)
+    uint64_t hash[2];
+
+    /// Number of launches
+    uint64_t launches;
+
+    /// Number of launches that reused a kernel from the in-memory cache
+    uint64_t cache_hits;
+
+    /// Number of launches that required compilation or loading from disk
+    uint64_t cache_misses;
+
+    /// Total number of array entries that were processed
+    uint64_t size;
+
+    /// Number of launches that finished and contributed to the timings below
+    uint64_t timed_launches;
+
+    /// Total time (ms) spent generating the kernel intermediate representation
+    float codegen_time;
+
+    /// Total time (ms) spent compiling the kernel
+    float backend_time;
+
+    /// Total time (ms) spent executing the kernel
+    float execution_time;
+
+    /// Minimum and maximum execution time (ms) of a single launch
+    float execution_time_min, execution_time_max;
+
+    /// Estimated median and 99th percentile of the execution time (ms)
+    float execution_time_p50, execution_time_p99;
+};
+
+/**
+ * \brief Return per-kernel statistics collected while \c JitFlag.KernelStats
+ * is set to \c true
+ *
+ * The function returns an array with one entry per kernel and writes its size
+ * to \c count. The caller is responsible for releasing the array via \c
+ * free(). Unlike \ref jit_kernel_history(), the statistics are not reset by
+ * this function. Launches that are still in progress are counted, but their
+ * execution time is only accounted for by later queries.
+ *
+ * The percentiles are estimated from a logarithmic histogram with a bin ratio
+ * of sqrt(2).
+ */
+extern JIT_EXPORT struct KernelStats *jit_kernel_stats(size_t *count);
+
+/// Reset the per-kernel statistics
+extern JIT_EXPORT void jit_kernel_stats_clear();
+
+/**
+ * \brief Start recording a timeline of Dr.Jit's internal phases (e.g.
+ * <tt>jit_eval</tt>, <tt>jit_llvm_compile</tt>), of the blocks of LLVM
+ * kernels executed by worker threads, and of parallel CPU tasks (reductions,
+ * prefix sums, etc.)
+ *
+ * Events are stored in per-thread ring buffers that retain the most recent
+ * 65536 events of each thread. Use \ref jit_profile_dump() to write them to
+ * disk. Tracing is independent of the ITT and NVTX integrations.
+ */
+extern JIT_EXPORT void jit_profile_start();
+
+/// Stop recording events (previously recorded events are retained)
+extern JIT_EXPORT void jit_profile_stop();
+
+/**
+ * \brief Discard all recorded events
+ *
+ * This function may be called while other threads are still recording events.
+ * It never modifies their buffers and only advances a per-buffer marker, so
+ * events recorded concurrently are either retained or discarded as a whole.
+ */
+extern JIT_EXPORT void jit_profile_clear();
+
+/**
+ * \brief Write the recorded events to \c filename in the Chrome trace event
+ * format (JSON), which can be loaded into <tt>chrome://tracing</tt> or
+ * Perfetto. Returns \c 1 on success.
+ *
+ * It is safe to call this function while other threads are recording events.
+ * Events that the owning thread overwrites while they are being written out
+ * are skipped instead of being reported with inconsistent contents.
+ */
+extern JIT_EXPORT int jit_profile_dump(const char *filename);
+
 #if defined(__cplusplus)
 }
 
@@ -1,5 +1,6 @@
 /*
     drjit-core/texture.h -- creating and querying of 1D/2D/3D textures on CUDA
+    and on the LLVM backend
 
     Copyright (c) 2021 Wenzel Jakob <wenzel.jakob@epfl.ch>
 
@@ -135,6 +136,58 @@ extern JIT_EXPORT void jit_cuda_tex_bilerp_fetch(size_t ndim,
 /// Destroys the provided texture handle
 extern JIT_EXPORT void jit_cuda_tex_destroy(void *texture_handle);
 
+/**
+ * \brief Allocate a texture on the LLVM backend
+ *
+ * This function is the LLVM counterpart of \ref jit_cuda_tex_create() and
+ * accepts the same filter and wrap modes. Texels are stored in host memory
+ * using a layout that keeps the texels involved in a linear interpolation
+ * along the first axis adjacent, which allows lookups to fetch them using
+ * fewer and wider loads. The texture is initially zero-valued.
+ */
+extern JIT_EXPORT void *jit_llvm_tex_create(size_t ndim, const size_t *shape,
+                                            size_t n_channels,
+                                            int filter_mode JIT_DEF(1),
+                                            int wrap_mode JIT_DEF(0));
+
+/// Retrieves the shape (including channels) of an existing LLVM texture
+extern JIT_EXPORT void jit_llvm_tex_get_shape(size_t ndim,
+                                              const void *texture_handle,
+                                              size_t *shape);
+
+/**
+ * \brief Copy from host memory to an LLVM texture
+ *
+ * The source contains <tt>shape[0] x ... x shape[ndim - 1]</tt> texels with
+ * interleaved channels, and \c shape must match the shape of the texture.
+ * In contrast to the CUDA version, this operation waits for pending kernels
+ * to finish and then performs the copy synchronously.
+ */
+extern JIT_EXPORT void jit_llvm_tex_memcpy_d2t(size_t ndim, const size_t *shape,
+                                               const void *src_ptr,
+                                               void *dst_texture_handle);
+
+/// Implements the reverse of \ref jit_llvm_tex_memcpy_d2t
+extern JIT_EXPORT void jit_llvm_tex_memcpy_t2d(size_t ndim, const size_t *shape,
+                                               const void *src_texture_handle,
+                                               void *dst_ptr);
+
+/**
+ * \brief Performs a texture lookup on the LLVM backend
+ *
+ * The arguments are analogous to \ref jit_cuda_tex_lookup(). Positions are
+ * normalized to the range <tt>[0, 1]</tt>. The lookup (including filtering
+ * and the handling of the wrap mode) is represented by a single node per
+ * group of four channels.
+ */
+extern JIT_EXPORT void jit_llvm_tex_lookup(size_t ndim,
+                                           const void *texture_handle,
+                                           const uint32_t *pos,
+                                           uint32_t *out);
+
+/// Destroys the provided LLVM texture handle
+extern JIT_EXPORT void jit_llvm_tex_destroy(void *texture_handle);
+
 #if defined(__cplusplus)
 }
 #endif
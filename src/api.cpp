@@ -15,9 +15,15 @@
 #include "registry.h"
 #include "llvm.h"
 #include "cuda_tex.h"
+#include "llvm_tex.h"
 #include "op.h"
 #include "vcall.h"
 #include "loop.h"
+#include "tile.h"
+#include "mapfile.h"
+#include "io.h"
+#include "profiler.h"
+#include "numa.h"
 #include <thread>
 #include <condition_variable>
 #include <drjit-core/texture.h>
@@ -274,6 +280,31 @@ void jit_llvm_set_thread_count(uint32_t size) {
     pool_set_size(nullptr, size);
 }
 
+void jit_llvm_set_numa(int enable) {
+    lock_guard guard(state.lock);
+    jitc_numa_set(enable != 0);
+}
+
+int jit_llvm_numa() {
+    lock_guard guard(state.lock);
+    return jitc_numa ? 1 : 0;
+}
+
+uint32_t jit_llvm_numa_node_count() {
+    lock_guard guard(state.lock);
+    return jitc_numa_node_count();
+}
+
+void jit_llvm_set_prefetch_distance(uint32_t packets) {
+    lock_guard guard(state.lock);
+    jitc_llvm_prefetch_distance = packets;
+}
+
+uint32_t jit_llvm_prefetch_distance() {
+    lock_guard guard(state.lock);
+    return jitc_llvm_prefetch_distance;
+}
+
 void jit_llvm_set_target(const char *target_cpu,
                          const char *target_features,
                          uint32_t vector_width) {
@@ -345,6 +376,18 @@ void jit_malloc_clear_statistics() {
     jitc_malloc_clear_statistics();
 }
 
+void jit_malloc_set_budget(AllocType type, size_t budget) {
+    lock_guard guard(state.lock);
+    jitc_malloc_set_budget(type, budget);
+}
+
+size_t jit_malloc_budget(AllocType type) {
+    lock_guard guard(state.lock);
+    if ((int) type >= (int) AllocType::Count)
+        jitc_raise("jit_malloc_budget(): invalid allocation type!");
+    return state.alloc_budget[(int) type];
+}
+
 enum AllocType jit_malloc_type(void *ptr) {
     lock_guard guard(state.lock);
     return jitc_malloc_type(ptr);
@@ -544,6 +587,27 @@ uint32_t jit_var_mem_copy(JitBackend backend, AllocType atype, VarType vtype,
     return jitc_var_mem_copy(backend, atype, vtype, value, size);
 }
 
+uint32_t jit_var_map_file(JitBackend backend, VarType type, const char *path,
+                          size_t offset, size_t size, JitFileMode mode) {
+    lock_guard guard(state.lock);
+    return jitc_var_map_file(backend, type, path, offset, size, mode);
+}
+
+void jit_var_eval_to_file(uint32_t index, const char *path, size_t offset) {
+    lock_guard guard(state.lock);
+    jitc_var_eval_to_file(index, path, offset);
+}
+
+void jit_var_save(uint32_t index, int fd, int compress) {
+    lock_guard guard(state.lock);
+    jitc_var_save(index, fd, compress != 0);
+}
+
+uint32_t jit_var_load(JitBackend backend, int fd) {
+    lock_guard guard(state.lock);
+    return jitc_var_load(backend, fd);
+}
+
 uint32_t jit_var_copy(uint32_t index) {
     lock_guard guard(state.lock);
     return jitc_var_copy(index);
@@ -599,6 +663,18 @@ uint32_t jit_var_reduce(uint32_t index, ReduceOp reduce_op) {
     return jitc_var_reduce(index, reduce_op);
 }
 
+void jit_var_eval_tiled(uint32_t n, const uint32_t *indices,
+                        uint32_t tile_size, JitTileSink sink, void *payload) {
+    lock_guard guard(state.lock);
+    jitc_var_eval_tiled(n, indices, tile_size, sink, payload);
+}
+
+uint32_t jit_var_reduce_tiled(uint32_t index, ReduceOp reduce_op,
+                              uint32_t tile_size) {
+    lock_guard guard(state.lock);
+    return jitc_var_reduce_tiled(index, reduce_op, tile_size);
+}
+
 const char *jit_var_whos() {
     lock_guard guard(state.lock);
     return jitc_var_whos();
@@ -619,6 +695,23 @@ void jit_var_read(uint32_t index, size_t offset, void *dst) {
     jitc_var_read(index, offset, dst);
 }
 
+void jit_var_read_many(uint32_t n, const uint32_t *indices,
+                       const size_t *offsets, void **dst) {
+    lock_guard guard(state.lock);
+    jitc_var_read_many(n, indices, offsets, dst);
+}
+
+JitReadFuture *jit_var_read_many_async(uint32_t n, const uint32_t *indices,
+                                       const size_t *offsets, void **dst) {
+    lock_guard guard(state.lock);
+    return jitc_var_read_many_async(n, indices, offsets, dst);
+}
+
+void jit_read_future_wait(JitReadFuture *future) {
+    lock_guard guard(state.lock);
+    jitc_read_future_wait(future);
+}
+
 uint32_t jit_var_write(uint32_t index, size_t offset, const void *src) {
     lock_guard guard(state.lock);
     return jitc_var_write(index, offset, src);
@@ -636,6 +729,33 @@ void jit_eval() {
     jitc_eval(thread_state_llvm);
 }
 
+void jit_set_kernel_op_budget(uint32_t ops) {
+    lock_guard guard(state.lock);
+    jitc_kernel_op_budget = ops;
+}
+
+uint32_t jit_kernel_op_budget() {
+    lock_guard guard(state.lock);
+    return jitc_kernel_op_budget;
+}
+
+void jit_set_auto_eval_threshold(uint32_t ops) {
+    lock_guard guard(state.lock);
+    jitc_auto_eval_threshold = ops;
+
+    if (ops == 0) {
+        for (ThreadState *ts : state.tss) {
+            ts->trace_vars.clear();
+            ts->trace_size = 0;
+        }
+    }
+}
+
+uint32_t jit_auto_eval_threshold() {
+    lock_guard guard(state.lock);
+    return jitc_auto_eval_threshold;
+}
+
 int jit_var_eval(uint32_t index) {
     if (index == 0)
         return 0;
@@ -699,6 +819,35 @@ uint32_t jit_mkperm(JitBackend backend, const uint32_t *values, uint32_t size,
     return jitc_mkperm(backend, values, size, bucket_count, perm, offsets);
 }
 
+void jit_sort(JitBackend backend, VarType type, const void *keys_in,
+              void *keys_out, const uint32_t *values_in, uint32_t *values_out,
+              uint32_t size) {
+    lock_guard guard(state.lock);
+    jitc_sort(backend, type, keys_in, keys_out, values_in, values_out, size);
+}
+
+void jit_argsort(JitBackend backend, VarType type, const void *keys,
+                 uint32_t size, uint32_t *perm) {
+    lock_guard guard(state.lock);
+    jitc_argsort(backend, type, keys, size, perm);
+}
+
+void jit_segmented_reduce(JitBackend backend, VarType type, ReduceOp op,
+                          const void *in, const uint32_t *offsets,
+                          uint32_t segment_count, void *out) {
+    lock_guard guard(state.lock);
+    jitc_segmented_reduce(backend, type, op, in, offsets, segment_count, out);
+}
+
+void jit_segmented_prefix_sum(JitBackend backend, VarType type, ReduceOp op,
+                              int exclusive, const void *in,
+                              const uint32_t *offsets, uint32_t segment_count,
+                              void *out) {
+    lock_guard guard(state.lock);
+    jitc_segmented_prefix_sum(backend, type, op, exclusive != 0, in, offsets,
+                              segment_count, out);
+}
+
 void jit_block_copy(JitBackend backend, enum VarType type, const void *in, void *out,
                     uint32_t size, uint32_t block_size) {
     lock_guard guard(state.lock);
@@ -826,6 +975,71 @@ struct KernelHistoryEntry *jit_kernel_history() {
     return state.kernel_history.get();
 }
 
+void jit_kernel_history_configure(size_t limit, int store_ir) {
+    lock_guard guard(state.lock);
+    state.kernel_history.configure(limit, store_ir != 0);
+}
+
+struct KernelStats *jit_kernel_stats(size_t *count) {
+    lock_guard guard(state.lock);
+    return state.kernel_stats.get(count);
+}
+
+void jit_kernel_stats_clear() {
+    lock_guard guard(state.lock);
+    state.kernel_stats.clear();
+}
+
+void jit_alloc_profile_start() {
+    lock_guard guard(state.lock);
+    state.alloc_profile.start();
+}
+
+void jit_alloc_profile_stop() {
+    lock_guard guard(state.lock);
+    state.alloc_profile.stop();
+}
+
+void jit_alloc_profile_clear() {
+    lock_guard guard(state.lock);
+    state.alloc_profile.clear();
+}
+
+struct AllocProfileEntry *jit_alloc_profile(size_t *count) {
+    lock_guard guard(state.lock);
+    return state.alloc_profile.get(count);
+}
+
+void jit_alloc_profile_cache(size_t *current, size_t *peak) {
+    lock_guard guard(state.lock);
+    state.alloc_profile.cache(current, peak);
+}
+
+int jit_alloc_profile_dump(const char *filename) {
+    lock_guard guard(state.lock);
+    return state.alloc_profile.dump(filename);
+}
+
+void jit_profile_start() {
+    lock_guard guard(state.lock);
+    jitc_profile_start();
+}
+
+void jit_profile_stop() {
+    lock_guard guard(state.lock);
+    jitc_profile_stop();
+}
+
+void jit_profile_clear() {
+    lock_guard guard(state.lock);
+    jitc_profile_clear();
+}
+
+int jit_profile_dump(const char *filename) {
+    lock_guard guard(state.lock);
+    return jitc_profile_dump(filename);
+}
+
 #if defined(DRJIT_ENABLE_OPTIX)
 OptixDeviceContext jit_optix_context() {
     lock_guard guard(state.lock);
@@ -910,6 +1124,41 @@ void jit_cuda_tex_destroy(void *texture) {
     jitc_cuda_tex_destroy(texture);
 }
 
+void *jit_llvm_tex_create(size_t ndim, const size_t *shape, size_t n_channels,
+                          int filter_mode, int wrap_mode) {
+    lock_guard guard(state.lock);
+    return jitc_llvm_tex_create(ndim, shape, n_channels, filter_mode, wrap_mode);
+}
+
+void jit_llvm_tex_get_shape(size_t ndim, const void *texture_handle,
+                            size_t *shape) {
+    lock_guard guard(state.lock);
+    jitc_llvm_tex_get_shape(ndim, texture_handle, shape);
+}
+
+void jit_llvm_tex_memcpy_d2t(size_t ndim, const size_t *shape,
+                             const void *src_ptr, void *dst_texture) {
+    lock_guard guard(state.lock);
+    jitc_llvm_tex_memcpy_d2t(ndim, shape, src_ptr, dst_texture);
+}
+
+void jit_llvm_tex_memcpy_t2d(size_t ndim, const size_t *shape,
+                             const void *src_texture, void *dst_ptr) {
+    lock_guard guard(state.lock);
+    jitc_llvm_tex_memcpy_t2d(ndim, shape, src_texture, dst_ptr);
+}
+
+void jit_llvm_tex_lookup(size_t ndim, const void *texture_handle,
+                         const uint32_t *pos, uint32_t *out) {
+    lock_guard guard(state.lock);
+    jitc_llvm_tex_lookup(ndim, texture_handle, pos, out);
+}
+
+void jit_llvm_tex_destroy(void *texture) {
+    lock_guard guard(state.lock);
+    jitc_llvm_tex_destroy(texture);
+}
+
 uint32_t jit_var_neg(uint32_t a0) {
     lock_guard guard(state.lock);
     return jitc_var_neg(a0);
@@ -15,7 +15,10 @@
 #include "util.h"
 #include "optix.h"
 #include "loop.h"
-#include <tsl/robin_set.h>
+#include "llvm.h"
+#include "io.h"
+#include "numa.h"
+#include "mapfile.h"
 
 // ====================================================================
 //  The following data structures are temporarily used during program
@@ -29,8 +32,32 @@ std::vector<ScheduledVariable> schedule;
 /// Groups of variables with the same size
 std::vector<ScheduledGroup> schedule_groups;
 
-/// Auxiliary data structure needed to compute 'schedule_sizes' and 'schedule'
-static tsl::robin_set<std::pair<uint32_t, uint32_t>, pair_hash> visited;
+/// Variables requested by jitc_eval(), ordered by size before traversal
+static std::vector<ScheduledVariable> schedule_roots;
+
+/// Maximum number of operations per kernel (0: unlimited)
+uint32_t jitc_kernel_op_budget = 0;
+
+/// Is jitc_eval() currently running on this thread?
+thread_local bool jitc_eval_active = false;
+
+/// Temporaries used by 'jitc_eval_split()' to partition oversized kernels
+static std::vector<ScheduledVariable> split_schedule;
+static std::vector<ScheduledGroup> split_groups;
+static std::vector<uint32_t> split_ops, split_last_use, split_cuts, split_need,
+                             split_mark, split_new_pos, split_replicate_ops;
+static std::vector<int32_t> split_bad, split_mat;
+static std::vector<uint8_t> split_kind;
+static tsl::robin_map<uint32_t, uint32_t, UInt32Hasher> split_pos;
+
+/// Pairs of schedule entries (dst, src): 'dst' reads the output of 'src'
+static std::vector<std::pair<uint32_t, uint32_t>> split_links;
+
+/// Explicit stack used by 'jitc_var_dfs()'
+std::vector<VisitFrame> visit_stack;
+
+/// Epoch of the most recent graph traversal (see 'Variable::visit_epoch')
+static uint32_t visit_epoch = 0;
 
 /// Kernel parameter buffer and device copy
 static std::vector<void *> kernel_params;
@@ -55,6 +82,9 @@ char kernel_name[52 /* strlen("__direct_callable__") + 32 + 1 */] { };
 // Total number of operations used across the entire kernel (including functions)
 static uint32_t n_ops_total = 0;
 
+/// Largest element size of the kernel outputs (for NUMA-aware block scheduling)
+static uint32_t output_isize = 0;
+
 /// Are we recording an OptiX kernel?
 bool uses_optix = false;
 
@@ -76,38 +106,65 @@ KernelHistoryEntry kernel_history_entry;
 
 // ====================================================================
 
-/// Recursively traverse the computation graph to find variables needed by a computation
-static void jitc_var_traverse(uint32_t size, uint32_t index) {
-    if (!visited.emplace(size, index).second)
-        return;
-
-    Variable *v = jitc_var(index);
-    for (int i = 0; i < 4; ++i) {
-        uint32_t index2 = v->dep[i];
-        if (index2 == 0)
-            break;
-        jitc_var_traverse(size, index2);
+uint32_t jitc_var_visit_epoch() {
+    if (unlikely(++visit_epoch == 0)) {
+        // Wrapped around, invalidate all marks
+        for (auto &kv : state.variables)
+            kv.second.visit_epoch = 0;
+        visit_epoch = 1;
     }
+    return visit_epoch;
+}
 
-    if (unlikely(v->extra)) {
-        auto it = state.extra.find(index);
-        if (it == state.extra.end())
-            jitc_fail("jit_var_traverse(): could not find matching 'extra' record!");
+const Extra *jitc_var_extra(const Variable *v, uint32_t index) {
+    if (likely(!v->extra))
+        return nullptr;
 
-        const Extra &extra = it->second;
-        for (uint32_t i = 0; i < extra.n_dep; ++i) {
-            uint32_t index2 = extra.dep[i];
-            if (index2 == 0)
-                continue;
-            jitc_var_traverse(size, index2);
-        }
-    }
+    auto it = state.extra.find(index);
+    if (unlikely(it == state.extra.end()))
+        jitc_fail("jit_var_extra(r%u): could not find matching 'extra' record!",
+                  index);
+
+    return &it->second;
+}
+
+/**
+ * Traverse the computation graph to find variables needed by a computation.
+ * All traversals within the same epoch must use the same 'size' value.
+ */
+static void jitc_var_traverse(uint32_t size, uint32_t index) {
+    uint32_t epoch = visit_epoch;
+
+    jitc_var_dfs(
+        index,
+        [epoch](uint32_t, Variable *v) {
+            if (v->visit_epoch == epoch)
+                return false;
+            v->visit_epoch = epoch;
+            v->output_flag = false;
+            return true;
+        },
+        [size](uint32_t index, Variable *v) {
+            schedule.emplace_back(size, v->scope, index);
+        });
+}
+
+/// Hash the kernel in 'buffer' and substitute the hash into its name
+static void jitc_assemble_hash() {
+    // Replace '^'s in '__raygen__^^^..' or 'drjit_^^^..' with hash
+    kernel_hash = hash_kernel(buffer.get());
 
-    // If we're really visiting this variable the first time, no matter its size
-    if (visited.emplace(0, index).second)
-        v->output_flag = false;
+    size_t hash_offset = strchr(buffer.get(), '^') - buffer.get(),
+           end_offset = buffer.size(),
+           prefix_len = uses_optix ? 10 : 6;
 
-    schedule.emplace_back(size, v->scope, index);
+    buffer.rewind_to(hash_offset);
+    buffer.put_q64_unchecked(kernel_hash.high64);
+    buffer.put_q64_unchecked(kernel_hash.low64);
+    buffer.rewind_to(end_offset);
+    memset(kernel_name, 0, sizeof(kernel_name));
+    memcpy(kernel_name, buffer.get() + hash_offset - prefix_len,
+           prefix_len + 32);
 }
 
 void jitc_assemble(ThreadState *ts, ScheduledGroup group) {
@@ -126,6 +183,8 @@ void jitc_assemble(ThreadState *ts, ScheduledGroup group) {
                  jit_flag(JitFlag::ForceOptiX);
 #endif
 
+    output_isize = 0;
+
     uint32_t n_params_in    = 0,
              n_params_out   = 0,
              n_side_effects = 0,
@@ -139,14 +198,19 @@ void jitc_assemble(ThreadState *ts, ScheduledGroup group) {
         // The first 3 variables are reserved on the CUDA backend
         n_regs = 4;
     } else {
-        // First 3 parameters reserved for: kernel ptr, size, ITT identifier
-        for (int i = 0; i < 3; ++i)
+        /* First 5 parameters reserved for: kernel ptr, size, ITT identifier,
+           the KernelLaunchTiming record of JitFlag::KernelStats, and the
+           NumaLaunch record of the NUMA mode */
+        for (int i = 0; i < 5; ++i)
             kernel_params.push_back(nullptr);
         n_regs = 1;
     }
 
     (void) timer();
 
+    if (unlikely(state.alloc_profile.active))
+        state.alloc_profile.kernel_begin();
+
     for (uint32_t group_index = group.start; group_index != group.end; ++group_index) {
         ScheduledVariable &sv = schedule[group_index];
         uint32_t index = sv.index;
@@ -166,31 +230,48 @@ void jitc_assemble(ThreadState *ts, ScheduledGroup group) {
         v->param_offset = (uint32_t) kernel_params.size() * sizeof(void *);
         v->reg_index = n_regs++;
 
-        if (v->is_data()) {
+        if (v->is_data() || sv.data) {
+            // (sv.data != nullptr: temporary computed by a preceding part
+            // of a split kernel, see jitc_eval_split())
             n_params_in++;
             v->param_type = ParamType::Input;
-            kernel_params.push_back(v->data);
+            kernel_params.push_back(v->is_data() ? v->data : sv.data);
+
+            if (unlikely(jitc_file_mapping_count))
+                jitc_file_advise(kernel_params.back(), false);
         } else if (v->output_flag && v->size == group.size) {
             n_params_out++;
             v->param_type = ParamType::Output;
 
             size_t isize = (size_t) type_size[v->type],
                    dsize = (size_t) group.size * isize;
+            output_isize = std::max(output_isize, (uint32_t) isize);
 
             // Padding to support out-of-bounds accesses in LLVM gather operations
             if (backend == JitBackend::LLVM && isize < 4)
                 dsize += 4 - isize;
 
-            sv.data = jitc_malloc(
-                backend == JitBackend::CUDA ? AllocType::Device
-                                            : AllocType::HostAsync,
-                dsize); // Note: unsafe to access 'v' after jitc_malloc().
+            // Write directly to a file mapping (see jit_var_eval_to_file())
+            void *file_ptr = nullptr;
+            if (unlikely(jitc_file_output_count))
+                file_ptr = jitc_file_output(index);
+
+            if (file_ptr)
+                sv.data = file_ptr;
+            else
+                sv.data = jitc_malloc(
+                    backend == JitBackend::CUDA ? AllocType::Device
+                                                : AllocType::HostAsync,
+                    dsize); // Note: unsafe to access 'v' after jitc_malloc().
 
             kernel_params.push_back(sv.data);
         } else if (v->is_literal() && (VarType) v->type == VarType::Pointer) {
             n_params_in++;
             v->param_type = ParamType::Input;
             kernel_params.push_back((void *) v->literal);
+
+            if (unlikely(jitc_file_mapping_count))
+                jitc_file_advise((void *) v->literal, true);
         } else {
             n_side_effects += (uint32_t) v->side_effect;
             v->param_type = ParamType::Register;
@@ -270,20 +351,10 @@ void jitc_assemble(ThreadState *ts, ScheduledGroup group) {
     else
         jitc_llvm_assemble(ts, group);
 
-    // Replace '^'s in '__raygen__^^^..' or 'drjit_^^^..' with hash
-    kernel_hash = hash_kernel(buffer.get());
+    jitc_assemble_hash();
 
-    size_t hash_offset = strchr(buffer.get(), '^') - buffer.get(),
-           end_offset = buffer.size(),
-           prefix_len = uses_optix ? 10 : 6;
-
-    buffer.rewind_to(hash_offset);
-    buffer.put_q64_unchecked(kernel_hash.high64);
-    buffer.put_q64_unchecked(kernel_hash.low64);
-    buffer.rewind_to(end_offset);
-    memset(kernel_name, 0, sizeof(kernel_name));
-    memcpy(kernel_name, buffer.get() + hash_offset - prefix_len,
-           prefix_len + 32);
+    if (unlikely(state.alloc_profile.active))
+        state.alloc_profile.kernel_end(kernel_hash.high64);
 
     if (unlikely(trace || (jitc_flags() & (uint32_t) JitFlag::PrintIR))) {
         LogLevel level = std::max(state.log_level_stderr, state.log_level_callback);
@@ -305,13 +376,18 @@ void jitc_assemble(ThreadState *ts, ScheduledGroup group) {
             uses_optix ? "via OptiX, " : "", group.size, n_params_in,
             n_params_out, n_ops_total, jitc_time_string(codegen_time));
 
-    if (unlikely(jit_flag(JitFlag::KernelHistory))) {
+    uint32_t flags = jit_flags();
+    if (unlikely(flags & ((uint32_t) JitFlag::KernelHistory |
+                          (uint32_t) JitFlag::KernelStats))) {
         kernel_history_entry.backend = backend;
         kernel_history_entry.type = KernelType::JIT;
         kernel_history_entry.hash[0] = kernel_hash.low64;
         kernel_history_entry.hash[1] = kernel_hash.high64;
-        kernel_history_entry.ir = (char *) malloc_check(buffer.size() + 1);
-        memcpy(kernel_history_entry.ir, buffer.get(), buffer.size() + 1);
+        if ((flags & (uint32_t) JitFlag::KernelHistory) &&
+            state.kernel_history.store_ir()) {
+            kernel_history_entry.ir = (char *) malloc_check(buffer.size() + 1);
+            memcpy(kernel_history_entry.ir, buffer.get(), buffer.size() + 1);
+        }
         kernel_history_entry.uses_optix = uses_optix;
         kernel_history_entry.size = group.size;
         kernel_history_entry.input_count = n_params_in;
@@ -321,12 +397,148 @@ void jitc_assemble(ThreadState *ts, ScheduledGroup group) {
     }
 }
 
+/**
+ * Temporarily change the vector width used by the LLVM code generator. The
+ * previous width is restored even if code generation raises an exception, so
+ * that the change never becomes visible outside of jitc_assemble_llvm_width().
+ */
+struct scoped_llvm_vector_width {
+    scoped_llvm_vector_width(uint32_t width)
+        : width_prev(jitc_llvm_vector_width) {
+        jitc_llvm_vector_width = width;
+        jitc_llvm_update_strings();
+    }
+
+    ~scoped_llvm_vector_width() {
+        jitc_llvm_vector_width = width_prev;
+        jitc_llvm_update_strings();
+    }
+
+    uint32_t width_prev;
+};
+
+/// Re-generate the LLVM IR of the kernel in 'buffer' for another vector width
+static void jitc_assemble_llvm_width(ThreadState *ts, ScheduledGroup group,
+                                     uint32_t width) {
+    /* scope */ {
+        scoped_llvm_vector_width guard(width);
+
+        globals.clear();
+        globals_map.clear();
+        alloca_size = alloca_align = -1;
+        callable_count = 0;
+        callable_count_unique = 0;
+        buffer.clear();
+
+        jitc_llvm_assemble(ts, group);
+        jitc_assemble_hash();
+    }
+
+    jitc_log(Info, "     autotuning: variant %016llx with width %u.",
+             (unsigned long long) kernel_hash.high64, width);
+
+    if (unlikely(kernel_history_entry.backend != JitBackend::Invalid)) {
+        kernel_history_entry.hash[0] = kernel_hash.low64;
+        kernel_history_entry.hash[1] = kernel_hash.high64;
+    }
+
+    if (unlikely(kernel_history_entry.ir)) {
+        free(kernel_history_entry.ir);
+        kernel_history_entry.ir = (char *) malloc_check(buffer.size() + 1);
+        memcpy(kernel_history_entry.ir, buffer.get(), buffer.size() + 1);
+    }
+}
+
+/**
+ * Autotuning: select the vector width of the LLVM kernel in 'buffer', and
+ * re-assemble it if this differs from the default. Returns the autotuning
+ * record and the index of the timed candidate, or \c nullptr once a width
+ * has been pinned.
+ */
+static KernelAutotune *jitc_autotune_select(ThreadState *ts,
+                                            ScheduledGroup group,
+                                            uint32_t &slot) {
+    auto result = state.kernel_autotune.try_emplace(kernel_hash.high64);
+    KernelAutotune &tune = result.first.value();
+
+    if (result.second) {
+        // Candidates: the default width and narrower ones (down to SSE4.2)
+        for (uint32_t w = jitc_llvm_vector_width; w >= 4 && tune.count < 3; w /= 2)
+            tune.width[tune.count++] = w;
+
+        uint32_t width = 0;
+        if (tune.count == 1) {
+            tune.pinned = tune.width[0];
+        } else if (jitc_kernel_autotune_load(kernel_hash, width)) {
+            for (uint32_t i = 0; i < tune.count; ++i) {
+                if (tune.width[i] == width)
+                    tune.pinned = width;
+            }
+        }
+    }
+
+    uint32_t width = tune.pinned;
+    if (!width) {
+        slot = 0;
+        for (uint32_t i = 1; i < tune.count; ++i) {
+            if (tune.launches[i] < tune.launches[slot])
+                slot = i;
+        }
+        width = tune.width[slot];
+    }
+
+    if (width != jitc_llvm_vector_width)
+        jitc_assemble_llvm_width(ts, group, width);
+
+    return tune.pinned ? nullptr : &tune;
+}
+
+/// Autotuning: account for a timed launch, and pin the fastest width when done
+static void jitc_autotune_record(KernelAutotune *tune, uint32_t slot,
+                                 XXH128_hash_t hash, uint32_t size,
+                                 float time_us) {
+    tune->launches[slot]++;
+    tune->time[slot] += time_us * 1e3 / size;
+
+    uint32_t best = 0;
+    for (uint32_t i = 0; i < tune->count; ++i) {
+        if (tune->launches[i] < DRJIT_AUTOTUNE_LAUNCHES)
+            return;
+        if (tune->time[i] < tune->time[best])
+            best = i;
+    }
+
+    tune->pinned = tune->width[best];
+
+    char msg[128];
+    size_t pos = 0;
+    for (uint32_t i = 0; i < tune->count; ++i)
+        pos += snprintf(msg + pos, sizeof(msg) - pos, "%s%u: %.3g ns",
+                        i == 0 ? "" : ", ", tune->width[i],
+                        tune->time[i] / DRJIT_AUTOTUNE_LAUNCHES);
+
+    jitc_log(Info,
+             "jit_autotune(): kernel %016llx uses width %u (per element: %s).",
+             (unsigned long long) hash.high64, tune->pinned, msg);
+
+    jitc_kernel_autotune_write(hash, tune->pinned);
+}
+
 static ProfilerRegion profiler_region_backend_compile("jit_eval: compiling");
 static ProfilerRegion profiler_region_backend_load("jit_eval: loading");
 
 Task *jitc_run(ThreadState *ts, ScheduledGroup group) {
     uint64_t flags = 0;
 
+    /* Autotuning: the kernel may be re-assembled for another vector width.
+       Kernels with callables are excluded, since they upload call tables. */
+    XXH128_hash_t tune_hash = kernel_hash;
+    KernelAutotune *tune = nullptr;
+    uint32_t tune_slot = 0;
+    if (ts->backend == JitBackend::LLVM && callable_count == 0 &&
+        jit_flag(JitFlag::KernelAutotune))
+        tune = jitc_autotune_select(ts, group, tune_slot);
+
 #if defined(DRJIT_ENABLE_OPTIX)
     if (uses_optix) {
         const OptixPipelineCompileOptions &pco = ts->optix_pipeline->compile_options;
@@ -436,7 +648,8 @@ Task *jitc_run(ThreadState *ts, ScheduledGroup group) {
         else
             state.kernel_hard_misses++;
 
-        if (unlikely(jit_flag(JitFlag::KernelHistory))) {
+        if (unlikely(jit_flags() & ((uint32_t) JitFlag::KernelHistory |
+                                    (uint32_t) JitFlag::KernelStats))) {
             kernel_history_entry.cache_disk = cache_hit;
             kernel_history_entry.cache_hit = cache_hit;
             if (!cache_hit)
@@ -449,14 +662,25 @@ Task *jitc_run(ThreadState *ts, ScheduledGroup group) {
     }
     state.kernel_launches++;
 
-    if (unlikely(jit_flag(JitFlag::KernelHistory) &&
-                 ts->backend == JitBackend::CUDA)) {
+    bool history = jit_flag(JitFlag::KernelHistory),
+         stats = jit_flag(JitFlag::KernelStats);
+
+    if (unlikely(history && ts->backend == JitBackend::CUDA)) {
         auto &e = kernel_history_entry;
         cuda_check(cuEventCreate((CUevent *) &e.event_start, CU_EVENT_DEFAULT));
         cuda_check(cuEventCreate((CUevent *) &e.event_end, CU_EVENT_DEFAULT));
         cuda_check(cuEventRecord((CUevent) e.event_start, ts->stream));
     }
 
+    // Separate events/timing record for JitFlag::KernelStats
+    KernelLaunchTiming *stats_timing = nullptr;
+    CUevent stats_event_start = nullptr, stats_event_end = nullptr;
+    if (unlikely(stats && ts->backend == JitBackend::CUDA)) {
+        cuda_check(cuEventCreate(&stats_event_start, CU_EVENT_DEFAULT));
+        cuda_check(cuEventCreate(&stats_event_end, CU_EVENT_DEFAULT));
+        cuda_check(cuEventRecord(stats_event_start, ts->stream));
+    }
+
     Task* ret_task = nullptr;
     if (ts->backend == JitBackend::CUDA) {
 #if defined(DRJIT_ENABLE_OPTIX)
@@ -494,6 +718,12 @@ Task *jitc_run(ThreadState *ts, ScheduledGroup group) {
 
         auto callback = [](uint32_t index, void *ptr) {
             void **params = (void **) ptr;
+            NumaLaunch *numa = (NumaLaunch *) params[4];
+
+            // NUMA mode: process a block whose outputs reside on this node
+            if (unlikely(numa))
+                index = numa->claim();
+
             LLVMKernelFunction kernel = (LLVMKernelFunction) params[0];
             uint32_t size       = (uint32_t) (uintptr_t) params[1],
                      block_size = (uint32_t) ((uintptr_t) params[1] >> 32),
@@ -505,13 +735,34 @@ Task *jitc_run(ThreadState *ts, ScheduledGroup group) {
             __itt_task_begin(drjit_domain, __itt_null, __itt_null,
                              (__itt_string_handle *) params[2]);
 #endif
+            KernelLaunchTiming *timing = (KernelLaunchTiming *) params[3];
+            bool profile = jitc_profile_active.load(std::memory_order_relaxed);
+
             // Perform the main computation
-            kernel(start, end, params);
+            if (unlikely(profile || timing)) {
+                uint64_t time = jitc_profile_time();
+                kernel(start, end, params);
+#if defined(DRJIT_ENABLE_ITTNOTIFY)
+                uint64_t hash = 0;
+#else
+                uint64_t hash = (uint64_t) (uintptr_t) params[2];
+#endif
+                if (profile)
+                    jitc_profile_record(ProfileEventType::Kernel,
+                                        "llvm kernel", time, hash);
+                if (timing)
+                    timing->record(time, jitc_profile_time());
+            } else {
+                kernel(start, end, params);
+            }
 
 #if defined(DRJIT_ENABLE_ITTNOTIFY)
             // Signal termination of kernel
             __itt_task_end(drjit_domain);
 #endif
+
+            if (unlikely(numa))
+                numa->release();
         };
 
         uint32_t block_size = DRJIT_POOL_BLOCK_SIZE,
@@ -523,13 +774,34 @@ Task *jitc_run(ThreadState *ts, ScheduledGroup group) {
 
 #if defined(DRJIT_ENABLE_ITTNOTIFY)
         kernel_params[2] = kernel.llvm.itt;
+#else
+        // Kernel identifier for the built-in tracer
+        kernel_params[2] = (void *) (uintptr_t) kernel_hash.high64;
 #endif
 
+        if (unlikely(stats))
+            stats_timing = new KernelLaunchTiming(blocks);
+        kernel_params[3] = stats_timing;
+
+        kernel_params[4] = nullptr;
+        if (unlikely(jitc_numa && blocks > 1))
+            kernel_params[4] = new NumaLaunch(
+                blocks, block_size, output_isize ? output_isize : 4);
+
         jitc_trace("jit_run(): scheduling %u packet%s in %u block%s ..",
                    packets, packets == 1 ? "" : "s", blocks,
                    blocks == 1 ? "" : "s");
         (void) packets; // jitc_trace may be disabled
 
+        if (unlikely(tune)) {
+            // Wait for preceding work so that only this launch is timed
+            unlock_guard guard(state.lock);
+            task_wait(jitc_task);
+            for (Task *task : scheduled_tasks)
+                task_wait(task);
+            (void) timer();
+        }
+
         ret_task = task_submit_dep(
             nullptr, &jitc_task, 1, blocks,
             callback, kernel_params.data(),
@@ -537,11 +809,26 @@ Task *jitc_run(ThreadState *ts, ScheduledGroup group) {
             nullptr
         );
 
+        if (unlikely(tune)) {
+            /* Unlock while synchronizing */ {
+                unlock_guard guard(state.lock);
+                task_wait(ret_task);
+            }
+            jitc_autotune_record(tune, tune_slot, tune_hash, group.size, timer());
+        }
+
         if (unlikely(jit_flag(JitFlag::LaunchBlocking)))
             task_wait(ret_task);
     }
 
-    if (unlikely(jit_flag(JitFlag::KernelHistory))) {
+    if (unlikely(stats)) {
+        if (ts->backend == JitBackend::CUDA)
+            cuda_check(cuEventRecord(stats_event_end, ts->stream));
+        state.kernel_stats.append(kernel_history_entry, stats_timing,
+                                  stats_event_start, stats_event_end);
+    }
+
+    if (unlikely(history)) {
         if (ts->backend == JitBackend::CUDA) {
             cuda_check(cuEventRecord((CUevent) kernel_history_entry.event_end,
                                      ts->stream));
@@ -556,6 +843,312 @@ Task *jitc_run(ThreadState *ts, ScheduledGroup group) {
     return ret_task;
 }
 
+/// Treatment of values that cross a cut in 'jitc_eval_split()'
+enum class SplitKind : uint8_t {
+    /// Cheap to recompute (literals, lane counters, evaluated arrays, scalars)
+    Replicate,
+
+    /// Written to a temporary array and read by subsequent parts
+    Materialize,
+
+    /// Must not cross a cut (loops, calls, side effects, placeholders, ..)
+    Pinned
+};
+
+/// Invoke 'func(dep, via_extra)' for each dependency of a scheduled variable
+template <typename Func>
+static void jitc_eval_split_deps(uint32_t index, const Variable *v, Func &&func) {
+    for (uint32_t i = 0; i < 4; ++i) {
+        if (!v->dep[i])
+            break;
+        func(v->dep[i], false);
+    }
+
+    const Extra *extra = jitc_var_extra(v, index);
+    if (extra) {
+        for (uint32_t i = 0; i < extra->n_dep; ++i) {
+            if (extra->dep[i])
+                func(extra->dep[i], true);
+        }
+    }
+}
+
+/// Split a single oversized group, returns \c false if no valid cut was found
+static bool jitc_eval_split_group(const ScheduledGroup &group, uint32_t budget) {
+    uint32_t n = group.end - group.start;
+
+    split_pos.clear();
+    for (uint32_t i = 0; i < n; ++i)
+        split_pos[schedule[group.start + i].index] = i;
+
+    split_last_use.resize(n);
+    split_kind.resize(n);
+    split_replicate_ops.resize(n);
+    split_ops.resize(n + 1);
+    split_ops[0] = 0;
+
+    // Classify variables and find the last use of each one within the group
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t index = schedule[group.start + i].index;
+        const Variable *v = jitc_var(index);
+        bool replicate_deps = true;
+        uint32_t replicate_ops = 1;
+
+        split_last_use[i] = i;
+        jitc_eval_split_deps(index, v, [&](uint32_t dep, bool via_extra) {
+            auto it = split_pos.find(dep);
+            if (it == split_pos.end()) {
+                replicate_deps = false;
+                return;
+            }
+            uint32_t j = it->second;
+            split_last_use[j] = i;
+            if (via_extra)
+                split_kind[j] = (uint8_t) SplitKind::Pinned;
+            replicate_deps &= split_kind[j] == (uint8_t) SplitKind::Replicate;
+            replicate_ops += split_replicate_ops[j];
+        });
+
+        bool is_op = !v->is_data() && !v->is_literal();
+
+        /* Scalar computation (and the default mask) can be replicated in
+           other parts as long as the number of replicated operations stays
+           small. This doesn't apply to scalar kernels. */
+        bool replicate = group.size != 1 &&
+                         (v->size == 1 || v->kind == VarKind::DefaultMask) &&
+                         replicate_deps && replicate_ops <= 8;
+
+        split_replicate_ops[i] = 0;
+
+        SplitKind kind;
+        if (!is_op || v->kind == VarKind::Counter) {
+            kind = SplitKind::Replicate;
+            split_replicate_ops[i] = is_op;
+        } else if (v->placeholder || v->extra || v->vcall_iface ||
+                   v->side_effect || (VarType) v->type == VarType::Void ||
+                   v->kind == VarKind::VCallMask ||
+                   v->kind == VarKind::VCallSelf) {
+            kind = SplitKind::Pinned;
+        } else if (replicate) {
+            kind = SplitKind::Replicate;
+            split_replicate_ops[i] = replicate_ops;
+        } else if (v->size == group.size) {
+            kind = SplitKind::Materialize;
+        } else {
+            kind = SplitKind::Pinned;
+        }
+
+        split_kind[i] = (uint8_t) kind;
+        split_ops[i + 1] = split_ops[i] + (uint32_t) is_op;
+    }
+
+    uint32_t total = split_ops[n];
+    if (total <= budget)
+        return false;
+
+    /* Count the values crossing each potential cut 'p' (which starts a new
+       part at position 'p'). Pinned values make a cut invalid, and values
+       that must be materialized (unless they are outputs anyway) add to its
+       cost. */
+    split_bad.assign(n + 1, 0);
+    split_mat.assign(n + 1, 0);
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t j = split_last_use[i];
+        if (j == i)
+            continue;
+
+        SplitKind kind = (SplitKind) split_kind[i];
+        if (kind == SplitKind::Pinned) {
+            split_bad[i + 1]++;
+            split_bad[j + 1]--;
+        } else if (kind == SplitKind::Materialize &&
+                   !jitc_var(schedule[group.start + i].index)->output_flag) {
+            split_mat[i + 1]++;
+            split_mat[j + 1]--;
+        }
+    }
+
+    for (uint32_t p = 1; p <= n; ++p) {
+        split_bad[p] += split_bad[p - 1];
+        split_mat[p] += split_mat[p - 1];
+    }
+
+    /* Place each cut within a window around its ideal position (which yields
+       parts with equal operation counts), choosing the cheapest one */
+    uint32_t parts = (total + budget - 1) / budget;
+    split_cuts.clear();
+    split_cuts.push_back(0);
+
+    for (uint32_t c = 1; c < parts; ++c) {
+        uint32_t target = (uint32_t) ((uint64_t) total * c / parts),
+                 window = std::max(total / (4 * parts), 1u),
+                 lo = target > window ? target - window : 0,
+                 hi = target + window,
+                 prev = split_cuts.back(),
+                 best = 0, best_dist = 0;
+        int32_t best_cost = 0;
+
+        uint32_t p = (uint32_t) (std::lower_bound(split_ops.begin(),
+                                                  split_ops.end(), lo) -
+                                 split_ops.begin());
+
+        for (p = std::max(p, prev + 1); p < n && split_ops[p] <= hi; ++p) {
+            if (split_bad[p] || split_ops[p] == split_ops[prev] ||
+                split_ops[p] == total)
+                continue;
+
+            uint32_t dist = split_ops[p] > target ? split_ops[p] - target
+                                                  : target - split_ops[p];
+
+            if (!best || split_mat[p] < best_cost ||
+                (split_mat[p] == best_cost && dist < best_dist)) {
+                best = p;
+                best_cost = split_mat[p];
+                best_dist = dist;
+            }
+        }
+
+        if (best)
+            split_cuts.push_back(best);
+    }
+
+    if (split_cuts.size() == 1) {
+        jitc_log(Debug, "jit_eval(): could not find a valid place to split a "
+                 "kernel with %u operations.", total);
+        return false;
+    }
+
+    split_cuts.push_back(n);
+    parts = (uint32_t) split_cuts.size() - 1;
+
+    // Values crossing a cut become outputs of the part that computes them
+    uint32_t temporaries = 0;
+    for (uint32_t i = 0, q = 0; i < n; ++i) {
+        while (i >= split_cuts[q + 1])
+            ++q;
+
+        if (split_kind[i] != (uint8_t) SplitKind::Materialize ||
+            split_last_use[i] < split_cuts[q + 1])
+            continue;
+
+        Variable *v = jitc_var(schedule[group.start + i].index);
+        if (!v->output_flag) {
+            v->output_flag = true;
+            temporaries++;
+        }
+    }
+
+    jitc_log(Info,
+             "jit_eval(): splitting kernel (n=%u, ops=%u) into %u parts, "
+             "materializing %u temporar%s.", group.size, total, parts,
+             temporaries, temporaries == 1 ? "y" : "ies");
+
+    split_mark.assign(n, 0);
+    split_new_pos.resize(n);
+
+    for (uint32_t q = 0; q < parts; ++q) {
+        uint32_t begin = split_cuts[q], end = split_cuts[q + 1],
+                 start = (uint32_t) split_schedule.size();
+
+        if (q > 0) {
+            // Collect values from preceding parts that are used by this one
+            split_need.clear();
+            auto need = [&](uint32_t dep, bool) {
+                auto it = split_pos.find(dep);
+                if (it == split_pos.end())
+                    return;
+                uint32_t j = it->second;
+                if (j < begin && split_mark[j] != q) {
+                    split_mark[j] = q;
+                    split_need.push_back(j);
+                }
+            };
+
+            for (uint32_t i = begin; i < end; ++i) {
+                uint32_t index = schedule[group.start + i].index;
+                jitc_eval_split_deps(index, jitc_var(index), need);
+            }
+
+            // Replicated values may in turn need other replicated values
+            for (size_t k = 0; k < split_need.size(); ++k) {
+                uint32_t j = split_need[k];
+                if (split_kind[j] != (uint8_t) SplitKind::Replicate)
+                    continue;
+                uint32_t index = schedule[group.start + j].index;
+                jitc_eval_split_deps(index, jitc_var(index), need);
+            }
+
+            std::sort(split_need.begin(), split_need.end());
+
+            for (uint32_t j : split_need) {
+                if (split_kind[j] == (uint8_t) SplitKind::Materialize)
+                    split_links.emplace_back((uint32_t) split_schedule.size(),
+                                             split_new_pos[j]);
+                split_schedule.push_back(schedule[group.start + j]);
+            }
+        }
+
+        for (uint32_t i = begin; i < end; ++i) {
+            split_new_pos[i] = (uint32_t) split_schedule.size();
+            split_schedule.push_back(schedule[group.start + i]);
+        }
+
+        split_groups.emplace_back(group.size, start,
+                                  (uint32_t) split_schedule.size(), q > 0);
+    }
+
+    return true;
+}
+
+/**
+ * \brief Partition kernels that exceed the operation budget set via
+ * \ref jit_set_kernel_op_budget()
+ *
+ * The compilation time of very large kernels grows superlinearly, and
+ * register pressure causes heavy spilling. This function cuts each oversized
+ * group of 'schedule' (which is topologically ordered) into consecutive parts
+ * with similar operation counts that are launched one after the other.
+ *
+ * Values crossing a cut are either replicated in the next part (when they are
+ * cheap to recompute) or written to a temporary array by the part computing
+ * them. Cut positions that minimize the number of such temporaries are
+ * preferred, and cuts through constructs that can't be separated (recorded
+ * loops, calls, ..) are avoided altogether.
+ */
+static void jitc_eval_split() {
+    uint32_t budget = jitc_kernel_op_budget;
+
+    bool oversized = false;
+    for (const ScheduledGroup &group : schedule_groups)
+        oversized |= group.end - group.start > budget;
+    if (!oversized)
+        return;
+
+    split_schedule.clear();
+    split_groups.clear();
+
+    bool changed = false;
+    for (const ScheduledGroup &group : schedule_groups) {
+        if (group.end - group.start > budget &&
+            jitc_eval_split_group(group, budget)) {
+            changed = true;
+            continue;
+        }
+
+        uint32_t start = (uint32_t) split_schedule.size();
+        split_schedule.insert(split_schedule.end(),
+                              schedule.begin() + group.start,
+                              schedule.begin() + group.end);
+        split_groups.emplace_back(group.size, start,
+                                  (uint32_t) split_schedule.size());
+    }
+
+    if (changed) {
+        schedule.swap(split_schedule);
+        schedule_groups.swap(split_groups);
+    }
+}
+
 static ProfilerRegion profiler_region_eval("jit_eval");
 
 /// Evaluate all computation that is queued on the given ThreadState
@@ -577,12 +1170,17 @@ void jitc_eval(ThreadState *ts) {
     lock_guard guard(state.eval_lock);
     lock_acquire(state.lock);
 
+    struct EvalActive {
+        EvalActive() { jitc_eval_active = true; }
+        ~EvalActive() { jitc_eval_active = false; }
+    } eval_active;
+
     jitc_var_loop_simplify();
 
-    visited.clear();
     schedule.clear();
+    schedule_roots.clear();
 
-    // Collect variables that must be computed along with their dependencies
+    // Collect variables that must be computed
     for (int j = 0; j < 2; ++j) {
         auto &source = j == 0 ? ts->scheduled : ts->side_effects;
         for (size_t i = 0; i < source.size(); ++i) {
@@ -591,19 +1189,39 @@ void jitc_eval(ThreadState *ts) {
             if (it == state.variables.end())
                 continue;
 
-            Variable *v = &it.value();
+            const Variable *v = &it.value();
 
             // Skip variables that are already evaluated
             if (v->is_data())
                 continue;
 
-            jitc_var_traverse(v->size, index);
-            v->output_flag = (VarType) v->type != VarType::Void;
+            schedule_roots.emplace_back(v->size, v->scope, index);
         }
 
         source.clear();
     }
 
+    /* Traverse their dependencies, one size at a time. A variable can be
+       needed by kernels of different sizes, hence each size gets its own
+       traversal epoch. Within a size, the order of requests is preserved. */
+    std::stable_sort(
+        schedule_roots.begin(), schedule_roots.end(),
+        [](const ScheduledVariable &a, const ScheduledVariable &b) {
+            return a.size > b.size;
+        });
+
+    for (size_t i = 0; i < schedule_roots.size(); ++i) {
+        const ScheduledVariable &sv = schedule_roots[i];
+        if (i == 0 || sv.size != schedule_roots[i - 1].size)
+            jitc_var_visit_epoch();
+        jitc_var_traverse(sv.size, sv.index);
+    }
+
+    for (const ScheduledVariable &sv : schedule_roots) {
+        Variable *v = jitc_var(sv.index);
+        v->output_flag = (VarType) v->type != VarType::Void;
+    }
+
     if (schedule.empty())
         return;
 
@@ -641,6 +1259,10 @@ void jitc_eval(ThreadState *ts) {
                                      cur, (uint32_t) schedule.size());
     }
 
+    split_links.clear();
+    if (jitc_kernel_op_budget)
+        jitc_eval_split();
+
     jitc_log(Info, "jit_eval(): launching %zu kernel%s.",
             schedule_groups.size(),
             schedule_groups.size() == 1 ? "" : "s");
@@ -648,10 +1270,23 @@ void jitc_eval(ThreadState *ts) {
     scoped_set_context_maybe guard2(ts->context);
     scheduled_tasks.clear();
 
+    size_t link = 0;
     for (ScheduledGroup &group : schedule_groups) {
+        // Temporaries computed by preceding parts of a split kernel
+        for (; link < split_links.size() && split_links[link].first < group.end; ++link)
+            schedule[split_links[link].first].data =
+                schedule[split_links[link].second].data;
+
         jitc_assemble(ts, group);
 
+        /* Parts of a split kernel must wait for their predecessor (this is
+           implicit on the CUDA backend, which uses a single stream) */
+        Task *jitc_task_prev = jitc_task;
+        if (group.chained && ts->backend == JitBackend::LLVM)
+            jitc_task = scheduled_tasks.back();
+
         scheduled_tasks.push_back(jitc_run(ts, group));
+        jitc_task = jitc_task_prev;
 
         if (ts->backend == JitBackend::CUDA) {
             jitc_free(kernel_params_global);
@@ -757,16 +1392,16 @@ jitc_assemble_func(ThreadState *ts, const char *name, uint32_t inst_id,
                    const uint32_t *se, bool use_self) {
     ProfilerPhase profiler(profiler_region_assemble_func);
 
-    visited.clear();
     schedule.clear();
+    uint32_t epoch = jitc_var_visit_epoch();
 
     for (uint32_t i = 0; i < n_in; ++i) {
         if (in[i] == 0)
             continue;
 
-        const Variable *v = jitc_var(in[i]);
+        Variable *v = jitc_var(in[i]);
         if (!v->is_literal())
-            visited.emplace(1, in[i]);
+            v->visit_epoch = epoch;
     }
 
     auto traverse = [](uint32_t index) {
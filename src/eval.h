@@ -11,6 +11,7 @@
 
 #include "internal.h"
 #include "strbuf.h"
+#include "var.h"
 #include <map>
 
 /// A single variable that is scheduled to execute for a launch with 'size' entries
@@ -30,8 +31,13 @@ struct ScheduledGroup {
     uint32_t start;
     uint32_t end;
 
-    ScheduledGroup(uint32_t size, uint32_t start, uint32_t end)
-        : size(size), start(start), end(end) { }
+    /// Part of a kernel that was split by \ref jitc_eval_split()? Then it
+    /// depends on the outputs of the preceding group.
+    bool chained;
+
+    ScheduledGroup(uint32_t size, uint32_t start, uint32_t end,
+                   bool chained = false)
+        : size(size), start(start), end(end), chained(chained) { }
 };
 
 struct GlobalKey {
@@ -97,6 +103,78 @@ extern std::vector<ScheduledVariable> schedule;
 /// Groups of variables with the same size
 extern std::vector<ScheduledGroup> schedule_groups;
 
+/// Maximum number of operations per kernel (0: unlimited), see jit_set_kernel_op_budget()
+extern uint32_t jitc_kernel_op_budget;
+
+/// Is jitc_eval() currently running on this thread? (suppresses automatic evaluation)
+extern thread_local bool jitc_eval_active;
+
+/// Stack entry of the iterative graph traversal in \ref jitc_var_dfs()
+struct VisitFrame {
+    uint32_t index;
+    uint32_t pos;
+    Variable *v;
+    const Extra *extra;
+};
+
+/// Explicit stack used by \ref jitc_var_dfs()
+extern std::vector<VisitFrame> visit_stack;
+
+/// Start a new graph traversal and return a fresh 'Variable::visit_epoch' value
+extern uint32_t jitc_var_visit_epoch();
+
+/// Return the 'Extra' record of a variable, or \c nullptr if there is none
+extern const Extra *jitc_var_extra(const Variable *v, uint32_t index);
+
+/**
+ * \brief Iterative depth-first traversal of the computation graph
+ *
+ * Invokes <tt>enter(index, v)</tt> when reaching a variable, starting with
+ * \c index. If this returns \c true, the dependencies of the variable
+ * ('Variable::dep' up to the first zero entry, followed by the nonzero entries
+ * of its 'Extra' record) are traversed, followed by a
+ * call to <tt>leave(index, v)</tt>. The callbacks are responsible for
+ * detecting previously visited variables, e.g. using 'Variable::visit_epoch'.
+ *
+ * The traversal uses an explicit stack so that very deep graphs cannot
+ * overflow the call stack.
+ */
+template <typename Enter, typename Leave>
+void jitc_var_dfs(uint32_t index, Enter &&enter, Leave &&leave) {
+    Variable *v = jitc_var(index);
+    if (!enter(index, v))
+        return;
+
+    std::vector<VisitFrame> &stack = visit_stack;
+    stack.clear();
+    stack.push_back({ index, 0, v, jitc_var_extra(v, index) });
+
+    while (!stack.empty()) {
+        VisitFrame &f = stack.back();
+        uint32_t n_dep = 4 + (f.extra ? f.extra->n_dep : 0),
+                 index_2 = 0;
+
+        while (f.pos < n_dep && !index_2) {
+            if (f.pos < 4) {
+                index_2 = f.v->dep[f.pos++];
+                if (!index_2) // dependency list ends here
+                    f.pos = 4;
+            } else {
+                index_2 = f.extra->dep[f.pos++ - 4];
+            }
+        }
+
+        if (index_2) {
+            Variable *v2 = jitc_var(index_2);
+            if (enter(index_2, v2))
+                stack.push_back({ index_2, 0, v2, jitc_var_extra(v2, index_2) });
+        } else {
+            leave(f.index, f.v);
+            stack.pop_back();
+        }
+    }
+}
+
 /// Evaluate all computation that is queued on the current thread
 extern void jitc_eval(ThreadState *ts);
 
@@ -0,0 +1,93 @@
+/*
+    src/half.h -- Host-side IEEE 754 half precision type used to constant-fold
+    and reduce VarType::Float16 values
+
+    Copyright (c) 2021 Wenzel Jakob <wenzel.jakob@epfl.ch>
+
+    All rights reserved. Use of this source code is governed by a BSD-style
+    license that can be found in the LICENSE file.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+/// Convert a single precision value to half precision (round to nearest even)
+inline uint16_t jitc_float_to_half(float value) {
+    const uint32_t f32_inf = 255u << 23, f16_max = (127u + 16u) << 23,
+                   denorm_magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+    uint32_t u;
+    memcpy(&u, &value, sizeof(uint32_t));
+
+    uint32_t sign = u & 0x80000000u;
+    u ^= sign;
+
+    uint16_t result;
+    if (u >= f16_max) {
+        // Overflow to infinity, NaNs are mapped to a quiet NaN
+        result = u > f32_inf ? 0x7e00 : 0x7c00;
+    } else if (u < (113u << 23)) {
+        // Denormalized result: let the FPU perform the rounding
+        float f, magic;
+        memcpy(&f, &u, sizeof(float));
+        memcpy(&magic, &denorm_magic, sizeof(float));
+        f += magic;
+        memcpy(&u, &f, sizeof(uint32_t));
+        result = (uint16_t) (u - denorm_magic);
+    } else {
+        uint32_t mant_odd = (u >> 13) & 1;
+        u += ((15u - 127u) << 23) + 0xfff + mant_odd;
+        result = (uint16_t) (u >> 13);
+    }
+
+    return (uint16_t) (result | (sign >> 16));
+}
+
+/// Convert a half precision value to single precision (exact)
+inline float jitc_half_to_float(uint16_t value) {
+    const uint32_t shifted_exp = 0x7c00u << 13, magic = 113u << 23;
+
+    uint32_t u = (uint32_t) (value & 0x7fff) << 13,
+             exp = u & shifted_exp;
+    u += (127u - 15u) << 23;
+
+    if (exp == shifted_exp) {
+        // Infinity or NaN
+        u += (128u - 16u) << 23;
+    } else if (exp == 0) {
+        // Zero or denormalized value: renormalize via the FPU
+        float f, m;
+        u += 1u << 23;
+        memcpy(&f, &u, sizeof(float));
+        memcpy(&m, &magic, sizeof(float));
+        f -= m;
+        memcpy(&u, &f, sizeof(uint32_t));
+    }
+
+    u |= (uint32_t) (value & 0x8000) << 16;
+
+    float result;
+    memcpy(&result, &u, sizeof(float));
+    return result;
+}
+
+/**
+ * \brief Minimal half precision type
+ *
+ * Arithmetic involving this type is performed in single precision (via the
+ * implicit conversion to \c float), and assigning the result rounds it back
+ * to half precision.
+ */
+struct half {
+    uint16_t value;
+
+    half() = default;
+    half(float f) : value(jitc_float_to_half(f)) { }
+
+    operator float() const { return jitc_half_to_float(value); }
+
+    half &operator+=(float f) { return *this = half(float(*this) + f); }
+    half &operator*=(float f) { return *this = half(float(*this) * f); }
+};
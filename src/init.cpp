@@ -15,6 +15,8 @@
 #include "var.h"
 #include "profiler.h"
 #include <sys/stat.h>
+#include <algorithm>
+#include <cmath>
 
 #if defined(DRJIT_ENABLE_OPTIX)
 #  include "optix_api.h"
@@ -56,7 +58,11 @@ static_assert(
     "VariableKey: incorrect size, likely an issue with padding/packing!");
 
 static_assert(
-    sizeof(tsl::detail_robin_hash::bucket_entry<VariableMap::value_type, false>) == 64,
+    sizeof(Variable) == 15 * sizeof(uint32_t),
+    "Variable: incorrect size, likely an issue with padding/packing!");
+
+static_assert(
+    sizeof(tsl::detail_robin_hash::bucket_entry<VariableMap::value_type, false>) == 68,
     "VariableMap: incorrect bucket size, likely an issue with padding/packing!");
 
 static ProfilerRegion profiler_region_init("jit_init");
@@ -184,7 +190,9 @@ void jitc_shutdown(int light) {
         state.kernel_cache.clear();
     }
 
+    state.kernel_autotune.clear();
     state.kernel_history.clear();
+    state.kernel_stats.release();
 
     // CUDA: Try to already free some memory asynchronously (faster)
     if (thread_state_cuda && thread_state_cuda->memory_pool) {
@@ -631,12 +639,34 @@ KernelHistory::KernelHistory() : m_data(nullptr), m_size(0), m_capacity(0) { }
 
 KernelHistory::~KernelHistory() { free(m_data); }
 
+/// Release the CUDA events/task handle and IR of a kernel history entry
+static void jitc_kernel_history_release(KernelHistoryEntry &k) {
+    if (k.backend == JitBackend::CUDA) {
+        cuEventDestroy((CUevent) k.event_start);
+        cuEventDestroy((CUevent) k.event_end);
+    } else {
+        task_release((Task *) k.task);
+    }
+    free(k.ir);
+}
+
 void KernelHistory::append(const KernelHistoryEntry &value) {
+    if (m_limit && m_size == m_limit) {
+        // Ring buffer mode: overwrite the oldest entry
+        KernelHistoryEntry &k = m_data[m_start];
+        jitc_kernel_history_release(k);
+        k = value;
+        m_start = (m_start + 1) % m_limit;
+        return;
+    }
+
     /* Expand kernel history buffer if necessary. There should always be
        enough memory for an additional end-of-list marker at the end */
 
     if (m_size + 2 > m_capacity) {
         m_capacity = (m_size + 2) * 2;
+        if (m_limit && m_capacity > m_limit + 1)
+            m_capacity = m_limit + 1;
         void *tmp = malloc_check(m_capacity * sizeof(KernelHistoryEntry));
         memcpy(tmp, m_data, m_size * sizeof(KernelHistoryEntry));
         free(m_data);
@@ -650,6 +680,9 @@ void KernelHistory::append(const KernelHistoryEntry &value) {
 KernelHistoryEntry *KernelHistory::get() {
     KernelHistoryEntry *data = m_data;
 
+    // Restore chronological order of a wrapped ring buffer
+    std::rotate(data, data + m_start, data + m_size);
+
     for (size_t i = 0; i < m_size; i++) {
         KernelHistoryEntry &k = data[i];
         if (k.backend == JitBackend::CUDA) {
@@ -667,7 +700,7 @@ KernelHistoryEntry *KernelHistory::get() {
     }
 
     m_data = nullptr;
-    m_size = m_capacity = 0;
+    m_size = m_capacity = m_start = 0;
 
     return data;
 }
@@ -676,17 +709,168 @@ void KernelHistory::clear() {
     if (m_size == 0)
         return;
 
-    for (size_t i = 0; i < m_size; i++) {
-        KernelHistoryEntry &k = m_data[i];
-        if (k.backend == JitBackend::CUDA) {
-            cuEventDestroy((CUevent) k.event_start);
-            cuEventDestroy((CUevent) k.event_end);
+    for (size_t i = 0; i < m_size; i++)
+        jitc_kernel_history_release(m_data[i]);
+
+    free(m_data);
+    m_data = nullptr;
+    m_size = m_capacity = m_start = 0;
+}
+
+void KernelHistory::configure(size_t limit, bool store_ir) {
+    if (limit && (m_start != 0 || m_size > limit || m_capacity > limit + 1))
+        clear();
+    m_limit = limit;
+    m_store_ir = store_ir;
+}
+
+/// ==========================================================================
+
+/// Map a runtime to a bin of the logarithmic histogram (ratio sqrt(2), starting at 1 us)
+static uint32_t jitc_kernel_stats_bin(uint64_t time_ns) {
+    double us = (double) time_ns * 1e-3;
+    if (us <= 1.0)
+        return 0;
+    return std::min((uint32_t) (2.0 * std::log2(us)),
+                    (uint32_t) DRJIT_KERNEL_STATS_BINS - 1);
+}
+
+/// Estimate a percentile (ms) using the geometric center of a histogram bin
+static float jitc_kernel_stats_percentile(const KernelStatsRecord &r, double q) {
+    const KernelStats &s = r.stats;
+    uint64_t rank = (uint64_t) std::ceil(q * (double) s.timed_launches),
+             sum = 0;
+    if (rank == 0)
+        rank = 1;
+    for (uint32_t i = 0; i < DRJIT_KERNEL_STATS_BINS; ++i) {
+        sum += r.histogram[i];
+        if (sum >= rank) {
+            float ms = (float) (std::exp2((i + .5) * .5) * 1e-3);
+            return std::max(s.execution_time_min,
+                            std::min(s.execution_time_max, ms));
+        }
+    }
+    return s.execution_time_max;
+}
+
+void KernelStatsTable::append(const KernelHistoryEntry &e,
+                              KernelLaunchTiming *timing, void *event_start,
+                              void *event_end) {
+    uint64_t key = e.type == KernelType::JIT
+                       ? e.hash[1]
+                       : (((uint64_t) e.backend) << 32) | (uint64_t) e.type;
+
+    auto result = m_records.try_emplace(key);
+    KernelStats &s = result.first.value().stats;
+    if (result.second) {
+        s.backend = e.backend;
+        s.type = e.type;
+        s.hash[0] = e.hash[0];
+        s.hash[1] = e.hash[1];
+    }
+
+    s.launches++;
+    if (e.type == KernelType::JIT) {
+        if (e.cache_hit && !e.cache_disk)
+            s.cache_hits++;
+        else
+            s.cache_misses++;
+    }
+    s.size += e.size;
+    s.codegen_time += e.codegen_time;
+    s.backend_time += e.backend_time;
+
+    m_pending.push_back(Pending{ key, timing, event_start, event_end });
+    harvest();
+}
+
+void KernelStatsTable::harvest() {
+    size_t j = 0;
+    for (size_t i = 0; i < m_pending.size(); ++i) {
+        Pending &p = m_pending[i];
+        uint64_t time_ns;
+
+        if (p.timing) {
+            if (p.timing->blocks_left.load(std::memory_order_acquire) != 0) {
+                m_pending[j++] = p;
+                continue;
+            }
+            time_ns = p.timing->end.load(std::memory_order_relaxed) -
+                      p.timing->start.load(std::memory_order_relaxed);
+            delete p.timing;
         } else {
-            task_release((Task *) k.task);
+            float ms = 0.f;
+            if (cuEventElapsedTime(&ms, (CUevent) p.event_start,
+                                   (CUevent) p.event_end) != CUDA_SUCCESS) {
+                m_pending[j++] = p;
+                continue;
+            }
+            cuEventDestroy((CUevent) p.event_start);
+            cuEventDestroy((CUevent) p.event_end);
+            time_ns = (uint64_t) ((double) ms * 1e6);
         }
+
+        auto it = m_records.find(p.key);
+        if (p.key == 0 || it == m_records.end())
+            continue; // discarded by clear()
+
+        KernelStatsRecord &r = it.value();
+        KernelStats &s = r.stats;
+        float ms = (float) ((double) time_ns * 1e-6);
+        if (s.timed_launches == 0) {
+            s.execution_time_min = s.execution_time_max = ms;
+        } else {
+            s.execution_time_min = std::min(s.execution_time_min, ms);
+            s.execution_time_max = std::max(s.execution_time_max, ms);
+        }
+        s.timed_launches++;
+        r.time_ns += time_ns;
+        r.histogram[jitc_kernel_stats_bin(time_ns)]++;
     }
+    m_pending.resize(j);
+}
 
-    free(m_data);
-    m_data = nullptr;
-    m_size = m_capacity = 0;
+KernelStats *KernelStatsTable::get(size_t *count) {
+    harvest();
+
+    *count = m_records.size();
+    if (m_records.empty())
+        return nullptr;
+
+    KernelStats *result =
+        (KernelStats *) malloc_check(m_records.size() * sizeof(KernelStats));
+
+    size_t i = 0;
+    for (auto &kv : m_records) {
+        const KernelStatsRecord &r = kv.second;
+        KernelStats &s = result[i++];
+        s = r.stats;
+        s.execution_time = (float) ((double) r.time_ns * 1e-6);
+        if (s.timed_launches) {
+            s.execution_time_p50 = jitc_kernel_stats_percentile(r, .5);
+            s.execution_time_p99 = jitc_kernel_stats_percentile(r, .99);
+        }
+    }
+
+    return result;
+}
+
+void KernelStatsTable::clear() {
+    m_records.clear();
+    for (Pending &p : m_pending)
+        p.key = 0;
+    harvest();
+}
+
+void KernelStatsTable::release() {
+    for (Pending &p : m_pending) {
+        if (p.timing) {
+            delete p.timing;
+        } else {
+            cuEventDestroy((CUevent) p.event_start);
+            cuEventDestroy((CUevent) p.event_end);
+        }
+    }
+    m_pending.clear();
+    m_records.clear();
 }
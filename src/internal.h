@@ -15,6 +15,7 @@
 #include "llvm.h"
 #include "alloc.h"
 #include "io.h"
+#include <atomic>
 #include <deque>
 #include <string.h>
 #include <inttypes.h>
@@ -26,6 +27,9 @@
 /// Can't pass more than 4096 bytes of parameter data to a CUDA kernel
 #define DRJIT_CUDA_ARG_LIMIT 512
 
+/// Number of timed launches per vector width when autotuning LLVM kernels
+#define DRJIT_AUTOTUNE_LAUNCHES 3
+
 #define DRJIT_PTR "<0x%" PRIxPTR ">"
 
 enum VarKind : uint32_t {
@@ -105,7 +109,7 @@ enum VarKind : uint32_t {
     // A polymorphic function call
     Dispatch,
 
-    // Perform a standard texture lookup (CUDA)
+    // Perform a standard texture lookup (CUDA, LLVM)
     TexLookup,
 
     // Load all texels used for bilinear interpolation (CUDA)
@@ -245,6 +249,19 @@ struct Variable {
     /// Number of queued side effects
     uint32_t ref_count_se;
 
+    // ==========================  Graph traversal  ===========================
+
+    /**
+     * \brief Epoch of the last graph traversal that reached this variable
+     *
+     * Traversals (e.g. in jitc_eval()) obtain a fresh epoch via
+     * jitc_var_visit_epoch() and compare it against this field instead of
+     * recording visited variables in a hash set. It is stored here (growing
+     * 'Variable' from 56 to 60 bytes) so that 'unused' remains reserved for
+     * 64 bit array sizes.
+     */
+    uint32_t visit_epoch;
+
     // =========================   Helper functions   ==========================
 
     bool is_data()    const { return kind == (uint32_t) VarKind::Data;    }
@@ -473,6 +490,15 @@ struct ThreadState {
     /// .. and the JIT variable that it will be mapped to
     uint32_t vcall_self_index = 0;
 
+    /**
+     * Estimated number of unevaluated operations, which triggers automatic
+     * evaluation when it exceeds \ref jitc_auto_eval_threshold
+     */
+    uint32_t trace_size = 0;
+
+    /// Unevaluated variables created by this thread (while the above is enabled)
+    std::vector<uint32_t> trace_vars;
+
     /// ---------------------------- CUDA-specific ----------------------------
 
     /// Redundant copy of the device context
@@ -558,12 +584,115 @@ struct KernelHistory {
     KernelHistoryEntry *get();
     void clear();
 
+    /// Retain at most 'limit' entries (0: unbounded), optionally without IR
+    void configure(size_t limit, bool store_ir);
+
+    /// Should entries include a copy of the kernel IR?
+    bool store_ir() const { return m_store_ir; }
+
 private:
     KernelHistoryEntry *m_data;
     size_t m_size;
     size_t m_capacity;
+
+    /// Ring buffer mode: maximum size, and index of the oldest entry
+    size_t m_limit = 0;
+    size_t m_start = 0;
+    bool m_store_ir = true;
+};
+
+/// Number of logarithmic histogram bins used to estimate kernel runtime percentiles
+#define DRJIT_KERNEL_STATS_BINS 64
+
+/**
+ * \brief Execution time of an LLVM kernel launch or parallel CPU task
+ *
+ * The worker threads processing the blocks of the launch update this record,
+ * which allows \ref KernelStatsTable to query the runtime without waiting.
+ */
+struct KernelLaunchTiming {
+    std::atomic<uint64_t> start { UINT64_MAX };
+    std::atomic<uint64_t> end { 0 };
+    std::atomic<uint32_t> blocks_left;
+
+    KernelLaunchTiming(uint32_t blocks) : blocks_left(blocks) { }
+
+    /// Called by a worker thread after processing a block
+    void record(uint64_t block_start, uint64_t block_end) {
+        uint64_t value = start.load(std::memory_order_relaxed);
+        while (block_start < value &&
+               !start.compare_exchange_weak(value, block_start,
+                                            std::memory_order_relaxed))
+            ;
+        value = end.load(std::memory_order_relaxed);
+        while (block_end > value &&
+               !end.compare_exchange_weak(value, block_end,
+                                          std::memory_order_relaxed))
+            ;
+        blocks_left.fetch_sub(1, std::memory_order_release);
+    }
+};
+
+/// Aggregated statistics of launches of a kernel (or of a class of CPU tasks)
+struct KernelStatsRecord {
+    KernelStats stats;
+    uint64_t time_ns;
+    uint32_t histogram[DRJIT_KERNEL_STATS_BINS];
+};
+
+/// Per-kernel launch statistics, see \ref JitFlag::KernelStats
+struct KernelStatsTable {
+    ~KernelStatsTable() { release(); }
+
+    /// Account for a kernel launch whose runtime is measured by 'timing' (LLVM) or a pair of CUDA events
+    void append(const KernelHistoryEntry &entry, KernelLaunchTiming *timing,
+                void *event_start, void *event_end);
+
+    /// Return a copy of the table (to be released via free())
+    KernelStats *get(size_t *count);
+
+    /// Reset all statistics
+    void clear();
+
+    /// Release all resources, requires that no launches are pending
+    void release();
+
+private:
+    /// Fold the runtime of completed launches into the table (never blocks)
+    void harvest();
+
+    struct Pending {
+        uint64_t key;
+        KernelLaunchTiming *timing;
+        void *event_start, *event_end;
+    };
+
+    tsl::robin_map<uint64_t, KernelStatsRecord, UInt64Hasher> m_records;
+    std::vector<Pending> m_pending;
 };
 
+/// Autotuning state of an LLVM kernel that is compiled for several vector widths
+struct KernelAutotune {
+    /// Candidate vector widths, starting with the default one
+    uint32_t width[3] { };
+
+    /// Number of candidates
+    uint32_t count = 0;
+
+    /// Number of timed launches of each candidate
+    uint32_t launches[3] { };
+
+    /// Accumulated launch time per element (in nanoseconds)
+    double time[3] { };
+
+    /// Selected vector width, or zero while still autotuning
+    uint32_t pinned = 0;
+};
+
+/// Maps from the hash of a kernel (compiled for the default width) to its autotuning state
+using KernelAutotuneMap =
+    tsl::robin_map<uint64_t, KernelAutotune, UInt64Hasher>;
+
 // Key associated with a pointer registered in DrJit's pointer registry
 struct RegistryKey {
     const char *domain;
@@ -657,7 +786,7 @@ struct State {
     /// Must be held to access members
     Lock lock;
 
-    /// Must be held to access 'state.alloc_free'
+    /// Must be held to access 'state.alloc_free' and 'state.alloc_free_epoch'
     Lock alloc_free_lock;
 
     /// Stores the mapping from variable indices to variables
@@ -704,6 +833,25 @@ struct State {
            alloc_allocated[(int) AllocType::Count] { 0 },
            alloc_watermark[(int) AllocType::Count] { 0 };
 
+    /// Memory budget per allocation type (0: unlimited), see jit_malloc_set_budget()
+    size_t alloc_budget[(int) AllocType::Count] { 0 };
+
+    /// Cached bytes released via madvise(MADV_FREE), these don't count toward the budget
+    size_t alloc_lazy[(int) AllocType::Count] { 0 };
+
+    /// Cached host allocations that were released via madvise(MADV_FREE)
+    AllocLazySet alloc_lazy_set;
+
+    /// Is a memory budget set? Enables the bookkeeping below.
+    bool alloc_budget_active = false;
+
+    /// Counter and time of the most recent use of each class of 'alloc_free'
+    uint64_t alloc_epoch = 0;
+    AllocEpochMap alloc_free_epoch;
+
+    /// Attributes allocations to prefixes and kernels, see jit_alloc_profile_start()
+    AllocProfiler alloc_profile;
+
     /// Keep track of the number of created JIT variables
     uint32_t variable_watermark = 0;
 
@@ -725,9 +873,15 @@ struct State {
     /// Cache of previously compiled kernels
     KernelCache kernel_cache;
 
+    /// Vector width selection of autotuned LLVM kernels
+    KernelAutotuneMap kernel_autotune;
+
     /// Kernel launch history
     KernelHistory kernel_history = KernelHistory();
 
+    /// Per-kernel launch statistics
+    KernelStatsTable kernel_stats;
+
 #if defined(DRJIT_ENABLE_OPTIX)
     /// Default OptiX pipeline for testcases etc.
     OptixPipelineData *optix_default_pipeline = nullptr;
@@ -873,6 +1027,7 @@ inline bool jitc_is_float(VarType type) {
            type == VarType::Float64;
 }
 
+inline bool jitc_is_half(VarType type) { return type == VarType::Float16; }
 inline bool jitc_is_single(VarType type) { return type == VarType::Float32; }
 inline bool jitc_is_double(VarType type) { return type == VarType::Float64; }
 inline bool jitc_is_bool(VarType type) { return type == VarType::Bool; }
@@ -901,6 +1056,7 @@ inline bool jitc_is_void(VarType type) {
 
 inline bool jitc_is_arithmetic(const Variable *v) { return jitc_is_arithmetic((VarType) v->type); }
 inline bool jitc_is_float(const Variable *v) { return jitc_is_float((VarType) v->type); }
+inline bool jitc_is_half(const Variable *v) { return jitc_is_half((VarType) v->type); }
 inline bool jitc_is_single(const Variable *v) { return jitc_is_single((VarType) v->type); }
 inline bool jitc_is_double(const Variable *v) { return jitc_is_double((VarType) v->type); }
 inline bool jitc_is_sint(const Variable *v) { return jitc_is_sint((VarType) v->type); }
@@ -1,5 +1,5 @@
 /*
-    src/io.cpp -- Disk cache for LLVM/CUDA kernels
+    src/io.cpp -- Disk cache for LLVM/CUDA kernels, serialization of arrays
 
     Copyright (c) 2021 Wenzel Jakob <wenzel.jakob@epfl.ch>
 
@@ -13,15 +13,20 @@
 #include "profiler.h"
 #include "cuda.h"
 #include "optix.h"
+#include "var.h"
+#include "malloc.h"
+#include "util.h"
 #include "../resources/kernels.h"
 #include <stdexcept>
 #include <stdio.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <lz4.h>
+#include <memory>
 
 #if defined(_WIN32)
 #  include <windows.h>
+#  include <io.h>
 #else
 #  include <unistd.h>
 #  include <sys/mman.h>
@@ -441,6 +446,67 @@ bool jitc_kernel_write(const char *source, uint32_t source_size,
     return success;
 }
 
+#pragma pack(push)
+#pragma pack(1)
+struct AutotuneFileRecord {
+    uint8_t version;
+    uint32_t width;
+};
+#pragma pack(pop)
+
+/// Open the file storing the autotuning result of an LLVM kernel
+static FILE *jitc_kernel_autotune_open(XXH128_hash_t hash, bool write) {
+#if !defined(_WIN32)
+    char filename[512];
+    if (unlikely(snprintf(filename, sizeof(filename), "%s/%016llx%016llx.llvm.tune",
+                          jitc_temp_path, (unsigned long long) hash.high64,
+                          (unsigned long long) hash.low64) < 0))
+        jitc_fail("jit_kernel_autotune(): scratch space for filename insufficient!");
+    return fopen(filename, write ? "wb" : "rb");
+#else
+    wchar_t filename_w[512];
+    int rv = _snwprintf(filename_w, sizeof(filename_w) / sizeof(wchar_t),
+                        L"%s\\%016llx%016llx.llvm.tune", jitc_temp_path,
+                        (unsigned long long) hash.high64,
+                        (unsigned long long) hash.low64);
+    if (rv < 0 || rv == sizeof(filename_w) / sizeof(wchar_t))
+        jitc_fail("jit_kernel_autotune(): scratch space for filename insufficient!");
+    return _wfopen(filename_w, write ? L"wb" : L"rb");
+#endif
+}
+
+bool jitc_kernel_autotune_load(XXH128_hash_t hash, uint32_t &width) {
+    FILE *f = jitc_kernel_autotune_open(hash, false);
+    if (!f)
+        return false;
+
+    AutotuneFileRecord record;
+    bool success = fread(&record, sizeof(AutotuneFileRecord), 1, f) == 1 &&
+                   record.version == DRJIT_CACHE_VERSION;
+    fclose(f);
+
+    if (success)
+        width = record.width;
+    return success;
+}
+
+bool jitc_kernel_autotune_write(XXH128_hash_t hash, uint32_t width) {
+    FILE *f = jitc_kernel_autotune_open(hash, true);
+    if (!f) {
+        jitc_log(Warn, "jit_kernel_autotune_write(): could not write "
+                       "autotuning result to the cache directory!");
+        return false;
+    }
+
+    AutotuneFileRecord record;
+    record.version = DRJIT_CACHE_VERSION;
+    record.width = width;
+    bool success = fwrite(&record, sizeof(AutotuneFileRecord), 1, f) == 1;
+    success &= fclose(f) == 0;
+
+    return success;
+}
+
 void jitc_kernel_free(int device_id, const Kernel &kernel) {
     if (device_id == -1) {
         if (kernel.llvm.n_reloc)
@@ -467,6 +533,9 @@ void jitc_kernel_free(int device_id, const Kernel &kernel) {
 }
 
 void jitc_flush_kernel_cache() {
+    // Kernels that are still running must not be released
+    jitc_sync_all_devices();
+
     jitc_log(Info, "jit_flush_kernel_cache(): releasing %zu kernel%s ..",
             state.kernel_cache.size(),
             state.kernel_cache.size() > 1 ? "s" : "");
@@ -478,3 +547,297 @@ void jitc_flush_kernel_cache() {
 
     state.kernel_cache.clear();
 }
+
+// ====================================================================
+//                     Serialization of evaluated arrays
+// ====================================================================
+
+/// Version number for serialized arrays (see jit_var_save())
+#define DRJIT_ARRAY_VERSION 1
+
+/// Arrays are split into chunks of this size that are (de)compressed in parallel
+#define DRJIT_ARRAY_CHUNK_SIZE (4 * 1024 * 1024)
+
+/// Flag marking chunks that are stored without compression
+#define DRJIT_ARRAY_CHUNK_RAW 0x80000000u
+
+#pragma pack(push)
+#pragma pack(1)
+struct ArrayFileHeader {
+    char magic[3];
+    uint8_t version;
+    uint8_t type;
+    uint8_t compressed;
+    uint16_t padding;
+    uint32_t size;
+    uint32_t chunk_size;
+};
+#pragma pack(pop)
+
+static void jitc_array_write(int fd, const void *data_, size_t size) {
+    const uint8_t *data = (const uint8_t *) data_;
+    while (size > 0) {
+#if !defined(_WIN32)
+        ssize_t n_written = write(fd, data, size);
+#else
+        int n_written = _write(fd, data, (unsigned) std::min(size, (size_t) 0x40000000));
+#endif
+        if (n_written <= 0) {
+            if (errno == EINTR)
+                continue;
+            jitc_raise("jit_var_save(): I/O error while writing array: %s",
+                       strerror(errno));
+        }
+        data += n_written;
+        size -= (size_t) n_written;
+    }
+}
+
+static void jitc_array_read(int fd, void *data_, size_t size) {
+    uint8_t *data = (uint8_t *) data_;
+    while (size > 0) {
+#if !defined(_WIN32)
+        ssize_t n_read = read(fd, data, size);
+#else
+        int n_read = _read(fd, data, (unsigned) std::min(size, (size_t) 0x40000000));
+#endif
+        if (n_read <= 0) {
+            if (n_read < 0 && errno == EINTR)
+                continue;
+            jitc_raise("jit_var_load(): I/O error while reading array: %s",
+                       n_read == 0 ? "unexpected end of file" : strerror(errno));
+        }
+        data += n_read;
+        size -= (size_t) n_read;
+    }
+}
+
+/// A batch of chunks that are (de)compressed in parallel
+struct ArrayChunkBatch {
+    uint8_t *data;        // Uncompressed array contents
+    size_t size;          // Size of the array in bytes
+    size_t first;         // Index of the first chunk of the batch
+    uint8_t *buffer;      // Compressed representation of each chunk
+    uint32_t stride;      // Buffer size per chunk
+    uint32_t *stored;     // Stored size per chunk (possibly DRJIT_ARRAY_CHUNK_RAW)
+};
+
+/// Process 'count' chunks starting at 'batch.first' using the thread pool
+static void jitc_array_process(const ArrayChunkBatch &batch, uint32_t count,
+                               bool compress) {
+    auto compress_chunk = [](uint32_t i, void *payload) {
+        const ArrayChunkBatch &b = *(const ArrayChunkBatch *) payload;
+        size_t offset = (b.first + i) * DRJIT_ARRAY_CHUNK_SIZE;
+        int len = (int) std::min(b.size - offset, (size_t) DRJIT_ARRAY_CHUNK_SIZE);
+
+        int rv = LZ4_compress_default((const char *) b.data + offset,
+                                      (char *) b.buffer + (size_t) i * b.stride,
+                                      len, (int) b.stride);
+
+        // Store incompressible chunks as-is
+        b.stored[i] = (rv <= 0 || rv >= len) ? ((uint32_t) len | DRJIT_ARRAY_CHUNK_RAW)
+                                             : (uint32_t) rv;
+    };
+
+    auto decompress_chunk = [](uint32_t i, void *payload) {
+        const ArrayChunkBatch &b = *(const ArrayChunkBatch *) payload;
+        if (b.stored[i] & DRJIT_ARRAY_CHUNK_RAW)
+            return;
+
+        size_t offset = (b.first + i) * DRJIT_ARRAY_CHUNK_SIZE;
+        int len = (int) std::min(b.size - offset, (size_t) DRJIT_ARRAY_CHUNK_SIZE);
+
+        int rv = LZ4_decompress_safe((const char *) b.buffer + (size_t) i * b.stride,
+                                     (char *) b.data + offset, (int) b.stored[i],
+                                     len);
+
+        // Signal failure to the caller
+        b.stored[i] = rv == len ? 0 : DRJIT_ARRAY_CHUNK_RAW - 1;
+    };
+
+    Task *task = task_submit_dep(nullptr, nullptr, 0, count,
+                                 compress ? (void (*)(uint32_t, void *)) compress_chunk
+                                          : (void (*)(uint32_t, void *)) decompress_chunk,
+                                 (void *) &batch, sizeof(ArrayChunkBatch));
+    task_wait_and_release(task);
+}
+
+void jitc_var_save(uint32_t index, int fd, bool compress) {
+    if (index == 0)
+        jitc_raise("jit_var_save(): uninitialized variable!");
+    else if (jitc_var(index)->placeholder)
+        jitc_raise("jit_var_save(): r%u is a placeholder variable!", index);
+
+    Ref ref = borrow(index);
+    jitc_var_eval(index);
+    uint8_t *data = (uint8_t *) jitc_var_ptr(index);
+
+    const Variable *v = jitc_var(index);
+    JitBackend backend = (JitBackend) v->backend;
+
+    ArrayFileHeader header;
+    memcpy(header.magic, "DJA", 3);
+    header.version = DRJIT_ARRAY_VERSION;
+    header.type = (uint8_t) v->type;
+    header.compressed = compress ? 1 : 0;
+    header.padding = 0;
+    header.size = v->size;
+    header.chunk_size = DRJIT_ARRAY_CHUNK_SIZE;
+
+    size_t size = (size_t) v->size * type_size[v->type],
+           chunk_count = (size + DRJIT_ARRAY_CHUNK_SIZE - 1) / DRJIT_ARRAY_CHUNK_SIZE;
+
+    // Device memory must first be copied to the host
+    void *host = nullptr;
+    if (backend == JitBackend::CUDA) {
+        host = jitc_malloc(AllocType::HostPinned, size);
+        jitc_memcpy(backend, host, data, size);
+        data = (uint8_t *) host;
+    }
+
+    jitc_log(Debug, "jit_var_save(r%u): writing %zu bytes in %zu chunk%s%s.",
+             index, size, chunk_count, chunk_count == 1 ? "" : "s",
+             compress ? " (compressed)" : "");
+
+    try {
+        unlock_guard guard(state.lock);
+        if (backend == JitBackend::LLVM)
+            jitc_sync_thread(thread_state(backend));
+
+        jitc_array_write(fd, &header, sizeof(ArrayFileHeader));
+
+        uint32_t batch_size = std::max(pool_size(), 1u) * 2,
+                 stride = (uint32_t) LZ4_compressBound(DRJIT_ARRAY_CHUNK_SIZE);
+        std::unique_ptr<uint8_t[]> buffer;
+        std::unique_ptr<uint32_t[]> stored(new uint32_t[batch_size]);
+        if (compress)
+            buffer.reset(new uint8_t[(size_t) batch_size * stride]);
+
+        for (size_t first = 0; first < chunk_count; first += batch_size) {
+            uint32_t count = (uint32_t) std::min((size_t) batch_size,
+                                                 chunk_count - first);
+            ArrayChunkBatch batch { data, size, first, buffer.get(), stride,
+                                    stored.get() };
+
+            if (compress) {
+                jitc_array_process(batch, count, true);
+            } else {
+                for (uint32_t i = 0; i < count; ++i)
+                    stored[i] = (uint32_t) std::min(
+                        size - (first + i) * DRJIT_ARRAY_CHUNK_SIZE,
+                        (size_t) DRJIT_ARRAY_CHUNK_SIZE) | DRJIT_ARRAY_CHUNK_RAW;
+            }
+
+            // Raw chunks are written directly from the array
+            for (uint32_t i = 0; i < count; ++i) {
+                jitc_array_write(fd, &stored[i], sizeof(uint32_t));
+                if (stored[i] & DRJIT_ARRAY_CHUNK_RAW)
+                    jitc_array_write(fd, data + (first + i) * DRJIT_ARRAY_CHUNK_SIZE,
+                                     stored[i] & ~DRJIT_ARRAY_CHUNK_RAW);
+                else
+                    jitc_array_write(fd, buffer.get() + (size_t) i * stride,
+                                     stored[i]);
+            }
+        }
+    } catch (...) {
+        jitc_free(host);
+        throw;
+    }
+
+    jitc_free(host);
+}
+
+uint32_t jitc_var_load(JitBackend backend, int fd) {
+    ArrayFileHeader header;
+    {
+        unlock_guard guard(state.lock);
+        jitc_array_read(fd, &header, sizeof(ArrayFileHeader));
+    }
+
+    if (memcmp(header.magic, "DJA", 3) != 0)
+        jitc_raise("jit_var_load(): invalid file format!");
+    else if (header.version != DRJIT_ARRAY_VERSION)
+        jitc_raise("jit_var_load(): array was serialized by an incompatible "
+                   "version of Dr.Jit (format %u, expected %u)!",
+                   (uint32_t) header.version, (uint32_t) DRJIT_ARRAY_VERSION);
+    else if (header.type == (uint8_t) VarType::Void ||
+             header.type >= (uint8_t) VarType::Count ||
+             header.chunk_size != DRJIT_ARRAY_CHUNK_SIZE)
+        jitc_raise("jit_var_load(): invalid file format!");
+
+    VarType type = (VarType) header.type;
+    size_t size = (size_t) header.size * type_size[(int) type],
+           chunk_count = (size + DRJIT_ARRAY_CHUNK_SIZE - 1) / DRJIT_ARRAY_CHUNK_SIZE;
+
+    if (size == 0)
+        return 0;
+
+    // Decompress into host memory, which is then handed over to the backend
+    uint8_t *data = (uint8_t *) jitc_malloc(
+        backend == JitBackend::CUDA ? AllocType::HostPinned : AllocType::Host,
+        size);
+
+    jitc_log(Debug, "jit_var_load(): reading %zu bytes in %zu chunk%s%s.", size,
+             chunk_count, chunk_count == 1 ? "" : "s",
+             header.compressed ? " (compressed)" : "");
+
+    try {
+        unlock_guard guard(state.lock);
+
+        uint32_t batch_size = std::max(pool_size(), 1u) * 2,
+                 stride = (uint32_t) LZ4_compressBound(DRJIT_ARRAY_CHUNK_SIZE);
+        std::unique_ptr<uint8_t[]> buffer;
+        std::unique_ptr<uint32_t[]> stored(new uint32_t[batch_size]);
+        if (header.compressed)
+            buffer.reset(new uint8_t[(size_t) batch_size * stride]);
+
+        for (size_t first = 0; first < chunk_count; first += batch_size) {
+            uint32_t count = (uint32_t) std::min((size_t) batch_size,
+                                                 chunk_count - first);
+            bool compressed = false;
+
+            // Raw chunks are read directly into the array
+            for (uint32_t i = 0; i < count; ++i) {
+                size_t offset = (first + i) * DRJIT_ARRAY_CHUNK_SIZE;
+                uint32_t len = (uint32_t) std::min(
+                    size - offset, (size_t) DRJIT_ARRAY_CHUNK_SIZE);
+
+                jitc_array_read(fd, &stored[i], sizeof(uint32_t));
+                if (stored[i] & DRJIT_ARRAY_CHUNK_RAW) {
+                    if ((stored[i] & ~DRJIT_ARRAY_CHUNK_RAW) != len)
+                        jitc_raise("jit_var_load(): invalid chunk size!");
+                    jitc_array_read(fd, data + offset, len);
+                } else {
+                    if (!header.compressed || stored[i] > stride)
+                        jitc_raise("jit_var_load(): invalid chunk size!");
+                    jitc_array_read(fd, buffer.get() + (size_t) i * stride,
+                                    stored[i]);
+                    compressed = true;
+                }
+            }
+
+            if (!compressed)
+                continue;
+
+            ArrayChunkBatch batch { data, size, first, buffer.get(), stride,
+                                    stored.get() };
+            jitc_array_process(batch, count, false);
+
+            for (uint32_t i = 0; i < count; ++i) {
+                if (stored[i] == DRJIT_ARRAY_CHUNK_RAW - 1)
+                    jitc_raise("jit_var_load(): decompression failed, the file "
+                               "is corrupt!");
+            }
+        }
+    } catch (...) {
+        jitc_free(data);
+        throw;
+    }
+
+    void *ptr = jitc_malloc_migrate(
+        data,
+        backend == JitBackend::CUDA ? AllocType::Device : AllocType::HostAsync,
+        1);
+
+    return jitc_var_mem_map(backend, type, ptr, header.size, 1);
+}
@@ -1,5 +1,5 @@
 /*
-    src/io.h -- Disk cache for LLVM/CUDA kernels
+    src/io.h -- Disk cache for LLVM/CUDA kernels, serialization of arrays
 
     Copyright (c) 2021 Wenzel Jakob <wenzel.jakob@epfl.ch>
 
@@ -76,6 +76,18 @@ extern bool jitc_kernel_write(const char *source, uint32_t source_size,
                               JitBackend backend, XXH128_hash_t hash,
                               const Kernel &kernel);
 
+/// Load the vector width selected by autotuning an LLVM kernel
+extern bool jitc_kernel_autotune_load(XXH128_hash_t hash, uint32_t &width);
+
+/// Persist the vector width selected by autotuning an LLVM kernel
+extern bool jitc_kernel_autotune_write(XXH128_hash_t hash, uint32_t width);
+
 extern void jitc_kernel_free(int device_id, const Kernel &kernel);
 
 extern void jitc_flush_kernel_cache();
+
+/// Write the contents of a variable to the file descriptor 'fd'
+extern void jitc_var_save(uint32_t index, int fd, bool compress);
+
+/// Create a variable from an array previously written by jitc_var_save()
+extern uint32_t jitc_var_load(JitBackend backend, int fd);
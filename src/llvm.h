@@ -16,6 +16,8 @@
 // Forward declarations
 struct Task;
 struct Kernel;
+enum VarKind : uint32_t;
+enum class VarType : uint32_t;
 
 /// Current top-level task in the task queue
 extern Task *jitc_task;
@@ -52,6 +54,9 @@ extern uint32_t jitc_llvm_vector_width;
 /// Should the LLVM IR use typed (e.g., "i8*") or untyped ("ptr") pointers?
 extern bool jitc_llvm_opaque_pointers;
 
+/// Distance (in packets) of gather prefetches, see JitFlag::GatherPrefetch
+extern uint32_t jitc_llvm_prefetch_distance;
+
 /// LLVM version (parts can equal -1, which means: not sure)
 extern int jitc_llvm_version_major;
 extern int jitc_llvm_version_minor;
@@ -60,6 +65,22 @@ extern int jitc_llvm_version_patch;
 /// Pre-generated strings for use by the template engine
 extern char **jitc_llvm_ones_str;
 
+/**
+ * \brief Register a vectorized implementation of the transcendental function
+ * 'kind' (Sin/Cos/Exp2/Log2) with the globals of the current module and return
+ * its name. 'type' must be Float32 or Float64.
+ */
+extern const char *jitc_llvm_math_func(VarKind kind, VarType type, bool fast);
+
+/**
+ * \brief Register the texture lookup routine of a \c VarKind::TexLookup node
+ * with the globals of the current module and return its name. The routine
+ * returns a struct of 'channels' single precision vectors, where 'channels'
+ * is encoded in the lowest byte of the node's literal.
+ */
+extern const char *jitc_llvm_tex_func(uint32_t ndim, uint64_t literal,
+                                      const char **ret_type);
+
 /// Try to load initialize LLVM backend
 extern bool jitc_llvm_init();
 
@@ -86,6 +107,9 @@ extern void jitc_llvm_compile(Kernel &kernel);
 /// Dump disassembly for the given kernel
 extern void jitc_llvm_disasm(const Kernel &kernel);
 
+/// Regenerate the strings used by the template engine (e.g. after changing the vector width)
+extern void jitc_llvm_update_strings();
+
 /// Override the target architecture
 extern void jitc_llvm_set_target(const char *target_cpu,
                                  const char *target_features,
@@ -0,0 +1,116 @@
+/*
+    src/llvm_builder.h -- Helper for assembling internal LLVM IR routines
+
+    Copyright (c) 2021 Wenzel Jakob <wenzel.jakob@epfl.ch>
+
+    All rights reserved. Use of this source code is governed by a BSD-style
+    license that can be found in the LICENSE file.
+*/
+
+#pragma once
+
+#include "llvm.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Helper for assembling the body of a vectorized routine that is
+ * emitted once per module (see llvm_math.cpp and llvm_tex.cpp)
+ *
+ * The floating point type of the routine is either single or double
+ * precision ('ft'), and 'it' refers to the integer type of the same size.
+ * Instructions are appended to 'body', and declarations of the intrinsics
+ * they reference are collected in 'decls'.
+ */
+struct LLVMBuilder {
+    LLVMBuilder(uint32_t width, bool dbl = false) : dbl(dbl), width(width) {
+        w = std::to_string(width);
+        ft = "<" + w + " x " + (dbl ? "double>" : "float>");
+        it = "<" + w + " x " + (dbl ? "i64>" : "i32>");
+        bt = "<" + w + " x i1>";
+        h = dbl ? "f64" : "f32";
+    }
+
+    /// Append an instruction that produces a new register, return its name
+    std::string op(const std::string &rhs) {
+        std::string name = "%r" + std::to_string(reg++);
+        body += "    " + name + " = " + rhs + "\n";
+        return name;
+    }
+
+    /// Splat a scalar constant (e.g. "i32 1") to all lanes
+    std::string splat(const std::string &elem) {
+        std::string result = "<";
+        for (uint32_t i = 0; i < width; ++i) {
+            if (i)
+                result += ", ";
+            result += elem;
+        }
+        return result + ">";
+    }
+
+    /// Floating point constant (LLVM represents 'float' constants as doubles)
+    std::string f(double value) {
+        if (!dbl)
+            value = (double) (float) value;
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(double));
+        char tmp[32];
+        snprintf(tmp, sizeof(tmp), "%s 0x%016llX", dbl ? "double" : "float",
+                 (unsigned long long) bits);
+        return splat(tmp);
+    }
+
+    /// Pointer type (typed or opaque depending on the LLVM version)
+    std::string ptr(const char *type) {
+        return jitc_llvm_opaque_pointers ? std::string("ptr")
+                                         : std::string(type) + "*";
+    }
+
+    std::string iop(const char *name, const std::string &a, const std::string &b) {
+        return op(std::string(name) + " " + it + " " + a + ", " + b);
+    }
+
+    std::string select(const std::string &m, const std::string &type,
+                       const std::string &a, const std::string &b) {
+        return op("select " + bt + " " + m + ", " + type + " " + a + ", " +
+                  type + " " + b);
+    }
+
+    /// Call an LLVM intrinsic on floating point arguments and remember to declare it
+    std::string intrinsic(const char *name, const std::string &a,
+                          const std::string &b = std::string(),
+                          const std::string &c = std::string()) {
+        uint32_t nargs = c.empty() ? (b.empty() ? 1 : 2) : 3;
+        std::string fname = std::string("@llvm.") + name + ".v" + w + h,
+                    decl = "declare " + ft + " " + fname + "(",
+                    call = "call " + ft + " " + fname + "(";
+        const std::string *args[3] = { &a, &b, &c };
+        for (uint32_t k = 0; k < nargs; ++k) {
+            decl += (k ? ", " : "") + ft;
+            call += (k ? ", " : "") + ft + " " + *args[k];
+        }
+        decls.emplace_back(decl + ")");
+        return op(call + ")");
+    }
+
+    /// Globals defining the routine: declarations followed by the function itself
+    std::vector<std::string> finish(const std::string &ret_type,
+                                    const std::string &name,
+                                    const std::string &args) {
+        std::vector<std::string> globals = std::move(decls);
+        globals.push_back("define internal " + ret_type + " @" + name + "(" +
+                          args + ") #0 {\n" + body + "}");
+        return globals;
+    }
+
+    std::string body;
+    std::vector<std::string> decls;
+    std::string w, ft, it, bt;
+    const char *h;
+    bool dbl;
+    uint32_t width, reg = 0;
+};
@@ -45,6 +45,9 @@ uint32_t jitc_llvm_vector_width = 0;
 /// Should the LLVM IR use typed (e.g., "i8*") or untyped ("ptr") pointers?
 bool jitc_llvm_opaque_pointers = false;
 
+/// Distance (in packets) of gather prefetches, see JitFlag::GatherPrefetch
+uint32_t jitc_llvm_prefetch_distance = 8;
+
 /// Strings related to the vector width, used by template engine
 char **jitc_llvm_ones_str = nullptr;
 
@@ -63,7 +63,10 @@
 #include "log.h"
 #include "var.h"
 #include "vcall.h"
+#include "loop.h"
 #include "op.h"
+#include "llvm.h"
+#include <tsl/robin_set.h>
 
 #define put(...)                                                               \
     buffer.put(__VA_ARGS__)
@@ -91,20 +94,244 @@ static void jitc_llvm_render_printf(uint32_t index, const Variable *v,
 static void jitc_llvm_render_trace(uint32_t index, const Variable *v,
                                    const Variable *func,
                                    const Variable *scene);
+static void jitc_llvm_render_refill();
+static void jitc_llvm_render_body(const ScheduledGroup &group,
+                                  bool print_labels, uint32_t refill_end,
+                                  const char *&refill_store);
+static bool jitc_llvm_prefetch_check(const Variable *v, uint32_t depth);
+static bool jitc_llvm_prefetch_varying(const Variable *v);
+static void jitc_llvm_render_prefetch(const Variable *v, const Variable *ptr,
+                                      const Variable *index);
+
+/// Is the kernel being assembled refilling the SIMD lanes of a loop?
+static bool refill_mode = false;
+
+/// Is the kernel being assembled split into full packets and a tail?
+static bool packet_split = false;
+
+/// Is the tail of a kernel with packet splitting being rendered?
+static bool packet_tail = false;
+
+/// Does the kernel being assembled prefetch the memory accessed by gathers?
+static bool prefetch = false;
+
+/// Variables whose prefetch registers were already emitted for the current gather
+static tsl::robin_set<uint32_t, UInt32Hasher> prefetch_visited;
 
 void jitc_llvm_assemble(ThreadState *ts, ScheduledGroup group) {
     bool print_labels = std::max(state.log_level_stderr,
                                  state.log_level_callback) >= LogLevel::Trace ||
                         (jitc_flags() & (uint32_t) JitFlag::PrintIR);
 
+    /* Lane refilling: the kernel processes its index range in rounds, where
+       lanes of a loop that finished are reassigned to the next pending
+       element. Memory is then accessed via gathers and scatters. */
+    uint32_t refill_end = jitc_var_loop_refill_begin(group.start, group.end);
+    const char *refill_store = "%refill_store_pre";
+    refill_mode = refill_end != 0;
+
+    /* Packet splitting: the kernel body is rendered twice, as an unmasked
+       main loop over full packets and a masked tail for the remainder.
+       Virtual function calls compile their callables while being rendered
+       and consume their side effects, hence they cannot be rendered twice. */
+    packet_split = false;
+    packet_tail = false;
+    if (!refill_mode && (jitc_flags() & (uint32_t) JitFlag::PacketSplit)) {
+        for (uint32_t gi = group.start; gi != group.end; ++gi) {
+            VarKind kind = (VarKind) jitc_var(schedule[gi].index)->kind;
+            if (kind == VarKind::DefaultMask) {
+                packet_split = true;
+            } else if (kind == VarKind::Dispatch) {
+                packet_split = false;
+                break;
+            }
+        }
+    }
+
     fmt("define void @drjit_^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^(i64 %start, i64 "
         "%end, {i8**} noalias %params) #0 ${\n"
-        "entry:\n"
-        "    br label %body\n"
-        "\n"
+        "entry:\n");
+
+    if (packet_split)
+        fmt("    %size = sub i64 %end, %start\n"
+            "    %size_tail = urem i64 %size, $w\n"
+            "    %end_full = sub i64 %end, %size_tail\n"
+            "    %has_full = icmp ult i64 %start, %end_full\n"
+            "    br i1 %has_full, label %body, label %tail\n");
+    else
+        put("    br label %body\n");
+
+    put("\n"
         "body:\n"
         "    %index = phi i64 [ %index_next, %suffix ], [ %start, %entry ]\n");
 
+    if (refill_mode)
+        jitc_llvm_render_refill();
+
+    /* Gather prefetching: determine the elements processed 'distance'
+       iterations later. Lanes past the end are masked. */
+    prefetch = !refill_mode && jitc_llvm_prefetch_distance > 0 &&
+               (jitc_flags() & (uint32_t) JitFlag::GatherPrefetch);
+    if (prefetch) {
+        fmt("    %pf_index = add i64 %index, $u\n"
+            "    %pf_0 = insertelement <$w x i64> undef, i64 %pf_index, i32 0\n"
+            "    %pf_1 = shufflevector <$w x i64> %pf_0, <$w x i64> undef, <$w x i32> $z\n"
+            "    %pf_2 = insertelement <$w x i64> undef, i64 %end, i32 0\n"
+            "    %pf_3 = shufflevector <$w x i64> %pf_2, <$w x i64> undef, <$w x i32> $z\n"
+            "    %pf_4 = add <$w x i64> %pf_1, <",
+            jitc_llvm_prefetch_distance * jitc_llvm_vector_width);
+        for (uint32_t i = 0; i < jitc_llvm_vector_width; ++i)
+            fmt("i64 $u$s", i, i + 1 < jitc_llvm_vector_width ? ", " : ">\n");
+        fmt("    %pf_mask = icmp ult <$w x i64> %pf_4, %pf_3\n");
+    }
+
+    jitc_llvm_render_body(group, print_labels, refill_end, refill_store);
+
+    put("    br label %suffix\n"
+        "\n"
+        "suffix:\n");
+    fmt("    %index_next = add i64 %index, $w\n");
+    if (packet_split) {
+        put("    %cond = icmp uge i64 %index_next, %end_full\n"
+            "    br i1 %cond, label %tail, label %body, !llvm.loop !4\n\n"
+            "tail:\n"
+            "    %has_tail = icmp ult i64 %end_full, %end\n"
+            "    br i1 %has_tail, label %body_t, label %done\n\n"
+            "body_t:\n"
+            "    %index_t = phi i64 [ %end_full, %tail ]\n");
+
+        /* Render the body a second time for the partial packet. Its
+           registers and labels are shifted past those of the main loop */
+        uint32_t reg_offset = 0;
+        for (uint32_t gi = group.start; gi != group.end; ++gi)
+            reg_offset = std::max(reg_offset, jitc_var(schedule[gi].index)->reg_index + 1);
+        for (uint32_t gi = group.start; gi != group.end; ++gi)
+            jitc_var(schedule[gi].index)->reg_index += reg_offset;
+
+        packet_tail = true;
+        prefetch = false;
+        jitc_llvm_render_body(group, print_labels, refill_end, refill_store);
+        packet_tail = false;
+
+        for (uint32_t gi = group.start; gi != group.end; ++gi)
+            jitc_var(schedule[gi].index)->reg_index -= reg_offset;
+
+        put("    br label %done\n\n");
+        packet_split = false;
+    } else if (!refill_mode) {
+        put("    %cond = icmp uge i64 %index_next, %end\n"
+            "    br i1 %cond, label %done, label %body, !llvm.loop !4\n\n");
+    } else {
+        // Continue while elements are pending or lanes are still active
+        fmt("    %refill_pending = icmp ult i64 %refill_next, %end\n"
+            "    %refill_any = call i1 @llvm.experimental.vector.reduce.or.v$wi1(<$w x i1> %refill_active)\n"
+            "    %cond = or i1 %refill_pending, %refill_any\n"
+            "    br i1 %cond, label %body, label %done, !llvm.loop !4\n\n");
+        jitc_var_loop_refill_end();
+        refill_mode = false;
+    }
+    put("done:\n"
+        "    ret void\n"
+        "}\n");
+
+    /* The program requires extra memory or uses callables. Insert
+       setup code the top of the function to accomplish this */
+    if (callable_count > 0 || alloca_size >= 0) {
+        size_t suffix_start = buffer.size(),
+               suffix_target = (char *) strchr(buffer.get(), ':') - buffer.get() + 2;
+
+        if (callable_count > 0)
+            fmt("    %callables = load {i8**}, {i8***} @callables, align 8\n");
+
+        if (alloca_size >= 0)
+            fmt("    %buffer = alloca i8, i32 $u, align $u\n",
+                alloca_size, alloca_align);
+
+        buffer.move_suffix(suffix_start, suffix_target);
+    }
+
+    uint32_t ctr = 0;
+    for (auto &it : globals_map) {
+        put('\n');
+        put(globals.get() + it.second.start, it.second.length);
+        put('\n');
+        if (!it.first.callable)
+            continue;
+        it.second.callable_index = 1 + ctr++;
+    }
+
+    put("\n"
+        "!0 = !{!0}\n"
+        "!1 = !{!1, !0}\n"
+        "!2 = !{!1}\n"
+        "!3 = !{i32 1}\n"
+        "!4 = !{!\"llvm.loop.unroll.disable\", !\"llvm.loop.vectorize.enable\", i1 0}\n\n");
+
+    fmt("attributes #0 = ${ norecurse nounwind \"frame-pointer\"=\"none\" "
+        "\"no-builtins\" \"no-stack-arg-probe\" \"target-cpu\"=\"$s\" "
+        "\"target-features\"=\"", jitc_llvm_target_cpu);
+
+#if !defined(__aarch64__)
+    put("-vzeroupper");
+    if (jitc_llvm_target_features)
+        put(",");
+#endif
+
+    if (jitc_llvm_target_features)
+        put(jitc_llvm_target_features, strlen(jitc_llvm_target_features));
+
+    put("\" }");
+
+    jitc_vcall_upload(ts);
+}
+
+/// Assign the kernel's pending elements to idle SIMD lanes (lane refilling)
+static void jitc_llvm_render_refill() {
+    uint32_t width = jitc_llvm_vector_width;
+
+    fmt("    %refill_next_prev = phi i64 [ %start, %entry ], [ %refill_next, %suffix ]\n"
+        "    %refill_active_prev = phi <$w x i1> [ $z, %entry ], [ %refill_active, %suffix ]\n"
+        "    %refill_index_prev = phi <$w x i64> [ $z, %entry ], [ %refill_index, %suffix ]\n");
+
+    // Loop state of lanes that were still active at the end of the last round
+    jitc_var_loop_refill_assemble_carry();
+
+    fmt("    %refill_mask = xor <$w x i1> %refill_active_prev, $s\n"
+        "    %refill_scan_0 = zext <$w x i1> %refill_mask to <$w x i64>\n",
+        jitc_llvm_ones_str[(int) VarType::Bool]);
+
+    // Inclusive prefix sum over the refill mask (log-step shifts)
+    uint32_t step = 0;
+    for (uint32_t shift = 1; shift < width; shift *= 2, ++step) {
+        fmt("    %refill_shift_$u = shufflevector <$w x i64> %refill_scan_$u, "
+            "<$w x i64> $z, <$w x i32> <", step, step);
+        for (uint32_t i = 0; i < width; ++i)
+            fmt("i32 $u$s", i >= shift ? i - shift : width,
+                i + 1 < width ? ", " : ">\n");
+        fmt("    %refill_scan_$u = add <$w x i64> %refill_scan_$u, %refill_shift_$u\n",
+            step + 1, step, step);
+    }
+
+    fmt("    %refill_rank = sub <$w x i64> %refill_scan_$u, %refill_scan_0\n"
+        "    %refill_count = extractelement <$w x i64> %refill_scan_$u, i32 $u\n"
+        "    %refill_next_0 = insertelement <$w x i64> undef, i64 %refill_next_prev, i32 0\n"
+        "    %refill_next_1 = shufflevector <$w x i64> %refill_next_0, <$w x i64> undef, <$w x i32> $z\n"
+        "    %refill_index_new = add <$w x i64> %refill_next_1, %refill_rank\n"
+        "    %refill_index = select <$w x i1> %refill_mask, <$w x i64> %refill_index_new, <$w x i64> %refill_index_prev\n"
+        "    %refill_next = add i64 %refill_next_prev, %refill_count\n"
+        "    %refill_end_0 = insertelement <$w x i64> undef, i64 %end, i32 0\n"
+        "    %refill_end_1 = shufflevector <$w x i64> %refill_end_0, <$w x i64> undef, <$w x i32> $z\n"
+        "    %refill_valid = icmp ult <$w x i64> %refill_index, %refill_end_1\n"
+        "    %refill_store_pre = and <$w x i1> %refill_mask, %refill_valid\n",
+        step, step, width - 1);
+}
+
+/// Render the statements of the kernel body (once, or twice with packet splitting)
+static void jitc_llvm_render_body(const ScheduledGroup &group,
+                                  bool print_labels, uint32_t refill_end,
+                                  const char *&refill_store) {
+    const char *index_reg = packet_tail ? "%index_t" : "%index";
+
     for (uint32_t gi = group.start; gi != group.end; ++gi) {
         uint32_t index = schedule[gi].index;
         Variable *v = jitc_var(index);
@@ -127,6 +354,8 @@ void jitc_llvm_assemble(ThreadState *ts, ScheduledGroup group) {
 
             if (extra.assemble) {
                 extra.assemble(v, extra);
+                if (index == refill_end)
+                    refill_store = "%refill_store_post";
                 continue;
             }
         }
@@ -146,17 +375,30 @@ void jitc_llvm_assemble(ThreadState *ts, ScheduledGroup group) {
                 v, v, v, v, v, v, v);
 
             // For output parameters and non-scalar inputs
-            if (v->param_type != ParamType::Input || size != 1)
-                fmt( "    $v_p{4|5} = getelementptr inbounds $m, {$m*} $v_p3, i64 %index\n"
+            if ((v->param_type != ParamType::Input || size != 1) && refill_mode)
+                fmt("    $v_p5 = getelementptr inbounds $m, {$m*} $v_p3, <$w x i64> %refill_index\n",
+                    v, v, v, v);
+            else if (v->param_type != ParamType::Input || size != 1)
+                fmt( "    $v_p{4|5} = getelementptr inbounds $m, {$m*} $v_p3, i64 $s\n"
                     "{    $v_p5 = bitcast $m* $v_p4 to $M*\n|}",
-                    v, v, v, v, v, v, v, v);
+                    v, v, v, v, index_reg, v, v, v, v);
         }
 
         if (likely(v->param_type == ParamType::Input)) {
             if (v->is_literal())
                 continue;
 
-            if (size != 1) {
+            if (size != 1 && refill_mode) {
+                // Gather the values of the lanes' current elements
+                const char *abbrev = type_name_llvm_abbrev[vt == VarType::Bool
+                                         ? (uint32_t) VarType::UInt8 : vti];
+                fmt_intrinsic("declare $M @llvm.masked.gather.v$w$s(<$w x {$m*}>, i32, <$w x i1>, $M)",
+                              v, abbrev, v, v);
+                fmt("    $v$s = call $M @llvm.masked.gather.v$w$s(<$w x {$m*}> $v_p5, i32 $a, <$w x i1> %refill_valid, $M $z)\n",
+                    v, vt == VarType::Bool ? "_0" : "", v, abbrev, v, v, v, v);
+                if (vt == VarType::Bool)
+                    fmt("    $v = trunc $M $v_0 to $T\n", v, v, v, v);
+            } else if (size != 1) {
                 // Load a packet of values
                 fmt("    $v$s = load $M, {$M*} $v_p5, align $A, !alias.scope !2, !nontemporal !3\n",
                     v, vt == VarType::Bool ? "_0" : "", v, v, v, v);
@@ -191,7 +433,17 @@ void jitc_llvm_assemble(ThreadState *ts, ScheduledGroup group) {
 
         v = jitc_var(index); // `v` might have been invalidated during its assembly
 
-        if (v->param_type == ParamType::Output) {
+        if (v->param_type == ParamType::Output && refill_mode) {
+            const char *abbrev = type_name_llvm_abbrev[vt == VarType::Bool
+                                     ? (uint32_t) VarType::UInt8 : vti];
+            if (vt == VarType::Bool)
+                fmt("    $v_e = zext $V to $M\n", v, v, v);
+            fmt_intrinsic("declare void @llvm.masked.scatter.v$w$s($M, <$w x {$m*}>, i32, <$w x i1>)",
+                          abbrev, v, v);
+            fmt("    call void @llvm.masked.scatter.v$w$s($M $v$s, <$w x {$m*}> $v_p5, i32 $a, <$w x i1> $s)\n",
+                abbrev, v, v, vt == VarType::Bool ? "_e" : "", v, v, v,
+                refill_store);
+        } else if (v->param_type == ParamType::Output) {
             if (vt != VarType::Bool) {
                 fmt("    store $V, {$T*} $v_p5, align $A, !noalias !2, !nontemporal !3\n",
                     v, v, v, v);
@@ -202,66 +454,6 @@ void jitc_llvm_assemble(ThreadState *ts, ScheduledGroup group) {
             }
         }
     }
-
-    put("    br label %suffix\n"
-        "\n"
-        "suffix:\n");
-    fmt("    %index_next = add i64 %index, $w\n");
-    put("    %cond = icmp uge i64 %index_next, %end\n"
-        "    br i1 %cond, label %done, label %body, !llvm.loop !4\n\n"
-        "done:\n"
-        "    ret void\n"
-        "}\n");
-
-    /* The program requires extra memory or uses callables. Insert
-       setup code the top of the function to accomplish this */
-    if (callable_count > 0 || alloca_size >= 0) {
-        size_t suffix_start = buffer.size(),
-               suffix_target = (char *) strchr(buffer.get(), ':') - buffer.get() + 2;
-
-        if (callable_count > 0)
-            fmt("    %callables = load {i8**}, {i8***} @callables, align 8\n");
-
-        if (alloca_size >= 0)
-            fmt("    %buffer = alloca i8, i32 $u, align $u\n",
-                alloca_size, alloca_align);
-
-        buffer.move_suffix(suffix_start, suffix_target);
-    }
-
-    uint32_t ctr = 0;
-    for (auto &it : globals_map) {
-        put('\n');
-        put(globals.get() + it.second.start, it.second.length);
-        put('\n');
-        if (!it.first.callable)
-            continue;
-        it.second.callable_index = 1 + ctr++;
-    }
-
-    put("\n"
-        "!0 = !{!0}\n"
-        "!1 = !{!1, !0}\n"
-        "!2 = !{!1}\n"
-        "!3 = !{i32 1}\n"
-        "!4 = !{!\"llvm.loop.unroll.disable\", !\"llvm.loop.vectorize.enable\", i1 0}\n\n");
-
-    fmt("attributes #0 = ${ norecurse nounwind \"frame-pointer\"=\"none\" "
-        "\"no-builtins\" \"no-stack-arg-probe\" \"target-cpu\"=\"$s\" "
-        "\"target-features\"=\"", jitc_llvm_target_cpu);
-
-#if !defined(__aarch64__)
-    put("-vzeroupper");
-    if (jitc_llvm_target_features)
-        put(",");
-#endif
-
-    if (jitc_llvm_target_features)
-        put(jitc_llvm_target_features, strlen(jitc_llvm_target_features));
-
-    put("\" }");
-
-    jitc_vcall_upload(ts);
 }
 
 void jitc_llvm_assemble_func(const char *name, uint32_t inst_id,
@@ -457,6 +649,27 @@ static void jitc_llvm_render_var(uint32_t index, Variable *v) {
             fmt("    $v = call $T @llvm.sqrt.v$w$h($V)\n", v, v, v, a0);
             break;
 
+        case VarKind::Sin:
+        case VarKind::Cos:
+        case VarKind::Exp2:
+        case VarKind::Log2: {
+                bool fast = jitc_flags() & (uint32_t) JitFlag::FastMath;
+                if ((VarType) v->type == VarType::Float16) {
+                    // Evaluate in single precision
+                    const char *func = jitc_llvm_math_func(
+                        (VarKind) v->kind, VarType::Float32, fast);
+                    fmt("    $v_0 = fpext $V to <$w x float>\n"
+                        "    $v_1 = call <$w x float> @$s(<$w x float> $v_0)\n"
+                        "    $v = fptrunc <$w x float> $v_1 to $T\n",
+                        v, a0, v, func, v, v, v, v);
+                } else {
+                    const char *func = jitc_llvm_math_func(
+                        (VarKind) v->kind, (VarType) v->type, fast);
+                    fmt("    $v = call $T @$s($V)\n", v, v, func, a0);
+                }
+            }
+            break;
+
         case VarKind::Abs:
             if (jitc_is_float(v)) {
                 fmt_intrinsic("declare $T @llvm.fabs.v$w$h($T)", v, v, a0);
@@ -755,6 +968,11 @@ static void jitc_llvm_render_var(uint32_t index, Variable *v) {
                 if (is_bool) // Temporary change
                     v->type = (uint32_t) VarType::UInt8;
 
+                if (prefetch && callable_depth == 0 &&
+                    jitc_llvm_prefetch_varying(a1) &&
+                    jitc_llvm_prefetch_check(a1, 0))
+                    jitc_llvm_render_prefetch(v, a0, a1);
+
                 fmt_intrinsic(
                     "declare $T @llvm.masked.gather.v$w$h(<$w x {$t*}>, i32, $T, $T)",
                     v, v, v, a2, v);
@@ -790,16 +1008,28 @@ static void jitc_llvm_render_var(uint32_t index, Variable *v) {
             break;
 
         case VarKind::Counter:
-            fmt("    $v_0 = trunc i64 %index to $t\n"
+            if (refill_mode) {
+                fmt("    $v = trunc <$w x i64> %refill_index to $T\n", v, v);
+                break;
+            }
+            fmt("    $v_0 = trunc i64 $s to $t\n"
                 "    $v_1 = insertelement $T undef, $t $v_0, i32 0\n"
                 "    $v_2 = shufflevector $V_1, $T undef, <$w x i32> $z\n"
                 "    $v = add $V_2, <",
-                v, v, v, v, v, v, v, v, v, v, v);
+                v, packet_tail ? "%index_t" : "%index", v, v, v, v, v,
+                v, v, v, v, v);
             for (uint32_t i = 0; i < jitc_llvm_vector_width; ++i)
                 fmt("i32 $u$s", i, i + 1 < jitc_llvm_vector_width ? ", " : ">\n");
             break;
 
         case VarKind::DefaultMask:
+            if (packet_split && !packet_tail) {
+                // Main loop of a kernel with packet splitting: all lanes are active
+                fmt("    $v_1 = insertelement $T undef, i1 1, i32 0\n"
+                    "    $v = shufflevector $T $v_1, $T undef, <$w x i32> $z\n",
+                    v, v, v, v, v, v);
+                break;
+            }
             fmt("    $v_0 = trunc i64 %end to i32\n"
                 "    $v_1 = insertelement <$w x i32> undef, i32 $v_0, i32 0\n"
                 "    $v_2 = shufflevector <$w x i32> $v_1, <$w x i32> undef, <$w x i32> zeroinitializer\n"
@@ -821,6 +1051,32 @@ static void jitc_llvm_render_var(uint32_t index, Variable *v) {
             jitc_llvm_render_trace(index, v, a0, a1);
             break;
 
+        case VarKind::TexLookup: {
+                const char *ret_type,
+                           *func = jitc_llvm_tex_func(a3 ? 3 : (a2 ? 2 : 1),
+                                                      v->literal, &ret_type);
+                uint32_t channels = (uint32_t) (v->literal & 0xFF);
+
+                // Inside of functions, the texture pointer is a vector
+                if (callable_depth > 0)
+                    fmt("    $v_p = extractelement <$w x {i8*}> $v, i32 0\n"
+                        "    $v_out = call $s @$s({i8*} $v_p, <$w x float> $v",
+                        v, a0, v, ret_type, func, v, a1);
+                else
+                    fmt("    $v_out = call $s @$s({i8*} $v, <$w x float> $v",
+                        v, ret_type, func, a0, a1);
+                if (a2)
+                    fmt(", <$w x float> $v", a2);
+                if (a3)
+                    fmt(", <$w x float> $v", a3);
+                put(")\n");
+
+                for (uint32_t i = 0; i < channels; ++i)
+                    fmt("    $v_out_$u = extractvalue $s $v_out, $u\n", v, i,
+                        ret_type, v, i);
+            }
+            break;
+
         case VarKind::Extract:
             fmt("    $v = bitcast $T $v_out_$u to $T\n", v, v, a0,
                 (uint32_t) v->literal, v);
@@ -832,6 +1088,130 @@ static void jitc_llvm_render_var(uint32_t index, Variable *v) {
     }
 }
 
+/// Can the value of 'v' be computed for a future packet? (gather prefetching)
+static bool jitc_llvm_prefetch_check(const Variable *v, uint32_t depth) {
+    if (!jitc_is_int(v) || depth > 8)
+        return false;
+
+    if (v->param_type == ParamType::Input)
+        return !v->is_literal(); // Packet of values or scalar input
+    else if (v->param_type != ParamType::Register)
+        return false;
+    else if (v->is_literal())
+        return true;
+
+    switch ((VarKind) v->kind) {
+        case VarKind::Counter:
+            return true;
+
+        case VarKind::Add:
+        case VarKind::Sub:
+        case VarKind::Mul:
+        case VarKind::And:
+        case VarKind::Or:
+        case VarKind::Shl:
+        case VarKind::Shr:
+            return jitc_llvm_prefetch_check(jitc_var(v->dep[0]), depth + 1) &&
+                   jitc_llvm_prefetch_check(jitc_var(v->dep[1]), depth + 1);
+
+        default:
+            return false;
+    }
+}
+
+/// Does the value of 'v' differ between packets?
+static bool jitc_llvm_prefetch_varying(const Variable *v) {
+    return !v->is_literal() && !(v->param_type == ParamType::Input && v->size == 1);
+}
+
+/**
+ * Compute the value of 'v' for the elements processed 'distance' iterations
+ * later. The resulting registers are named after 'v', with a suffix that
+ * refers to the gather 'g' (registers of different gathers may be located in
+ * different basic blocks, hence they are not shared). Operands that occur
+ * several times in the expression are only computed once.
+ */
+static void jitc_llvm_render_prefetch_value(const Variable *g, const Variable *v) {
+    uint32_t g_reg = g->reg_index;
+
+    if (!jitc_llvm_prefetch_varying(v) ||
+        !prefetch_visited.insert(v->reg_index).second) {
+        return;
+    } else if (v->param_type == ParamType::Input) {
+        const char *abbrev = type_name_llvm_abbrev[v->type];
+        fmt_intrinsic("declare $M @llvm.masked.load.v$w$s({$M*}, i32, <$w x i1>, $M)",
+                      v, abbrev, v, v);
+        fmt( "    $v_pf$u_0 = getelementptr $m, {$m*} $v_p3, i64 %pf_index\n"
+            "{    $v_pf$u_1 = bitcast $m* $v_pf$u_0 to $M*\n|}"
+             "    $v_pf$u = call $M @llvm.masked.load.v$w$s({$M*} $v_pf$u_{1|0}, i32 $a, <$w x i1> %pf_mask, $M $z)\n",
+             v, g_reg, v, v, v,
+             v, g_reg, v, v, g_reg, v,
+             v, g_reg, v, abbrev, v, v, g_reg, v, v);
+        return;
+    } else if ((VarKind) v->kind == VarKind::Counter) {
+        fmt("    $v_pf$u_0 = trunc i64 %pf_index to $t\n"
+            "    $v_pf$u_1 = insertelement $T undef, $t $v_pf$u_0, i32 0\n"
+            "    $v_pf$u_2 = shufflevector $T $v_pf$u_1, $T undef, <$w x i32> $z\n"
+            "    $v_pf$u = add $T $v_pf$u_2, <",
+            v, g_reg, v,
+            v, g_reg, v, v, v, g_reg,
+            v, g_reg, v, v, g_reg, v,
+            v, g_reg, v, v, g_reg);
+        for (uint32_t i = 0; i < jitc_llvm_vector_width; ++i)
+            fmt("$t $u$s", v, i, i + 1 < jitc_llvm_vector_width ? ", " : ">\n");
+        return;
+    }
+
+    const Variable *a0 = jitc_var(v->dep[0]),
+                   *a1 = jitc_var(v->dep[1]);
+    jitc_llvm_render_prefetch_value(g, a0);
+    jitc_llvm_render_prefetch_value(g, a1);
+
+    const char *op;
+    switch ((VarKind) v->kind) {
+        case VarKind::Add: op = "add"; break;
+        case VarKind::Sub: op = "sub"; break;
+        case VarKind::Mul: op = "mul"; break;
+        case VarKind::And: op = "and"; break;
+        case VarKind::Or:  op = "or"; break;
+        case VarKind::Shl: op = "shl"; break;
+        default: op = jitc_is_uint(v) ? "lshr" : "ashr"; break;
+    }
+
+    fmt("    $v_pf$u = $s $T ", v, g_reg, op, v);
+    const Variable *args[] = { a0, a1 };
+    for (uint32_t i = 0; i < 2; ++i) {
+        if (jitc_llvm_prefetch_varying(args[i]))
+            fmt("$v_pf$u", args[i], g_reg);
+        else
+            fmt("$v", args[i]);
+        fmt("$s", i == 0 ? ", " : "\n");
+    }
+}
+
+/// Prefetch the memory that the gather 'v' will access in a future packet
+static void jitc_llvm_render_prefetch(const Variable *v, const Variable *ptr,
+                                      const Variable *index) {
+    prefetch_visited.clear();
+    jitc_llvm_render_prefetch_value(v, index);
+
+    fmt_intrinsic("declare void @llvm.prefetch({i8*}, i32, i32, i32)");
+    fmt("{    $v_pfb = bitcast i8* $v to $t*\n|}"
+         "    $v_pfa = getelementptr $t, {$t*} {$v_pfb|$v}, $T ",
+        v, ptr, v, v, v, v, v, ptr, index);
+    if (jitc_llvm_prefetch_varying(index))
+        fmt("$v_pf$u\n", index, v->reg_index);
+    else
+        fmt("$v\n", index);
+
+    for (uint32_t i = 0; i < jitc_llvm_vector_width; ++i)
+        fmt( "    $v_pfa$u = extractelement <$w x {$t*}> $v_pfa, i32 $u\n"
+            "{    $v_pfc$u = bitcast $t* $v_pfa$u to i8*\n|}"
+             "    call void @llvm.prefetch({i8*} {$v_pfc$u|$v_pfa$u}, i32 0, i32 3, i32 1)\n",
+             v, i, v, v, i,
+             v, i, v, v, i, v, i, v, i);
+}
+
 static void jitc_llvm_render_scatter(const Variable *v,
                                      const Variable *ptr,
                                      const Variable *value,
@@ -859,6 +1239,10 @@ static void jitc_llvm_render_scatter(const Variable *v,
                     op = "fadd";
                     zero_elem = "double -0.0, ";
                     intrinsic_name = "v2.fadd.f64";
+                } else if (jitc_is_half(value)) {
+                    op = "fadd";
+                    zero_elem = "half -0.0, ";
+                    intrinsic_name = "v2.fadd.f16";
                 } else {
                     op = "add";
                 }
@@ -873,6 +1257,10 @@ static void jitc_llvm_render_scatter(const Variable *v,
                     op = "fmul";
                     zero_elem = "double -0.0, ";
                     intrinsic_name = "v2.fmul.f64";
+                } else if (jitc_is_half(value)) {
+                    op = "fmul";
+                    zero_elem = "half -0.0, ";
+                    intrinsic_name = "v2.fmul.f16";
                 } else {
                     op = "mul";
                 }
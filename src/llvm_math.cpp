@@ -0,0 +1,332 @@
+/*
+    src/llvm_math.cpp -- Vectorized transcendental functions for the LLVM backend
+
+    Copyright (c) 2021 Wenzel Jakob <wenzel.jakob@epfl.ch>
+
+    All rights reserved. Use of this source code is governed by a BSD-style
+    license that can be found in the LICENSE file.
+*/
+
+/**
+ * LLVM has no vectorized counterparts of the sin/cos/exp2/log2 intrinsics
+ * (they are lowered into one libm call per lane). This file instead generates
+ * branch-free routines that use Cody-Waite range reduction and the polynomial
+ * and rational approximations of the Cephes math library. Each routine is
+ * emitted once per module as an internal function in the 'globals' section.
+ *
+ * The \c JitFlag::FastMath variants skip the handling of special cases
+ * (infinities, NaNs, denormals), use a shorter range reduction, and evaluate
+ * double precision functions using the single precision approximations.
+ */
+
+#include "internal.h"
+#include "eval.h"
+#include "llvm.h"
+#include "llvm_builder.h"
+#include "log.h"
+#include <tsl/robin_map.h>
+#include <string>
+#include <vector>
+#include <limits>
+#include <cstring>
+
+namespace {
+
+/// Helper for assembling the body of a vectorized math routine
+struct MathBuilder : LLVMBuilder {
+    MathBuilder(bool dbl, uint32_t width) : LLVMBuilder(width, dbl) { }
+
+    /// Integer constant
+    std::string i(int64_t value) {
+        return splat((dbl ? "i64 " : "i32 ") + std::to_string(value));
+    }
+
+    std::string add(const std::string &a, const std::string &b) { return op("fadd " + ft + " " + a + ", " + b); }
+    std::string sub(const std::string &a, const std::string &b) { return op("fsub " + ft + " " + a + ", " + b); }
+    std::string mul(const std::string &a, const std::string &b) { return op("fmul " + ft + " " + a + ", " + b); }
+    std::string div(const std::string &a, const std::string &b) { return op("fdiv " + ft + " " + a + ", " + b); }
+
+    std::string fcmp(const char *cond, const std::string &a, const std::string &b) {
+        return op(std::string("fcmp ") + cond + " " + ft + " " + a + ", " + b);
+    }
+
+    std::string select(const std::string &m, const std::string &a,
+                       const std::string &b, bool is_int = false) {
+        return LLVMBuilder::select(m, is_int ? it : ft, a, b);
+    }
+
+    std::string to_int(const std::string &a) { return op("bitcast " + ft + " " + a + " to " + it); }
+    std::string to_float(const std::string &a) { return op("bitcast " + it + " " + a + " to " + ft); }
+
+    std::string fma(const std::string &a, const std::string &b, const std::string &c) {
+        return intrinsic("fma", a, b, c);
+    }
+
+    /// Evaluate a polynomial with coefficients ordered by decreasing degree
+    std::string horner(const std::string &x, const double *c, size_t n) {
+        std::string r = f(c[0]);
+        for (size_t k = 1; k < n; ++k)
+            r = fma(r, x, f(c[k]));
+        return r;
+    }
+
+    template <size_t N>
+    std::string horner(const std::string &x, const double (&c)[N]) {
+        return horner(x, c, N);
+    }
+};
+
+/// Coefficients of the single precision approximations (Cephes sinf/cosf)
+const double sin_f32[] = { -1.9515295891e-4, 8.3321608736e-3, -1.6666654611e-1 };
+const double cos_f32[] = { 2.443315711809948e-5, -1.388731625493765e-3,
+                           4.166664568298827e-2 };
+
+/// Coefficients of the double precision approximations (Cephes sin/cos)
+const double sin_f64[] = { 1.58962301576546568060e-10, -2.50507477628578072866e-8,
+                           2.75573136213857245213e-6,  -1.98412698295895385996e-4,
+                           8.33333333332211858878e-3,  -1.66666666666666307295e-1 };
+const double cos_f64[] = { -1.13585365213876817300e-11, 2.08757008419747316778e-9,
+                           -2.75573141792967388112e-7,  2.48015872888517045348e-5,
+                           -1.38888888888730564116e-3,  4.16666666666665929218e-2 };
+
+/// Cephes exp2f polynomial, rational approximation of exp2()
+const double exp2_f32[] = { 1.535336188319500e-4, 1.339887440266574e-3,
+                            9.618437357674640e-3, 5.550332471162809e-2,
+                            2.402264791363012e-1, 6.931472028550421e-1 };
+const double exp2_f64_p[] = { 2.30933477057345225087e-2, 2.02020656693165307700e1,
+                              1.51390680115615096133e3 };
+const double exp2_f64_q[] = { 1.0, 2.33184211722314911771e2,
+                              4.36821166879210612817e3 };
+
+/// Cephes logf polynomial, rational approximation of log()
+const double log_f32[] = { 7.0376836292e-2, -1.1514610310e-1, 1.1676998740e-1,
+                           -1.2420140846e-1, 1.4249322787e-1, -1.6668057665e-1,
+                           2.0000714765e-1, -2.4999993993e-1, 3.3333331174e-1 };
+const double log_f64_p[] = { 1.01875663804580931796e-4, 4.97494994976747001425e-1,
+                             4.70579119878881725854e0,  1.44989225341610930846e1,
+                             1.79368678507819816313e1,  7.70838733755885391666e0 };
+const double log_f64_q[] = { 1.0, 1.12873587189167450590e1,
+                             4.52279145837532221105e1, 8.29875266912776603211e1,
+                             7.11544750618563894466e1, 2.31251620126765340583e1 };
+
+const double inf = std::numeric_limits<double>::infinity(),
+             nan = std::numeric_limits<double>::quiet_NaN();
+
+std::string sign_mask(MathBuilder &b) {
+    return b.i(b.dbl ? (int64_t) INT64_MIN : (int64_t) INT32_MIN);
+}
+
+void render_sincos(MathBuilder &b, bool cos, bool fast) {
+    bool dbl = b.dbl, precise = dbl && !fast;
+
+    // Reduce 'x' to the octant [-pi/4, pi/4]
+    std::string xa = b.intrinsic("fabs", "%x"),
+                t  = b.mul(xa, b.f(1.27323954473516268615)), // 4/pi
+                tc = b.intrinsic("minnum", t, b.f(dbl ? 0x1p62 : 0x1p30)),
+                j0 = b.op("fptosi " + b.ft + " " + tc + " to " + b.it),
+                j1 = b.iop("add", j0, b.i(1)),
+                j  = b.iop("and", j1, b.i(-2)),
+                y  = b.op("sitofp " + b.it + " " + j + " to " + b.ft);
+
+    // Extended precision modular arithmetic (Cody-Waite)
+    double dp1, dp2, dp3;
+    if (precise) {
+        dp1 = 7.85398125648498535156e-1;
+        dp2 = 3.77489470793079817668e-8;
+        dp3 = 2.69515142907905952645e-15;
+    } else {
+        dp1 = 0.78515625;
+        dp2 = 2.4187564849853515625e-4;
+        dp3 = 3.77489497744594108e-8;
+    }
+
+    std::string r = b.fma(y, b.f(-dp1), xa);
+    if (fast && !dbl) {
+        r = b.fma(y, b.f(-(dp2 + dp3)), r);
+    } else {
+        r = b.fma(y, b.f(-dp2), r);
+        r = b.fma(y, b.f(-dp3), r);
+    }
+
+    std::string z = b.mul(r, r), s, c;
+    if (precise) {
+        s = b.mul(b.horner(z, sin_f64), z);
+        c = b.mul(b.horner(z, cos_f64), b.mul(z, z));
+    } else {
+        s = b.mul(b.horner(z, sin_f32), z);
+        c = b.mul(b.horner(z, cos_f32), b.mul(z, z));
+    }
+    s = b.fma(s, r, r);
+    c = b.add(b.fma(z, b.f(-0.5), c), b.f(1.0));
+
+    // Select the polynomial and the sign based on the octant
+    std::string shift = b.i(dbl ? 61 : 29),
+                poly  = b.op("icmp eq " + b.it + " " + b.iop("and", j, b.i(2)) +
+                             ", " + b.i(0)),
+                result, sign;
+
+    if (!cos) {
+        result = b.select(poly, s, c);
+        sign = b.iop("xor", b.iop("and", b.to_int("%x"), sign_mask(b)),
+                     b.iop("and", b.iop("shl", j, shift), sign_mask(b)));
+    } else {
+        result = b.select(poly, c, s);
+        sign = b.iop("and",
+                     b.iop("shl", b.iop("xor", b.iop("sub", j, b.i(2)), b.i(-1)),
+                           shift),
+                     sign_mask(b));
+    }
+
+    result = b.to_float(b.iop("xor", b.to_int(result), sign));
+
+    // Infinite arguments produce a NaN
+    if (!fast)
+        result = b.select(b.fcmp("oeq", xa, b.f(inf)), b.f(nan), result);
+
+    b.body += "    ret " + b.ft + " " + result + "\n";
+}
+
+void render_exp2(MathBuilder &b, bool fast) {
+    bool dbl = b.dbl, precise = dbl && !fast;
+    int bias = dbl ? 1023 : 127, mant = dbl ? 52 : 23;
+
+    /* Clamp to the range where the result is finite and nonzero. The scale
+       factor 2^n is split into two factors to also reach the denormals. */
+    double lo = fast ? (double) (1 - bias) : (double) -(bias + mant),
+           hi = (double) (bias + 1);
+
+    std::string xc = b.intrinsic("minnum", b.intrinsic("maxnum", "%x", b.f(lo)), b.f(hi)),
+                n  = b.intrinsic("floor", b.add(xc, b.f(0.5))),
+                x  = b.sub(xc, n), r;
+
+    if (precise) {
+        std::string xx = b.mul(x, x),
+                    px = b.mul(x, b.horner(xx, exp2_f64_p)),
+                    qx = b.horner(xx, exp2_f64_q);
+        r = b.div(px, b.sub(qx, px));
+        r = b.fma(r, b.f(2.0), b.f(1.0));
+    } else {
+        r = b.fma(b.horner(x, exp2_f32), x, b.f(1.0));
+    }
+
+    std::string ni = b.op("fptosi " + b.ft + " " + n + " to " + b.it);
+    if (fast) {
+        std::string scale = b.iop("shl", b.iop("add", ni, b.i(bias)), b.i(mant));
+        r = b.mul(r, b.to_float(scale));
+    } else {
+        std::string n1 = b.iop("ashr", ni, b.i(1)),
+                    n2 = b.iop("sub", ni, n1),
+                    s1 = b.iop("shl", b.iop("add", n1, b.i(bias)), b.i(mant)),
+                    s2 = b.iop("shl", b.iop("add", n2, b.i(bias)), b.i(mant));
+        r = b.mul(b.mul(r, b.to_float(s1)), b.to_float(s2));
+        r = b.select(b.fcmp("uno", "%x", "%x"), "%x", r);
+    }
+
+    b.body += "    ret " + b.ft + " " + r + "\n";
+}
+
+void render_log2(MathBuilder &b, bool fast) {
+    bool dbl = b.dbl, precise = dbl && !fast;
+    int bias = dbl ? 1023 : 127, mant = dbl ? 52 : 23;
+
+    std::string x = "%x", e_adj;
+    if (!fast) {
+        // Move denormals into the normal range
+        std::string dn = b.fcmp("olt", x, b.f(dbl ? 0x1p-1022 : 0x1p-126));
+        x = b.select(dn, b.mul(x, b.f(dbl ? 0x1p52 : 0x1p23)), x);
+        e_adj = b.select(dn, b.i(-mant), b.i(0), true);
+    }
+
+    // Decompose into mantissa 'm' in [sqrt(1/2), sqrt(2)) and exponent 'e'
+    std::string xi = b.to_int(x),
+                e  = b.iop("sub", b.iop("lshr", xi, b.i(mant)), b.i(bias)),
+                mi = b.iop("or", b.iop("and", xi, b.i(((int64_t) 1 << mant) - 1)),
+                           b.i((int64_t) bias << mant)),
+                m  = b.to_float(mi),
+                big = b.fcmp("ogt", m, b.f(1.41421356237309504880));
+
+    m = b.select(big, b.mul(m, b.f(0.5)), m);
+    e = b.iop("add", e, b.op("zext " + b.bt + " " + big + " to " + b.it));
+    if (!fast)
+        e = b.iop("add", e, e_adj);
+
+    std::string f = b.sub(m, b.f(1.0)),
+                z = b.mul(f, f), y;
+
+    if (precise)
+        y = b.mul(f, b.div(b.mul(z, b.horner(f, log_f64_p)),
+                           b.horner(f, log_f64_q)));
+    else
+        y = b.mul(b.mul(b.horner(f, log_f32), f), z);
+    y = b.fma(z, b.f(-0.5), y);
+
+    // log2(x) = (y + f) * log2(e) + e, with log2(e) - 1 split off
+    const double log2ea = 0.44269504088896340735992;
+    std::string r = b.mul(y, b.f(log2ea));
+    r = b.fma(f, b.f(log2ea), r);
+    r = b.add(r, y);
+    r = b.add(r, f);
+    r = b.add(r, b.op("sitofp " + b.it + " " + e + " to " + b.ft));
+
+    if (!fast) {
+        r = b.select(b.fcmp("oeq", "%x", b.f(0.0)), b.f(-inf), r);
+        r = b.select(b.fcmp("olt", "%x", b.f(0.0)), b.f(nan), r);
+        r = b.select(b.fcmp("oeq", "%x", b.f(inf)), b.f(inf), r);
+        r = b.select(b.fcmp("uno", "%x", "%x"), "%x", r);
+    }
+
+    b.body += "    ret " + b.ft + " " + r + "\n";
+}
+
+struct MathRoutine {
+    std::string name;
+    std::vector<std::string> globals;
+};
+
+/// Cache of generated routines, keyed by function, type, width, and variant
+tsl::robin_map<uint64_t, MathRoutine> math_routines;
+
+} // namespace
+
+const char *jitc_llvm_math_func(VarKind kind, VarType type, bool fast) {
+    const char *fname;
+    switch (kind) {
+        case VarKind::Sin:  fname = "sin"; break;
+        case VarKind::Cos:  fname = "cos"; break;
+        case VarKind::Exp2: fname = "exp2"; break;
+        case VarKind::Log2: fname = "log2"; break;
+        default:
+            jitc_fail("jitc_llvm_math_func(): unsupported operation!");
+    }
+
+    bool dbl = type == VarType::Float64;
+    if (type != VarType::Float32 && !dbl)
+        jitc_fail("jitc_llvm_math_func(): unsupported type!");
+
+    uint64_t key = (uint64_t) kind | ((uint64_t) dbl << 8) |
+                   ((uint64_t) fast << 9) |
+                   ((uint64_t) jitc_llvm_vector_width << 32);
+
+    auto it = math_routines.find(key);
+    if (it == math_routines.end()) {
+        MathBuilder b(dbl, jitc_llvm_vector_width);
+
+        switch (kind) {
+            case VarKind::Sin:  render_sincos(b, false, fast); break;
+            case VarKind::Cos:  render_sincos(b, true, fast); break;
+            case VarKind::Exp2: render_exp2(b, fast); break;
+            default:            render_log2(b, fast); break;
+        }
+
+        MathRoutine routine;
+        routine.name = std::string("drjit_") + fname + (fast ? "_fast" : "") +
+                       "_v" + b.w + b.h;
+        routine.globals = b.finish(b.ft, routine.name, b.ft + " %x");
+        it = math_routines.emplace(key, std::move(routine)).first;
+    }
+
+    for (const std::string &s : it->second.globals)
+        jitc_register_global(s.c_str());
+
+    return it->second.name.c_str();
+}
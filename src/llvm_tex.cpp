@@ -0,0 +1,663 @@
+/*
+    src/llvm_tex.cpp -- Texture objects and lookups for the LLVM backend
+
+    Copyright (c) 2021 Wenzel Jakob <wenzel.jakob@epfl.ch>
+
+    All rights reserved. Use of this source code is governed by a BSD-style
+    license that can be found in the LICENSE file.
+*/
+
+/**
+ * Textures on the LLVM backend mirror the interface of the CUDA version: the
+ * channels are partitioned into groups of (up to) 4, each of which is stored
+ * in a separate buffer and accessed using a separate \c VarKind::TexLookup
+ * node. Groups with 3 channels are padded to 4 channels.
+ *
+ * Each buffer begins with a 16-byte header storing the texture shape, which
+ * is followed by the texels in a pitch-linear layout with a border of one
+ * texel on each side of every dimension. The border replicates the texels
+ * selected by the wrap mode, which has the following consequence: the two
+ * texels that are interpolated along the X axis are always adjacent in
+ * memory. Each pair of them is fetched using 64-bit gathers that load two
+ * channels at once, hence a bilinear lookup of a 4-channel texture requires
+ * only 8 gathers instead of the 16 needed when fetching channels one by one.
+ *
+ * The lookup itself is a single node that calls a routine that is generated
+ * once per module for each combination of dimension, filter mode, wrap mode,
+ * and channel count. The shape is read from the header at runtime so that
+ * kernels can be reused for textures of different resolution.
+ */
+
+#include "llvm_tex.h"
+#include "internal.h"
+#include "llvm.h"
+#include "llvm_builder.h"
+#include "log.h"
+#include "var.h"
+#include "eval.h"
+#include "malloc.h"
+#include <tsl/robin_map.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstring>
+
+/// Size of the header storing the texture shape
+static constexpr size_t TexHeaderSize = 16;
+
+struct DrJitLlvmTexture {
+    size_t ndim; /// Dimension of the texture
+    size_t shape[3]; /// Shape of the texture (unused entries are set to 1)
+    size_t n_channels; /// Total number of channels
+    size_t n_textures; /// Number of channel groups
+    int filter_mode; /// 0: nearest, 1: linear
+    int wrap_mode; /// 0: repeat, 1: clamp, 2: mirror
+    std::atomic_size_t n_referenced_textures; /// Number of referenced groups
+    std::unique_ptr<void *[]> buffers; /// Memory of each channel group
+    std::unique_ptr<uint32_t[]> indices; /// Pointer variables of each group
+
+    DrJitLlvmTexture(size_t ndim, const size_t *shape_, size_t n_channels,
+                     int filter_mode, int wrap_mode)
+        : ndim(ndim), n_channels(n_channels),
+          n_textures(1 + ((n_channels - 1) / 4)), filter_mode(filter_mode),
+          wrap_mode(wrap_mode), n_referenced_textures(n_textures),
+          buffers(std::make_unique<void *[]>(n_textures)),
+          indices(std::make_unique<uint32_t[]>(n_textures)) {
+        for (size_t i = 0; i < 3; ++i)
+            shape[i] = i < ndim ? shape_[i] : 1;
+    }
+
+    /// Number of channels from the original data stored in channel group 'index'
+    size_t channels(size_t index) const {
+        size_t tex_channels = 4;
+        if (index == n_textures - 1) {
+            tex_channels = n_channels % 4;
+            if (tex_channels == 0)
+                tex_channels = 4;
+        }
+        return tex_channels;
+    }
+
+    /// Number of channels (either 1, 2, or 4) stored per texel in group 'index'
+    size_t channels_internal(size_t index) const {
+        const size_t channels_raw = channels(index);
+        return (channels_raw == 3) ? 4 : channels_raw;
+    }
+
+    /// Extent of dimension 'dim' including the border
+    size_t padded(size_t dim) const {
+        return dim < ndim ? shape[dim] + 2 : 1;
+    }
+
+    /// Total number of texels including the border
+    size_t padded_texels() const {
+        return padded(0) * padded(1) * padded(2);
+    }
+
+    /// Map a (possibly out-of-range) border coordinate onto the texture
+    size_t wrap(int64_t i, size_t dim) const {
+        int64_t size = (int64_t) shape[dim];
+        if (i < 0)
+            i = wrap_mode == 0 ? size - 1 : 0;
+        else if (i >= size)
+            i = wrap_mode == 0 ? 0 : size - 1;
+        return (size_t) i;
+    }
+
+    /**
+     * \brief Releases the memory of the channel group at the given index and
+     * returns whether or not there is at least one group that is still not
+     * released.
+     */
+    bool release_texture(size_t index) {
+        jitc_free(buffers[index]);
+        return (--n_referenced_textures) > 0;
+    }
+};
+
+struct LlvmTextureReleasePayload {
+    DrJitLlvmTexture* texture;
+    size_t index;
+};
+
+void *jitc_llvm_tex_create(size_t ndim, const size_t *shape, size_t n_channels,
+                           int filter_mode, int wrap_mode) {
+    if (ndim < 1 || ndim > 3)
+        jitc_raise("jit_llvm_tex_create(): invalid texture dimension!");
+    else if (n_channels == 0)
+        jitc_raise("jit_llvm_tex_create(): must have at least 1 channel!");
+    else if (filter_mode < 0 || filter_mode > 1)
+        jitc_raise("jit_llvm_tex_create(): invalid filter mode!");
+    else if (wrap_mode < 0 || wrap_mode > 2)
+        jitc_raise("jit_llvm_tex_create(): invalid wrap mode!");
+
+    for (size_t i = 0; i < ndim; ++i) {
+        // Generated code performs 32-bit arithmetic on '2 * shape[i]'
+        if (shape[i] == 0 || shape[i] >= (1u << 29))
+            jitc_raise("jit_llvm_tex_create(): invalid shape!");
+    }
+
+    DrJitLlvmTexture *texture = new DrJitLlvmTexture(
+        ndim, shape, n_channels, filter_mode, wrap_mode);
+
+    for (size_t tex = 0; tex < texture->n_textures; ++tex) {
+        size_t size = TexHeaderSize + texture->padded_texels() *
+                                      texture->channels_internal(tex) *
+                                      sizeof(float);
+
+        void *buffer = jitc_malloc(AllocType::HostAsync, size);
+        texture->buffers[tex] = buffer;
+
+        /* The buffer is written by the host (see below), wait for pending
+           kernels that may still be using a previous allocation. */
+        jitc_sync_thread(thread_state(JitBackend::LLVM));
+
+        uint32_t *header = (uint32_t *) buffer;
+        for (size_t i = 0; i < 3; ++i)
+            header[i] = (uint32_t) texture->shape[i];
+        header[3] = 0;
+        memset((uint8_t *) buffer + TexHeaderSize, 0, size - TexHeaderSize);
+
+        texture->indices[tex] =
+            jitc_var_pointer(JitBackend::LLVM, buffer, 0, 0);
+
+        LlvmTextureReleasePayload *payload_ptr =
+            new LlvmTextureReleasePayload({ texture, tex });
+
+        jitc_var_set_callback(
+            texture->indices[tex],
+            [](uint32_t /* index */, int free, void *callback_data) {
+                if (free) {
+                    LlvmTextureReleasePayload& payload =
+                        *((LlvmTextureReleasePayload *) callback_data);
+
+                    DrJitLlvmTexture *texture = payload.texture;
+                    size_t tex = payload.index;
+
+                    if (!texture->release_texture(tex))
+                        delete texture;
+
+                    delete &payload;
+                }
+            },
+            (void *) payload_ptr
+        );
+    }
+
+    jitc_log(LogLevel::Debug, "jitc_llvm_tex_create(): " DRJIT_PTR,
+             (uintptr_t) texture);
+
+    return (void *) texture;
+}
+
+void jitc_llvm_tex_get_shape(size_t ndim, const void *texture_handle,
+                             size_t *shape) {
+    const DrJitLlvmTexture &texture = *((const DrJitLlvmTexture *) texture_handle);
+    if (ndim != texture.ndim)
+        jitc_raise("jit_llvm_tex_get_shape(): invalid texture dimension!");
+
+    for (size_t i = 0; i < ndim; ++i)
+        shape[i] = texture.shape[i];
+    shape[ndim] = texture.n_channels;
+}
+
+static void jitc_llvm_tex_check_shape(const char *name, size_t ndim,
+                                      const size_t *shape,
+                                      const DrJitLlvmTexture &texture) {
+    if (ndim != texture.ndim)
+        jitc_raise("%s(): invalid texture dimension!", name);
+    for (size_t i = 0; i < ndim; ++i) {
+        if (shape[i] != texture.shape[i])
+            jitc_raise("%s(): shape mismatch in dimension %zu!", name, i);
+    }
+}
+
+void jitc_llvm_tex_memcpy_d2t(size_t ndim, const size_t *shape,
+                              const void *src_ptr, void *dst_texture_handle) {
+    DrJitLlvmTexture &tex = *((DrJitLlvmTexture *) dst_texture_handle);
+    jitc_llvm_tex_check_shape("jit_llvm_tex_memcpy_d2t", ndim, shape, tex);
+
+    // The source may be produced by a kernel that is still running
+    jitc_sync_thread(thread_state(JitBackend::LLVM));
+
+    const float *src = (const float *) src_ptr;
+    size_t p0 = tex.padded(0), p1 = tex.padded(1), p2 = tex.padded(2),
+           b0 = ndim >= 1, b1 = ndim >= 2, b2 = ndim >= 3;
+
+    for (size_t ti = 0, ch_offset = 0; ti < tex.n_textures; ++ti) {
+        size_t ch = tex.channels(ti), ch_int = tex.channels_internal(ti);
+        float *dst = (float *) ((uint8_t *) tex.buffers[ti] + TexHeaderSize);
+
+        // Fill the interior and the border, replicating texels as needed
+        for (size_t z = 0; z < p2; ++z) {
+            size_t sz = tex.wrap((int64_t) z - (int64_t) b2, 2);
+            for (size_t y = 0; y < p1; ++y) {
+                size_t sy = tex.wrap((int64_t) y - (int64_t) b1, 1);
+                for (size_t x = 0; x < p0; ++x) {
+                    size_t sx = tex.wrap((int64_t) x - (int64_t) b0, 0);
+                    const float *s =
+                        src + ((sz * tex.shape[1] + sy) * tex.shape[0] + sx) *
+                                  tex.n_channels + ch_offset;
+                    float *d = dst + ((z * p1 + y) * p0 + x) * ch_int;
+                    for (size_t c = 0; c < ch_int; ++c)
+                        d[c] = c < ch ? s[c] : 0.f;
+                }
+            }
+        }
+
+        ch_offset += ch;
+    }
+}
+
+void jitc_llvm_tex_memcpy_t2d(size_t ndim, const size_t *shape,
+                              const void *src_texture_handle, void *dst_ptr) {
+    const DrJitLlvmTexture &tex = *((const DrJitLlvmTexture *) src_texture_handle);
+    jitc_llvm_tex_check_shape("jit_llvm_tex_memcpy_t2d", ndim, shape, tex);
+
+    // The destination may still be accessed by a running kernel
+    jitc_sync_thread(thread_state(JitBackend::LLVM));
+
+    float *dst = (float *) dst_ptr;
+    size_t p0 = tex.padded(0), p1 = tex.padded(1),
+           b0 = ndim >= 1, b1 = ndim >= 2, b2 = ndim >= 3;
+
+    for (size_t ti = 0, ch_offset = 0; ti < tex.n_textures; ++ti) {
+        size_t ch = tex.channels(ti), ch_int = tex.channels_internal(ti);
+        const float *src =
+            (const float *) ((const uint8_t *) tex.buffers[ti] + TexHeaderSize);
+
+        for (size_t z = 0; z < tex.shape[2]; ++z) {
+            for (size_t y = 0; y < tex.shape[1]; ++y) {
+                for (size_t x = 0; x < tex.shape[0]; ++x) {
+                    const float *s =
+                        src + (((z + b2) * p1 + y + b1) * p0 + x + b0) * ch_int;
+                    float *d = dst + ((z * tex.shape[1] + y) * tex.shape[0] + x) *
+                                         tex.n_channels + ch_offset;
+                    for (size_t c = 0; c < ch; ++c)
+                        d[c] = s[c];
+                }
+            }
+        }
+
+        ch_offset += ch;
+    }
+}
+
+static Variable jitc_llvm_tex_check(size_t ndim, const uint32_t *pos) {
+    // Validate input types, determine size of the operation
+    uint32_t size = 0;
+    bool dirty = false, placeholder = false;
+
+    for (size_t i = 0; i < ndim; ++i) {
+        const Variable *v = jitc_var(pos[i]);
+        if ((VarType) v->type != VarType::Float32)
+            jitc_raise("jit_llvm_tex_lookup(): type mismatch for arg. %zu (got "
+                       "%s, expected %s)", i, type_name[v->type],
+                       type_name[(int) VarType::Float32]);
+        if ((JitBackend) v->backend != JitBackend::LLVM)
+            jitc_raise("jit_llvm_tex_lookup(): arg. %zu is not an LLVM "
+                       "variable!", i);
+        size = std::max(size, v->size);
+        dirty |= v->is_dirty();
+        placeholder |= (bool) v->placeholder;
+    }
+
+    for (size_t i = 0; i < ndim; ++i) {
+        const Variable *v = jitc_var(pos[i]);
+        if (v->size != 1 && v->size != size)
+            jitc_raise("jit_llvm_tex_lookup(): arithmetic involving arrays of "
+                       "incompatible size!");
+    }
+
+    if (dirty) {
+        jitc_eval(thread_state(JitBackend::LLVM));
+        for (size_t i = 0; i < ndim; ++i) {
+            if (jitc_var(pos[i])->is_dirty())
+                jitc_fail("jit_llvm_tex_lookup(): operand r%u remains dirty "
+                          "following evaluation!", pos[i]);
+        }
+    }
+
+    Variable v;
+    v.size = size;
+    v.backend = (uint32_t) JitBackend::LLVM;
+    v.placeholder = placeholder;
+    v.type = (uint32_t) VarType::Float32;
+    return v;
+}
+
+void jitc_llvm_tex_lookup(size_t ndim, const void *texture_handle,
+                          const uint32_t *pos, uint32_t *out) {
+    const DrJitLlvmTexture &tex = *((const DrJitLlvmTexture *) texture_handle);
+    if (ndim != tex.ndim)
+        jitc_raise("jit_llvm_tex_lookup(): invalid texture dimension!");
+
+    Variable v = jitc_llvm_tex_check(ndim, pos);
+
+    for (size_t ti = 0; ti < tex.n_textures; ++ti) {
+        // Perform a lookup per channel group ..
+        v.kind = VarKind::TexLookup;
+        v.literal = (uint64_t) tex.channels_internal(ti) |
+                    ((uint64_t) tex.filter_mode << 8) |
+                    ((uint64_t) tex.wrap_mode << 16);
+        memset(v.dep, 0, sizeof(v.dep));
+        v.dep[0] = tex.indices[ti];
+        jitc_var_inc_ref(tex.indices[ti]);
+        for (size_t j = 0; j < ndim; ++j) {
+            v.dep[j + 1] = pos[j];
+            jitc_var_inc_ref(pos[j]);
+        }
+        Ref tex_load = steal(jitc_var_new(v));
+
+        // .. and then extract components
+        v.kind = VarKind::Extract;
+        memset(v.dep, 0, sizeof(v.dep));
+        for (size_t ch = 0; ch < tex.channels(ti); ++ch) {
+            v.literal = (uint64_t) ch;
+            v.dep[0] = tex_load;
+            jitc_var_inc_ref(tex_load);
+            *out++ = jitc_var_new(v);
+        }
+    }
+}
+
+void jitc_llvm_tex_destroy(void *texture_handle) {
+    if (!texture_handle)
+        return;
+
+    jitc_log(LogLevel::Debug, "jitc_llvm_tex_destroy(" DRJIT_PTR ")",
+             (uintptr_t) texture_handle);
+
+    DrJitLlvmTexture *texture = (DrJitLlvmTexture *) texture_handle;
+
+    /* The `texture` struct can potentially be deleted when decreasing the
+       reference count of the individual channel groups. We must hoist the
+       number of groups out of the loop condition. */
+    const size_t n_textures = texture->n_textures;
+    for (size_t tex = 0; tex < n_textures; ++tex)
+        jitc_var_dec_ref(texture->indices[tex]);
+}
+
+// ===========================================================================
+// Generation of the lookup routines
+// ===========================================================================
+
+namespace {
+
+/// Helper for assembling the body of a texture lookup routine
+struct TexBuilder : LLVMBuilder {
+    TexBuilder(uint32_t width) : LLVMBuilder(width) {
+        lt = "<" + w + " x i64>";
+    }
+
+    std::string i(int32_t value) { return splat("i32 " + std::to_string(value)); }
+    std::string l(int64_t value) { return splat("i64 " + std::to_string(value)); }
+
+    std::string fop(const char *name, const std::string &a, const std::string &b) {
+        return op(std::string(name) + " " + ft + " " + a + ", " + b);
+    }
+
+    std::string lop(const char *name, const std::string &a, const std::string &b) {
+        return op(std::string(name) + " " + lt + " " + a + ", " + b);
+    }
+
+    /// Broadcast the scalar 'value' of type 'type' to a vector of type 'vtype'
+    std::string broadcast(const char *type, const std::string &vtype,
+                          const std::string &value) {
+        std::string r = op("insertelement " + vtype + " undef, " + type + " " +
+                           value + ", i32 0");
+        return op("shufflevector " + vtype + " " + r + ", " + vtype +
+                  " undef, <" + w + " x i32> zeroinitializer");
+    }
+
+    /// Non-negative remainder of 'a' (arbitrary sign) and 'b' (positive)
+    std::string posmod(const std::string &a, const std::string &b) {
+        std::string r = iop("srem", a, b),
+                    n = iop("icmp slt", r, i(0));
+        return select(n, it, iop("add", r, b), r);
+    }
+
+    /// Linear interpolation between 'a' and 'b' with weights '1 - t' and 't'
+    std::string lerp(const std::string &a, const std::string &b,
+                     const std::string &t, const std::string &t1) {
+        return intrinsic("fma", t, b, fop("fmul", t1, a));
+    }
+
+    /**
+     * \brief Gather 'count' consecutive floats per lane starting at the
+     * addresses 'p' (a vector of float pointers). Pairs of floats are fetched
+     * using a single 64-bit gather.
+     */
+    void load(const std::string &p, uint32_t count, std::vector<std::string> &out) {
+        std::string ones = splat("i1 true"),
+                    pf = "<" + w + " x " + ptr("float") + ">",
+                    pl = "<" + w + " x " + ptr("i64") + ">";
+
+        if (count == 1) {
+            decls.emplace_back("declare " + ft + " @llvm.masked.gather.v" + w +
+                               "f32(" + pf + ", i32, " + bt + ", " + ft + ")");
+            out.push_back(op("call " + ft + " @llvm.masked.gather.v" + w +
+                             "f32(" + pf + " " + p + ", i32 4, " + bt + " " +
+                             ones + ", " + ft + " zeroinitializer)"));
+            return;
+        }
+
+        decls.emplace_back("declare " + lt + " @llvm.masked.gather.v" + w +
+                           "i64(" + pl + ", i32, " + bt + ", " + lt + ")");
+
+        for (uint32_t k = 0; k < count; k += 2) {
+            std::string q = p;
+            if (k)
+                q = op("getelementptr float, " + pf + " " + p + ", i64 " +
+                       std::to_string(k));
+            if (!jitc_llvm_opaque_pointers)
+                q = op("bitcast " + pf + " " + q + " to " + pl);
+
+            std::string g = op("call " + lt + " @llvm.masked.gather.v" + w +
+                               "i64(" + pl + " " + q + ", i32 4, " + bt + " " +
+                               ones + ", " + lt + " zeroinitializer)"),
+                        lo = op("trunc " + lt + " " + g + " to " + it),
+                        hi = op("trunc " + lt + " " + lop("lshr", g, l(32)) +
+                                " to " + it);
+            out.push_back(op("bitcast " + it + " " + lo + " to " + ft));
+            out.push_back(op("bitcast " + it + " " + hi + " to " + ft));
+        }
+    }
+
+    std::string lt;
+};
+
+/**
+ * \brief Compute the index of the texel along one dimension of the padded
+ * texture (i.e. including the border).
+ *
+ * When 'linear' is true, the returned index refers to the lower of the two
+ * texels being interpolated, and 'weight' and 'weight_1' receive the weight
+ * of the upper and lower texel, respectively.
+ */
+void render_coord(TexBuilder &b, const std::string &pos, const std::string &size,
+                  bool linear, int wrap_mode, std::string &index,
+                  std::string &weight, std::string &weight_1) {
+    std::string size_f = b.op("sitofp " + b.it + " " + size + " to " + b.ft),
+                u = b.fop("fmul", pos, size_f);
+
+    if (linear)
+        u = b.fop("fsub", u, b.f(0.5));
+
+    // Keep the conversion below in range (this also takes care of NaNs)
+    u = b.intrinsic("minnum", u, b.f(1 << 30));
+    u = b.intrinsic("maxnum", u, b.f(-(1 << 30)));
+
+    std::string u_floor = b.intrinsic("floor", u),
+                i = b.op("fptosi " + b.ft + " " + u_floor + " to " + b.it);
+
+    if (linear)
+        weight = b.fop("fsub", u, u_floor);
+
+    switch (wrap_mode) {
+        case 0: // Repeat, the border stores the texels of the opposite side
+            index = b.posmod(i, size);
+            break;
+
+        case 1: { // Clamp, the border replicates the outermost texels
+                std::string lower = b.i(linear ? -1 : 0),
+                            upper = b.iop("add", size, b.i(-1));
+                index = b.select(b.iop("icmp slt", i, lower), b.it, lower, i);
+                index = b.select(b.iop("icmp sgt", index, upper), b.it, upper, index);
+            }
+            break;
+
+        default: { // Mirror, reflected periods traverse the texels in reverse
+                std::string size_2 = b.iop("add", size, size),
+                            t = b.posmod(i, size_2),
+                            back = b.iop("icmp sge", t, size),
+                            t_back = b.iop("sub", b.iop("add", size_2,
+                                                        b.i(linear ? -2 : -1)), t);
+                index = b.select(back, b.it, t_back, t);
+                if (linear)
+                    weight = b.select(back, b.ft,
+                                      b.fop("fsub", b.f(1.0), weight), weight);
+            }
+            break;
+    }
+
+    // Skip the border
+    index = b.iop("add", index, b.i(1));
+
+    if (linear)
+        weight_1 = b.fop("fsub", b.f(1.0), weight);
+}
+
+struct TexRoutine {
+    std::string name, ret_type;
+    std::vector<std::string> globals;
+};
+
+/// Cache of generated routines, keyed by dimension, mode, channels, and width
+tsl::robin_map<uint64_t, TexRoutine> tex_routines;
+
+} // namespace
+
+const char *jitc_llvm_tex_func(uint32_t ndim, uint64_t literal,
+                               const char **ret_type) {
+    uint32_t channels  = (uint32_t) (literal & 0xFF),
+             linear    = (uint32_t) ((literal >> 8) & 0xFF),
+             wrap_mode = (uint32_t) ((literal >> 16) & 0xFF);
+
+    if (ndim < 1 || ndim > 3 || (channels != 1 && channels != 2 && channels != 4))
+        jitc_fail("jitc_llvm_tex_func(): invalid texture configuration!");
+
+    uint64_t key = (uint64_t) ndim | ((literal & 0xFFFFFF) << 8) |
+                   ((uint64_t) jitc_llvm_opaque_pointers << 32) |
+                   ((uint64_t) jitc_llvm_vector_width << 40);
+
+    auto it = tex_routines.find(key);
+    if (it == tex_routines.end()) {
+        TexBuilder b(jitc_llvm_vector_width);
+        const char *wrap_names[3] = { "repeat", "clamp", "mirror" };
+
+        // Load the shape from the header
+        std::string base_i32 = "%tex", base_f32 = "%tex";
+        if (!jitc_llvm_opaque_pointers) {
+            base_i32 = b.op("bitcast i8* %tex to i32*");
+            base_f32 = b.op("bitcast i8* %tex to float*");
+        }
+
+        std::string size[3], index[3], weight[3], weight_1[3];
+        for (uint32_t k = 0; k < ndim; ++k) {
+            std::string p = b.op("getelementptr inbounds i32, " + b.ptr("i32") +
+                                 " " + base_i32 + ", i32 " + std::to_string(k)),
+                        s = b.op("load i32, " + b.ptr("i32") + " " + p + ", align 4");
+            size[k] = b.broadcast("i32", b.it, s);
+            render_coord(b, "%p" + std::to_string(k), size[k], linear, wrap_mode,
+                         index[k], weight[k], weight_1[k]);
+        }
+
+        // Linearize the texel index and compute the strides of rows and slices
+        std::string offset, stride[3];
+        stride[0] = b.l(1);
+        for (uint32_t k = 0; k < ndim; ++k) {
+            std::string idx = b.op("zext " + b.it + " " + index[k] + " to " + b.lt),
+                        padded = b.op("zext " + b.it + " " +
+                                      b.iop("add", size[k], b.i(2)) + " to " + b.lt);
+            offset = k == 0 ? idx
+                            : b.lop("add", b.lop("mul", idx, stride[k]), offset);
+            if (k + 1 < ndim)
+                stride[k + 1] = k == 0 ? padded : b.lop("mul", stride[k], padded);
+        }
+
+        // Turn texel indices into pointers, skipping the header
+        auto texel_ptr = [&](const std::string &offset) {
+            std::string o = b.lop("add", b.lop("mul", offset, b.l(channels)),
+                                  b.l(TexHeaderSize / sizeof(float)));
+            return b.op("getelementptr float, " + b.ptr("float") + " " +
+                        base_f32 + ", " + b.lt + " " + o);
+        };
+
+        std::vector<std::string> result;
+        if (!linear) {
+            b.load(texel_ptr(offset), channels, result);
+        } else {
+            /* Fetch pairs of adjacent texels along X for each of the 1/2/4
+               rows of the footprint and interpolate them */
+            uint32_t n_rows = 1u << (ndim - 1);
+            std::vector<std::vector<std::string>> rows(n_rows);
+            for (uint32_t r = 0; r < n_rows; ++r) {
+                std::string o = offset;
+                for (uint32_t k = 1; k < ndim; ++k) {
+                    if (r & (1u << (k - 1)))
+                        o = b.lop("add", o, stride[k]);
+                }
+
+                std::vector<std::string> pair;
+                b.load(texel_ptr(o), 2 * channels, pair);
+                for (uint32_t c = 0; c < channels; ++c)
+                    rows[r].push_back(b.lerp(pair[c], pair[channels + c],
+                                             weight[0], weight_1[0]));
+            }
+
+            // Interpolate along Y, then Z
+            for (uint32_t k = 1; k < ndim; ++k) {
+                uint32_t step = 1u << (k - 1);
+                for (uint32_t r = 0; r < n_rows; r += 2 * step) {
+                    for (uint32_t c = 0; c < channels; ++c)
+                        rows[r][c] = b.lerp(rows[r][c], rows[r + step][c],
+                                            weight[k], weight_1[k]);
+                }
+            }
+
+            result = rows[0];
+        }
+
+        TexRoutine routine;
+        routine.ret_type = "{";
+        for (uint32_t c = 0; c < channels; ++c)
+            routine.ret_type += (c ? ", " : " ") + b.ft;
+        routine.ret_type += " }";
+
+        std::string agg = "undef";
+        for (uint32_t c = 0; c < channels; ++c)
+            agg = b.op("insertvalue " + routine.ret_type + " " + agg + ", " +
+                       b.ft + " " + result[c] + ", " + std::to_string(c));
+        b.body += "    ret " + routine.ret_type + " " + agg + "\n";
+
+        routine.name = "drjit_tex" + std::to_string(ndim) + "d_" +
+                       (linear ? "linear_" : "nearest_") +
+                       wrap_names[wrap_mode] + "_c" + std::to_string(channels) +
+                       "_v" + b.w;
+
+        std::string args = b.ptr("i8") + " %tex";
+        for (uint32_t k = 0; k < ndim; ++k)
+            args += ", " + b.ft + " %p" + std::to_string(k);
+
+        routine.globals = b.finish(routine.ret_type, routine.name, args);
+        it = tex_routines.emplace(key, std::move(routine)).first;
+    }
+
+    for (const std::string &s : it->second.globals)
+        jitc_register_global(s.c_str());
+
+    *ret_type = it->second.ret_type.c_str();
+    return it->second.name.c_str();
+}
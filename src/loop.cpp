@@ -4,7 +4,6 @@
 #include "eval.h"
 #include "op.h"
 #include "profiler.h"
-#include <tsl/robin_set.h>
 
 struct Loop {
     // A descriptive name
@@ -21,6 +20,9 @@ struct Loop {
     uint32_t se = 0;
     /// Number of side effects
     uint32_t se_count = 0;
+    /// Does the loop body have side effects? (unlike 'se_count', this isn't
+    /// reset once the side effects have been assembled)
+    bool has_side_effects = false;
     /// Storage size in bytes for all variables before simplification
     uint32_t storage_size_initial = 0;
     /// Input variables before loop
@@ -43,6 +45,17 @@ struct Loop {
 
 static std::vector<Loop *> loops;
 
+/// Loop compiled with lane refilling in the kernel being assembled (LLVM)
+static Loop *refill_loop = nullptr;
+
+/// Phi node templates for the loop state at the top of the condition block (LLVM)
+static const char *llvm_phi_cond =
+    "$r0 = phi <$w x $t0> [ $r0_final, %l_$i2_tail ], [ $r1, %l_$i2_start ]";
+static const char *llvm_phi_cond_invariant =
+    "$r0 = phi <$w x $t0> [ $r0, %l_$i2_tail ], [ $r1, %l_$i2_start ]";
+static const char *llvm_phi_cond_refill =
+    "$r0 = phi <$w x $t0> [ $r0_final, %l_$i2_tail ], [ $r0_refill, %l_$i2_start ]";
+
 // Forward declarations
 static void jitc_var_loop_callback(uint32_t index, int free, void *ptr);
 static void jitc_var_loop_assemble_init(const Variable *v, const Extra &extra);
@@ -118,8 +131,7 @@ uint32_t jitc_var_loop_init(size_t n_indices, uint32_t **indices) {
 
     // Create Phi nodes (LLVM)
     if (backend == JitBackend::LLVM) {
-        v.stmt = (char *) "$r0 = phi <$w x $t0> [ $r0_final, %l_$i2_tail ], "
-                           "[ $r1, %l_$i2_start ]";
+        v.stmt = (char *) llvm_phi_cond;
         for (size_t i = 0; i < n_indices; ++i)
             wrap(v, *indices[i], result);
 
@@ -202,6 +214,7 @@ uint32_t jitc_var_loop(const char *name, uint32_t loop_init,
     loop->out.reserve(n_indices);
     loop->name = strdup(name);
     loop->se_count = (uint32_t) se.size() - checkpoint;
+    loop->has_side_effects = loop->se_count != 0;
     loop->init = loop_init;
     loop->cond = jitc_var(loop_cond)->dep[0];
 
@@ -287,8 +300,7 @@ uint32_t jitc_var_loop(const char *name, uint32_t loop_init,
                     // Rewrite the previously generated phi expression. Needed
                     // in case the loop condition depends on a loop-invariant
                     // variable (see loop test 09_optim_cond)
-                    v2->stmt = (char *) "$r0 = phi <$w x $t0> [ $r0, "
-                                         "%l_$i2_tail ], [ $r1, %l_$i2_start ]";
+                    v2->stmt = (char *) llvm_phi_cond_invariant;
                 }
                 jitc_var_inc_ref(index_3);
                 jitc_var_dec_ref(index_1);
@@ -566,33 +578,29 @@ static void jitc_var_loop_callback(uint32_t index, int free, void *ptr) {
     loop->simplify = true;
 }
 
-static void jitc_var_loop_dfs(tsl::robin_set<uint32_t, UInt32Hasher> &set, uint32_t lowest_index, uint32_t index) {
-    if (!set.insert(index).second)
-        return;
-    // jitc_trace("jitc_var_dfs(r%u)", index);
-
-    const Variable *v = jitc_var(index);
-    for (uint32_t i = 0; i < 4; ++i) {
-        uint32_t index_2 = v->dep[i];
-        if (index_2 >= lowest_index)
-            jitc_var_loop_dfs(set, lowest_index, index_2);
-    }
-
-    if (unlikely(v->extra)) {
-        auto it = state.extra.find(index);
-        if (unlikely(it == state.extra.end()))
-            jitc_fail("jit_var_loop_dfs(): could not find matching 'extra' record!");
+/// Mark variables reachable from 'index' that were created by the loop
+static uint32_t jitc_var_loop_dfs(uint32_t epoch, uint32_t lowest_index, uint32_t index) {
+    uint32_t count = 0;
+    jitc_var_dfs(
+        index,
+        [&](uint32_t index_2, Variable *v) {
+            if ((index_2 < lowest_index && index_2 != index) ||
+                v->visit_epoch == epoch)
+                return false;
+            v->visit_epoch = epoch;
+            count++;
+            return true;
+        },
+        [](uint32_t, Variable *) { });
+    return count;
+}
 
-        const Extra &extra = it->second;
-        for (uint32_t i = 0; i < extra.n_dep; ++i) {
-            uint32_t index_2 = extra.dep[i];
-            if (index_2 >= lowest_index)
-                jitc_var_loop_dfs(set, lowest_index, index_2);
-        }
-    }
+/// Was the variable reached by the current traversal?
+static bool jitc_var_loop_visited(uint32_t epoch, uint32_t index) {
+    return jitc_var(index)->visit_epoch == epoch;
 }
 
-static size_t jitc_var_loop_simplify(Loop *loop, tsl::robin_set<uint32_t, UInt32Hasher> &visited) {
+static size_t jitc_var_loop_simplify(Loop *loop) {
     loop->simplify = false;
 
     if (state.variables.find(loop->end) == state.variables.end())
@@ -602,34 +610,31 @@ static size_t jitc_var_loop_simplify(Loop *loop, tsl::robin_set<uint32_t, UInt32
 
     /// Determine variable range to be traversed
     uint32_t lowest_index = 0xFFFFFFFF,
-             highest_index = 0,
+             n_visited = 0,
              n_freed = 0;
 
     for (uint32_t i = 0; i < n; ++i) {
         uint32_t index = loop->in_cond[i];
         if (index)
             lowest_index = std::min(lowest_index, index);
-        index = loop->out_body[i];
-        if (index)
-            highest_index = std::max(highest_index, index);
     }
 
-    visited.clear();
-    if (highest_index > lowest_index)
-        visited.reserve(highest_index - lowest_index);
+    uint32_t epoch = jitc_var_visit_epoch();
 
     // Find all inputs that are reachable from the outputs that are still alive
     for (uint32_t i = 0; i < n; ++i) {
         if (!loop->out[i] || !loop->out_body[i])
             continue;
         // jitc_trace("jit_var_loop_simplify(): DFS from %u (r%u)", i, loop->out_body[i]);
-        visited.insert(loop->in_cond[i]);
-        jitc_var_loop_dfs(visited, lowest_index, loop->out_body[i]);
+        Variable *v = jitc_var(loop->in_cond[i]);
+        n_visited += v->visit_epoch != epoch;
+        v->visit_epoch = epoch;
+        n_visited += jitc_var_loop_dfs(epoch, lowest_index, loop->out_body[i]);
     }
 
     // Also search from loop condition
     // jitc_trace("jit_var_loop_simplify(): DFS from loop condition (r%u)", loop->cond);
-    jitc_var_loop_dfs(visited, lowest_index, loop->cond);
+    n_visited += jitc_var_loop_dfs(epoch, lowest_index, loop->cond);
 
     // Find all inputs that are reachable from the side effects
     if (loop->se) {
@@ -638,7 +643,7 @@ static size_t jitc_var_loop_simplify(Loop *loop, tsl::robin_set<uint32_t, UInt32
             const Extra &e = it->second;
             for (uint32_t i = 0; i < e.n_dep; ++i) {
                 // jitc_trace("jit_var_loop_simplify(): DFS from side effect %u (r%u)", i, e.dep[i]);
-                jitc_var_loop_dfs(visited, lowest_index, e.dep[i]);
+                n_visited += jitc_var_loop_dfs(epoch, lowest_index, e.dep[i]);
             }
         }
     }
@@ -649,9 +654,9 @@ static size_t jitc_var_loop_simplify(Loop *loop, tsl::robin_set<uint32_t, UInt32
         again = false;
         for (uint32_t i = 0; i < n; ++i) {
             if (loop->in_cond[i] &&
-                visited.find(loop->in_cond[i]) != visited.end() &&
-                visited.find(loop->out_body[i]) == visited.end()) {
-                jitc_var_loop_dfs(visited, lowest_index, loop->out_body[i]);
+                jitc_var_loop_visited(epoch, loop->in_cond[i]) &&
+                !jitc_var_loop_visited(epoch, loop->out_body[i])) {
+                n_visited += jitc_var_loop_dfs(epoch, lowest_index, loop->out_body[i]);
                 again = true;
             }
         }
@@ -660,7 +665,7 @@ static size_t jitc_var_loop_simplify(Loop *loop, tsl::robin_set<uint32_t, UInt32
     /// Remove loop variables that are never referenced
     for (uint32_t i = 0; i < n; ++i) {
         uint32_t index = loop->in_cond[i];
-        if (index == 0 || visited.find(index) != visited.end())
+        if (index == 0 || jitc_var_loop_visited(epoch, index))
             continue;
         n_freed++;
 
@@ -683,8 +688,8 @@ static size_t jitc_var_loop_simplify(Loop *loop, tsl::robin_set<uint32_t, UInt32
 
     jitc_log(InfoSym,
              "jit_var_loop_simplify(\"%s\"): freed %u loop variables, visited "
-             "%zu variables.",
-             loop->name, n_freed, visited.size());
+             "%u variables.",
+             loop->name, n_freed, n_visited);
 
     return n_freed;
 }
@@ -692,8 +697,6 @@ static size_t jitc_var_loop_simplify(Loop *loop, tsl::robin_set<uint32_t, UInt32
 static ProfilerRegion profiler_region_var_loop_simplify("jit_var_loop_simplify");
 
 void jitc_var_loop_simplify() {
-    tsl::robin_set<uint32_t, UInt32Hasher> visited;
-
     ProfilerPhase profiler(profiler_region_var_loop_simplify);
     bool progress;
     do {
@@ -701,7 +704,7 @@ void jitc_var_loop_simplify() {
         for (size_t i = 0; i < loops.size(); ++i) {
             Loop *loop = loops[i];
             if (loop->simplify)
-                progress |= jitc_var_loop_simplify(loop, visited) > 0;
+                progress |= jitc_var_loop_simplify(loop) > 0;
         }
     } while (progress);
 }
@@ -713,6 +716,35 @@ static void jitc_var_loop_assemble_init(const Variable *, const Extra &extra) {
     if (loop->backend == JitBackend::LLVM) {
         buffer.fmt("    br label %%l_%u_start\n", loop_reg);
         buffer.fmt("\nl_%u_start:\n", loop_reg);
+
+        uint32_t width = jitc_llvm_vector_width;
+        bool refill = loop == refill_loop;
+        for (size_t i = 0; i < loop->in_cond.size(); ++i) {
+            auto it = state.variables.find(loop->in_cond[i]);
+            if (it == state.variables.end())
+                continue;
+
+            Variable *v = &it.value();
+            if (v->stmt != llvm_phi_cond && v->stmt != llvm_phi_cond_refill)
+                continue;
+
+            /* Lane refilling: refilled lanes take their initial state from
+               the (re-)evaluated loop inputs, others resume where they
+               left off in the previous round */
+            v->stmt = (char *) (refill ? llvm_phi_cond_refill : llvm_phi_cond);
+            if (!refill)
+                continue;
+
+            const Variable *v_in = jitc_var(v->dep[0]);
+            uint32_t vti = v->type;
+            buffer.fmt("    %s%u_refill = select <%u x i1> %%refill_mask, "
+                       "<%u x %s> %s%u, <%u x %s> %s%u_carry\n",
+                       type_prefix[vti], v->reg_index, width, width,
+                       type_name_llvm[vti], type_prefix[vti], v_in->reg_index,
+                       width, type_name_llvm[vti], type_prefix[vti],
+                       v->reg_index);
+        }
+
         buffer.fmt("    br label %%l_%u_cond\n", loop_reg);
     }
 
@@ -737,9 +769,36 @@ static void jitc_var_loop_assemble_cond(const Variable *, const Extra &extra) {
             width, width);
         jitc_register_global(global);
 
-        buffer.fmt("    %%p%u = call i1 @llvm.experimental.vector.reduce.or.v%ui1(<%u x i1> %%p%u)\n"
-                   "    br i1 %%p%u, label %%l_%u_body, label %%l_%u_done\n",
-                   loop_reg, width, width, mask_reg, loop_reg, loop_reg, loop_reg);
+        if (loop != refill_loop) {
+            buffer.fmt("    %%p%u = call i1 @llvm.experimental.vector.reduce.or.v%ui1(<%u x i1> %%p%u)\n"
+                       "    br i1 %%p%u, label %%l_%u_body, label %%l_%u_done\n",
+                       loop_reg, width, width, mask_reg, loop_reg, loop_reg, loop_reg);
+        } else {
+            /* Lane refilling: leave the loop to fetch new work once half of
+               the lanes have finished and the index range is not exhausted */
+            snprintf(global, sizeof(global),
+                     "declare i%u @llvm.ctpop.i%u(i%u)", width, width, width);
+            jitc_register_global(global);
+
+            buffer.fmt("    %%p%u_active = and <%u x i1> %%p%u, %%refill_valid\n"
+                       "    %%p%u_any = call i1 @llvm.experimental.vector.reduce.or.v%ui1(<%u x i1> %%p%u_active)\n"
+                       "    %%p%u_bits = bitcast <%u x i1> %%p%u_active to i%u\n"
+                       "    %%p%u_count = call i%u @llvm.ctpop.i%u(i%u %%p%u_bits)\n"
+                       "    %%p%u_few = icmp ule i%u %%p%u_count, %u\n"
+                       "    %%p%u_pending = icmp ult i64 %%refill_next, %%end\n"
+                       "    %%p%u_yield = and i1 %%p%u_few, %%p%u_pending\n"
+                       "    %%p%u = select i1 %%p%u_yield, i1 false, i1 %%p%u_any\n"
+                       "    br i1 %%p%u, label %%l_%u_body, label %%l_%u_done\n",
+                       loop_reg, width, mask_reg,
+                       loop_reg, width, width, loop_reg,
+                       loop_reg, width, loop_reg, width,
+                       loop_reg, width, width, width, loop_reg,
+                       loop_reg, width, loop_reg, width / 2,
+                       loop_reg,
+                       loop_reg, loop_reg, loop_reg,
+                       loop_reg, loop_reg, loop_reg,
+                       loop_reg, loop_reg, loop_reg);
+        }
     }
 
     buffer.fmt("\nl_%u_body:\n", loop_reg);
@@ -795,6 +854,11 @@ static void jitc_var_loop_assemble_end(const Variable *, const Extra &extra) {
 
     buffer.fmt("\nl_%u_done:\n", loop_reg);
 
+    if (loop == refill_loop)
+        buffer.fmt("    %%refill_active = and <%u x i1> %%p%u, %%refill_valid\n"
+                   "    %%refill_store_post = xor <%u x i1> %%refill_valid, %%refill_active\n",
+                   width, mask_reg, width);
+
     jitc_log(InfoSym,
              "jit_var_loop_assemble(): loop (\"%s\") with %u/%u loop "
              "variable%s (%u/%u bytes), %u side effect%s",
@@ -808,3 +872,96 @@ static void jitc_var_loop_assemble_end(const Variable *, const Extra &extra) {
         loop->simplify = true;
     }
 }
+
+uint32_t jitc_var_loop_refill_begin(uint32_t start, uint32_t end) {
+    refill_loop = nullptr;
+
+    if (!(jitc_flags() & (uint32_t) JitFlag::LoopRefill))
+        return 0;
+
+    Loop *loop = nullptr;
+    bool inside = false, gather_before = false;
+
+    for (uint32_t gi = start; gi != end; ++gi) {
+        uint32_t index = schedule[gi].index;
+        const Variable *v = jitc_var(index);
+
+        if (v->extra) {
+            auto it = state.extra.find(index);
+            if (it != state.extra.end() && it->second.assemble) {
+                const Extra &e = it->second;
+                if (e.assemble == jitc_var_loop_assemble_init) {
+                    if (loop) // Only a single top-level loop is supported
+                        return 0;
+                    loop = (Loop *) e.callback_data;
+                    inside = true;
+                } else if (e.assemble == jitc_var_loop_assemble_end) {
+                    inside = false;
+                } else if (!inside) {
+                    return 0;
+                }
+                continue;
+            }
+        }
+
+        if (loop && index == loop->se)
+            continue;
+
+        /* Code outside of the loop runs once per refill round. Side effects
+           there would be performed multiple times. */
+        if (v->side_effect && !inside)
+            return 0;
+
+        switch ((VarKind) v->kind) {
+            // Callables and ray tracing calls assume contiguous lanes
+            case VarKind::Dispatch:
+            case VarKind::TraceRay:
+                return 0;
+
+            case VarKind::Gather:
+                gather_before |= !loop;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    /* Inputs are re-fetched for lanes that are still active. This is only
+       safe when the loop body cannot modify memory read before the loop. */
+    if (!loop || loop->backend != JitBackend::LLVM ||
+        (loop->has_side_effects && gather_before))
+        return 0;
+
+    jitc_log(InfoSym,
+             "jit_var_loop_refill(): compiling loop (\"%s\") with lane refilling.",
+             loop->name);
+
+    refill_loop = loop;
+    return loop->end;
+}
+
+void jitc_var_loop_refill_assemble_carry() {
+    Loop *loop = refill_loop;
+    uint32_t width = jitc_llvm_vector_width;
+
+    for (size_t i = 0; i < loop->in_cond.size(); ++i) {
+        auto it = state.variables.find(loop->in_cond[i]);
+        if (it == state.variables.end())
+            continue;
+
+        const Variable *v = &it->second;
+        if (v->stmt != llvm_phi_cond && v->stmt != llvm_phi_cond_refill)
+            continue;
+
+        uint32_t vti = v->type;
+        buffer.fmt("    %s%u_carry = phi <%u x %s> [ undef, %%entry ], "
+                   "[ %s%u, %%suffix ]\n",
+                   type_prefix[vti], v->reg_index, width, type_name_llvm[vti],
+                   type_prefix[vti], v->reg_index);
+    }
+}
+
+void jitc_var_loop_refill_end() {
+    refill_loop = nullptr;
+}
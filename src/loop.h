@@ -11,3 +11,9 @@ extern uint32_t jitc_var_loop(const char *name, uint32_t loop_init,
                               uint32_t checkpoint, int first_round);
 
 extern void jitc_var_loop_simplify();
+
+extern uint32_t jitc_var_loop_refill_begin(uint32_t start, uint32_t end);
+
+extern void jitc_var_loop_refill_assemble_carry();
+
+extern void jitc_var_loop_refill_end();
@@ -11,6 +11,8 @@
 #include "log.h"
 #include "util.h"
 #include "profiler.h"
+#include "numa.h"
+#include <algorithm>
 
 #if !defined(_WIN32)
 #  include <sys/mman.h>
@@ -25,6 +27,13 @@
 
 #define DRJIT_HUGEPAGE_SIZE (2 * 1024 * 1024)
 
+// Release large cached host allocations lazily (only on Linux/macOS)
+#if !defined(_WIN32) && defined(MADV_FREE)
+#  define DRJIT_MADV_FREE 1
+#else
+#  define DRJIT_MADV_FREE 0
+#endif
+
 static_assert(
     sizeof(tsl::detail_robin_hash::bucket_entry<AllocUsedMap::value_type, false>) == 24,
     "AllocUsedMap: incorrect bucket size, likely an issue with padding/packing!");
@@ -105,6 +114,14 @@ static void aligned_free(void *ptr, size_t size) {
 #endif
 }
 
+/// Record the use of a class of the allocation cache (requires 'alloc_free_lock')
+static void jitc_malloc_touch(AllocInfo info) {
+    if (unlikely(state.alloc_budget_active))
+        state.alloc_free_epoch[info] = ++state.alloc_epoch;
+}
+
+static void jitc_malloc_trim(AllocType type, size_t target);
+
 void* jitc_malloc(AllocType type, size_t size) {
     if (size == 0)
         return nullptr;
@@ -135,9 +152,17 @@ void* jitc_malloc(AllocType type, size_t size) {
         device = ts->device;
     }
 
+    /* NUMA mode: large host-asynchronous allocations are partitioned across
+       nodes. They are cached separately from regular allocations, which
+       is achieved by using a special device ID. */
+    bool numa = type == AllocType::HostAsync && jitc_numa_partition_size(size);
+    if (numa)
+        device = 1;
+
     AllocInfo ai = alloc_info_encode(size, type, device);
     const char *descr = nullptr;
     void *ptr = nullptr;
+    bool reused = false;
 
     /* Try to reuse a freed allocation */ {
         lock_guard guard(state.alloc_free_lock);
@@ -149,17 +174,35 @@ void* jitc_malloc(AllocType type, size_t size) {
                 ptr = list.back();
                 list.pop_back();
                 descr = "reused";
+                reused = true;
+                jitc_malloc_touch(ai);
             }
         }
     }
 
+    // Reused allocations released via madvise(MADV_FREE) count again
+    if (reused && unlikely(!state.alloc_lazy_set.empty()) &&
+        state.alloc_lazy_set.erase((uintptr_t) ptr))
+        state.alloc_lazy[(int) type] -= size;
+
     // Otherwise, allocate memory
     if (unlikely(!ptr)) {
+        size_t budget = state.alloc_budget[(int) type];
+        if (unlikely(budget) &&
+            state.alloc_allocated[(int) type] - state.alloc_lazy[(int) type] +
+                    size > budget) {
+            // Trim the cache to 3/4 of the budget, leaving room for 'size'
+            size_t target = budget / 4 * 3;
+            jitc_malloc_trim(type, target > size ? target - size : 0);
+        }
+
         for (int i = 0; i < 2; ++i) {
             unlock_guard guard(state.lock);
             /* Temporarily release the main lock */ {
                 if (backend != JitBackend::CUDA) {
                     ptr = aligned_malloc(size);
+                    if (numa && ptr)
+                        jitc_numa_partition(ptr, size);
                 } else {
                     scoped_set_context guard_2(ts->context);
                     CUresult ret;
@@ -196,6 +239,9 @@ void* jitc_malloc(AllocType type, size_t size) {
     state.alloc_used.emplace((uintptr_t) ptr, ai);
     state.alloc_usage[(int) type] += size;
 
+    if (unlikely(state.alloc_profile.active))
+        state.alloc_profile.alloc(ptr, size, type, backend, reused);
+
     (void) descr; // don't warn if tracing is disabled
     if (ts)
         jitc_trace("jit_malloc(type=%s, device=%u, size=%zu): " DRJIT_PTR " (%s)",
@@ -207,10 +253,12 @@ void* jitc_malloc(AllocType type, size_t size) {
     return ptr;
 }
 
-void jitc_free(void *ptr) {
-    if (!ptr)
-        return;
-
+/**
+ * Remove the allocation 'ptr' from the set of used allocations, update the
+ * usage statistics, and return its type via 'type_out'. Shared by jitc_free()
+ * and jitc_free_many(), which then return the memory to the allocation cache.
+ */
+static AllocInfo jitc_free_unregister(void *ptr, AllocType &type_out) {
     auto it = state.alloc_used.find((uintptr_t) ptr);
     if (unlikely(it == state.alloc_used.end()))
         jitc_raise("jit_free(): unknown address " DRJIT_PTR "!", (uintptr_t) ptr);
@@ -220,32 +268,8 @@ void jitc_free(void *ptr) {
     auto [size, type, device] = alloc_info_decode(info);
     state.alloc_usage[(int) type] -= size;
 
-    if (type != AllocType::HostPinned) {
-        lock_guard guard(state.alloc_free_lock);
-        state.alloc_free[info].push_back(ptr);
-    } else {
-        /* Host-pinned memory is released asynchronously by inserting
-           an event into the CUDA stream */
-        struct ReleaseRecord {
-            AllocInfo info;
-            void *ptr;
-        };
-        ReleaseRecord *r =
-            (ReleaseRecord *) malloc_check(sizeof(ReleaseRecord));
-        r->info = info;
-        r->ptr = ptr;
-        cuda_check(cuLaunchHostFunc(
-            thread_state_cuda->stream,
-            [](void *p) {
-                ReleaseRecord *r2 = (ReleaseRecord *) p;
-                {
-                    lock_guard guard(state.alloc_free_lock);
-                    state.alloc_free[r2->info].push_back(r2->ptr);
-                }
-                free(r2);
-            },
-            r));
-    }
+    if (unlikely(state.alloc_profile.active))
+        state.alloc_profile.free(ptr, size, type);
 
     if (type == AllocType::Device || type == AllocType::HostPinned)
         jitc_trace("jit_free(" DRJIT_PTR ", type=%s, device=%i, size=%zu)",
@@ -253,6 +277,87 @@ void jitc_free(void *ptr) {
     else
         jitc_trace("jit_free(" DRJIT_PTR ", type=%s, size=%zu)",
                    (uintptr_t) ptr, alloc_type_name[(int) type], size);
+
+    type_out = type;
+    return info;
+}
+
+/// Host-pinned memory is released asynchronously by inserting an event into the CUDA stream
+static void jitc_free_pinned(AllocInfo info, void *ptr) {
+    struct ReleaseRecord {
+        AllocInfo info;
+        void *ptr;
+    };
+    ReleaseRecord *r =
+        (ReleaseRecord *) malloc_check(sizeof(ReleaseRecord));
+    r->info = info;
+    r->ptr = ptr;
+    cuda_check(cuLaunchHostFunc(
+        thread_state_cuda->stream,
+        [](void *p) {
+            ReleaseRecord *r2 = (ReleaseRecord *) p;
+            {
+                lock_guard guard(state.alloc_free_lock);
+                state.alloc_free[r2->info].push_back(r2->ptr);
+                jitc_malloc_touch(r2->info);
+            }
+            free(r2);
+        },
+        r));
+}
+
+void jitc_free(void *ptr) {
+    if (!ptr)
+        return;
+
+    AllocType type;
+    AllocInfo info = jitc_free_unregister(ptr, type);
+
+    if (type != AllocType::HostPinned) {
+        lock_guard guard(state.alloc_free_lock);
+        state.alloc_free[info].push_back(ptr);
+        jitc_malloc_touch(info);
+    } else {
+        jitc_free_pinned(info, ptr);
+    }
+}
+
+void jitc_free_many(void **ptrs, size_t count) {
+    static std::vector<std::pair<AllocInfo, void *>> released;
+    released.clear();
+
+    // Return the collected allocations to the cache using a single lock
+    auto flush = []() {
+        if (released.empty())
+            return;
+        lock_guard guard(state.alloc_free_lock);
+        for (auto [info, ptr] : released) {
+            state.alloc_free[info].push_back(ptr);
+            jitc_malloc_touch(info);
+        }
+        released.clear();
+    };
+
+    try {
+        for (size_t i = 0; i < count; ++i) {
+            void *ptr = ptrs[i];
+            if (!ptr)
+                continue;
+
+            AllocType type;
+            AllocInfo info = jitc_free_unregister(ptr, type);
+            if (type == AllocType::HostPinned)
+                jitc_free_pinned(info, ptr);
+            else
+                released.emplace_back(info, ptr);
+        }
+    } catch (...) {
+        // Don't leak the allocations that were already unregistered
+        flush();
+        throw;
+    }
+
+    flush();
 }
 
 void jitc_malloc_clear_statistics() {
@@ -348,6 +453,44 @@ void* jitc_malloc_migrate(void *ptr, AllocType dst_type, int move) {
     return ptr_new;
 }
 
+/// Return unused memory of the allocation cache to the GPU / OS
+static void jitc_free_cached(AllocType type, int device, size_t size,
+                             void *const *ptrs, size_t count) {
+    switch (type) {
+        case AllocType::Device:
+            if (state.backends & (uint32_t) JitBackend::CUDA) {
+                const Device &dev = state.devices[device];
+                scoped_set_context guard(dev.context);
+                if (dev.memory_pool) {
+                    for (size_t i = 0; i < count; ++i)
+                        cuda_check(cuMemFreeAsync((CUdeviceptr) ptrs[i], dev.stream));
+                } else {
+                    for (size_t i = 0; i < count; ++i)
+                        cuda_check(cuMemFree((CUdeviceptr) ptrs[i]));
+                }
+            }
+            break;
+
+        case AllocType::HostPinned:
+            if (state.backends & (uint32_t) JitBackend::CUDA) {
+                const Device &dev = state.devices[device];
+                scoped_set_context guard(dev.context);
+                for (size_t i = 0; i < count; ++i)
+                    cuda_check(cuMemFreeHost(ptrs[i]));
+            }
+            break;
+
+        case AllocType::Host:
+        case AllocType::HostAsync:
+            for (size_t i = 0; i < count; ++i)
+                aligned_free(ptrs[i], size);
+            break;
+
+        default:
+            jitc_fail("jit_free_cached(): unsupported allocation type!");
+    }
+}
+
 static bool jitc_flush_malloc_cache_warned = false;
 
 static ProfilerRegion profiler_region_flush_malloc_cache("jit_flush_malloc_cache");
@@ -375,8 +518,12 @@ void jitc_flush_malloc_cache(bool warn) {
     /* Critical section */ {
         lock_guard guard(state.alloc_free_lock);
         alloc_free.swap(state.alloc_free);
+        state.alloc_free_epoch.clear();
     }
 
+    if (unlikely(state.alloc_profile.active))
+        state.alloc_profile.flush();
+
     size_t trim_count[(int) AllocType::Count] = { 0 },
            trim_size [(int) AllocType::Count] = { 0 };
 
@@ -390,44 +537,15 @@ void jitc_flush_malloc_cache(bool warn) {
             trim_count[(int) type] += entries.size();
             trim_size[(int) type] += size * entries.size();
 
-            switch ((AllocType) type) {
-                case AllocType::Device:
-                    if (state.backends & (uint32_t) JitBackend::CUDA) {
-                        const Device &dev = state.devices[device];
-                        scoped_set_context guard2(dev.context);
-                        if (dev.memory_pool) {
-                            for (void *ptr : entries)
-                                cuda_check(cuMemFreeAsync((CUdeviceptr) ptr, dev.stream));
-                        } else {
-                            for (void *ptr : entries)
-                                cuda_check(cuMemFree((CUdeviceptr) ptr));
-                        }
-                    }
-                    break;
-
-                case AllocType::HostPinned:
-                    if (state.backends & (uint32_t) JitBackend::CUDA) {
-                        const Device &dev = state.devices[device];
-                        scoped_set_context guard2(dev.context);
-                        for (void *ptr : entries)
-                            cuda_check(cuMemFreeHost(ptr));
-                    }
-                    break;
-
-                case AllocType::Host:
-                case AllocType::HostAsync:
-                    for (void *ptr : entries)
-                        aligned_free(ptr, size);
-                    break;
-
-                default:
-                    jitc_fail("jit_flush_malloc_cache(): unsupported allocation type!");
-            }
+            jitc_free_cached(type, device, size, entries.data(), entries.size());
         }
     }
 
-    for (int i = 0; i < (int) AllocType::Count; ++i)
+    for (int i = 0; i < (int) AllocType::Count; ++i) {
         state.alloc_allocated[i] -= trim_size[i];
+        state.alloc_lazy[i] = 0;
+    }
+    state.alloc_lazy_set.clear();
 
     size_t total = 0;
     for (int i = 0; i < (int) AllocType::Count; ++i)
@@ -445,6 +563,191 @@ void jitc_flush_malloc_cache(bool warn) {
     }
 }
 
+/// Host allocation removed from the cache by jitc_malloc_trim()
+struct TrimRecord {
+    void *ptr;
+    size_t size;
+    AllocInfo info;
+
+    /// Release the pages via madvise(MADV_FREE) but keep the allocation
+    bool advise;
+};
+
+static void jitc_malloc_trim_host(const std::vector<TrimRecord> &records) {
+    bool advised = false;
+    for (const TrimRecord &r : records) {
+#if DRJIT_MADV_FREE
+        if (r.advise) {
+            madvise(r.ptr, r.size, MADV_FREE);
+            advised = true;
+            continue;
+        }
+#endif
+        aligned_free(r.ptr, r.size);
+    }
+
+    /* Advised allocations were taken off the free list, since writes by a
+       new owner that precede madvise() could be discarded. Now they can
+       be reused. */
+    if (advised) {
+        lock_guard guard(state.alloc_free_lock);
+        for (const TrimRecord &r : records) {
+            if (r.advise)
+                state.alloc_free[r.info].push_back(r.ptr);
+        }
+    }
+}
+
+/**
+ * Release cached memory of the given type in least recently used order until
+ * its footprint (used and cached bytes) drops below 'target'. Large host
+ * allocations remain in the cache, but their pages are released via
+ * madvise(MADV_FREE) so that the OS can reclaim them when needed.
+ */
+static void jitc_malloc_trim(AllocType type, size_t target) {
+    size_t &allocated = state.alloc_allocated[(int) type],
+           &lazy = state.alloc_lazy[(int) type];
+    if (allocated - lazy <= target)
+        return;
+
+    bool host = type == AllocType::Host || type == AllocType::HostAsync;
+    std::vector<std::pair<uint64_t, AllocInfo>> classes;
+    std::vector<std::pair<AllocInfo, void *>> released;
+    std::vector<TrimRecord> host_records;
+    size_t trim_size = 0, advise_size = 0;
+
+    /* Critical section */ {
+        lock_guard guard(state.alloc_free_lock);
+
+        for (auto &kv : state.alloc_free) {
+            auto [size, type_2, device] = alloc_info_decode(kv.first);
+            (void) size; (void) device;
+            if (type_2 != type || kv.second.empty())
+                continue;
+
+            auto it = state.alloc_free_epoch.find(kv.first);
+            classes.emplace_back(
+                it != state.alloc_free_epoch.end() ? it->second : 0, kv.first);
+        }
+
+        /* Least recently used classes first, and larger ones among those
+           with the same age (AllocInfo stores the size in its upper bits) */
+        std::sort(classes.begin(), classes.end(),
+                  [](const std::pair<uint64_t, AllocInfo> &a,
+                     const std::pair<uint64_t, AllocInfo> &b) {
+                      if (a.first != b.first)
+                          return a.first < b.first;
+                      return a.second > b.second;
+                  });
+
+        for (auto [epoch, info] : classes) {
+            if (allocated - lazy <= target)
+                break;
+
+            auto [size, type_2, device] = alloc_info_decode(info);
+            (void) epoch; (void) type_2; (void) device;
+            std::vector<void *> &list = state.alloc_free[info];
+            bool advise = DRJIT_MADV_FREE && host && size >= DRJIT_HUGEPAGE_SIZE;
+
+            /* Entries are appended when released, hence the oldest come first.
+               Evicted and advised entries are removed from the list, the
+               latter are re-added by jitc_malloc_trim_host(). */
+            std::vector<void *> kept;
+            size_t i = 0;
+            for (; i < list.size() && allocated - lazy > target; ++i) {
+                void *ptr = list[i];
+                if (advise) {
+                    if (state.alloc_lazy_set.insert((uintptr_t) ptr).second) {
+                        lazy += size;
+                        advise_size += size;
+                        host_records.push_back(TrimRecord{ ptr, size, info, true });
+                    } else {
+                        kept.push_back(ptr);
+                    }
+                } else {
+                    allocated -= size;
+                    trim_size += size;
+                    if (host)
+                        host_records.push_back(TrimRecord{ ptr, size, info, false });
+                    else
+                        released.emplace_back(info, ptr);
+                }
+            }
+
+            kept.insert(kept.end(), list.begin() + i, list.end());
+            list.swap(kept);
+        }
+    }
+
+    if (unlikely(state.alloc_profile.active) && trim_size)
+        state.alloc_profile.trim(trim_size, type);
+
+    jitc_log(Debug, "jit_malloc_trim(): %s memory exceeds the budget, "
+             "released %s from the cache.", alloc_type_name[(int) type],
+             jitc_mem_string(trim_size));
+    if (advise_size)
+        jitc_log(Debug, " - %s via madvise(MADV_FREE)",
+                 jitc_mem_string(advise_size));
+
+    if (type == AllocType::HostAsync && jitc_task && !host_records.empty()) {
+        // Kernels that were launched previously may still access this memory
+        std::vector<TrimRecord> *records =
+            new std::vector<TrimRecord>(std::move(host_records));
+        host_records.clear();
+
+        Task *new_task = task_submit_dep(
+            nullptr, &jitc_task, 1, 1,
+            [](uint32_t, void *payload) {
+                std::vector<TrimRecord> *r = *(std::vector<TrimRecord> **) payload;
+                jitc_malloc_trim_host(*r);
+                delete r;
+            },
+            &records, sizeof(void *), nullptr, 1);
+
+        task_release(jitc_task);
+        jitc_task = new_task;
+    }
+
+    // Also wait for pending operations involving CUDA memory
+    if (!released.empty())
+        jitc_sync_all_devices();
+
+    /* Temporarily release the main lock */ {
+        unlock_guard guard(state.lock);
+        jitc_malloc_trim_host(host_records);
+        for (auto [info, ptr] : released) {
+            auto [size, type_2, device] = alloc_info_decode(info);
+            jitc_free_cached(type_2, device, size, &ptr, 1);
+        }
+    }
+}
+
+void jitc_malloc_set_budget(AllocType type, size_t budget) {
+    if ((int) type >= (int) AllocType::Count)
+        jitc_raise("jit_malloc_set_budget(): invalid allocation type!");
+
+    state.alloc_budget[(int) type] = budget;
+
+    bool active = false;
+    for (int i = 0; i < (int) AllocType::Count; ++i)
+        active |= state.alloc_budget[i] != 0;
+
+    /* Critical section */ {
+        lock_guard guard(state.alloc_free_lock);
+        state.alloc_budget_active = active;
+        if (!active)
+            state.alloc_free_epoch.clear();
+    }
+
+    jitc_log(Info, "jit_malloc_set_budget(): %s memory budget set to %s.",
+             alloc_type_name[(int) type],
+             budget ? jitc_mem_string(budget) : "unlimited");
+
+    size_t &allocated = state.alloc_allocated[(int) type];
+    if (budget && allocated - state.alloc_lazy[(int) type] > budget)
+        jitc_malloc_trim(type, budget / 4 * 3);
+}
+
 /// Query the flavor of a memory allocation made using \ref jitc_malloc()
 AllocType jitc_malloc_type(void *ptr) {
     auto it = state.alloc_used.find((uintptr_t) ptr);
@@ -497,3 +800,269 @@ void jitc_malloc_shutdown() {
         }
     }
 }
+
+// ==========================================================================
+
+/// Is the calling thread currently allocating the outputs of a kernel?
+static thread_local bool alloc_profile_kernel = false;
+
+void AllocProfiler::start() {
+    if (active)
+        return;
+
+    // Allocations made while the profiler was stopped can't be attributed
+    for (Tag &t : m_tags)
+        t.live = 0;
+    m_live.clear();
+    m_pending.clear();
+    m_live_bytes = 0;
+
+    if (m_events.empty())
+        m_events.resize(DRJIT_ALLOC_PROFILE_EVENTS);
+    if (!m_start_time)
+        m_start_time = jitc_profile_time();
+
+    cache_bytes(m_cache, m_pinned);
+    m_cache_peak = std::max(m_cache_peak, m_cache);
+    m_pinned_peak = std::max(m_pinned_peak, m_pinned);
+    active = true;
+}
+
+void AllocProfiler::clear() {
+    for (Tag &t : m_tags) {
+        t.peak = t.live;
+        t.total = 0;
+        t.count = 0;
+    }
+    m_live_peak = m_live_bytes;
+    m_cache_peak = m_cache;
+    m_pinned_peak = m_pinned;
+    m_head = 0;
+    m_start_time = active ? jitc_profile_time() : 0;
+}
+
+void AllocProfiler::cache_bytes(size_t &cache, size_t &pinned) {
+    cache = pinned = 0;
+    lock_guard guard(state.alloc_free_lock);
+    for (auto &kv : state.alloc_free) {
+        auto [size, type, device] = alloc_info_decode(kv.first);
+        (void) device;
+        (type == AllocType::HostPinned ? pinned : cache) +=
+            size * kv.second.size();
+    }
+}
+
+uint32_t AllocProfiler::tag(const char *name, bool kernel) {
+    // Interned names are unique, so distinct names never share a tag
+    name = jitc_profile_intern(name);
+    auto result = m_tag_map[kernel ? 1 : 0].try_emplace(
+        (uintptr_t) name, (uint32_t) m_tags.size());
+    if (result.second)
+        m_tags.push_back(Tag{ name, 0, 0, 0, 0, kernel });
+    return result.first->second;
+}
+
+void AllocProfiler::record(EventType et, uint32_t tag, size_t size,
+                           AllocType type) {
+    m_events[m_head++ % DRJIT_ALLOC_PROFILE_EVENTS] =
+        Event{ jitc_profile_time(), size, m_live_bytes, m_cache, m_pinned,
+               tag, et, type };
+}
+
+void AllocProfiler::account(void *ptr, uint32_t tag, size_t size,
+                            AllocType type, EventType et) {
+    m_live[(uintptr_t) ptr] = tag;
+
+    Tag &t = m_tags[tag];
+    t.live += size;
+    t.total += size;
+    t.count++;
+    t.peak = std::max(t.peak, t.live);
+
+    m_live_bytes += size;
+    m_live_peak = std::max(m_live_peak, m_live_bytes);
+
+    record(et, tag, size, type);
+}
+
+void AllocProfiler::alloc(void *ptr, size_t size, AllocType type,
+                          JitBackend backend, bool reused) {
+    if (reused) {
+        size_t &cache = cache_ref(type);
+        cache -= std::min(cache, size);
+    }
+
+    if (alloc_profile_kernel) {
+        // Attributed once the kernel hash is known, see kernel_end()
+        m_live[(uintptr_t) ptr] = Pending;
+        m_pending.push_back(PendingAlloc{ ptr, size, type });
+        return;
+    }
+
+    ThreadState *ts = backend == JitBackend::CUDA ? thread_state_cuda
+                                                  : thread_state_llvm;
+    const char *name = (ts && ts->prefix) ? ts->prefix : "(no prefix)";
+
+    account(ptr, tag(name, false), size, type,
+            reused ? EventType::Reuse : EventType::Alloc);
+}
+
+void AllocProfiler::free(void *ptr, size_t size, AllocType type) {
+    /* Pinned memory reaches the cache only once the CUDA stream has caught
+       up (see jitc_free_pinned()), it is counted separately until reused */
+    if (type == AllocType::HostPinned) {
+        m_pinned += size;
+        m_pinned_peak = std::max(m_pinned_peak, m_pinned);
+    } else {
+        m_cache += size;
+        m_cache_peak = std::max(m_cache_peak, m_cache);
+    }
+
+    uint32_t index = Pending;
+    auto it = m_live.find((uintptr_t) ptr);
+    if (it != m_live.end()) {
+        index = it->second;
+        m_live.erase(it);
+        if (index != Pending) {
+            m_tags[index].live -= size;
+            m_live_bytes -= size;
+        }
+    }
+
+    record(EventType::Free, index, size, type);
+}
+
+void AllocProfiler::flush() {
+    size_t size = m_cache + m_pinned;
+    m_cache = m_pinned = 0;
+    record(EventType::Flush, Pending, size, AllocType::Host);
+}
+
+void AllocProfiler::trim(size_t size, AllocType type) {
+    size_t &cache = cache_ref(type);
+    cache -= std::min(cache, size);
+    record(EventType::Flush, Pending, size, type);
+}
+
+void AllocProfiler::resolve(const char *name) {
+    uint32_t index = tag(name, true);
+
+    for (const PendingAlloc &p : m_pending) {
+        auto it = m_live.find((uintptr_t) p.ptr);
+        // Skip allocations that were already released or attributed
+        if (it == m_live.end() || it->second != Pending)
+            continue;
+        account(p.ptr, index, p.size, p.type, EventType::Alloc);
+    }
+
+    m_pending.clear();
+}
+
+void AllocProfiler::kernel_begin() {
+    // An exception may have interrupted the previous kernel
+    if (!m_pending.empty())
+        resolve("kernel (unknown)");
+    alloc_profile_kernel = true;
+}
+
+void AllocProfiler::kernel_end(uint64_t hash) {
+    alloc_profile_kernel = false;
+
+    char name[32];
+    snprintf(name, sizeof(name), "kernel %016llx", (unsigned long long) hash);
+    resolve(name);
+}
+
+AllocProfileEntry *AllocProfiler::get(size_t *count) {
+    AllocProfileEntry *result = (AllocProfileEntry *) malloc_check(
+        std::max(m_tags.size(), (size_t) 1) * sizeof(AllocProfileEntry));
+
+    for (size_t i = 0; i < m_tags.size(); ++i) {
+        const Tag &t = m_tags[i];
+        result[i] = AllocProfileEntry{ t.name, t.kernel ? 1 : 0, t.count,
+                                       t.total, t.live, t.peak };
+    }
+
+    *count = m_tags.size();
+    return result;
+}
+
+void AllocProfiler::cache(size_t *current, size_t *peak) {
+    if (!active) {
+        cache_bytes(m_cache, m_pinned);
+        m_cache_peak = std::max(m_cache_peak, m_cache);
+        m_pinned_peak = std::max(m_pinned_peak, m_pinned);
+    }
+
+    if (current)
+        *current = m_cache;
+    if (peak)
+        *peak = m_cache_peak;
+}
+
+int AllocProfiler::dump(const char *filename) {
+    FILE *f = fopen(filename, "w");
+    if (!f) {
+        jitc_log(Warn, "jit_alloc_profile_dump(): could not open \"%s\"!",
+                 filename);
+        return 0;
+    }
+
+    const char *event_name[] = { "alloc", "reuse", "free", "flush" };
+    size_t cache_current = 0, cache_peak = 0;
+    cache(&cache_current, &cache_peak);
+
+    /* The cache is considered bloated when it holds more memory than the
+       live allocations, which hints at fragmentation across sizes */
+    bool bloat = cache_current > m_live_bytes;
+    if (bloat)
+        jitc_log(Info,
+                 "jit_alloc_profile_dump(): the allocation cache holds %s, "
+                 "which exceeds the live memory (%s).",
+                 jitc_mem_string(cache_current), jitc_mem_string(m_live_bytes));
+
+    fprintf(f, "{\n  \"live\": {\"bytes\": %zu, \"peak\": %zu},\n",
+            m_live_bytes, m_live_peak);
+    fprintf(f, "  \"cache\": {\"bytes\": %zu, \"peak\": %zu, \"bloat\": %s},\n",
+            cache_current, cache_peak, bloat ? "true" : "false");
+    fprintf(f, "  \"pinned\": {\"bytes\": %zu, \"peak\": %zu},\n", m_pinned,
+            m_pinned_peak);
+
+    fprintf(f, "  \"tags\": [");
+    for (size_t i = 0; i < m_tags.size(); ++i) {
+        const Tag &t = m_tags[i];
+        fprintf(f, "%s\n    {\"tag\": ", i == 0 ? "" : ",");
+        jitc_profile_put_str(f, t.name);
+        fprintf(f, ", \"kernel\": %s, \"count\": %llu, \"total\": %zu, "
+                   "\"live\": %zu, \"peak\": %zu}",
+                t.kernel ? "true" : "false", (unsigned long long) t.count,
+                t.total, t.live, t.peak);
+    }
+    fprintf(f, "\n  ],\n  \"timeline\": [");
+
+    uint64_t start = m_head > DRJIT_ALLOC_PROFILE_EVENTS
+                         ? m_head - DRJIT_ALLOC_PROFILE_EVENTS : 0;
+    for (uint64_t i = start; i < m_head; ++i) {
+        const Event &e = m_events[i % DRJIT_ALLOC_PROFILE_EVENTS];
+        fprintf(f, "%s\n    {\"ts\": %.3f, \"event\": \"%s\", \"tag\": ",
+                i == start ? "" : ",", (e.time - m_start_time) * 1e-3,
+                event_name[(int) e.type]);
+        if (e.tag == Pending)
+            fputs("null", f);
+        else
+            jitc_profile_put_str(f, m_tags[e.tag].name);
+        if (e.type != EventType::Flush)
+            fprintf(f, ", \"type\": \"%s\"", alloc_type_name[(int) e.alloc_type]);
+        fprintf(f, ", \"size\": %zu, \"live\": %zu, \"cache\": %zu, "
+                   "\"pinned\": %zu}", e.size, e.live, e.cache, e.pinned);
+    }
+    fprintf(f, "\n  ]\n}\n");
+
+    bool success = ferror(f) == 0;
+    fclose(f);
+
+    jitc_log(Info, "jit_alloc_profile_dump(): wrote %zu tags and %llu events to \"%s\".",
+             m_tags.size(), (unsigned long long) (m_head - start), filename);
+
+    return success ? 1 : 0;
+}
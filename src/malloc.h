@@ -12,6 +12,7 @@
 #include <drjit-core/jit.h>
 #include <drjit-core/containers.h>
 #include "hash.h"
+#include <tsl/robin_set.h>
 
 using AllocInfo = uint64_t;
 
@@ -28,6 +29,8 @@ inline drjit::dr_tuple<size_t, AllocType, int> alloc_info_decode(AllocInfo value
 
 using AllocInfoMap = tsl::robin_map<AllocInfo, std::vector<void *>, UInt64Hasher>;
 using AllocUsedMap = tsl::robin_map<uintptr_t, AllocInfo, UInt64Hasher>;
+using AllocEpochMap = tsl::robin_map<AllocInfo, uint64_t, UInt64Hasher>;
+using AllocLazySet = tsl::robin_set<uintptr_t, UInt64Hasher>;
 
 /// Round to the next power of two
 extern size_t round_pow2(size_t x);
@@ -43,6 +46,9 @@ extern void *jitc_malloc(AllocType type, size_t size) JIT_MALLOC;
 /// Release the given pointer
 extern void jitc_free(void *ptr);
 
+/// Release several pointers, acquiring 'state.alloc_free_lock' only once
+extern void jitc_free_many(void **ptrs, size_t count);
+
 /// Change the flavor of an allocated memory region
 extern void* jitc_malloc_migrate(void *ptr, AllocType type, int move);
 
@@ -60,3 +66,108 @@ extern int jitc_malloc_device(void *ptr);
 
 /// Clear the peak memory usage statistics
 extern void jitc_malloc_clear_statistics();
+
+/// Set the memory budget of an allocation type (0: unlimited)
+extern void jitc_malloc_set_budget(AllocType type, size_t budget);
+
+/// Number of allocator events retained by the allocation profiler
+#define DRJIT_ALLOC_PROFILE_EVENTS 65536
+
+/**
+ * \brief Allocation profiler, see \ref jit_alloc_profile_start()
+ *
+ * Attributes every allocation to a tag (the prefix of the calling thread, or
+ * the kernel whose output it stores) and tracks the live and peak bytes per
+ * tag, the bytes sitting in the allocation cache, and a bounded timeline of
+ * allocator events. Host-pinned memory is released asynchronously and is
+ * tracked separately from the cache of the other allocation types. All
+ * members are protected by 'state.lock'.
+ */
+struct AllocProfiler {
+    enum class EventType : uint8_t { Alloc, Reuse, Free, Flush };
+
+    struct Event {
+        uint64_t time;
+        size_t size;
+        size_t live;
+        size_t cache;
+        size_t pinned;
+        uint32_t tag;
+        EventType type;
+        AllocType alloc_type;
+    };
+
+    struct PendingAlloc {
+        void *ptr;
+        size_t size;
+        AllocType type;
+    };
+
+    struct Tag {
+        const char *name;
+        size_t live, peak, total;
+        uint64_t count;
+        bool kernel;
+    };
+
+    /// Is the profiler currently active?
+    bool active = false;
+
+    void start();
+    void stop() { active = false; }
+    void clear();
+
+    /// Account for a new allocation made by the given backend
+    void alloc(void *ptr, size_t size, AllocType type, JitBackend backend,
+               bool reused);
+
+    /// Account for a released allocation
+    void free(void *ptr, size_t size, AllocType type);
+
+    /// The allocation cache was flushed
+    void flush();
+
+    /// Part of the allocation cache was released to stay within a budget
+    void trim(size_t size, AllocType type);
+
+    /// Allocations until the next \ref kernel_end() store outputs of a kernel
+    void kernel_begin();
+
+    /// ..which is now known to have the given hash
+    void kernel_end(uint64_t hash);
+
+    /// Return the per-tag statistics (to be released via free())
+    AllocProfileEntry *get(size_t *count);
+
+    /// Return the current and peak size of the allocation cache (without pinned memory)
+    void cache(size_t *current, size_t *peak);
+
+    /// Write the statistics and the timeline to a JSON file
+    int dump(const char *filename);
+
+private:
+    uint32_t tag(const char *name, bool kernel);
+    void account(void *ptr, uint32_t tag, size_t size, AllocType type,
+                 EventType et);
+    void record(EventType et, uint32_t tag, size_t size, AllocType type);
+    void resolve(const char *name);
+    void cache_bytes(size_t &cache, size_t &pinned);
+    size_t &cache_ref(AllocType type) {
+        return type == AllocType::HostPinned ? m_pinned : m_cache;
+    }
+
+    /// Tag index of allocations whose kernel has not been assembled yet
+    static constexpr uint32_t Pending = (uint32_t) -1;
+
+    std::vector<Tag> m_tags;
+    /// Maps interned tag names to tag indices (separately for prefixes and kernels)
+    tsl::robin_map<uintptr_t, uint32_t, UInt64Hasher> m_tag_map[2];
+    tsl::robin_map<uintptr_t, uint32_t, UInt64Hasher> m_live;
+    std::vector<PendingAlloc> m_pending;
+    std::vector<Event> m_events;
+    uint64_t m_head = 0;
+    uint64_t m_start_time = 0;
+    size_t m_live_bytes = 0, m_live_peak = 0;
+    size_t m_cache = 0, m_cache_peak = 0;
+    size_t m_pinned = 0, m_pinned_peak = 0;
+};
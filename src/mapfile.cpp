@@ -0,0 +1,353 @@
+/*
+    src/mapfile.cpp -- Memory-mapped files as inputs and outputs of kernels
+
+    Copyright (c) 2021 Wenzel Jakob <wenzel.jakob@epfl.ch>
+
+    All rights reserved. Use of this source code is governed by a BSD-style
+    license that can be found in the LICENSE file.
+*/
+
+#include "internal.h"
+#include "log.h"
+#include "var.h"
+#include "util.h"
+#include "malloc.h"
+#include "llvm.h"
+#include "mapfile.h"
+#include <nanothread/nanothread.h>
+#include <cstring>
+#include <cerrno>
+
+#if !defined(_WIN32)
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#endif
+
+struct FileMapping {
+    /// Page-aligned start and length of the mapped region (incl. guard page)
+    void *base = nullptr;
+    size_t length = 0;
+
+    /// Start of the requested region within the mapping
+    void *data = nullptr;
+
+    /// Bytes between the end of the requested region and the end of its page
+    size_t slack = 0;
+
+    /// Was the file opened in read-only mode?
+    bool read_only = false;
+
+    /// Most recent advice given to the operating system (-1: none)
+    int advice = -1;
+
+    /// Previous storage of a variable evaluated via jit_var_eval_to_file()
+    void *prev = nullptr;
+};
+
+/// Active file mappings, keyed by the data pointer of the associated variable
+static tsl::robin_map<uint64_t, FileMapping, UInt64Hasher> file_mappings;
+
+/// Pending outputs of jit_var_eval_to_file(), see jitc_file_output()
+static tsl::robin_map<uint32_t, void *, UInt32Hasher> file_outputs;
+
+uint32_t jitc_file_mapping_count = 0;
+uint32_t jitc_file_output_count = 0;
+
+static void jitc_file_unmap(void *base, size_t length) {
+#if !defined(_WIN32)
+    if (munmap(base, length) != 0)
+        jitc_log(Warn, "jit_file_unmap(): munmap() failed: %s", strerror(errno));
+#else
+    (void) base; (void) length;
+#endif
+}
+
+/// Unmap a region once previously launched kernels have finished
+static void jitc_file_unmap_async(void *base, size_t length) {
+    if (!jitc_task) {
+        jitc_file_unmap(base, length);
+        return;
+    }
+
+    struct Payload { void *base; size_t length; };
+    Payload payload { base, length };
+
+    Task *task = task_submit_dep(
+        nullptr, &jitc_task, 1, 1,
+        [](uint32_t, void *p) {
+            Payload *payload = (Payload *) p;
+            jitc_file_unmap(payload->base, payload->length);
+        },
+        &payload, sizeof(Payload), nullptr, 1);
+    task_release(task);
+}
+
+/// Map 'size' bytes starting at byte 'offset' of the file 'path'
+static FileMapping jitc_file_map(const char *name, const char *path,
+                                 size_t offset, size_t size, JitFileMode mode) {
+#if !defined(_WIN32)
+    bool write = mode == JitFileMode::ReadWrite;
+
+    int fd = open(path, write ? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+    if (fd < 0)
+        jitc_raise("%s(): could not open file \"%s\": %s", name, path,
+                   strerror(errno));
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        jitc_raise("%s(): could not query the size of \"%s\": %s", name, path,
+                   strerror(err));
+    }
+
+    if ((size_t) st.st_size < offset + size) {
+        if (!write) {
+            close(fd);
+            jitc_raise("%s(): file \"%s\" is too small (%zu bytes, expected at "
+                       "least %zu bytes)!", name, path, (size_t) st.st_size,
+                       offset + size);
+        }
+
+        if (ftruncate(fd, (off_t) (offset + size)) != 0) {
+            int err = errno;
+            close(fd);
+            jitc_raise("%s(): could not resize file \"%s\": %s", name, path,
+                       strerror(err));
+        }
+    }
+
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE),
+           start = offset - offset % page_size,
+           length = offset - start + size,
+           length_pages = (length + page_size - 1) / page_size * page_size;
+
+    FileMapping m;
+    m.length = length_pages + page_size;
+    m.slack = length_pages - length;
+    m.read_only = mode == JitFileMode::Read;
+
+    /* LLVM kernels load and store full packets, hence the last one may
+       extend past the end of the region. Reserve an anonymous guard page
+       behind the file mapping, so that such accesses don't fault. */
+    void *ptr = mmap(nullptr, m.length, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr != MAP_FAILED &&
+        mmap(ptr, length, m.read_only ? PROT_READ : (PROT_READ | PROT_WRITE),
+             (write ? MAP_SHARED : MAP_PRIVATE) | MAP_FIXED, fd,
+             (off_t) start) == MAP_FAILED) {
+        int err = errno;
+        munmap(ptr, m.length);
+        ptr = MAP_FAILED;
+        errno = err;
+    }
+    int err = errno;
+    close(fd);
+
+    if (ptr == MAP_FAILED)
+        jitc_raise("%s(): could not map file \"%s\": %s", name, path,
+                   strerror(err));
+
+    m.base = ptr;
+    m.data = (uint8_t *) ptr + (offset - start);
+    return m;
+#else
+    (void) offset; (void) size; (void) mode;
+    jitc_raise("%s(\"%s\"): memory-mapped files are not supported on Windows!",
+               name, path);
+#endif
+}
+
+/// Variable callback that releases the file mapping once the variable is freed
+static void jitc_file_callback(uint32_t, int free, void *ptr) {
+    if (!free)
+        return;
+
+    auto it = file_mappings.find((uint64_t) (uintptr_t) ptr);
+    if (it == file_mappings.end())
+        jitc_fail("jit_file_callback(): unknown file mapping " DRJIT_PTR "!",
+                  (uintptr_t) ptr);
+
+    FileMapping m = it->second;
+    file_mappings.erase(it);
+    jitc_file_mapping_count--;
+
+    jitc_log(Debug, "jit_file_unmap(" DRJIT_PTR ", %zu bytes)",
+             (uintptr_t) m.base, m.length);
+
+    if (m.prev)
+        jitc_free(m.prev);
+
+    jitc_file_unmap_async(m.base, m.length);
+}
+
+/// Register the mapping 'm' whose data is referenced by variable 'index'
+static void jitc_file_register(uint32_t index, void *ptr, const FileMapping &m) {
+    file_mappings[(uint64_t) (uintptr_t) ptr] = m;
+    jitc_file_mapping_count++;
+
+    Extra &extra = state.extra[index];
+    extra.callback = jitc_file_callback;
+    extra.callback_data = ptr;
+    extra.callback_internal = true;
+    jitc_var(index)->extra = true;
+}
+
+uint32_t jitc_var_map_file(JitBackend backend, VarType type, const char *path,
+                           size_t offset, size_t size, JitFileMode mode) {
+    if (unlikely(size == 0))
+        return 0;
+
+    if (unlikely(size > 0xFFFFFFFF))
+        jitc_raise("jit_var_map_file(): tried to create an array with %zu "
+                   "entries, which exceeds the limit of 2^32 == 4294967296 "
+                   "entries.", size);
+
+    if (backend == JitBackend::CUDA && mode == JitFileMode::ReadWrite)
+        jitc_raise("jit_var_map_file(): JitFileMode::ReadWrite is not "
+                   "supported by the CUDA backend!");
+
+    size_t bytes = size * (size_t) type_size[(int) type];
+    FileMapping m = jitc_file_map("jit_var_map_file", path, offset, bytes, mode);
+    void *ptr = m.data;
+
+    uint32_t index;
+    if (backend == JitBackend::CUDA) {
+        // Copy to the device, the mapping is not needed afterwards
+        try {
+            index = jitc_var_mem_copy(backend, AllocType::Host, type, ptr, size);
+        } catch (...) {
+            jitc_file_unmap(m.base, m.length);
+            throw;
+        }
+        jitc_file_unmap(m.base, m.length);
+    } else {
+        index = jitc_var_mem_map(backend, type, ptr, size, 0);
+        jitc_file_register(index, ptr, m);
+    }
+
+    jitc_log(Debug, "jit_var_map_file(%s r%u[%zu] <- \"%s\" @ %zu)",
+             type_name[(int) type], index, size, path, offset);
+
+    return index;
+}
+
+void jitc_var_eval_to_file(uint32_t index, const char *path, size_t offset) {
+    if (index == 0)
+        jitc_raise("jit_var_eval_to_file(): uninitialized variable!");
+
+    Variable *v = jitc_var(index);
+    if ((JitBackend) v->backend != JitBackend::LLVM)
+        jitc_raise("jit_var_eval_to_file(): only supported by the LLVM backend!");
+    else if (v->placeholder)
+        jitc_raise("jit_var_eval_to_file(): r%u is a placeholder variable!",
+                   index);
+    else if (offset % 64 != 0)
+        jitc_raise("jit_var_eval_to_file(): the offset must be a multiple of "
+                   "64 bytes!");
+    else if (v->extra && state.extra[index].callback)
+        jitc_raise("jit_var_eval_to_file(): r%u already has a callback (it "
+                   "may already refer to a file mapping)!", index);
+
+    size_t bytes = (size_t) v->size * (size_t) type_size[v->type];
+    FileMapping m = jitc_file_map("jit_var_eval_to_file", path, offset, bytes,
+                                  JitFileMode::ReadWrite);
+    void *ptr = m.data;
+
+    try {
+        if (v->is_stmt() || v->is_node()) {
+            /* The last packet written by the kernel may extend past the end
+               of the region. Preserve the following bytes of the file. */
+            uint8_t *end = (uint8_t *) ptr + bytes;
+            void *saved = nullptr;
+            if (m.slack) {
+                saved = jitc_malloc(AllocType::HostAsync, m.slack);
+                jitc_memcpy_async(JitBackend::LLVM, saved, end, m.slack);
+            }
+
+            // Let the kernel write to the mapping, see jitc_file_output()
+            file_outputs[index] = ptr;
+            jitc_file_output_count++;
+            try {
+                jitc_var_eval(index);
+            } catch (...) {
+                if (file_outputs.erase(index))
+                    jitc_file_output_count--;
+                if (saved) {
+                    jitc_memcpy_async(JitBackend::LLVM, end, saved, m.slack);
+                    jitc_free(saved);
+                }
+                throw;
+            }
+            if (file_outputs.erase(index))
+                jitc_file_output_count--;
+            if (saved) {
+                jitc_memcpy_async(JitBackend::LLVM, end, saved, m.slack);
+                jitc_free(saved);
+            }
+        } else {
+            jitc_var_eval(index);
+        }
+
+        v = jitc_var(index);
+        if (v->data != ptr) {
+            // The variable was already evaluated, copy its contents once
+            void *prev = jitc_var_ptr(index);
+            jitc_memcpy_async(JitBackend::LLVM, ptr, prev, bytes);
+
+            /* The previous storage is released along with the mapping,
+               since pending gathers may still reference it */
+            v = jitc_var(index);
+            if (!v->retain_data)
+                m.prev = prev;
+            v->data = ptr;
+        }
+    } catch (...) {
+        jitc_file_unmap_async(m.base, m.length);
+        throw;
+    }
+
+    v->retain_data = true;
+    v->unaligned = false;
+    jitc_file_register(index, ptr, m);
+
+    jitc_log(Debug, "jit_var_eval_to_file(r%u -> \"%s\" @ %zu)", index, path,
+             offset);
+}
+
+void jitc_file_advise(const void *ptr, bool random) {
+#if !defined(_WIN32)
+    auto it = file_mappings.find((uint64_t) (uintptr_t) ptr);
+    if (it == file_mappings.end())
+        return;
+
+    FileMapping &m = it.value();
+    int advice = random ? MADV_RANDOM : MADV_SEQUENTIAL;
+    if (m.advice == advice)
+        return;
+
+    if (madvise(m.base, m.length, advice) != 0)
+        jitc_log(Debug, "jit_file_advise(): madvise() failed: %s",
+                 strerror(errno));
+
+    // Also start reading the file ahead of sequential accesses
+    if (!random)
+        madvise(m.base, m.length, MADV_WILLNEED);
+
+    m.advice = advice;
+#else
+    (void) ptr; (void) random;
+#endif
+}
+
+bool jitc_file_read_only(const void *ptr) {
+    auto it = file_mappings.find((uint64_t) (uintptr_t) ptr);
+    return it != file_mappings.end() && it->second.read_only;
+}
+
+void *jitc_file_output(uint32_t index) {
+    auto it = file_outputs.find(index);
+    return it != file_outputs.end() ? it->second : nullptr;
+}
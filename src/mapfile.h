@@ -0,0 +1,40 @@
+/*
+    src/mapfile.h -- Memory-mapped files as inputs and outputs of kernels
+
+    Copyright (c) 2021 Wenzel Jakob <wenzel.jakob@epfl.ch>
+
+    All rights reserved. Use of this source code is governed by a BSD-style
+    license that can be found in the LICENSE file.
+*/
+
+#pragma once
+
+#include <drjit-core/jit.h>
+
+/// Number of active file mappings (used to skip lookups when there are none)
+extern uint32_t jitc_file_mapping_count;
+
+/// Number of variables that will be evaluated into a file mapping
+extern uint32_t jitc_file_output_count;
+
+/// Map a region of a file and expose it as a variable
+extern uint32_t jitc_var_map_file(JitBackend backend, VarType type,
+                                  const char *path, size_t offset, size_t size,
+                                  JitFileMode mode);
+
+/// Evaluate a variable directly into a file
+extern void jitc_var_eval_to_file(uint32_t index, const char *path,
+                                  size_t offset);
+
+/**
+ * \brief Inform the operating system about how a kernel accesses the file
+ * mapping at 'ptr' (if any): sequentially by default, or randomly when the
+ * mapping is the source of a gather operation
+ */
+extern void jitc_file_advise(const void *ptr, bool random);
+
+/// Is 'ptr' a read-only file mapping that must not be modified in place?
+extern bool jitc_file_read_only(const void *ptr);
+
+/// Return the file mapping that should receive the output of variable 'index'
+extern void *jitc_file_output(uint32_t index);
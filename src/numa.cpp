@@ -0,0 +1,201 @@
+/*
+    src/numa.cpp -- NUMA-aware placement of host memory and scheduling of
+    LLVM kernel blocks
+
+    Copyright (c) 2021 Wenzel Jakob <wenzel.jakob@epfl.ch>
+
+    All rights reserved. Use of this source code is governed by a BSD-style
+    license that can be found in the LICENSE file.
+*/
+
+#include "numa.h"
+#include "log.h"
+#include <nanothread/nanothread.h>
+#include <algorithm>
+#include <vector>
+#include <cstdio>
+
+#if defined(__linux__)
+#  include <sched.h>
+#  include <unistd.h>
+#  include <sys/syscall.h>
+#endif
+
+bool jitc_numa = false;
+
+struct NumaNode {
+    /// Node ID assigned by the operating system
+    uint32_t id;
+
+    /// CPUs belonging to the node
+    std::vector<uint32_t> cpus;
+};
+
+/// NUMA nodes of the machine, detected on first use
+static std::vector<NumaNode> numa_nodes;
+static bool numa_detected = false;
+
+/// Index of the node that the calling worker thread is pinned to
+static thread_local int numa_worker_node = -1;
+
+#if defined(__linux__)
+/// Parse a list of ranges such as "0-3,8-11" as found in /sys
+static std::vector<uint32_t> jitc_numa_parse_list(const char *filename) {
+    std::vector<uint32_t> result;
+    FILE *f = fopen(filename, "r");
+    if (!f)
+        return result;
+
+    unsigned int start, end;
+    while (fscanf(f, "%u", &start) == 1) {
+        end = start;
+        int c = fgetc(f);
+        if (c == '-') {
+            if (fscanf(f, "%u", &end) != 1)
+                break;
+            c = fgetc(f);
+        }
+        for (uint32_t i = start; i <= end; ++i)
+            result.push_back(i);
+        if (c != ',')
+            break;
+    }
+
+    fclose(f);
+    return result;
+}
+#endif
+
+static void jitc_numa_detect() {
+    if (numa_detected)
+        return;
+    numa_detected = true;
+
+#if defined(__linux__)
+    char filename[128];
+    for (uint32_t id : jitc_numa_parse_list("/sys/devices/system/node/online")) {
+        // Node IDs must fit into the bit mask passed to mbind()
+        if (id >= sizeof(unsigned long) * 8 ||
+            numa_nodes.size() == DRJIT_NUMA_MAX_NODES)
+            break;
+
+        snprintf(filename, sizeof(filename),
+                 "/sys/devices/system/node/node%u/cpulist", id);
+        NumaNode node { id, jitc_numa_parse_list(filename) };
+
+        // Skip memory-only nodes
+        if (!node.cpus.empty())
+            numa_nodes.push_back(std::move(node));
+    }
+#endif
+
+    if (numa_nodes.size() > 1)
+        jitc_log(Info, "jit_numa(): detected %zu NUMA nodes.", numa_nodes.size());
+}
+
+uint32_t jitc_numa_node_count() {
+    jitc_numa_detect();
+    return std::max((uint32_t) numa_nodes.size(), 1u);
+}
+
+void jitc_numa_set(bool value) {
+    if (value && jitc_numa_node_count() == 1) {
+        jitc_log(Info, "jit_llvm_set_numa(): this machine has a single NUMA "
+                       "node, ignoring.");
+        value = false;
+    }
+    jitc_numa = value;
+}
+
+void jitc_numa_partition(void *ptr, size_t size) {
+#if defined(__linux__)
+    const int mpol_preferred = 1;
+    uint32_t node_count = jitc_numa_node_count();
+
+    for (size_t offset = 0, chunk = 0; offset < size;
+         offset += DRJIT_NUMA_CHUNK_SIZE, ++chunk) {
+        unsigned long mask = 1ul << numa_nodes[chunk % node_count].id;
+        size_t len = std::min(size - offset, (size_t) DRJIT_NUMA_CHUNK_SIZE);
+
+        if (syscall(SYS_mbind, (uint8_t *) ptr + offset, len, mpol_preferred,
+                    &mask, sizeof(unsigned long) * 8, 0) != 0) {
+            jitc_log(Warn, "jit_numa_partition(): mbind() failed, disabling "
+                           "the NUMA mode.");
+            jitc_numa = false;
+            return;
+        }
+    }
+#else
+    (void) ptr; (void) size;
+#endif
+}
+
+/// Determine the node of the calling thread, and pin worker threads to a node
+static uint32_t jitc_numa_current_node() {
+    if (numa_worker_node >= 0)
+        return (uint32_t) numa_worker_node;
+
+    uint32_t node_count = jitc_numa_node_count();
+
+#if defined(__linux__)
+    uint32_t worker_id = pool_thread_id();
+    if (worker_id > 0) {
+        // Distribute the workers of the thread pool evenly across the nodes
+        uint32_t index = (worker_id - 1) % node_count;
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (uint32_t cpu : numa_nodes[index].cpus) {
+            if (cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &set);
+        }
+
+        if (sched_setaffinity(0, sizeof(cpu_set_t), &set) != 0)
+            jitc_log(Warn, "jit_numa(): could not pin worker %u to NUMA node %u!",
+                     worker_id, numa_nodes[index].id);
+
+        numa_worker_node = (int) index;
+        return index;
+    }
+
+    // Other threads may migrate, query the node that currently runs them
+    unsigned int cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+        for (uint32_t i = 0; i < node_count; ++i) {
+            if (numa_nodes[i].id == node)
+                return i;
+        }
+    }
+#endif
+
+    return 0;
+}
+
+NumaLaunch::NumaLaunch(uint32_t blocks, uint32_t block_size, uint32_t isize)
+    : blocks(blocks), node_count(jitc_numa_node_count()),
+      blocks_left(blocks) {
+    run = std::max((uint32_t) (DRJIT_NUMA_CHUNK_SIZE /
+                               ((size_t) block_size * isize)), 1u);
+    for (uint32_t i = 0; i < DRJIT_NUMA_MAX_NODES; ++i)
+        next[i].store(0, std::memory_order_relaxed);
+}
+
+uint32_t NumaLaunch::claim() {
+    uint32_t node = jitc_numa_current_node();
+
+    /* Since each invocation claims exactly one block, some node always has
+       an unclaimed block left. The index is monotonic in the counter value,
+       hence nodes whose counter is past the end can be skipped. */
+    while (true) {
+        for (uint32_t i = 0; i < node_count; ++i) {
+            uint32_t k = (node + i) % node_count;
+            if (index(k, next[k].load(std::memory_order_relaxed)) >= blocks)
+                continue;
+
+            uint64_t result =
+                index(k, next[k].fetch_add(1, std::memory_order_relaxed));
+            if (result < blocks)
+                return (uint32_t) result;
+        }
+    }
+}
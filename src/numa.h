@@ -0,0 +1,79 @@
+/*
+    src/numa.h -- NUMA-aware placement of host memory and scheduling of
+    LLVM kernel blocks
+
+    Copyright (c) 2021 Wenzel Jakob <wenzel.jakob@epfl.ch>
+
+    All rights reserved. Use of this source code is governed by a BSD-style
+    license that can be found in the LICENSE file.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// Maximum number of NUMA nodes that are taken into account
+#define DRJIT_NUMA_MAX_NODES 16
+
+/**
+ * Granularity of the node placement of partitioned allocations: consecutive
+ * chunks of this size are assigned to the NUMA nodes in a round-robin fashion
+ */
+#define DRJIT_NUMA_CHUNK_SIZE (2 * 1024 * 1024)
+
+/// Is the NUMA mode enabled? (see \ref jit_llvm_set_numa())
+extern bool jitc_numa;
+
+/// Number of NUMA nodes of the machine (1 if unavailable)
+extern uint32_t jitc_numa_node_count();
+
+/// Enable or disable the NUMA mode
+extern void jitc_numa_set(bool value);
+
+/// Should an allocation of the given size be partitioned across nodes?
+inline bool jitc_numa_partition_size(size_t size) {
+    return jitc_numa && size >= DRJIT_NUMA_CHUNK_SIZE * jitc_numa_node_count();
+}
+
+/// Place the chunks of a freshly mapped region onto the NUMA nodes
+extern void jitc_numa_partition(void *ptr, size_t size);
+
+/**
+ * \brief Per-launch state that maps the blocks of an LLVM kernel to the NUMA
+ * node owning their output range
+ *
+ * Block \c i writes the bytes <tt>[i*block_size*isize, (i+1)*block_size*isize)</tt>
+ * of its outputs, which lie in chunk <tt>i*block_size*isize /
+ * DRJIT_NUMA_CHUNK_SIZE</tt>. nanothread hands out block indices to arbitrary
+ * workers, hence each invocation instead claims the next unprocessed block of
+ * the node that runs it, and falls back to the blocks of other nodes once
+ * these are exhausted. The last block releases the record.
+ */
+struct NumaLaunch {
+    NumaLaunch(uint32_t blocks, uint32_t block_size, uint32_t isize);
+
+    /// Claim a block to be processed by the calling thread
+    uint32_t claim();
+
+    /// Index of the block that the 'c'-th claim on node 'k' refers to
+    uint64_t index(uint32_t k, uint32_t c) const {
+        return ((uint64_t) (c / run) * node_count + k) * run + c % run;
+    }
+
+    /// Called after processing a block
+    void release() {
+        if (blocks_left.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete this;
+    }
+
+    uint32_t blocks;
+    uint32_t node_count;
+
+    /// Number of consecutive blocks writing to the same chunk
+    uint32_t run;
+
+    std::atomic<uint32_t> next[DRJIT_NUMA_MAX_NODES];
+    std::atomic<uint32_t> blocks_left;
+};
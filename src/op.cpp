@@ -4,6 +4,8 @@
 #include "log.h"
 #include "eval.h"
 #include "op.h"
+#include "mapfile.h"
+#include "half.h"
 
 template <bool Value> using enable_if_t = std::enable_if_t<Value, int>;
 
@@ -14,8 +16,7 @@ enum CheckFlags {
     IsInt = 2,
     IsIntOrBool = 4,
     IsNotVoid = 8,
-    IsFloat = 16,
-    IsCUDA = 32
+    IsFloat = 16
 };
 
 /// Summary information about a set of variables returned by jitc_var_check()
@@ -116,13 +117,6 @@ auto jitc_var_check_impl(const char *name, std::index_sequence<Is...>, Args... a
             }
         }
 
-        if constexpr (bool(Flags & IsCUDA)) {
-            if (unlikely((JitBackend) vi->backend != JitBackend::CUDA)) {
-                err = "operation is only supported on the CUDA backend";
-                goto fail;
-            }
-        }
-
         if constexpr (Flags != Disabled) {
             if (unlikely(type != VarType::Void && (VarType) vi->type != type)) {
                 err = "operands have incompatible types";
@@ -223,6 +217,16 @@ Dst memcpy_cast(const Src &src) {
 
 template <typename T, typename... Ts> T first(T arg, Ts...) { return arg; }
 
+/// Type traits that also cover the host-side half precision type
+template <typename T>
+constexpr bool is_float_v = std::is_floating_point_v<T> || std::is_same_v<T, half>;
+template <typename T>
+constexpr bool is_signed_v = std::is_signed_v<T> || std::is_same_v<T, half>;
+
+/// Round single precision results of half precision operands back to half
+template <typename T> T round_half(T value) { return value; }
+inline half round_half(float value) { return half(value); }
+
 template <typename Func, typename... Args>
 JIT_INLINE uint32_t jitc_eval_literal(const VarInfo &info, Func func,
                                       const Args *...args) {
@@ -238,6 +242,7 @@ JIT_INLINE uint32_t jitc_eval_literal(const VarInfo &info, Func func,
         case VarType::UInt32:  r = v2i(func(i2v<uint32_t>(args->literal)...)); break;
         case VarType::Int64:   r = v2i(func(i2v< int64_t>(args->literal)...)); break;
         case VarType::UInt64:  r = v2i(func(i2v<uint64_t>(args->literal)...)); break;
+        case VarType::Float16: r = v2i(round_half(func(i2v<    half>(args->literal)...))); break;
         case VarType::Float32: r = v2i(func(i2v<   float>(args->literal)...)); break;
         case VarType::Float64: r = v2i(func(i2v<  double>(args->literal)...)); break;
         default: jitc_fail("jit_eval_literal(): unsupported variable type!");
@@ -291,10 +296,10 @@ uint32_t jitc_var_shift(const VarInfo &info, uint32_t index, uint64_t amount) {
 
 // --------------------------------------------------------------------------
 
-template <typename T, enable_if_t<!std::is_signed_v<T>> = 0>
+template <typename T, enable_if_t<!is_signed_v<T>> = 0>
 T eval_neg(T v) { return T(-(std::make_signed_t<T>) v); }
 
-template <typename T, enable_if_t<std::is_signed_v<T>> = 0>
+template <typename T, enable_if_t<is_signed_v<T>> = 0>
 T eval_neg(T v) { return -v; }
 
 static bool eval_neg(bool) { jitc_fail("eval_neg(): unsupported operands!"); }
@@ -340,10 +345,10 @@ uint32_t jitc_var_not(uint32_t a0) {
 
 // --------------------------------------------------------------------------
 
-template <typename T, enable_if_t<std::is_floating_point_v<T>> = 0>
+template <typename T, enable_if_t<is_float_v<T>> = 0>
 T eval_sqrt(T value) { return std::sqrt(value); }
 
-template <typename T, enable_if_t<!std::is_floating_point_v<T>> = 0>
+template <typename T, enable_if_t<!is_float_v<T>> = 0>
 T eval_sqrt(T) { jitc_fail("eval_sqrt(): unsupported operands!"); }
 
 uint32_t jitc_var_sqrt(uint32_t a0) {
@@ -363,10 +368,10 @@ uint32_t jitc_var_sqrt(uint32_t a0) {
 
 // --------------------------------------------------------------------------
 
-template <typename T, enable_if_t<std::is_signed_v<T>> = 0>
+template <typename T, enable_if_t<is_signed_v<T>> = 0>
 T eval_abs(T value) { return (T) std::abs(value); }
 
-template <typename T, enable_if_t<!std::is_signed_v<T>> = 0>
+template <typename T, enable_if_t<!is_signed_v<T>> = 0>
 T eval_abs(T value) { return value; }
 
 uint32_t jitc_var_abs(uint32_t a0) {
@@ -571,10 +576,10 @@ uint32_t jitc_var_mulhi(uint32_t a0, uint32_t a1) {
 
 // --------------------------------------------------------------------------
 
-template <typename T, enable_if_t<std::is_floating_point_v<T>> = 0>
+template <typename T, enable_if_t<is_float_v<T>> = 0>
 T eval_fma(T a, T b, T c) { return std::fma(a, b, c); }
 
-template <typename T, enable_if_t<!std::is_floating_point_v<T> &&
+template <typename T, enable_if_t<!is_float_v<T> &&
                                   !std::is_same_v<T, bool>> = 0>
 T eval_fma(T a, T b, T c) { return (T) (a * b + c); }
 
@@ -665,10 +670,10 @@ uint32_t jitc_var_max(uint32_t a0, uint32_t a1) {
 
 // --------------------------------------------------------------------------
 
-template <typename T, enable_if_t<std::is_floating_point<T>::value> = 0>
+template <typename T, enable_if_t<is_float_v<T>> = 0>
 T eval_ceil(T value) { return std::ceil(value); }
 
-template <typename T, enable_if_t<!std::is_floating_point<T>::value> = 0>
+template <typename T, enable_if_t<!is_float_v<T>> = 0>
 T eval_ceil(T) { jitc_fail("eval_ceil(): unsupported operands!"); }
 
 uint32_t jitc_var_ceil(uint32_t a0) {
@@ -688,10 +693,10 @@ uint32_t jitc_var_ceil(uint32_t a0) {
 
 // --------------------------------------------------------------------------
 
-template <typename T, enable_if_t<std::is_floating_point<T>::value> = 0>
+template <typename T, enable_if_t<is_float_v<T>> = 0>
 T eval_floor(T value) { return std::floor(value); }
 
-template <typename T, enable_if_t<!std::is_floating_point<T>::value> = 0>
+template <typename T, enable_if_t<!is_float_v<T>> = 0>
 T eval_floor(T) { jitc_fail("eval_floor(): unsupported operands!"); }
 
 uint32_t jitc_var_floor(uint32_t a0) {
@@ -711,10 +716,10 @@ uint32_t jitc_var_floor(uint32_t a0) {
 
 // --------------------------------------------------------------------------
 
-template <typename T, enable_if_t<std::is_floating_point<T>::value> = 0>
+template <typename T, enable_if_t<is_float_v<T>> = 0>
 T eval_round(T value) { return std::rint(value); }
 
-template <typename T, enable_if_t<!std::is_floating_point<T>::value> = 0>
+template <typename T, enable_if_t<!is_float_v<T>> = 0>
 T eval_round(T) { jitc_fail("eval_round(): unsupported operands!"); }
 
 uint32_t jitc_var_round(uint32_t a0) {
@@ -734,10 +739,10 @@ uint32_t jitc_var_round(uint32_t a0) {
 
 // --------------------------------------------------------------------------
 
-template <typename T, enable_if_t<std::is_floating_point<T>::value> = 0>
+template <typename T, enable_if_t<is_float_v<T>> = 0>
 T eval_trunc(T value) { return std::trunc(value); }
 
-template <typename T, enable_if_t<!std::is_floating_point<T>::value> = 0>
+template <typename T, enable_if_t<!is_float_v<T>> = 0>
 T eval_trunc(T) { jitc_fail("eval_trunc(): unsupported operands!"); }
 
 uint32_t jitc_var_trunc(uint32_t a0) {
@@ -1179,10 +1184,10 @@ uint32_t jitc_var_shr(uint32_t a0, uint32_t a1) {
 
 // --------------------------------------------------------------------------
 
-template <typename T, enable_if_t<std::is_floating_point_v<T>> = 0>
+template <typename T, enable_if_t<is_float_v<T>> = 0>
 T eval_rcp(T value) { return 1 / value; }
 
-template <typename T, enable_if_t<!std::is_floating_point_v<T>> = 0>
+template <typename T, enable_if_t<!is_float_v<T>> = 0>
 T eval_rcp(T) { jitc_fail("eval_rcp(): unsupported operands!"); }
 
 uint32_t jitc_var_rcp(uint32_t a0) {
@@ -1193,11 +1198,13 @@ uint32_t jitc_var_rcp(uint32_t a0) {
         result = jitc_eval_literal(info, [](auto l0) { return eval_rcp(l0); }, v0);
 
     if (!result && info.backend == JitBackend::LLVM) {
-        float f1 = 1.f; double d1 = 1.0;
+        half h1 = 1.f; float f1 = 1.f; double d1 = 1.0;
         uint32_t one = jitc_var_literal(info.backend, info.type,
-                                            info.type == VarType::Float32
-                                                ? (const void *) &f1
-                                                : (const void *) &d1, 1, 0);
+                                        info.type == VarType::Float16
+                                            ? (const void *) &h1
+                                        : info.type == VarType::Float32
+                                            ? (const void *) &f1
+                                            : (const void *) &d1, 1, 0);
         result = jitc_var_div(one, a0);
         jitc_var_dec_ref(one);
     }
@@ -1212,10 +1219,10 @@ uint32_t jitc_var_rcp(uint32_t a0) {
 
 // --------------------------------------------------------------------------
 
-template <typename T, enable_if_t<std::is_floating_point<T>::value> = 0>
+template <typename T, enable_if_t<is_float_v<T>> = 0>
 T eval_rsqrt(T value) { return 1 / std::sqrt(value); }
 
-template <typename T, enable_if_t<!std::is_floating_point<T>::value> = 0>
+template <typename T, enable_if_t<!is_float_v<T>> = 0>
 T eval_rsqrt(T) { jitc_fail("eval_rsqrt(): unsupported operands!"); }
 
 uint32_t jitc_var_rsqrt(uint32_t a0) {
@@ -1242,14 +1249,14 @@ uint32_t jitc_var_rsqrt(uint32_t a0) {
 
 // --------------------------------------------------------------------------
 
-template <typename T, enable_if_t<std::is_floating_point_v<T>> = 0>
+template <typename T, enable_if_t<is_float_v<T>> = 0>
 T eval_sin(T value) { return std::sin(value); }
 
-template <typename T, enable_if_t<!std::is_floating_point_v<T>> = 0>
+template <typename T, enable_if_t<!is_float_v<T>> = 0>
 T eval_sin(T) { jitc_fail("eval_sin(): unsupported operands!"); }
 
 uint32_t jitc_var_sin(uint32_t a0) {
-    auto [info, v0] = jitc_var_check<IsFloat | IsCUDA>("jit_var_sin", a0);
+    auto [info, v0] = jitc_var_check<IsFloat>("jit_var_sin", a0);
 
     uint32_t result = 0;
     if (info.simplify && info.literal)
@@ -1265,14 +1272,14 @@ uint32_t jitc_var_sin(uint32_t a0) {
 
 // --------------------------------------------------------------------------
 
-template <typename T, enable_if_t<std::is_floating_point_v<T>> = 0>
+template <typename T, enable_if_t<is_float_v<T>> = 0>
 T eval_cos(T value) { return std::cos(value); }
 
-template <typename T, enable_if_t<!std::is_floating_point_v<T>> = 0>
+template <typename T, enable_if_t<!is_float_v<T>> = 0>
 T eval_cos(T) { jitc_fail("eval_cos(): unsupported operands!"); }
 
 uint32_t jitc_var_cos(uint32_t a0) {
-    auto [info, v0] = jitc_var_check<IsFloat | IsCUDA>("jit_var_cos", a0);
+    auto [info, v0] = jitc_var_check<IsFloat>("jit_var_cos", a0);
 
     uint32_t result = 0;
     if (info.simplify && info.literal)
@@ -1288,14 +1295,14 @@ uint32_t jitc_var_cos(uint32_t a0) {
 
 // --------------------------------------------------------------------------
 
-template <typename T, enable_if_t<std::is_floating_point_v<T>> = 0>
+template <typename T, enable_if_t<is_float_v<T>> = 0>
 T eval_exp2(T value) { return std::exp2(value); }
 
-template <typename T, enable_if_t<!std::is_floating_point_v<T>> = 0>
+template <typename T, enable_if_t<!is_float_v<T>> = 0>
 T eval_exp2(T) { jitc_fail("eval_exp2(): unsupported operands!"); }
 
 uint32_t jitc_var_exp2(uint32_t a0) {
-    auto [info, v0] = jitc_var_check<IsFloat | IsCUDA>("jit_var_exp2", a0);
+    auto [info, v0] = jitc_var_check<IsFloat>("jit_var_exp2", a0);
 
     uint32_t result = 0;
     if (info.simplify && info.literal)
@@ -1311,14 +1318,14 @@ uint32_t jitc_var_exp2(uint32_t a0) {
 
 // --------------------------------------------------------------------------
 
-template <typename T, enable_if_t<std::is_floating_point_v<T>> = 0>
+template <typename T, enable_if_t<is_float_v<T>> = 0>
 T eval_log2(T value) { return std::log2(value); }
 
-template <typename T, enable_if_t<!std::is_floating_point_v<T>> = 0>
+template <typename T, enable_if_t<!is_float_v<T>> = 0>
 T eval_log2(T) { jitc_fail("eval_log2(): unsupported operands!"); }
 
 uint32_t jitc_var_log2(uint32_t a0) {
-    auto [info, v0] = jitc_var_check<IsFloat | IsCUDA>("jit_var_log2", a0);
+    auto [info, v0] = jitc_var_check<IsFloat>("jit_var_log2", a0);
 
     uint32_t result = 0;
     if (info.simplify && info.literal)
@@ -1377,6 +1384,7 @@ uint32_t jitc_var_cast(uint32_t a0, VarType target_type, int reinterpret) {
                     case VarType::UInt32:  return v2i((uint32_t) value);
                     case VarType::Int64:   return v2i((int64_t) value);
                     case VarType::UInt64:  return v2i((uint64_t) value);
+                    case VarType::Float16: return v2i(half((float) value));
                     case VarType::Float32: return v2i((float) value);
                     case VarType::Float64: return v2i((double) value);
                     default: jitc_fail("jit_var_cast(): unsupported variable type!");
@@ -1713,7 +1721,9 @@ uint32_t jitc_var_scatter(uint32_t target_, uint32_t value, uint32_t index,
     }
 
     // Check if it is safe to write directly
-    if (target_v->ref_count > 2) /// 1 from original array, 1 from borrow above
+    if (target_v->ref_count > 2 || /// 1 from original array, 1 from borrow above
+        (unlikely(jitc_file_mapping_count) && target_v->is_data() &&
+         jitc_file_read_only(target_v->data)))
         target = steal(jitc_var_copy(target));
 
     ptr = steal(jitc_var_pointer(var_info.backend, jitc_var_ptr(target), target, 1));
@@ -0,0 +1,196 @@
+/*
+    src/profiler.cpp -- Built-in tracer that records profiler phases and
+    kernel launches, and writes them in the Chrome trace event format
+
+    Copyright (c) 2021 Wenzel Jakob <wenzel.jakob@epfl.ch>
+
+    All rights reserved. Use of this source code is governed by a BSD-style
+    license that can be found in the LICENSE file.
+*/
+
+#include "common.h"
+#include "profiler.h"
+#include "log.h"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include <cstdio>
+
+/// Number of events retained per thread (older events are overwritten)
+#define DRJIT_PROFILE_BUFFER_SIZE 65536
+
+struct ProfileEvent {
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+    uint64_t arg;
+    ProfileEventType type;
+};
+
+/**
+ * Ring buffer of events. Only the owning thread writes \c events and \c head,
+ * while \c tail (the index of the first event that was not cleared) is only
+ * written by jitc_profile_clear() while holding \c profile_mutex. Readers
+ * therefore never need to stop the owner: see jitc_profile_dump() for how
+ * events that are overwritten during a read are detected.
+ */
+struct ProfileBuffer {
+    std::unique_ptr<ProfileEvent[]> events;
+    std::atomic<uint64_t> head { 0 };
+    std::atomic<uint64_t> tail { 0 };
+    uint32_t tid;
+
+    ProfileBuffer(uint32_t tid)
+        : events(new ProfileEvent[DRJIT_PROFILE_BUFFER_SIZE]), tid(tid) { }
+};
+
+std::atomic<bool> jitc_profile_active { false };
+
+/// Buffers of all threads that recorded events so far (never released)
+static std::mutex profile_mutex;
+static std::vector<std::unique_ptr<ProfileBuffer>> profile_buffers;
+static thread_local ProfileBuffer *profile_buffer = nullptr;
+
+/// Time of the most recent jit_profile_start() call (protected by profile_mutex)
+static uint64_t profile_start_time = 0;
+
+uint64_t jitc_profile_time() {
+    return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void jitc_profile_record(ProfileEventType type, const char *name,
+                         uint64_t start, uint64_t arg) {
+    uint64_t end = jitc_profile_time();
+
+    ProfileBuffer *buf = profile_buffer;
+    if (unlikely(!buf)) {
+        std::lock_guard<std::mutex> guard(profile_mutex);
+        buf = new ProfileBuffer((uint32_t) profile_buffers.size());
+        profile_buffers.emplace_back(buf);
+        profile_buffer = buf;
+    }
+
+    uint64_t head = buf->head.load(std::memory_order_relaxed);
+    buf->events[head % DRJIT_PROFILE_BUFFER_SIZE] =
+        ProfileEvent{ name, start, end, arg, type };
+    buf->head.store(head + 1, std::memory_order_release);
+}
+
+const char *jitc_profile_intern(const char *name) {
+    static std::mutex mutex;
+    static std::unordered_set<std::string> names;
+
+    std::lock_guard<std::mutex> guard(mutex);
+    return names.emplace(name).first->c_str();
+}
+
+void jitc_profile_start() {
+    std::lock_guard<std::mutex> guard(profile_mutex);
+    if (!profile_start_time)
+        profile_start_time = jitc_profile_time();
+    jitc_profile_active.store(true, std::memory_order_relaxed);
+    jitc_log(Info, "jit_profile_start(): recording events.");
+}
+
+void jitc_profile_stop() {
+    jitc_profile_active.store(false, std::memory_order_relaxed);
+}
+
+void jitc_profile_clear() {
+    std::lock_guard<std::mutex> guard(profile_mutex);
+    for (auto &buf : profile_buffers)
+        buf->tail.store(buf->head.load(std::memory_order_acquire),
+                        std::memory_order_relaxed);
+    profile_start_time = jitc_profile_active ? jitc_profile_time() : 0;
+}
+
+/// Print a JSON string literal (only backslashes and quotes are escaped)
+void jitc_profile_put_str(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\')
+            fputc('\\', f);
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+int jitc_profile_dump(const char *filename) {
+    FILE *f = fopen(filename, "w");
+    if (!f) {
+        jitc_log(Warn, "jit_profile_dump(): could not open \"%s\"!", filename);
+        return 0;
+    }
+
+    const char *type_name[] = { "phase", "kernel", "task" };
+    size_t count = 0;
+    bool first = true;
+
+    fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+
+    std::lock_guard<std::mutex> guard(profile_mutex);
+    std::vector<ProfileEvent> events;
+    for (auto &buf : profile_buffers) {
+        uint64_t head = buf->head.load(std::memory_order_acquire),
+                 start = head > DRJIT_PROFILE_BUFFER_SIZE
+                             ? head - DRJIT_PROFILE_BUFFER_SIZE : 0;
+        start = std::max(start, buf->tail.load(std::memory_order_relaxed));
+
+        /* The owning thread may still be appending. Copy the events first,
+           then re-read 'head': an event that is in progress at that point
+           overwrites the slot of event 'head2 - DRJIT_PROFILE_BUFFER_SIZE',
+           so all copies at or before that index may be torn and are
+           skipped (seqlock-style validation). */
+        events.clear();
+        for (uint64_t i = start; i < head; ++i)
+            events.push_back(buf->events[i % DRJIT_PROFILE_BUFFER_SIZE]);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t head2 = buf->head.load(std::memory_order_relaxed);
+        if (head2 >= DRJIT_PROFILE_BUFFER_SIZE)
+            start = std::max(start, head2 - DRJIT_PROFILE_BUFFER_SIZE + 1);
+
+        if (start >= head)
+            continue;
+
+        fprintf(f, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, "
+                   "\"tid\": %u, \"args\": {\"name\": \"thread %u\"}}",
+                first ? "" : ",\n", buf->tid, buf->tid);
+        first = false;
+
+        for (uint64_t i = start; i < head; ++i) {
+            const ProfileEvent &e = events[i - (head - events.size())];
+            if (e.start < profile_start_time)
+                continue;
+
+            fprintf(f, ",\n{\"name\": ");
+            jitc_profile_put_str(f, e.name);
+            fprintf(f, ", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 0, "
+                       "\"tid\": %u, \"ts\": %.3f, \"dur\": %.3f",
+                    type_name[(int) e.type], buf->tid,
+                    (e.start - profile_start_time) * 1e-3,
+                    (e.end - e.start) * 1e-3);
+            if (e.type == ProfileEventType::Kernel)
+                fprintf(f, ", \"args\": {\"hash\": \"%016llx\"}",
+                        (unsigned long long) e.arg);
+            else if (e.type == ProfileEventType::Task)
+                fprintf(f, ", \"args\": {\"block\": %llu}",
+                        (unsigned long long) e.arg);
+            fputc('}', f);
+            count++;
+        }
+    }
+
+    fprintf(f, "\n]}\n");
+    bool success = ferror(f) == 0;
+    fclose(f);
+
+    jitc_log(Info, "jit_profile_dump(): wrote %zu events to \"%s\".", count,
+             filename);
+
+    return success ? 1 : 0;
+}
@@ -1,3 +1,5 @@
+#pragma once
+
 #if defined(DRJIT_ENABLE_ITTNOTIFY)
 #  include <ittnotify.h>
 #endif
@@ -6,12 +8,55 @@
 #  include <nvtx3/nvToolsExt.h>
 #endif
 
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
 #if defined(DRJIT_ENABLE_ITTNOTIFY)
 extern __itt_domain *drjit_domain;
 #endif
 
+/// Kinds of events recorded by the built-in tracer (see jit_profile_start())
+enum class ProfileEventType : uint32_t {
+    /// A \ref ProfilerPhase of Dr.Jit itself
+    Phase,
+
+    /// A block of an LLVM kernel, executed by a worker thread
+    Kernel,
+
+    /// A parallel task submitted via jitc_submit_cpu() (reductions, etc.)
+    Task
+};
+
+/// Is the built-in tracer currently recording events?
+extern std::atomic<bool> jitc_profile_active;
+
+/// Current time in nanoseconds for the built-in tracer
+extern uint64_t jitc_profile_time();
+
+/**
+ * \brief Record an event that started at time 'start' and ends now
+ *
+ * The event is appended to a ring buffer owned by the calling thread, which
+ * does not require any locks. The 'name' string must remain valid until the
+ * trace has been written.
+ */
+extern void jitc_profile_record(ProfileEventType type, const char *name,
+                                uint64_t start, uint64_t arg = 0);
+
+/// Return a copy of 'name' that remains valid until the process exits
+extern const char *jitc_profile_intern(const char *name);
+
+extern void jitc_profile_start();
+extern void jitc_profile_stop();
+extern void jitc_profile_clear();
+extern int jitc_profile_dump(const char *filename);
+
+/// Print a JSON string literal (only backslashes and quotes are escaped)
+extern void jitc_profile_put_str(FILE *f, const char *s);
+
 struct ProfilerRegion {
-    ProfilerRegion(const char *name) : name(name) {
+    ProfilerRegion(const char *name) : name(jitc_profile_intern(name)) {
 #if defined(DRJIT_ENABLE_ITTNOTIFY)
         itt_handle = __itt_string_handle_create(name);
 #endif
@@ -24,7 +69,9 @@ struct ProfilerRegion {
 };
 
 struct ProfilerPhase {
-    ProfilerPhase(const ProfilerRegion &region) {
+    ProfilerPhase(const ProfilerRegion &region) : name(region.name), start(0) {
+        if (jitc_profile_active.load(std::memory_order_relaxed))
+            start = jitc_profile_time();
 #if defined(DRJIT_ENABLE_ITTNOTIFY)
         __itt_task_begin(drjit_domain, __itt_null, __itt_null, region.itt_handle);
 #endif
@@ -40,5 +87,10 @@ struct ProfilerPhase {
 #if defined(DRJIT_ENABLE_NVTX)
         nvtxRangePop();
 #endif
+        if (start)
+            jitc_profile_record(ProfileEventType::Phase, name, start);
     }
+
+    const char *name;
+    uint64_t start;
 };
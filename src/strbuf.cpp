@@ -630,6 +630,13 @@ void StringBuffer::fmt_llvm(size_t nargs, const char *fmt, ...) {
                             *m_cur ++= '0';
                             *m_cur ++= 'x';
                             put_x64_unchecked(literal);
+                        } else if (vt == VarType::Float16) {
+                            // Half precision literals use the '0xH' prefix
+                            *m_cur ++= '0';
+                            *m_cur ++= 'x';
+                            *m_cur ++= 'H';
+                            for (uint32_t i = 0; i < 4; ++i)
+                                *m_cur ++= num[(literal >> (12 - 4 * i)) & 0xF];
                         } else {
                             put_u64_unchecked(literal);
                         }
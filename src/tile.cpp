@@ -0,0 +1,348 @@
+/*
+    src/tile.cpp -- Tiled evaluation of elementwise computations that are too
+    large to be materialized at once
+
+    Copyright (c) 2021 Wenzel Jakob <wenzel.jakob@epfl.ch>
+
+    All rights reserved. Use of this source code is governed by a BSD-style
+    license that can be found in the LICENSE file.
+*/
+
+#include "internal.h"
+#include "log.h"
+#include "var.h"
+#include "op.h"
+#include "eval.h"
+#include "util.h"
+#include "tile.h"
+
+using TileMap = tsl::robin_map<uint32_t, uint32_t, UInt32Hasher>;
+
+/// Can the computation of variable 'v' be split into tiles?
+static bool jitc_tile_supported(uint32_t index, const Variable *v) {
+    if (v->placeholder || v->side_effect || v->is_dirty())
+        return false;
+
+    // Labels are fine, but not callbacks or custom code generation
+    if (v->extra) {
+        const Extra &extra = state.extra[index];
+        if (extra.callback || extra.assemble || extra.n_dep ||
+            extra.vcall_bucket_count)
+            return false;
+    }
+
+    switch ((VarKind) v->kind) {
+        case VarKind::Data:
+        case VarKind::Literal:
+        case VarKind::Counter:
+        case VarKind::DefaultMask:
+        case VarKind::Gather:
+            return true;
+
+        default:
+            return v->kind >= (uint32_t) VarKind::Nop &&
+                   v->kind <= (uint32_t) VarKind::Bitcast;
+    }
+}
+
+/**
+ * Check that the computation graph of 'indices' depends elementwise on its
+ * inputs. Scalar variables are shared by all tiles and not traversed.
+ * Returns the first unsupported variable, or zero.
+ */
+static uint32_t jitc_tile_check(uint32_t n, const uint32_t *indices,
+                                uint32_t size) {
+    TileMap visited;
+    std::vector<uint32_t> stack(indices, indices + n);
+
+    while (!stack.empty()) {
+        uint32_t index = stack.back();
+        stack.pop_back();
+
+        const Variable *v = jitc_var(index);
+        if (v->size != size || !visited.emplace(index, 0).second)
+            continue;
+
+        if (!jitc_tile_supported(index, v))
+            return index;
+
+        for (uint32_t i = 0; i < 4; ++i) {
+            if (v->dep[i])
+                stack.push_back(v->dep[i]);
+        }
+    }
+
+    return 0;
+}
+
+/// Create the counterpart of variable 'index' for the entries [offset, offset + count)
+static uint32_t jitc_tile_var(uint32_t index, uint32_t size, uint32_t offset,
+                              uint32_t count, TileMap &map) {
+    struct Frame {
+        uint32_t index;
+        bool expanded;
+    };
+
+    std::vector<Frame> stack;
+    stack.push_back(Frame{ index, false });
+
+    while (!stack.empty()) {
+        Frame frame = stack.back();
+        const Variable *v = jitc_var(frame.index);
+
+        if (v->size != size || map.find(frame.index) != map.end()) {
+            stack.pop_back();
+            continue;
+        }
+
+        if (!frame.expanded && v->is_node() &&
+            v->kind != (uint32_t) VarKind::Counter &&
+            v->kind != (uint32_t) VarKind::DefaultMask) {
+            // Create the dependencies first
+            stack.back().expanded = true;
+            for (uint32_t i = 0; i < 4; ++i) {
+                if (v->dep[i])
+                    stack.push_back(Frame{ v->dep[i], false });
+            }
+            continue;
+        }
+
+        stack.pop_back();
+
+        JitBackend backend = (JitBackend) v->backend;
+        VarType type = (VarType) v->type;
+        bool has_label = v->extra;
+        uint32_t result;
+
+        if (v->is_data()) {
+            uint8_t *ptr = (uint8_t *) v->data +
+                           (size_t) offset * type_size[(int) type];
+            result = jitc_var_mem_map(backend, type, ptr, count, 0);
+        } else if (v->is_literal()) {
+            uint64_t literal = v->literal;
+            result = jitc_var_literal(backend, type, &literal, count, 0);
+        } else if (v->kind == (uint32_t) VarKind::Counter) {
+            Ref counter = steal(jitc_var_counter(backend, count, false)),
+                shift = steal(jitc_var_literal(backend, VarType::UInt32,
+                                               &offset, 1, 0));
+            result = jitc_var_add(counter, shift);
+        } else if (v->kind == (uint32_t) VarKind::DefaultMask) {
+            // Masks the lanes beyond the end of the tile
+            result = jitc_var_mask_default(backend, count);
+        } else {
+            /* Nodes of the supported kinds are fully described by the
+               fields below (see jitc_var_new_node_*()), the remainder is
+               assigned by jitc_var_new() */
+            Variable v2;
+            v2.kind = v->kind;
+            v2.backend = v->backend;
+            v2.type = v->type;
+            v2.literal = v->literal;
+            v2.size = count;
+
+            for (uint32_t i = 0; i < 4; ++i) {
+                uint32_t dep = v->dep[i];
+                if (!dep)
+                    continue;
+                auto it = map.find(dep);
+                dep = it != map.end() ? it->second : dep;
+                v2.dep[i] = dep;
+                jitc_var_inc_ref(dep);
+            }
+
+            result = jitc_var_new(v2);
+        }
+
+        map[frame.index] = result;
+
+        if (has_label) {
+            const char *label = jitc_var_label(frame.index);
+            if (label)
+                jitc_var_set_label(result, label);
+        }
+    }
+
+    auto it = map.find(index);
+    uint32_t result = it != map.end() ? it->second : index;
+    jitc_var_inc_ref(result);
+    return result;
+}
+
+void jitc_var_eval_tiled(uint32_t n, const uint32_t *indices,
+                         uint32_t tile_size, JitTileSink sink, void *payload,
+                         bool internal) {
+    if (n == 0)
+        return;
+
+    uint32_t size = 1;
+    JitBackend backend = JitBackend::Invalid;
+    for (uint32_t i = 0; i < n; ++i) {
+        if (!indices[i])
+            jitc_raise("jit_var_eval_tiled(): uninitialized variable!");
+        const Variable *v = jitc_var(indices[i]);
+        if (v->placeholder)
+            jitc_raise("jit_var_eval_tiled(): r%u is a placeholder variable!",
+                       indices[i]);
+        if (backend == JitBackend::Invalid)
+            backend = (JitBackend) v->backend;
+        else if (backend != (JitBackend) v->backend)
+            jitc_raise("jit_var_eval_tiled(): variables use different backends!");
+        if (v->size != 1 && size != 1 && v->size != size)
+            jitc_raise("jit_var_eval_tiled(): incompatible sizes (%u and %u)!",
+                       v->size, size);
+        size = std::max(size, v->size);
+    }
+
+    if (tile_size == 0)
+        tile_size = DRJIT_TILE_SIZE;
+
+    // Keep tiles aligned to the packet size of the LLVM backend
+    tile_size = (uint32_t) std::min((((uint64_t) tile_size + 63) / 64) * 64,
+                                    (uint64_t) 0xFFFFFFC0u);
+
+    std::vector<uint32_t> tiles(n);
+    auto invoke = [&](uint32_t offset, uint32_t count) {
+        if (internal) {
+            sink(payload, offset, count, tiles.data());
+        } else {
+            unlock_guard guard(state.lock);
+            sink(payload, offset, count, tiles.data());
+        }
+    };
+
+    uint32_t unsupported = 0;
+    if (size > tile_size)
+        unsupported = jitc_tile_check(n, indices, size);
+
+    if (size <= tile_size || unsupported) {
+        if (unsupported)
+            jitc_log(Info,
+                     "jit_var_eval_tiled(): r%u (%s) does not depend "
+                     "elementwise on its inputs, evaluating at full size.",
+                     unsupported, var_kind_name[jitc_var(unsupported)->kind]);
+
+        for (uint32_t i = 0; i < n; ++i) {
+            jitc_var_eval(indices[i]);
+            tiles[i] = indices[i];
+        }
+
+        invoke(0, size);
+        return;
+    }
+
+    uint32_t tile_count = (uint32_t) (((uint64_t) size + tile_size - 1) / tile_size);
+    jitc_log(Info, "jit_var_eval_tiled(): evaluating %u variable%s of size %u "
+             "in %u tiles.", n, n == 1 ? "" : "s", size, tile_count);
+
+    TileMap map;
+    auto release_map = [&map]() {
+        for (auto &kv : map)
+            jitc_var_dec_ref(kv.second);
+        map.clear();
+    };
+
+    /* Each tile is evaluated via jitc_eval() with only its own variables
+       scheduled. Other pending work of this thread (including anything that
+       the sink schedules without evaluating it) is set aside and restored at
+       the end, so that it is not flushed once per tile. */
+    ThreadState *ts = thread_state(backend);
+    std::vector<uint32_t> pending, pending_se;
+    pending.swap(ts->scheduled);
+    pending_se.swap(ts->side_effects);
+
+    auto set_aside = [&]() {
+        pending.insert(pending.end(), ts->scheduled.begin(),
+                       ts->scheduled.end());
+        pending_se.insert(pending_se.end(), ts->side_effects.begin(),
+                          ts->side_effects.end());
+        ts->scheduled.clear();
+        ts->side_effects.clear();
+    };
+
+    auto restore = [&]() {
+        set_aside();
+        pending.swap(ts->scheduled);
+        pending_se.swap(ts->side_effects);
+    };
+
+    for (uint64_t offset_ = 0; offset_ < size; offset_ += tile_size) {
+        uint32_t offset = (uint32_t) offset_,
+                 count = std::min(tile_size, size - offset);
+
+        std::fill(tiles.begin(), tiles.end(), 0u);
+
+        try {
+            for (uint32_t i = 0; i < n; ++i) {
+                tiles[i] = jitc_tile_var(indices[i], size, offset, count, map);
+                jitc_var_schedule(tiles[i]);
+            }
+
+            // Release intermediate variables that are not outputs of this tile
+            release_map();
+
+            jitc_eval(ts);
+            for (uint32_t i = 0; i < n; ++i)
+                jitc_var_eval(tiles[i]);
+            invoke(offset, count);
+            set_aside();
+        } catch (...) {
+            release_map();
+            for (uint32_t i = 0; i < n; ++i)
+                jitc_var_dec_ref(tiles[i]);
+            restore();
+            throw;
+        }
+
+        for (uint32_t i = 0; i < n; ++i)
+            jitc_var_dec_ref(tiles[i]);
+    }
+
+    restore();
+}
+
+struct TileReduction {
+    ReduceOp reduce_op;
+    uint32_t result;
+};
+
+static void jitc_tile_reduce_sink(void *payload, uint32_t, uint32_t,
+                                  const uint32_t *tiles) {
+    TileReduction *r = (TileReduction *) payload;
+    Ref value = steal(jitc_var_reduce(tiles[0], r->reduce_op));
+
+    if (!r->result) {
+        r->result = value.release();
+        return;
+    }
+
+    uint32_t combined;
+    switch (r->reduce_op) {
+        case ReduceOp::Add: combined = jitc_var_add(r->result, value); break;
+        case ReduceOp::Mul: combined = jitc_var_mul(r->result, value); break;
+        case ReduceOp::Min: combined = jitc_var_min(r->result, value); break;
+        case ReduceOp::Max: combined = jitc_var_max(r->result, value); break;
+        default: jitc_raise("jit_var_reduce_tiled(): unsupported reduction!");
+    }
+
+    jitc_var_dec_ref(r->result);
+    r->result = combined;
+    jitc_var_eval(combined);
+}
+
+uint32_t jitc_var_reduce_tiled(uint32_t index, ReduceOp reduce_op,
+                               uint32_t tile_size) {
+    if (unlikely(reduce_op == ReduceOp::And || reduce_op == ReduceOp::Or))
+        jitc_raise("jit_var_reduce_tiled(): doesn't support And/Or operation!");
+    else if (index == 0)
+        return 0;
+
+    TileReduction r { reduce_op, 0 };
+    try {
+        jitc_var_eval_tiled(1, &index, tile_size, jitc_tile_reduce_sink, &r,
+                            true);
+    } catch (...) {
+        jitc_var_dec_ref(r.result);
+        throw;
+    }
+    return r.result;
+}
@@ -0,0 +1,25 @@
+/*
+    src/tile.h -- Tiled evaluation of elementwise computations that are too
+    large to be materialized at once
+
+    Copyright (c) 2021 Wenzel Jakob <wenzel.jakob@epfl.ch>
+
+    All rights reserved. Use of this source code is governed by a BSD-style
+    license that can be found in the LICENSE file.
+*/
+
+#pragma once
+
+#include <drjit-core/jit.h>
+
+/// Default number of entries per tile
+#define DRJIT_TILE_SIZE (1u << 22)
+
+/// Evaluate the variables 'indices' tile by tile, see jit_var_eval_tiled()
+extern void jitc_var_eval_tiled(uint32_t n, const uint32_t *indices,
+                                uint32_t tile_size, JitTileSink sink,
+                                void *payload, bool internal = false);
+
+/// Reduce a variable without materializing it, see jit_var_reduce_tiled()
+extern uint32_t jitc_var_reduce_tiled(uint32_t index, ReduceOp reduce_op,
+                                      uint32_t tile_size);
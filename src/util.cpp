@@ -8,6 +8,7 @@
 */
 
 #include <condition_variable>
+#include <thread>
 #include "internal.h"
 #include "util.h"
 #include "var.h"
@@ -15,6 +16,7 @@
 #include "log.h"
 #include "vcall.h"
 #include "profiler.h"
+#include "half.h"
 
 #if defined(_MSC_VER)
 #  pragma warning (disable: 4146) // unary minus operator applied to unsigned type, result still unsigned
@@ -23,36 +25,82 @@
 const char *reduction_name[(int) ReduceOp::Count] = { "none", "sum", "mul",
                                                       "min", "max", "and", "or" };
 
+/// Names of parallel CPU tasks for the built-in tracer (indexed by KernelType)
+static const char *kernel_type_name[] = { "jit_submit_cpu: jit",
+                                          "jit_submit_cpu: reduce",
+                                          "jit_submit_cpu: vcall_reduce",
+                                          "jit_submit_cpu: other" };
+
+/// The CUDA kernels of the parallel primitives use 32-bit sizes
+static void jitc_cuda_check_size(const char *name, size_t size) {
+    if (unlikely(size > 0xFFFFFFFF))
+        jitc_raise("%s(): the CUDA backend supports arrays with at most "
+                   "2^32-1 entries (got %zu)!", name, size);
+}
+
 /// Helper function: enqueue parallel CPU task (synchronous or asynchronous)
 template <typename Func>
-void jitc_submit_cpu(KernelType type, Func &&func, uint32_t width,
+void jitc_submit_cpu(KernelType type, Func &&func, size_t width,
                      uint32_t size = 1, bool release_prev = true,
                      bool always_async = false) {
 
-    struct Payload { Func f; };
-    Payload payload{ std::forward<Func>(func) };
+    /* jit_sync_thread() only waits for 'jitc_task' when the calling thread
+       has an LLVM thread state, which callers don't necessarily create */
+    thread_state(JitBackend::LLVM);
+
+    uint32_t flags = jit_flags();
+
+    // Timing record for JitFlag::KernelStats
+    KernelLaunchTiming *timing = nullptr;
+    if (unlikely(flags & (uint32_t) JitFlag::KernelStats))
+        timing = new KernelLaunchTiming(size);
+
+    struct Payload { Func f; KernelType type; KernelLaunchTiming *timing; };
+    Payload payload{ std::forward<Func>(func), type, timing };
 
     static_assert(std::is_trivially_copyable<Payload>::value &&
                   std::is_trivially_destructible<Payload>::value, "Internal error!");
 
     Task *new_task = task_submit_dep(
         nullptr, &jitc_task, 1, size,
-        [](uint32_t index, void *payload) { ((Payload *) payload)->f(index); },
+        [](uint32_t index, void *payload) {
+            Payload *p = (Payload *) payload;
+            bool profile = jitc_profile_active.load(std::memory_order_relaxed);
+            if (unlikely(profile || p->timing)) {
+                uint64_t time = jitc_profile_time();
+                p->f(index);
+                if (profile)
+                    jitc_profile_record(ProfileEventType::Task,
+                                        kernel_type_name[(int) p->type], time,
+                                        index);
+                if (p->timing)
+                    p->timing->record(time, jitc_profile_time());
+            } else {
+                p->f(index);
+            }
+        },
         &payload, sizeof(Payload), nullptr, (int) always_async);
 
-    if (unlikely(jit_flag(JitFlag::LaunchBlocking)))
+    if (unlikely(flags & (uint32_t) JitFlag::LaunchBlocking))
         task_wait(new_task);
 
-    if (unlikely(jit_flag(JitFlag::KernelHistory))) {
+    if (unlikely(flags & ((uint32_t) JitFlag::KernelHistory |
+                          (uint32_t) JitFlag::KernelStats))) {
         KernelHistoryEntry entry = {};
         entry.backend = JitBackend::LLVM;
         entry.type = type;
-        entry.size = width;
+        entry.size = (uint32_t) std::min(width, (size_t) 0xFFFFFFFFu);
         entry.input_count = 1;
         entry.output_count = 1;
-        task_retain(new_task);
-        entry.task = new_task;
-        state.kernel_history.append(entry);
+
+        if (timing)
+            state.kernel_stats.append(entry, timing, nullptr, nullptr);
+
+        if (flags & (uint32_t) JitFlag::KernelHistory) {
+            task_retain(new_task);
+            entry.task = new_task;
+            state.kernel_history.append(entry);
+        }
     }
 
     if (release_prev)
@@ -76,31 +124,45 @@ void jitc_submit_gpu(KernelType type, CUfunction kernel, uint32_t block_count,
         cuda_check(cuEventRecord((CUevent) entry.event_start, stream));
     }
 
+    // Separate events for JitFlag::KernelStats
+    CUevent stats_event_start = nullptr, stats_event_end = nullptr;
+    if (unlikely(flags & (uint32_t) JitFlag::KernelStats)) {
+        cuda_check(cuEventCreate(&stats_event_start, CU_EVENT_DEFAULT));
+        cuda_check(cuEventCreate(&stats_event_end, CU_EVENT_DEFAULT));
+        cuda_check(cuEventRecord(stats_event_start, stream));
+    }
+
     cuda_check(cuLaunchKernel(kernel, block_count, 1, 1, thread_count, 1, 1,
                               shared_mem_bytes, stream, args, extra));
 
     if (unlikely(flags & (uint32_t) JitFlag::LaunchBlocking))
         cuda_check(cuStreamSynchronize(stream));
 
+    entry.backend = JitBackend::CUDA;
+    entry.type = type;
+    entry.size = width;
+    entry.input_count = 1;
+    entry.output_count = 1;
+
+    if (unlikely(flags & (uint32_t) JitFlag::KernelStats)) {
+        cuda_check(cuEventRecord(stats_event_end, stream));
+        state.kernel_stats.append(entry, nullptr, stats_event_start,
+                                  stats_event_end);
+    }
+
     if (unlikely(flags & (uint32_t) JitFlag::KernelHistory)) {
-        entry.backend = JitBackend::CUDA;
-        entry.type = type;
-        entry.size = width;
-        entry.input_count = 1;
-        entry.output_count = 1;
         cuda_check(cuEventRecord((CUevent) entry.event_end, stream));
-
         state.kernel_history.append(entry);
     }
 }
 
 /// Fill a device memory region with constants of a given type
-void jitc_memset_async(JitBackend backend, void *ptr, uint32_t size_,
+void jitc_memset_async(JitBackend backend, void *ptr, size_t size_,
                        uint32_t isize, const void *src) {
     if (isize != 1 && isize != 2 && isize != 4 && isize != 8)
         jitc_raise("jit_memset_async(): invalid element size (must be 1, 2, 4, or 8)!");
 
-    jitc_trace("jit_memset_async(" DRJIT_PTR ", isize=%u, size=%u)",
+    jitc_trace("jit_memset_async(" DRJIT_PTR ", isize=%u, size=%zu)",
               (uintptr_t) ptr, isize, size_);
 
     if (size_ == 0)
@@ -118,6 +180,7 @@ void jitc_memset_async(JitBackend backend, void *ptr, uint32_t size_,
     ThreadState *ts = thread_state(backend);
 
     if (backend == JitBackend::CUDA) {
+        jitc_cuda_check_size("jit_memset_async", size_);
         scoped_set_context guard(ts->context);
         switch (isize) {
             case 1:
@@ -140,13 +203,13 @@ void jitc_memset_async(JitBackend backend, void *ptr, uint32_t size_,
 
             case 8: {
                     const Device &device = state.devices[ts->device];
-                    uint32_t block_count, thread_count;
-                    device.get_launch_config(&block_count, &thread_count, size_);
-                    void *args[] = { &ptr, &size_, (void *) src };
+                    uint32_t block_count, thread_count, size_32 = (uint32_t) size_;
+                    device.get_launch_config(&block_count, &thread_count, size_32);
+                    void *args[] = { &ptr, &size_32, (void *) src };
                     CUfunction kernel = jitc_cuda_fill_64[device.id];
                     jitc_submit_gpu(KernelType::Other, kernel, block_count,
                                     thread_count, 0, ts->stream, args, nullptr,
-                                    size_);
+                                    size_32);
                 }
                 break;
         }
@@ -164,7 +227,7 @@ void jitc_memset_async(JitBackend backend, void *ptr, uint32_t size_,
                     case 2: {
                             uint16_t value = ((uint16_t *) src8)[0],
                                     *p = (uint16_t *) ptr;
-                            for (uint32_t i = 0; i < size; ++i)
+                            for (size_t i = 0; i < size; ++i)
                                 p[i] = value;
                         }
                         break;
@@ -172,7 +235,7 @@ void jitc_memset_async(JitBackend backend, void *ptr, uint32_t size_,
                     case 4: {
                             uint32_t value = ((uint32_t *) src8)[0],
                                     *p = (uint32_t *) ptr;
-                            for (uint32_t i = 0; i < size; ++i)
+                            for (size_t i = 0; i < size; ++i)
                                 p[i] = value;
                         }
                         break;
@@ -180,14 +243,14 @@ void jitc_memset_async(JitBackend backend, void *ptr, uint32_t size_,
                     case 8: {
                             uint64_t value = ((uint64_t *) src8)[0],
                                     *p = (uint64_t *) ptr;
-                            for (uint32_t i = 0; i < size; ++i)
+                            for (size_t i = 0; i < size; ++i)
                                 p[i] = value;
                         }
                         break;
                 }
             },
 
-            (uint32_t) size
+            size
         );
     }
 }
@@ -223,72 +286,102 @@ void jitc_memcpy_async(JitBackend backend, void *dst, const void *src, size_t si
                 memcpy(dst, src, size);
             },
 
-            (uint32_t) size
+            size
+        );
+    }
+}
+
+void jitc_memcpy_many_async(JitBackend backend, const MemcpyRecord *records,
+                            uint32_t count) {
+    if (count == 0)
+        return;
+
+    if (backend == JitBackend::CUDA) {
+        ThreadState *ts = thread_state(backend);
+        scoped_set_context guard(ts->context);
+        for (uint32_t i = 0; i < count; ++i)
+            cuda_check(cuMemcpyAsync((CUdeviceptr) records[i].dst,
+                                     (CUdeviceptr) records[i].src,
+                                     records[i].size, ts->stream));
+    } else {
+        jitc_submit_cpu(
+            KernelType::Other,
+            [records, count](uint32_t) {
+                for (uint32_t i = 0; i < count; ++i)
+                    memcpy(records[i].dst, records[i].src, records[i].size);
+            },
+
+            count
         );
     }
 }
 
-using Reduction = void (*) (const void *ptr, uint32_t start, uint32_t end, void *out);
+using Reduction = void (*) (const void *ptr, size_t start, size_t end, void *out);
+
+/// Half precision values are accumulated in single precision
+template <typename Value>
+using accum_t = std::conditional_t<std::is_same_v<Value, half>, float, Value>;
 
 template <typename Value>
 static Reduction jitc_reduce_create(ReduceOp rtype) {
     using UInt = uint_with_size_t<Value>;
+    using Accum = accum_t<Value>;
 
     switch (rtype) {
         case ReduceOp::Add:
-            return [](const void *ptr_, uint32_t start, uint32_t end, void *out) {
+            return [](const void *ptr_, size_t start, size_t end, void *out) {
                 const Value *ptr = (const Value *) ptr_;
-                Value result = 0;
-                for (uint32_t i = start; i != end; ++i)
+                Accum result = 0;
+                for (size_t i = start; i != end; ++i)
                     result += ptr[i];
-                *((Value *) out) = result;
+                *((Value *) out) = (Value) result;
             };
 
         case ReduceOp::Mul:
-            return [](const void *ptr_, uint32_t start, uint32_t end, void *out) {
+            return [](const void *ptr_, size_t start, size_t end, void *out) {
                 const Value *ptr = (const Value *) ptr_;
-                Value result = 1;
-                for (uint32_t i = start; i != end; ++i)
+                Accum result = 1;
+                for (size_t i = start; i != end; ++i)
                     result *= ptr[i];
-                *((Value *) out) = result;
+                *((Value *) out) = (Value) result;
             };
 
         case ReduceOp::Max:
-            return [](const void *ptr_, uint32_t start, uint32_t end, void *out) {
+            return [](const void *ptr_, size_t start, size_t end, void *out) {
                 const Value *ptr = (const Value *) ptr_;
-                Value result = std::is_integral<Value>::value
-                                   ?  std::numeric_limits<Value>::min()
-                                   : -std::numeric_limits<Value>::infinity();
-                for (uint32_t i = start; i != end; ++i)
-                    result = std::max(result, ptr[i]);
-                *((Value *) out) = result;
+                Accum result = std::is_integral<Value>::value
+                                   ?  std::numeric_limits<Accum>::min()
+                                   : -std::numeric_limits<Accum>::infinity();
+                for (size_t i = start; i != end; ++i)
+                    result = std::max(result, (Accum) ptr[i]);
+                *((Value *) out) = (Value) result;
             };
 
         case ReduceOp::Min:
-            return [](const void *ptr_, uint32_t start, uint32_t end, void *out) {
+            return [](const void *ptr_, size_t start, size_t end, void *out) {
                 const Value *ptr = (const Value *) ptr_;
-                Value result = std::is_integral<Value>::value
-                                   ?  std::numeric_limits<Value>::max()
-                                   :  std::numeric_limits<Value>::infinity();
-                for (uint32_t i = start; i != end; ++i)
-                    result = std::min(result, ptr[i]);
-                *((Value *) out) = result;
+                Accum result = std::is_integral<Value>::value
+                                   ?  std::numeric_limits<Accum>::max()
+                                   :  std::numeric_limits<Accum>::infinity();
+                for (size_t i = start; i != end; ++i)
+                    result = std::min(result, (Accum) ptr[i]);
+                *((Value *) out) = (Value) result;
             };
 
         case ReduceOp::Or:
-            return [](const void *ptr_, uint32_t start, uint32_t end, void *out) {
+            return [](const void *ptr_, size_t start, size_t end, void *out) {
                 const UInt *ptr = (const UInt *) ptr_;
                 UInt result = 0;
-                for (uint32_t i = start; i != end; ++i)
+                for (size_t i = start; i != end; ++i)
                     result |= ptr[i];
                 *((UInt *) out) = result;
             };
 
         case ReduceOp::And:
-            return [](const void *ptr_, uint32_t start, uint32_t end, void *out) {
+            return [](const void *ptr_, size_t start, size_t end, void *out) {
                 const UInt *ptr = (const UInt *) ptr_;
                 UInt result = (UInt) -1;
-                for (uint32_t i = start; i != end; ++i)
+                for (size_t i = start; i != end; ++i)
                     result &= ptr[i];
                 *((UInt *) out) = result;
             };
@@ -307,6 +400,7 @@ static Reduction jitc_reduce_create(VarType type, ReduceOp rtype) {
         case VarType::UInt32:  return jitc_reduce_create<uint32_t>(rtype);
         case VarType::Int64:   return jitc_reduce_create<int64_t >(rtype);
         case VarType::UInt64:  return jitc_reduce_create<uint64_t>(rtype);
+        case VarType::Float16: return jitc_reduce_create<half    >(rtype);
         case VarType::Float32: return jitc_reduce_create<float   >(rtype);
         case VarType::Float64: return jitc_reduce_create<double  >(rtype);
         default: jitc_raise("jit_reduce_create(): unsupported data type!");
@@ -314,16 +408,18 @@ static Reduction jitc_reduce_create(VarType type, ReduceOp rtype) {
 }
 
 void jitc_reduce(JitBackend backend, VarType type, ReduceOp rtype, const void *ptr,
-                uint32_t size, void *out) {
+                size_t size_, void *out) {
     ThreadState *ts = thread_state(backend);
 
-    jitc_log(Debug, "jit_reduce(" DRJIT_PTR ", type=%s, rtype=%s, size=%u)",
+    jitc_log(Debug, "jit_reduce(" DRJIT_PTR ", type=%s, rtype=%s, size=%zu)",
             (uintptr_t) ptr, type_name[(int) type],
-            reduction_name[(int) rtype], size);
+            reduction_name[(int) rtype], size_);
 
     uint32_t tsize = type_size[(int) type];
 
     if (backend == JitBackend::CUDA) {
+        jitc_cuda_check_size("jit_reduce", size_);
+        uint32_t size = (uint32_t) size_;
         scoped_set_context guard(ts->context);
         const Device &device = state.devices[ts->device];
         CUfunction func = jitc_cuda_reductions[(int) rtype][(int) type][device.id];
@@ -361,15 +457,16 @@ void jitc_reduce(JitBackend backend, VarType type, ReduceOp rtype, const void *p
             jitc_free(temp);
         }
     } else {
-        uint32_t block_size = size, blocks = 1;
+        size_t size = size_, block_size = size;
+        uint32_t blocks = 1;
         if (pool_size() > 1) {
             block_size = DRJIT_POOL_BLOCK_SIZE;
-            blocks     = (size + block_size - 1) / block_size;
+            blocks     = (uint32_t) ((size + block_size - 1) / block_size);
         }
 
         void *target = out;
         if (blocks > 1)
-            target = jitc_malloc(AllocType::HostAsync, blocks * tsize);
+            target = jitc_malloc(AllocType::HostAsync, (size_t) blocks * tsize);
 
         Reduction reduction = jitc_reduce_create(type, rtype);
         jitc_submit_cpu(
@@ -459,17 +556,17 @@ bool jitc_any(JitBackend backend, uint8_t *values, uint32_t size) {
 }
 
 template <typename T>
-void sum_reduce_1(uint32_t start, uint32_t end, const void *in_, uint32_t index,
+void sum_reduce_1(size_t start, size_t end, const void *in_, uint32_t index,
                   void *scratch) {
     const T *in = (const T *) in_;
     T accum = T(0);
-    for (uint32_t i = start; i != end; ++i)
+    for (size_t i = start; i != end; ++i)
         accum += in[i];
     ((T*) scratch)[index] = accum;
 }
 
 template <typename T>
-void sum_reduce_2(uint32_t start, uint32_t end, const void *in_, void *out_,
+void sum_reduce_2(size_t start, size_t end, const void *in_, void *out_,
                   uint32_t index, const void *scratch, bool exclusive) {
     const T *in = (const T *) in_;
     T *out = (T *) out_;
@@ -481,13 +578,13 @@ void sum_reduce_2(uint32_t start, uint32_t end, const void *in_, void *out_,
         accum = T(0);
 
     if (exclusive) {
-        for (uint32_t i = start; i != end; ++i) {
+        for (size_t i = start; i != end; ++i) {
             T value = in[i];
             out[i] = accum;
             accum += value;
         }
     } else {
-        for (uint32_t i = start; i != end; ++i) {
+        for (size_t i = start; i != end; ++i) {
             T value = in[i];
             accum += value;
             out[i] = accum;
@@ -495,32 +592,126 @@ void sum_reduce_2(uint32_t start, uint32_t end, const void *in_, void *out_,
     }
 }
 
-void sum_reduce_1(VarType vt, uint32_t start, uint32_t end, const void *in, uint32_t index, void *scratch) {
-    switch (vt) {
-        case VarType::UInt32:  sum_reduce_1<uint32_t>(start, end, in, index, scratch); break;
-        case VarType::UInt64:  sum_reduce_1<uint64_t>(start, end, in, index, scratch); break;
-        case VarType::Float32: sum_reduce_1<float>   (start, end, in, index, scratch); break;
-        case VarType::Float64: sum_reduce_1<double>  (start, end, in, index, scratch); break;
-        default:
-            jitc_raise("jit_prefix_sum(): type %s is not supported!", type_name[(int) vt]);
+/**
+ * \brief Per-launch state of a single-pass scan on the CPU
+ *
+ * The blocks of the input are claimed in increasing order (nanothread hands
+ * out work units in arbitrary order), which ensures that the predecessors of
+ * a block are already being processed by other workers. Each block publishes
+ * its local sum and then looks back at its predecessors until it finds one
+ * whose inclusive prefix is known ("decoupled look-back"). This replaces the
+ * separate reduction, recursive scan and second pass with a single traversal
+ * of the input that stays resident in the L2 cache. The last block releases
+ * the record.
+ */
+template <typename T> struct ScanLaunch {
+    struct alignas(64) Block {
+        /// 0: pending, 1: 'aggregate' is valid, 2: 'prefix' is valid
+        std::atomic<uint32_t> status;
+        T aggregate, prefix;
+    };
+
+    ScanLaunch(uint32_t blocks)
+        : blocks(new Block[blocks]), next(0), blocks_left(blocks) {
+        for (uint32_t i = 0; i < blocks; ++i)
+            this->blocks[i].status.store(0, std::memory_order_relaxed);
     }
-}
 
-void sum_reduce_2(VarType vt, uint32_t start, uint32_t end, const void *in, void *out, uint32_t index, const void *scratch, bool exclusive) {
-    switch (vt) {
-        case VarType::UInt32:  sum_reduce_2<uint32_t>(start, end, in, out, index, scratch, exclusive); break;
-        case VarType::UInt64:  sum_reduce_2<uint64_t>(start, end, in, out, index, scratch, exclusive); break;
-        case VarType::Float32: sum_reduce_2<float>   (start, end, in, out, index, scratch, exclusive); break;
-        case VarType::Float64: sum_reduce_2<double>  (start, end, in, out, index, scratch, exclusive); break;
-        default:
-            jitc_raise("jit_prefix_sum(): type %s is not supported!", type_name[(int) vt]);
+    ~ScanLaunch() { delete[] blocks; }
+
+    /// Claim a block to be processed by the calling thread
+    uint32_t claim() { return next.fetch_add(1, std::memory_order_relaxed); }
+
+    /// Publish the sum of block 'index' and return its exclusive prefix
+    T prefix(uint32_t index, T aggregate) {
+        Block &block = blocks[index];
+
+        if (index == 0) {
+            block.prefix = aggregate;
+            block.status.store(2, std::memory_order_release);
+            return T(0);
+        }
+
+        block.aggregate = aggregate;
+        block.status.store(1, std::memory_order_release);
+
+        T accum = T(0);
+        for (uint32_t i = index - 1; ; --i) {
+            const Block &pred = blocks[i];
+            uint32_t status;
+            while ((status = pred.status.load(std::memory_order_acquire)) == 0)
+                std::this_thread::yield();
+
+            if (status == 2) {
+                accum = pred.prefix + accum;
+                break;
+            }
+
+            accum = pred.aggregate + accum;
+        }
+
+        block.prefix = accum + aggregate;
+        block.status.store(2, std::memory_order_release);
+        return accum;
+    }
+
+    /// Called after processing a block
+    void release() {
+        if (blocks_left.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete this;
     }
+
+    Block *blocks;
+    std::atomic<uint32_t> next;
+    std::atomic<uint32_t> blocks_left;
+};
+
+template <typename T>
+static void jitc_prefix_sum_cpu(const void *in, size_t size, void *out,
+                                bool exclusive) {
+    size_t block_size = size;
+    uint32_t blocks = 1;
+    if (pool_size() > 1) {
+        block_size = DRJIT_POOL_BLOCK_SIZE;
+        blocks     = (uint32_t) ((size + block_size - 1) / block_size);
+    }
+
+    jitc_log(Debug,
+            "jit_prefix_sum(" DRJIT_PTR " -> " DRJIT_PTR
+            ", size=%zu, block_size=%zu, blocks=%u)",
+            (uintptr_t) in, (uintptr_t) out, size, block_size, blocks);
+
+    ScanLaunch<T> *launch = blocks > 1 ? new ScanLaunch<T>(blocks) : nullptr;
+
+    jitc_submit_cpu(
+        KernelType::Other,
+        [block_size, size, in, out, launch, exclusive](uint32_t index) {
+            if (launch)
+                index = launch->claim();
+
+            size_t start = index * block_size,
+                   end = std::min(start + block_size, size);
+
+            T carry = T(0);
+            if (launch) {
+                T aggregate;
+                sum_reduce_1<T>(start, end, in, 0, &aggregate);
+                carry = launch->prefix(index, aggregate);
+            }
+
+            sum_reduce_2<T>(start, end, in, out, 0, &carry, exclusive);
+
+            if (launch)
+                launch->release();
+        },
+        size, blocks
+    );
 }
 
 /// Exclusive prefix sum
 void jitc_prefix_sum(JitBackend backend, VarType vt, bool exclusive,
-               const void *in, uint32_t size, void *out) {
-    if (size == 0)
+               const void *in, size_t size_, void *out) {
+    if (size_ == 0)
         return;
     if (vt == VarType::Int32)
         vt = VarType::UInt32;
@@ -529,6 +720,8 @@ void jitc_prefix_sum(JitBackend backend, VarType vt, bool exclusive,
     ThreadState *ts = thread_state(backend);
 
     if (backend == JitBackend::CUDA) {
+        jitc_cuda_check_size("jit_prefix_sum", size_);
+        uint32_t size = (uint32_t) size_;
         const Device &device = state.devices[ts->device];
         scoped_set_context guard(ts->context);
 
@@ -612,47 +805,14 @@ void jitc_prefix_sum(JitBackend backend, VarType vt, bool exclusive,
             jitc_free(scratch);
         }
     } else {
-        uint32_t block_size = size, blocks = 1;
-        if (pool_size() > 1) {
-            block_size = DRJIT_POOL_BLOCK_SIZE;
-            blocks     = (size + block_size - 1) / block_size;
-        }
-
-        jitc_log(Debug,
-                "jit_prefix_sum(" DRJIT_PTR " -> " DRJIT_PTR
-                ", size=%u, block_size=%u, blocks=%u)",
-                (uintptr_t) in, (uintptr_t) out, size, block_size, blocks);
-
-        void *scratch = nullptr;
-
-        if (blocks > 1) {
-            scratch = (void *) jitc_malloc(AllocType::HostAsync, blocks * isize);
-
-            jitc_submit_cpu(
-                KernelType::Other,
-                [block_size, size, in, vt, scratch](uint32_t index) {
-                    uint32_t start = index * block_size,
-                             end = std::min(start + block_size, size);
-
-                    sum_reduce_1(vt, start, end, in, index, scratch);
-                },
-                size, blocks);
-
-            jitc_prefix_sum(backend, vt, true, scratch, blocks, scratch);
+        switch (vt) {
+            case VarType::UInt32:  jitc_prefix_sum_cpu<uint32_t>(in, size_, out, exclusive); break;
+            case VarType::UInt64:  jitc_prefix_sum_cpu<uint64_t>(in, size_, out, exclusive); break;
+            case VarType::Float32: jitc_prefix_sum_cpu<float>   (in, size_, out, exclusive); break;
+            case VarType::Float64: jitc_prefix_sum_cpu<double>  (in, size_, out, exclusive); break;
+            default:
+                jitc_raise("jit_prefix_sum(): type %s is not supported!", type_name[(int) vt]);
         }
-
-        jitc_submit_cpu(
-            KernelType::Other,
-            [block_size, size, in, out, vt, scratch, exclusive](uint32_t index) {
-                uint32_t start = index * block_size,
-                         end = std::min(start + block_size, size);
-
-                sum_reduce_2(vt, start, end, in, out, index, scratch, exclusive);
-            },
-            size, blocks
-        );
-
-        jitc_free(scratch);
     }
 }
 
@@ -755,56 +915,49 @@ uint32_t jitc_compress(JitBackend backend, const uint8_t *in, uint32_t size, uin
                 ", size=%u, block_size=%u, blocks=%u)",
                 (uintptr_t) in, (uintptr_t) out, size, block_size, blocks);
 
-        uint32_t *scratch = nullptr;
-
-        if (blocks > 1) {
-            scratch = (uint32_t *) jitc_malloc(AllocType::HostAsync,
-                                               blocks * sizeof(uint32_t));
-
-            jitc_submit_cpu(
-                KernelType::Other,
-                [block_size, size, in, scratch](uint32_t index) {
-                    uint32_t start = index * block_size,
-                             end = std::min(start + block_size, size);
-
-                    uint32_t accum = 0;
-                    for (uint32_t i = start; i != end; ++i)
-                        accum += (uint32_t) in[i];
-
-                    scratch[index] = accum;
-                },
-
-                size, blocks
-            );
-
-            jitc_prefix_sum(backend, VarType::UInt32, true, scratch, blocks, scratch);
-        }
+        ScanLaunch<uint32_t> *launch =
+            blocks > 1 ? new ScanLaunch<uint32_t>(blocks) : nullptr;
 
         jitc_submit_cpu(
             KernelType::Other,
-            [block_size, size, scratch, in, out, &count_out](uint32_t index) {
+            [block_size, size, launch, in, out, &count_out](uint32_t index) {
+                if (launch)
+                    index = launch->claim();
+
                 uint32_t start = index * block_size,
                          end = std::min(start + block_size, size);
 
                 uint32_t accum = 0;
-                if (scratch)
-                    accum = scratch[index];
+                if (launch) {
+                    uint32_t count = 0;
+                    for (uint32_t i = start; i != end; ++i)
+                        count += (uint32_t) in[i];
+                    accum = launch->prefix(index, count);
+                }
 
-                for (uint32_t i = start; i != end; ++i) {
-                    uint32_t value = (uint32_t) in[i];
-                    if (value)
-                        out[accum] = i;
-                    accum += value;
+                /* Branch-free compaction: entries with a zero mask write to
+                   a slot that the next active entry overwrites. Trailing
+                   inactive entries are skipped, since their slot belongs to
+                   the next block. */
+                uint32_t last = end;
+                while (last != start && !in[last - 1])
+                    --last;
+
+                for (uint32_t i = start; i != last; ++i) {
+                    out[accum] = i;
+                    accum += (uint32_t) in[i];
                 }
 
                 if (end == size)
                     count_out = accum;
+
+                if (launch)
+                    launch->release();
             },
 
             size, blocks
         );
 
-        jitc_free(scratch);
         jitc_sync_thread();
 
         return count_out;
@@ -1108,13 +1261,217 @@ uint32_t jitc_mkperm(JitBackend backend, const uint32_t *ptr, uint32_t size,
     }
 }
 
-using BlockOp = void (*) (const void *ptr, void *out, uint32_t start, uint32_t end, uint32_t block_size);
+/// Map radix sort keys to unsigned integers with the same ordering
+template <typename UInt, int Kind> static UInt radix_map(UInt value) {
+    constexpr UInt msb = UInt(UInt(1) << (sizeof(UInt) * 8 - 1));
+    if constexpr (Kind == 1) // Signed integer: flip the sign bit
+        return UInt(value ^ msb);
+    else if constexpr (Kind == 2) // Floating point: flip negative values entirely
+        return UInt((value & msb) ? ~value : (value | msb));
+    else
+        return value;
+}
+
+/**
+ * Passes where all keys have the same digit can be skipped. This is detected
+ * using the bitwise AND and OR of the keys per block (from the first pass).
+ */
+template <typename UInt>
+static bool radix_skip(const UInt *bits, uint32_t blocks, uint32_t shift) {
+    UInt bits_and = UInt(~UInt(0)), bits_or = 0;
+    for (uint32_t i = 0; i < blocks; ++i) {
+        bits_and &= bits[2 * i];
+        bits_or |= bits[2 * i + 1];
+    }
+    return (((bits_and ^ bits_or) >> shift) & 0xFF) == 0;
+}
+
+template <typename UInt, int Kind>
+static void jitc_radix_sort(const UInt *keys_in, UInt *keys_out,
+                            const uint32_t *values_in, uint32_t *values_out,
+                            uint32_t size) {
+    constexpr uint32_t passes = sizeof(UInt);
+
+    uint32_t blocks = 1, block_size = size, pool_size = ::pool_size();
+    if (pool_size > 1) {
+        // Same partitioning as jitc_mkperm()
+        blocks = pool_size * 4;
+        block_size = (size + blocks - 1) / blocks;
+        block_size = std::max((uint32_t) DRJIT_POOL_BLOCK_SIZE, block_size);
+        blocks = (size + block_size - 1) / block_size;
+    }
+
+    UInt *keys_tmp = (UInt *) jitc_malloc(AllocType::HostAsync,
+                                          (size_t) size * sizeof(UInt)),
+         *bits = (UInt *) jitc_malloc(AllocType::HostAsync,
+                                      2 * blocks * sizeof(UInt));
+    uint32_t *values_tmp = nullptr,
+             *counts = (uint32_t *) jitc_malloc(
+                 AllocType::HostAsync, 256 * blocks * sizeof(uint32_t));
+    if (values_out)
+        values_tmp = (uint32_t *) jitc_malloc(AllocType::HostAsync,
+                                              (size_t) size * sizeof(uint32_t));
+
+    const UInt *src_k = keys_in;
+    const uint32_t *src_v = values_in;
+
+    // With an odd number of passes, the first one writes to 'keys_out'
+    if (passes % 2 == 1 && (const void *) keys_in == (const void *) keys_out) {
+        jitc_memcpy_async(JitBackend::LLVM, keys_tmp, keys_in,
+                          (size_t) size * sizeof(UInt));
+        src_k = keys_tmp;
+    }
+    if (passes % 2 == 1 && values_in && values_in == values_out) {
+        jitc_memcpy_async(JitBackend::LLVM, values_tmp, values_in,
+                          (size_t) size * sizeof(uint32_t));
+        src_v = values_tmp;
+    }
+
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        bool last = (passes - 1 - pass) % 2 == 0;
+        UInt *dst_k = last ? keys_out : keys_tmp;
+        uint32_t *dst_v = last ? values_out : values_tmp,
+                 shift = pass * 8;
+
+        // Phase 1: per-block digit histograms (stored digit-major)
+        jitc_submit_cpu(
+            KernelType::Other,
+            [block_size, size, blocks, src_k, bits, counts, pass,
+             shift](uint32_t index) {
+                uint32_t start = index * block_size,
+                         end = std::min(start + block_size, size),
+                         local[256] { };
+
+                if (pass == 0) {
+                    UInt bits_and = UInt(~UInt(0)), bits_or = 0;
+                    for (uint32_t i = start; i != end; ++i) {
+                        UInt key = radix_map<UInt, Kind>(src_k[i]);
+                        bits_and &= key;
+                        bits_or |= key;
+                        local[(key >> shift) & 0xFF]++;
+                    }
+                    bits[2 * index] = bits_and;
+                    bits[2 * index + 1] = bits_or;
+                } else if (!radix_skip(bits, blocks, shift)) {
+                    for (uint32_t i = start; i != end; ++i)
+                        local[(radix_map<UInt, Kind>(src_k[i]) >> shift) & 0xFF]++;
+                }
+
+                for (uint32_t i = 0; i < 256; ++i)
+                    counts[i * blocks + index] = local[i];
+            },
+            size, blocks);
+
+        // Phase 2: offsets of the digits of each block
+        jitc_prefix_sum(JitBackend::LLVM, VarType::UInt32, true, counts,
+                        256 * blocks, counts);
+
+        // Phase 3: stable scatter into the destination buffers
+        jitc_submit_cpu(
+            KernelType::Other,
+            [block_size, size, blocks, src_k, src_v, dst_k, dst_v, bits,
+             counts, shift](uint32_t index) {
+                uint32_t start = index * block_size,
+                         end = std::min(start + block_size, size);
+
+                if (radix_skip(bits, blocks, shift)) {
+                    memcpy(dst_k + start, src_k + start,
+                           (end - start) * sizeof(UInt));
+                    if (dst_v && src_v)
+                        memcpy(dst_v + start, src_v + start,
+                               (end - start) * sizeof(uint32_t));
+                    else if (dst_v)
+                        for (uint32_t i = start; i != end; ++i)
+                            dst_v[i] = i;
+                    return;
+                }
+
+                uint32_t offset[256];
+                for (uint32_t i = 0; i < 256; ++i)
+                    offset[i] = counts[i * blocks + index];
+
+                for (uint32_t i = start; i != end; ++i) {
+                    UInt key = src_k[i];
+                    uint32_t j = offset[(radix_map<UInt, Kind>(key) >> shift) & 0xFF]++;
+                    dst_k[j] = key;
+                    if (dst_v)
+                        dst_v[j] = src_v ? src_v[i] : i;
+                }
+            },
+            size, blocks);
+
+        src_k = dst_k;
+        src_v = dst_v;
+    }
+
+    // Free memory (happens asynchronously after the above steps)
+    jitc_free(keys_tmp);
+    jitc_free(values_tmp);
+    jitc_free(counts);
+    jitc_free(bits);
+}
+
+/// Sort an array of keys, optionally along with a 32 bit payload
+void jitc_sort(JitBackend backend, VarType type, const void *keys_in,
+               void *keys_out, const uint32_t *values_in, uint32_t *values_out,
+               uint32_t size) {
+    if (size == 0)
+        return;
+    else if (backend == JitBackend::CUDA)
+        jitc_raise("jit_sort(): not yet supported by the CUDA backend!");
+
+    jitc_log(Debug,
+             "jit_sort(" DRJIT_PTR " -> " DRJIT_PTR ", type=%s, size=%u, "
+             "payload=%i)", (uintptr_t) keys_in, (uintptr_t) keys_out,
+             type_name[(int) type], size, values_out ? 1 : 0);
+
+    const void *ki = keys_in;
+    void *ko = keys_out;
+    const uint32_t *vi = values_in;
+    uint32_t *vo = values_out;
+
+    switch (type) {
+        case VarType::UInt8:   jitc_radix_sort<uint8_t,  0>((const uint8_t *)  ki, (uint8_t *)  ko, vi, vo, size); break;
+        case VarType::Int8:    jitc_radix_sort<uint8_t,  1>((const uint8_t *)  ki, (uint8_t *)  ko, vi, vo, size); break;
+        case VarType::UInt16:  jitc_radix_sort<uint16_t, 0>((const uint16_t *) ki, (uint16_t *) ko, vi, vo, size); break;
+        case VarType::Int16:   jitc_radix_sort<uint16_t, 1>((const uint16_t *) ki, (uint16_t *) ko, vi, vo, size); break;
+        case VarType::UInt32:  jitc_radix_sort<uint32_t, 0>((const uint32_t *) ki, (uint32_t *) ko, vi, vo, size); break;
+        case VarType::Int32:   jitc_radix_sort<uint32_t, 1>((const uint32_t *) ki, (uint32_t *) ko, vi, vo, size); break;
+        case VarType::Float32: jitc_radix_sort<uint32_t, 2>((const uint32_t *) ki, (uint32_t *) ko, vi, vo, size); break;
+        case VarType::UInt64:  jitc_radix_sort<uint64_t, 0>((const uint64_t *) ki, (uint64_t *) ko, vi, vo, size); break;
+        case VarType::Int64:   jitc_radix_sort<uint64_t, 1>((const uint64_t *) ki, (uint64_t *) ko, vi, vo, size); break;
+        case VarType::Float64: jitc_radix_sort<uint64_t, 2>((const uint64_t *) ki, (uint64_t *) ko, vi, vo, size); break;
+        default:
+            jitc_raise("jit_sort(): type %s is not supported!", type_name[(int) type]);
+    }
+}
+
+/// Compute a stable permutation that sorts an array of keys
+void jitc_argsort(JitBackend backend, VarType type, const void *keys,
+                  uint32_t size, uint32_t *perm) {
+    if (size == 0)
+        return;
+    else if (backend == JitBackend::CUDA)
+        jitc_raise("jit_argsort(): not yet supported by the CUDA backend!");
+
+    void *keys_out = jitc_malloc(AllocType::HostAsync,
+                                 (size_t) size * type_size[(int) type]);
+    try {
+        jitc_sort(backend, type, keys, keys_out, nullptr, perm, size);
+    } catch (...) {
+        jitc_free(keys_out);
+        throw;
+    }
+    jitc_free(keys_out);
+}
+
+using BlockOp = void (*) (const void *ptr, void *out, size_t start, size_t end, uint32_t block_size);
 
 template <typename Value> static BlockOp jitc_block_copy_create() {
-    return [](const void *in_, void *out_, uint32_t start, uint32_t end, uint32_t block_size) {
+    return [](const void *in_, void *out_, size_t start, size_t end, uint32_t block_size) {
         const Value *in = (const Value *) in_ + start;
         Value *out = (Value *) out_ + start * block_size;
-        for (uint32_t i = start; i != end; ++i) {
+        for (size_t i = start; i != end; ++i) {
             Value value = *in++;
             for (uint32_t j = 0; j != block_size; ++j)
                 *out++ = value;
@@ -1123,14 +1480,14 @@ template <typename Value> static BlockOp jitc_block_copy_create() {
 }
 
 template <typename Value> static BlockOp jitc_block_sum_create() {
-    return [](const void *in_, void *out_, uint32_t start, uint32_t end, uint32_t block_size) {
+    return [](const void *in_, void *out_, size_t start, size_t end, uint32_t block_size) {
         const Value *in = (const Value *) in_ + start * block_size;
         Value *out = (Value *) out_ + start;
-        for (uint32_t i = start; i != end; ++i) {
-            Value sum = 0;
+        for (size_t i = start; i != end; ++i) {
+            accum_t<Value> sum = 0;
             for (uint32_t j = 0; j != block_size; ++j)
                 sum += *in++;
-            *out++ = sum;
+            *out++ = (Value) sum;
         }
     };
 }
@@ -1141,6 +1498,7 @@ static BlockOp jitc_block_copy_create(VarType type) {
         case VarType::UInt16:  return jitc_block_copy_create<uint16_t>();
         case VarType::UInt32:  return jitc_block_copy_create<uint32_t>();
         case VarType::UInt64:  return jitc_block_copy_create<uint64_t>();
+        case VarType::Float16: return jitc_block_copy_create<uint16_t>();
         case VarType::Float32: return jitc_block_copy_create<float   >();
         case VarType::Float64: return jitc_block_copy_create<double  >();
         default: jitc_raise("jit_block_copy_create(): unsupported data type!");
@@ -1153,6 +1511,7 @@ static BlockOp jitc_block_sum_create(VarType type) {
         case VarType::UInt16:  return jitc_block_sum_create<uint16_t>();
         case VarType::UInt32:  return jitc_block_sum_create<uint32_t>();
         case VarType::UInt64:  return jitc_block_sum_create<uint64_t>();
+        case VarType::Float16: return jitc_block_sum_create<half    >();
         case VarType::Float32: return jitc_block_sum_create<float   >();
         case VarType::Float64: return jitc_block_sum_create<double  >();
         default: jitc_raise("jit_block_sum_create(): unsupported data type!");
@@ -1171,13 +1530,13 @@ static VarType make_int_type_unsigned(VarType type) {
 
 /// Replicate individual input elements to larger blocks
 void jitc_block_copy(JitBackend backend, enum VarType type, const void *in, void *out,
-                    uint32_t size, uint32_t block_size) {
+                    size_t size, uint32_t block_size) {
     if (block_size == 0)
         jitc_raise("jit_block_copy(): block_size cannot be zero!");
 
     jitc_log(Debug,
             "jit_block_copy(" DRJIT_PTR " -> " DRJIT_PTR
-            ", type=%s, block_size=%u, size=%u)",
+            ", type=%s, block_size=%u, size=%zu)",
             (uintptr_t) in, (uintptr_t) out,
             type_name[(int) type], block_size, size);
 
@@ -1193,24 +1552,26 @@ void jitc_block_copy(JitBackend backend, enum VarType type, const void *in, void
     if (backend == JitBackend::CUDA) {
         scoped_set_context guard(ts->context);
         const Device &device = state.devices[ts->device];
-        size *= block_size;
+        jitc_cuda_check_size("jit_block_copy", size * block_size);
+        uint32_t size_32 = (uint32_t) (size * block_size);
 
         CUfunction func = jitc_cuda_block_copy[(int) type][device.id];
         if (!func)
             jitc_raise("jit_block_copy(): no existing kernel for type=%s!",
                       type_name[(int) type]);
 
-        uint32_t thread_count = std::min(size, 1024u),
-                 block_count  = (size + thread_count - 1) / thread_count;
+        uint32_t thread_count = std::min(size_32, 1024u),
+                 block_count  = (size_32 + thread_count - 1) / thread_count;
 
-        void *args[] = { &in, &out, &size, &block_size };
+        void *args[] = { &in, &out, &size_32, &block_size };
         jitc_submit_gpu(KernelType::Other, func, block_count, thread_count, 0,
-                        ts->stream, args, nullptr, size);
+                        ts->stream, args, nullptr, size_32);
     } else {
-        uint32_t work_unit_size = size, work_units = 1;
+        size_t work_unit_size = size;
+        uint32_t work_units = 1;
         if (pool_size() > 1) {
             work_unit_size = DRJIT_POOL_BLOCK_SIZE;
-            work_units     = (size + work_unit_size - 1) / work_unit_size;
+            work_units     = (uint32_t) ((size + work_unit_size - 1) / work_unit_size);
         }
 
         BlockOp op = jitc_block_copy_create(type);
@@ -1218,8 +1579,8 @@ void jitc_block_copy(JitBackend backend, enum VarType type, const void *in, void
         jitc_submit_cpu(
             KernelType::Other,
             [in, out, op, work_unit_size, size, block_size](uint32_t index) {
-                uint32_t start = index * work_unit_size,
-                         end = std::min(start + work_unit_size, size);
+                size_t start = index * work_unit_size,
+                       end = std::min(start + work_unit_size, size);
 
                 op(in, out, start, end, block_size);
             },
@@ -1231,13 +1592,13 @@ void jitc_block_copy(JitBackend backend, enum VarType type, const void *in, void
 
 /// Sum over elements within blocks
 void jitc_block_sum(JitBackend backend, enum VarType type, const void *in, void *out,
-                    uint32_t size, uint32_t block_size) {
+                    size_t size, uint32_t block_size) {
     if (block_size == 0)
         jitc_raise("jit_block_sum(): block_size cannot be zero!");
 
     jitc_log(Debug,
             "jit_block_sum(" DRJIT_PTR " -> " DRJIT_PTR
-            ", type=%s, block_size=%u, size=%u)",
+            ", type=%s, block_size=%u, size=%zu)",
             (uintptr_t) in, (uintptr_t) out,
             type_name[(int) type], block_size, size);
 
@@ -1255,26 +1616,27 @@ void jitc_block_sum(JitBackend backend, enum VarType type, const void *in, void
     if (backend == JitBackend::CUDA) {
         scoped_set_context guard(ts->context);
         const Device &device = state.devices[ts->device];
-
-        size *= block_size;
+        jitc_cuda_check_size("jit_block_sum", size * block_size);
+        uint32_t size_32 = (uint32_t) (size * block_size);
 
         CUfunction func = jitc_cuda_block_sum[(int) type][device.id];
         if (!func)
             jitc_raise("jit_block_sum(): no existing kernel for type=%s!",
                       type_name[(int) type]);
 
-        uint32_t thread_count = std::min(size, 1024u),
-                 block_count  = (size + thread_count - 1) / thread_count;
+        uint32_t thread_count = std::min(size_32, 1024u),
+                 block_count  = (size_32 + thread_count - 1) / thread_count;
 
-        void *args[] = { &in, &out, &size, &block_size };
+        void *args[] = { &in, &out, &size_32, &block_size };
         cuda_check(cuMemsetD8Async((CUdeviceptr) out, 0, out_size, ts->stream));
         jitc_submit_gpu(KernelType::Other, func, block_count, thread_count, 0,
-                        ts->stream, args, nullptr, size);
+                        ts->stream, args, nullptr, size_32);
     } else {
-        uint32_t work_unit_size = size, work_units = 1;
+        size_t work_unit_size = size;
+        uint32_t work_units = 1;
         if (pool_size() > 1) {
             work_unit_size = DRJIT_POOL_BLOCK_SIZE;
-            work_units     = (size + work_unit_size - 1) / work_unit_size;
+            work_units     = (uint32_t) ((size + work_unit_size - 1) / work_unit_size);
         }
 
         BlockOp op = jitc_block_sum_create(type);
@@ -1282,8 +1644,8 @@ void jitc_block_sum(JitBackend backend, enum VarType type, const void *in, void
         jitc_submit_cpu(
             KernelType::Other,
             [in, out, op, work_unit_size, size, block_size](uint32_t index) {
-                uint32_t start = index * work_unit_size,
-                         end = std::min(start + work_unit_size, size);
+                size_t start = index * work_unit_size,
+                       end = std::min(start + work_unit_size, size);
 
                 op(in, out, start, end, block_size);
             },
@@ -1293,6 +1655,287 @@ void jitc_block_sum(JitBackend backend, enum VarType type, const void *in, void
     }
 }
 
+/// Identity element and combination rule of a reduction
+template <typename Value, ReduceOp Op> struct ReduceFn {
+    static Value identity() {
+        if constexpr (Op == ReduceOp::Add || Op == ReduceOp::Or)
+            return Value(0);
+        else if constexpr (Op == ReduceOp::Mul)
+            return Value(1);
+        else if constexpr (Op == ReduceOp::And)
+            return Value(~Value(0));
+        else if constexpr (Op == ReduceOp::Min)
+            return std::is_integral<Value>::value
+                       ?  std::numeric_limits<Value>::max()
+                       :  std::numeric_limits<Value>::infinity();
+        else
+            return std::is_integral<Value>::value
+                       ?  std::numeric_limits<Value>::min()
+                       : -std::numeric_limits<Value>::infinity();
+    }
+
+    static Value apply(Value a, Value b) {
+        if constexpr (Op == ReduceOp::Add)
+            return Value(a + b);
+        else if constexpr (Op == ReduceOp::Mul)
+            return Value(a * b);
+        else if constexpr (Op == ReduceOp::Min)
+            return std::min(a, b);
+        else if constexpr (Op == ReduceOp::Max)
+            return std::max(a, b);
+        else if constexpr (Op == ReduceOp::And)
+            return Value(a & b);
+        else
+            return Value(a | b);
+    }
+};
+
+/// Per-block record of the segments crossing block boundaries
+template <typename Value> struct SegmentBlock {
+    /// Segment that started in an earlier block and continues here
+    uint32_t cont;
+    /// Segment that continues in the next block
+    uint32_t tail;
+    /// Partial results of these segments within the block
+    Value cont_value, tail_value;
+    /// Result of the 'cont' segment up to the start of the block
+    Value carry;
+};
+
+/**
+ * Partition of the range <tt>[offsets[0], offsets[segment_count])</tt> into
+ * at most \c max_blocks blocks. The offsets may be produced by a kernel that
+ * is still queued, hence this is only computed within the submitted tasks.
+ */
+struct SegmentPartition {
+    uint32_t base, size, block_size, blocks;
+
+    SegmentPartition(const uint32_t *offsets, uint32_t segment_count,
+                     uint32_t max_blocks) {
+        base = offsets[0];
+        size = offsets[segment_count] - base;
+
+        // Same partitioning as jitc_mkperm()
+        block_size = (uint32_t) (((uint64_t) size + max_blocks - 1) / max_blocks);
+        if (max_blocks > 1)
+            block_size = std::max((uint32_t) DRJIT_POOL_BLOCK_SIZE, block_size);
+        blocks = block_size ? (uint32_t) (((uint64_t) size + block_size - 1) /
+                                          block_size) : 0;
+        blocks = std::max(blocks, 1u);
+    }
+};
+
+/**
+ * Segmented reduction or scan. The elements are split into equal-sized blocks
+ * irrespective of the segment boundaries. Each block processes the segments
+ * beginning within it, along with the remainder of a segment that began in an
+ * earlier block. A serial step then combines the partial results of segments
+ * spanning several blocks, and scans finally add the carry to the affected
+ * prefix of each block.
+ */
+template <typename Value, ReduceOp Op>
+static void jitc_segmented_impl(const Value *in, const uint32_t *offsets,
+                                uint32_t segment_count, Value *out, bool scan,
+                                bool exclusive) {
+    using Fn = ReduceFn<Value, Op>;
+    constexpr uint32_t None = (uint32_t) -1;
+
+    /* 'offsets' may not be available yet (e.g. when it is produced by a
+       queued kernel), so the number of tasks can't depend on the segment
+       sizes. Tasks beyond the actual number of blocks return immediately. */
+    uint32_t pool_size = ::pool_size(),
+             max_blocks = pool_size > 1 ? pool_size * 4 : 1;
+
+    SegmentBlock<Value> *records = (SegmentBlock<Value> *) jitc_malloc(
+        AllocType::HostAsync, max_blocks * sizeof(SegmentBlock<Value>));
+
+    // Phase 1: process the segments of each block
+    jitc_submit_cpu(
+        KernelType::Other,
+        [in, offsets, segment_count, out, scan, exclusive, max_blocks,
+         records](uint32_t index) {
+            SegmentPartition part(offsets, segment_count, max_blocks);
+            SegmentBlock<Value> &r = records[index];
+            r.cont = r.tail = None;
+            if (index >= part.blocks)
+                return;
+
+            uint32_t start = part.base + index * part.block_size,
+                     end = part.base + (uint32_t) std::min(
+                               (uint64_t) (index + 1) * part.block_size,
+                               (uint64_t) part.size);
+            bool last_block = index + 1 == part.blocks;
+
+            // Reduce or scan the range [start, end) of one segment
+            auto process = [&](uint32_t start, uint32_t end) {
+                Value accum = Fn::identity();
+                if (!scan) {
+                    for (uint32_t i = start; i != end; ++i)
+                        accum = Fn::apply(accum, in[i]);
+                } else if (exclusive) {
+                    for (uint32_t i = start; i != end; ++i) {
+                        Value value = in[i];
+                        out[i] = accum;
+                        accum = Fn::apply(accum, value);
+                    }
+                } else {
+                    for (uint32_t i = start; i != end; ++i) {
+                        accum = Fn::apply(accum, in[i]);
+                        out[i] = accum;
+                    }
+                }
+                return accum;
+            };
+
+            uint32_t s = (uint32_t) (
+                std::lower_bound(offsets, offsets + segment_count, start) -
+                offsets);
+
+            if (s > 0 && offsets[s] > start) {
+                uint32_t seg_end = offsets[s];
+                r.cont = s - 1;
+                r.cont_value = process(start, std::min(seg_end, end));
+                if (seg_end > end) {
+                    r.tail = r.cont;
+                    r.tail_value = r.cont_value;
+                }
+            }
+
+            for (; s < segment_count; ++s) {
+                uint32_t seg_start = offsets[s], seg_end = offsets[s + 1];
+                if (seg_start > end || (seg_start == end && !last_block))
+                    break;
+
+                Value value = process(seg_start, std::min(seg_end, end));
+                if (seg_end > end) {
+                    r.tail = s;
+                    r.tail_value = value;
+                } else if (!scan) {
+                    out[s] = value;
+                }
+            }
+        },
+        segment_count, max_blocks);
+
+    if (max_blocks == 1) {
+        jitc_free(records);
+        return;
+    }
+
+    // Phase 2: combine the partial results of segments spanning several blocks
+    jitc_submit_cpu(
+        KernelType::Other,
+        [out, scan, max_blocks, records](uint32_t) {
+            Value carry = Fn::identity();
+            for (uint32_t i = 0; i < max_blocks; ++i) {
+                SegmentBlock<Value> &r = records[i];
+                if (r.cont != None) {
+                    r.carry = carry;
+                    Value value = Fn::apply(carry, r.cont_value);
+                    if (r.tail == r.cont)
+                        carry = value;
+                    else if (!scan)
+                        out[r.cont] = value;
+                }
+                if (r.tail != None && r.tail != r.cont)
+                    carry = r.tail_value;
+            }
+        },
+        segment_count);
+
+    // Phase 3: add the carry to segments continuing from an earlier block
+    if (scan) {
+        jitc_submit_cpu(
+            KernelType::Other,
+            [offsets, segment_count, out, max_blocks, records](uint32_t index) {
+                const SegmentBlock<Value> &r = records[index];
+                if (r.cont == None)
+                    return;
+
+                SegmentPartition part(offsets, segment_count, max_blocks);
+                uint32_t start = part.base + index * part.block_size,
+                         end = std::min(
+                             part.base + (uint32_t) std::min(
+                                 (uint64_t) (index + 1) * part.block_size,
+                                 (uint64_t) part.size),
+                             offsets[r.cont + 1]);
+
+                for (uint32_t i = start; i != end; ++i)
+                    out[i] = Fn::apply(r.carry, out[i]);
+            },
+            segment_count, max_blocks);
+    }
+
+    // Free memory (happens asynchronously after the above steps)
+    jitc_free(records);
+}
+
+template <typename Value>
+static void jitc_segmented_dispatch(ReduceOp op, const void *in,
+                                    const uint32_t *offsets,
+                                    uint32_t segment_count, void *out,
+                                    bool scan, bool exclusive) {
+    using UInt = uint_with_size_t<Value>;
+    const Value *vi = (const Value *) in;
+    Value *vo = (Value *) out;
+
+    switch (op) {
+        case ReduceOp::Add: jitc_segmented_impl<Value, ReduceOp::Add>(vi, offsets, segment_count, vo, scan, exclusive); break;
+        case ReduceOp::Mul: jitc_segmented_impl<Value, ReduceOp::Mul>(vi, offsets, segment_count, vo, scan, exclusive); break;
+        case ReduceOp::Min: jitc_segmented_impl<Value, ReduceOp::Min>(vi, offsets, segment_count, vo, scan, exclusive); break;
+        case ReduceOp::Max: jitc_segmented_impl<Value, ReduceOp::Max>(vi, offsets, segment_count, vo, scan, exclusive); break;
+        case ReduceOp::And: jitc_segmented_impl<UInt, ReduceOp::And>((const UInt *) in, offsets, segment_count, (UInt *) out, scan, exclusive); break;
+        case ReduceOp::Or:  jitc_segmented_impl<UInt, ReduceOp::Or> ((const UInt *) in, offsets, segment_count, (UInt *) out, scan, exclusive); break;
+        default: jitc_raise("jit_segmented_reduce(): unsupported reduction type!");
+    }
+}
+
+static void jitc_segmented(const char *name, JitBackend backend, VarType type,
+                           ReduceOp op, const void *in, const uint32_t *offsets,
+                           uint32_t segment_count, void *out, bool scan,
+                           bool exclusive) {
+    if (segment_count == 0)
+        return;
+    else if (backend == JitBackend::CUDA)
+        jitc_raise("%s(): not yet supported by the CUDA backend!", name);
+
+    jitc_log(Debug,
+             "%s(" DRJIT_PTR " -> " DRJIT_PTR ", type=%s, rtype=%s, "
+             "segments=%u)", name, (uintptr_t) in, (uintptr_t) out,
+             type_name[(int) type], reduction_name[(int) op], segment_count);
+
+    switch (type) {
+        case VarType::Int8:    jitc_segmented_dispatch<int8_t  >(op, in, offsets, segment_count, out, scan, exclusive); break;
+        case VarType::UInt8:   jitc_segmented_dispatch<uint8_t >(op, in, offsets, segment_count, out, scan, exclusive); break;
+        case VarType::Int16:   jitc_segmented_dispatch<int16_t >(op, in, offsets, segment_count, out, scan, exclusive); break;
+        case VarType::UInt16:  jitc_segmented_dispatch<uint16_t>(op, in, offsets, segment_count, out, scan, exclusive); break;
+        case VarType::Int32:   jitc_segmented_dispatch<int32_t >(op, in, offsets, segment_count, out, scan, exclusive); break;
+        case VarType::UInt32:  jitc_segmented_dispatch<uint32_t>(op, in, offsets, segment_count, out, scan, exclusive); break;
+        case VarType::Int64:   jitc_segmented_dispatch<int64_t >(op, in, offsets, segment_count, out, scan, exclusive); break;
+        case VarType::UInt64:  jitc_segmented_dispatch<uint64_t>(op, in, offsets, segment_count, out, scan, exclusive); break;
+        case VarType::Float32: jitc_segmented_dispatch<float   >(op, in, offsets, segment_count, out, scan, exclusive); break;
+        case VarType::Float64: jitc_segmented_dispatch<double  >(op, in, offsets, segment_count, out, scan, exclusive); break;
+        default: jitc_raise("%s(): unsupported data type!", name);
+    }
+}
+
+/// Reduce variable-length segments of an array
+void jitc_segmented_reduce(JitBackend backend, VarType type, ReduceOp op,
+                           const void *in, const uint32_t *offsets,
+                           uint32_t segment_count, void *out) {
+    jitc_segmented("jit_segmented_reduce", backend, type, op, in, offsets,
+                   segment_count, out, false, false);
+}
+
+/// Scan variable-length segments of an array
+void jitc_segmented_prefix_sum(JitBackend backend, VarType type, ReduceOp op,
+                               bool exclusive, const void *in,
+                               const uint32_t *offsets, uint32_t segment_count,
+                               void *out) {
+    jitc_segmented("jit_segmented_prefix_sum", backend, type, op, in, offsets,
+                   segment_count, out, true, exclusive);
+}
+
 /// Asynchronously update a single element in memory
 void jitc_poke(JitBackend backend, void *dst, const void *src, uint32_t size) {
     jitc_log(Debug, "jit_poke(" DRJIT_PTR ", size=%u)", (uintptr_t) dst, size);
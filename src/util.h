@@ -16,12 +16,12 @@
 extern const char *reduction_name[(int) ReduceOp::Count];
 
 /// Fill a device memory region with constants of a given type
-extern void jitc_memset_async(JitBackend backend, void *ptr, uint32_t size,
+extern void jitc_memset_async(JitBackend backend, void *ptr, size_t size,
                               uint32_t isize, const void *src);
 
 /// Reduce the given array to a single value
 extern void jitc_reduce(JitBackend backend, VarType type, ReduceOp rtype,
-                        const void *ptr, uint32_t size, void *out);
+                        const void *ptr, size_t size, void *out);
 
 /// 'All' reduction for boolean arrays
 extern bool jitc_all(JitBackend backend, uint8_t *values, uint32_t size);
@@ -31,7 +31,7 @@ extern bool jitc_any(JitBackend backend, uint8_t *values, uint32_t size);
 
 /// Exclusive prefix sum
 extern void jitc_prefix_sum(JitBackend backend, VarType vt, bool exclusive,
-                            const void *in, uint32_t size, void *out);
+                            const void *in, size_t size, void *out);
 
 /// Mask compression
 extern uint32_t jitc_compress(JitBackend backend, const uint8_t *in, uint32_t size,
@@ -42,19 +42,53 @@ extern uint32_t jitc_mkperm(JitBackend backend, const uint32_t *values, uint32_t
                             uint32_t bucket_count, uint32_t *perm,
                             uint32_t *offsets);
 
+/// Sort an array of keys, optionally along with a 32 bit payload
+extern void jitc_sort(JitBackend backend, VarType type, const void *keys_in,
+                      void *keys_out, const uint32_t *values_in,
+                      uint32_t *values_out, uint32_t size);
+
+/// Compute a stable permutation that sorts an array of keys
+extern void jitc_argsort(JitBackend backend, VarType type, const void *keys,
+                         uint32_t size, uint32_t *perm);
+
 /// Perform a synchronous copy operation
 extern void jitc_memcpy(JitBackend backend, void *dst, const void *src, size_t size);
 
 /// Perform an assynchronous copy operation
 extern void jitc_memcpy_async(JitBackend backend, void *dst, const void *src, size_t size);
 
+/// Source, target, and size of a copy operation
+struct MemcpyRecord {
+    void *dst;
+    const void *src;
+    size_t size;
+};
+
+/**
+ * Perform a set of small asynchronous copy operations at once. On the LLVM
+ * backend, the records must remain valid until the copy has finished.
+ */
+extern void jitc_memcpy_many_async(JitBackend backend,
+                                   const MemcpyRecord *records, uint32_t count);
+
 /// Replicate individual input elements to larger blocks
 extern void jitc_block_copy(JitBackend backend, enum VarType type, const void *in,
-                            void *out, uint32_t size, uint32_t block_size);
+                            void *out, size_t size, uint32_t block_size);
 
 /// Sum over elements within blocks
 extern void jitc_block_sum(JitBackend backend, enum VarType type, const void *in,
-                           void *out, uint32_t size, uint32_t block_size);
+                           void *out, size_t size, uint32_t block_size);
+
+/// Reduce variable-length segments of an array
+extern void jitc_segmented_reduce(JitBackend backend, VarType type, ReduceOp op,
+                                  const void *in, const uint32_t *offsets,
+                                  uint32_t segment_count, void *out);
+
+/// Scan variable-length segments of an array
+extern void jitc_segmented_prefix_sum(JitBackend backend, VarType type,
+                                      ReduceOp op, bool exclusive,
+                                      const void *in, const uint32_t *offsets,
+                                      uint32_t segment_count, void *out);
 
 /// Asynchronously update a single element in memory
 extern void jitc_poke(JitBackend backend, void *dst, const void *src, uint32_t size);
@@ -14,6 +14,9 @@
 #include "util.h"
 #include "op.h"
 #include "registry.h"
+#include "mapfile.h"
+#include "llvm.h"
+#include "half.h"
 
 // When debugging via valgrind, this will make iterator invalidation more obvious
 // #define DRJIT_VALGRIND 1
@@ -135,7 +138,7 @@ const char *var_kind_name[(int) VarKind::Count] {
     // Fast approximations
     "rcp", "rsqrt",
 
-    // Multi-function generator (CUDA)
+    // Transcendental functions (CUDA: multi-function generator)
     "sin", "cos", "exp2", "log2",
 
     // Casts
@@ -182,22 +185,74 @@ StringBuffer var_buffer(0);
                    "exceeds the limit of 2^32 == 4294967296 entries.",         \
                    name, size);
 
-/// Cleanup handler, called when the internal/external reference count reaches zero
-void jitc_var_free(uint32_t index, Variable *v) {
-    jitc_trace("jit_var_free(r%u)", index);
+/* State of the deferred-free worklist. It is thread-local: callbacks run
+   with 'state.lock' released, during which other threads may release their
+   own variables concurrently. */
 
-    if (v->is_data()) {
-        // Release memory referenced by this variable
-        if (!v->retain_data)
-            jitc_free(v->data);
-    } else {
-        // Unevaluated variable, drop from CSE cache
-        jitc_lvn_drop(index, v);
+/// Variables whose reference count reached zero, awaiting release
+static thread_local std::vector<uint32_t> var_free_queue;
+
+/// Released variables awaiting removal from the LVN cache and variable table
+static thread_local std::vector<uint32_t> var_free_erase;
+
+/// Memory regions of released variables, returned to the allocator in bulk
+static thread_local std::vector<void *> var_free_data;
+
+/// Is a call to jitc_var_free() currently processing 'var_free_queue'?
+static thread_local bool var_free_busy = false;
+
+/// RAII helper to temporarily change 'var_free_busy' (restored if an exception is raised)
+struct scoped_var_free_busy {
+    scoped_var_free_busy(bool value) : backup(var_free_busy) {
+        var_free_busy = value;
+    }
+    ~scoped_var_free_busy() { var_free_busy = backup; }
+    bool backup;
+};
+
+/**
+ * Remove the variables in 'var_free_erase' from the LVN cache and the
+ * variable table in one batch. When 'drop_queued' is set, variables that are
+ * still waiting in 'var_free_queue' are also dropped from the LVN cache, so
+ * that code running in the meantime (callbacks) cannot reuse them.
+ */
+static void jitc_var_free_flush(bool drop_queued) noexcept(true) {
+    if (drop_queued) {
+        for (uint32_t index : var_free_queue) {
+            const Variable *v = jitc_var(index);
+            if (!v->is_data())
+                jitc_lvn_drop(index, v);
+        }
+    }
+
+    for (uint32_t index : var_free_erase) {
+        Variable *v = jitc_var(index);
+        if (!v->is_data())
+            jitc_lvn_drop(index, v);
+        if (unlikely(v->free_stmt))
+            free(v->stmt);
     }
 
-    // Free IR string if needed
-    if (unlikely(v->free_stmt))
-        free(v->stmt);
+    for (uint32_t index : var_free_erase)
+        state.variables.erase(index);
+
+#if defined(DRJIT_VALGRIND)
+    if (!var_free_erase.empty()) {
+        VariableMap var_new(state.variables);
+        state.variables.swap(var_new);
+    }
+#endif
+
+    var_free_erase.clear();
+}
+
+/// Release a single variable and queue its dependencies (via jitc_var_dec_ref())
+static void jitc_var_free_one(uint32_t index, Variable *v) {
+    jitc_trace("jit_var_free(r%u)", index);
+
+    // Release memory referenced by this variable
+    if (v->is_data() && !v->retain_data)
+        var_free_data.push_back(v->data);
 
     uint32_t dep[4];
     bool write_ptr = v->write_ptr;
@@ -211,8 +266,15 @@ void jitc_var_free(uint32_t index, Variable *v) {
         state.extra.erase(it);
 
         /* Notify callback that the variable was freed.
-           Do this first, before freeing any dependencies */
+           Do this first, before freeing any dependencies. Variables
+           released by the callback are freed before it returns. */
         if (extra.callback) {
+            // Pending LVN entries must not be reused by the callback
+            if (!v->is_data())
+                jitc_lvn_drop(index, v);
+            jitc_var_free_flush(true);
+
+            scoped_var_free_busy busy_guard(false);
             if (extra.callback_internal) {
                 extra.callback(index, 1, extra.callback_data);
             } else {
@@ -239,13 +301,8 @@ void jitc_var_free(uint32_t index, Variable *v) {
         free(extra.label);
     }
 
-    // Remove from hash table
-    state.variables.erase(index);
-
-#if defined(DRJIT_VALGRIND)
-    VariableMap var_new(state.variables);
-    state.variables.swap(var_new);
-#endif
+    // Remove from the LVN cache and hash table later on (in a batch)
+    var_free_erase.push_back(index);
 
     if (likely(!write_ptr)) {
         // Decrease reference count of dependencies
@@ -256,6 +313,47 @@ void jitc_var_free(uint32_t index, Variable *v) {
     }
 }
 
+/**
+ * Cleanup handler, called when the internal/external reference count reaches
+ * zero. Dependencies whose reference count drops to zero in turn are not
+ * released recursively: they are appended to a worklist that the outermost
+ * call processes iteratively. Released variables are then removed from the
+ * LVN cache and variable table as a group, and their memory is returned to
+ * the allocator in a single batch. No new variables are created while the
+ * worklist is processed (except by callbacks, before which pending entries
+ * are dropped from the LVN cache), hence queued variables cannot be reused.
+ */
+void jitc_var_free(uint32_t index, Variable *) {
+    var_free_queue.push_back(index);
+    if (var_free_busy)
+        return;
+
+    // Nested calls (from callbacks) only process the entries they added
+    size_t base = var_free_queue.size() - 1;
+
+    try {
+        scoped_var_free_busy busy_guard(true);
+        while (var_free_queue.size() > base) {
+            uint32_t index_2 = var_free_queue.back();
+            var_free_queue.pop_back();
+            jitc_var_free_one(index_2, jitc_var(index_2));
+        }
+    } catch (...) {
+        /* Drop the remaining entries of this call. Left in the queue, they
+           would be skipped by later calls, which only process their own. */
+        var_free_queue.resize(base);
+        jitc_var_free_flush(false);
+        throw;
+    }
+
+    jitc_var_free_flush(false);
+
+    if (base == 0 && !var_free_data.empty()) {
+        jitc_free_many(var_free_data.data(), var_free_data.size());
+        var_free_data.clear();
+    }
+}
+
 /// Access a variable by ID, terminate with an error if it doesn't exist
 Variable *jitc_var(uint32_t index) {
     auto it = state.variables.find(index);
@@ -410,6 +508,7 @@ void jitc_value_print(const Variable *v, bool graphviz = false) {
         break;
 
     switch ((VarType) v->type) {
+        case VarType::Float16: JIT_LITERAL_PRINT(half, float, "%g");
         case VarType::Float32: JIT_LITERAL_PRINT(float, float, "%g");
         case VarType::Float64: JIT_LITERAL_PRINT(double, double, "%g");
         case VarType::Bool:    JIT_LITERAL_PRINT(bool, int, "%i");
@@ -429,6 +528,140 @@ void jitc_value_print(const Variable *v, bool graphviz = false) {
     #undef JIT_LITERAL_PRINT
 }
 
+/// Operation count that triggers automatic evaluation (0: disabled)
+uint32_t jitc_auto_eval_threshold = 0;
+
+/// Temporaries used by 'jitc_var_auto_eval()'
+static std::vector<uint32_t> auto_eval_pending;
+static std::vector<std::pair<uint32_t, uint32_t>> auto_eval_roots;
+static tsl::robin_map<uint32_t, uint32_t, UInt32Hasher> auto_eval_refs;
+
+/**
+ * \brief Bound the size of the unevaluated trace (see \ref
+ * jit_set_auto_eval_threshold())
+ *
+ * Determines the unevaluated variables created by the given thread that are
+ * still referenced from outside of the computation graph (by the
+ * application), and measures the size of the subgraph that each one
+ * contributes. The heaviest ones are then evaluated until the remaining trace
+ * has shrunk to a quarter of the threshold.
+ *
+ * This function is invoked by \ref jitc_var_new() once an arithmetic
+ * operation has been fully registered, which never happens while a compound
+ * operation (call, loop, ..) is partially constructed. Placeholder variables
+ * that are part of a recorded computation are never evaluated.
+ */
+static void jitc_var_auto_eval(ThreadState *ts) {
+    uint32_t threshold = jitc_auto_eval_threshold;
+    std::vector<uint32_t> &trace = ts->trace_vars;
+
+    auto_eval_pending.clear();
+    auto_eval_roots.clear();
+    auto_eval_refs.clear();
+
+    /* Count references between the unevaluated variables of this thread,
+       and drop variables that were evaluated or freed in the meantime */
+    size_t n_trace = 0;
+    for (uint32_t index : trace) {
+        auto it = state.variables.find(index);
+        if (it == state.variables.end())
+            continue;
+        const Variable &v = it.value();
+        if (v.is_data() || v.is_literal())
+            continue;
+
+        trace[n_trace++] = index;
+        if (!v.placeholder)
+            auto_eval_pending.push_back(index);
+
+        for (uint32_t i = 0; i < 4; ++i) {
+            if (v.dep[i])
+                auto_eval_refs[v.dep[i]]++;
+        }
+
+        const Extra *extra = jitc_var_extra(&v, index);
+        if (extra) {
+            for (uint32_t i = 0; i < extra->n_dep; ++i) {
+                if (extra->dep[i])
+                    auto_eval_refs[extra->dep[i]]++;
+            }
+        }
+    }
+
+    trace.resize(n_trace);
+
+    uint32_t total = (uint32_t) auto_eval_pending.size();
+    if (total < threshold) {
+        /* Temporaries were freed in the meantime. Don't check again until
+           at least 'threshold / 2' more operations exist */
+        jitc_log(Debug, "jit_var_new(): trace contains %u unevaluated "
+                 "operations, not evaluating.", total);
+        ts->trace_size = std::min(total, threshold / 2);
+        return;
+    }
+
+    /* Variables with references from elsewhere are roots of the trace. The
+       size of each subgraph excludes parts that were already attributed to
+       previously created roots ('trace' is in order of creation). */
+    uint32_t epoch = jitc_var_visit_epoch(), weight = 0;
+    for (uint32_t index : auto_eval_pending) {
+        const Variable *v = jitc_var(index);
+        if ((VarType) v->type == VarType::Void ||
+            !(v->is_stmt() || v->is_node()))
+            continue;
+
+        auto it = auto_eval_refs.find(index);
+        uint32_t refs = it == auto_eval_refs.end() ? 0 : it->second;
+        if (v->ref_count <= refs)
+            continue;
+
+        weight = 0;
+        jitc_var_dfs(
+            index,
+            [epoch, &weight](uint32_t, Variable *v2) {
+                if (v2->visit_epoch == epoch || v2->is_data() || v2->placeholder)
+                    return false;
+                v2->visit_epoch = epoch;
+                weight += !v2->is_literal();
+                return true;
+            },
+            [](uint32_t, Variable *) { });
+
+        if (weight)
+            auto_eval_roots.emplace_back(weight, index);
+    }
+
+    std::stable_sort(
+        auto_eval_roots.begin(), auto_eval_roots.end(),
+        [](const std::pair<uint32_t, uint32_t> &a,
+           const std::pair<uint32_t, uint32_t> &b) { return a.first > b.first; });
+
+    // Evaluate the heaviest subgraphs
+    uint32_t remainder = total, n_roots = 0;
+    for (auto [weight_i, index] : auto_eval_roots) {
+        if (remainder <= threshold / 4)
+            break;
+        jitc_log(Debug, "jit_var_new(): scheduling r%u (%u operations).",
+                 index, weight_i);
+        ts->scheduled.push_back(index);
+        remainder -= weight_i;
+        n_roots++;
+    }
+
+    jitc_log(Info,
+             "jit_var_new(): trace contains %u unevaluated operations "
+             "(threshold: %u), evaluating %u of %u referenced subgraph%s "
+             "(%u operations).", total, threshold, n_roots,
+             (uint32_t) auto_eval_roots.size(),
+             auto_eval_roots.size() == 1 ? "" : "s", total - remainder);
+
+    if (n_roots)
+        jitc_eval(ts);
+
+    // Don't check again until at least 'threshold / 2' more operations exist
+    ts->trace_size = std::min(remainder, threshold / 2);
+}
+
 /// Append the given variable to the instruction trace and return its ID
 uint32_t jitc_var_new(Variable &v, bool disable_lvn) {
     ThreadState *ts = thread_state(v.backend);
@@ -480,6 +713,13 @@ uint32_t jitc_var_new(Variable &v, bool disable_lvn) {
             vo->extra = true;
             state.extra[index].label = strdup(ts->prefix);
         }
+
+        // Keep track of unevaluated operations for 'jitc_var_auto_eval()'
+        if (unlikely(jitc_auto_eval_threshold) &&
+            (v.is_stmt() || v.is_node())) {
+            ts->trace_vars.push_back(index);
+            ts->trace_size += !v.placeholder;
+        }
     } else {
         // .. found a match! Deallocate 'v'.
         if (v.free_stmt)
@@ -542,6 +782,15 @@ uint32_t jitc_var_new(Variable &v, bool disable_lvn) {
 
     jitc_var_inc_ref(index, vo);
 
+    /* Automatic evaluation: consider evaluating the trace once an arithmetic
+       operation has been appended. The new variable is complete at this
+       point, and the caller holds a reference to it. */
+    if (unlikely(jitc_auto_eval_threshold) &&
+        ts->trace_size >= jitc_auto_eval_threshold && !v.placeholder &&
+        v.kind >= VarKind::Neg && v.kind <= VarKind::Bitcast &&
+        !jitc_eval_active && !(jitc_flags() & (uint32_t) JitFlag::Recording))
+        jitc_var_auto_eval(ts);
+
     return index;
 }
 
@@ -976,6 +1225,7 @@ const char *jitc_var_str(uint32_t index) {
             case VarType::UInt32:  var_buffer.fmt("%"   PRIu32 "%s", *((uint32_t *) dst), comma); break;
             case VarType::Int64:   var_buffer.fmt("%"   PRId64 "%s", *(( int64_t *) dst), comma); break;
             case VarType::UInt64:  var_buffer.fmt("%"   PRIu64 "%s", *((uint64_t *) dst), comma); break;
+            case VarType::Float16: var_buffer.fmt("%g%s", (float) *((half *) dst), comma); break;
             case VarType::Float32: var_buffer.fmt("%g%s", *((float *) dst), comma); break;
             case VarType::Float64: var_buffer.fmt("%g%s", *((double *) dst), comma); break;
             default: jitc_fail("jit_var_str(): unsupported type!");
@@ -1110,10 +1360,194 @@ void jitc_var_read(uint32_t index, size_t offset, void *dst) {
         jitc_fail("jit_var_read(): internal error!");
 }
 
+struct JitReadFuture {
+    JitBackend backend = JitBackend::Invalid;
+
+    /// Pending copy operations (into 'staging' on the CUDA backend)
+    std::vector<MemcpyRecord> records;
+
+    /// Final output buffers (CUDA backend)
+    std::vector<void *> dst;
+
+    /// Task performing the copy (LLVM backend)
+    Task *task = nullptr;
+
+    /// Pinned memory receiving the values & completion event (CUDA backend)
+    uint8_t *staging = nullptr;
+    CUevent event = nullptr;
+};
+
+/**
+ * Evaluate the variables of a read_many() operation using a single call to
+ * jitc_eval() and determine the copy operations. Literal constants are
+ * written to 'dst' right away.
+ */
+static JitBackend jitc_var_read_prepare(const char *name, uint32_t n,
+                                        const uint32_t *indices,
+                                        const size_t *offsets, void **dst,
+                                        std::vector<MemcpyRecord> &records) {
+    JitBackend backend = JitBackend::Invalid;
+    ThreadState *ts = nullptr;
+    bool eval = false;
+
+    for (uint32_t i = 0; i < n; ++i) {
+        if (!indices[i])
+            jitc_raise("%s(): uninitialized variable!", name);
+
+        const Variable *v = jitc_var(indices[i]);
+        if (unlikely(v->placeholder))
+            jitc_raise_placeholder_error(name, indices[i]);
+
+        if (backend == JitBackend::Invalid) {
+            backend = (JitBackend) v->backend;
+            ts = thread_state(backend);
+        } else if (backend != (JitBackend) v->backend) {
+            jitc_raise("%s(): variables use different backends!", name);
+        }
+
+        if (v->is_stmt() || v->is_node()) {
+            ts->scheduled.push_back(indices[i]);
+            eval = true;
+        } else if (v->is_data() && v->is_dirty()) {
+            eval = true;
+        }
+    }
+
+    if (eval)
+        jitc_eval(ts);
+
+    records.reserve(n);
+    for (uint32_t i = 0; i < n; ++i) {
+        const Variable *v = jitc_var(indices[i]);
+        size_t offset = offsets ? offsets[i] : 0;
+
+        if (v->size == 1)
+            offset = 0;
+        else if (unlikely(offset >= (size_t) v->size))
+            jitc_raise("%s(): attempted to access entry %zu in an array of "
+                       "size %u!", name, offset, v->size);
+
+        uint32_t isize = type_size[v->type];
+        if (v->is_literal())
+            memcpy(dst[i], &v->literal, isize);
+        else if (v->is_data() && !v->is_dirty())
+            records.push_back(MemcpyRecord{
+                dst[i], (const uint8_t *) v->data + offset * isize, isize });
+        else
+            jitc_raise("%s(): variable r%u could not be evaluated!", name,
+                       indices[i]);
+    }
+
+    return backend;
+}
+
+void jitc_var_read_many(uint32_t n, const uint32_t *indices,
+                        const size_t *offsets, void **dst) {
+    std::vector<MemcpyRecord> records;
+    JitBackend backend = jitc_var_read_prepare("jit_var_read_many", n, indices,
+                                               offsets, dst, records);
+    if (records.empty())
+        return;
+
+    ThreadState *ts = thread_state(backend);
+    jitc_log(Debug, "jit_var_read_many(): reading %zu entries.", records.size());
+
+    // Temporarily release the lock while copying
+    unlock_guard guard(state.lock);
+    if (backend == JitBackend::CUDA) {
+        scoped_set_context guard_2(ts->context);
+        cuda_check(cuStreamSynchronize(ts->stream));
+        for (const MemcpyRecord &r : records)
+            cuda_check(cuMemcpy((CUdeviceptr) r.dst, (CUdeviceptr) r.src, r.size));
+    } else {
+        jitc_sync_thread(ts);
+        for (const MemcpyRecord &r : records)
+            memcpy(r.dst, r.src, r.size);
+    }
+}
+
+JitReadFuture *jitc_var_read_many_async(uint32_t n, const uint32_t *indices,
+                                        const size_t *offsets, void **dst) {
+    JitReadFuture *future = new JitReadFuture();
+
+    try {
+        future->backend =
+            jitc_var_read_prepare("jit_var_read_many_async", n, indices,
+                                  offsets, dst, future->records);
+    } catch (...) {
+        delete future;
+        throw;
+    }
+
+    uint32_t count = (uint32_t) future->records.size();
+    if (count == 0)
+        return future;
+
+    jitc_log(Debug, "jit_var_read_many_async(): reading %u entries.", count);
+
+    if (future->backend == JitBackend::CUDA) {
+        // Copy to pinned memory, which is then read by jitc_read_future_wait()
+        size_t total = 0;
+        for (const MemcpyRecord &r : future->records)
+            total += r.size;
+        future->staging = (uint8_t *) jitc_malloc(AllocType::HostPinned, total);
+
+        total = 0;
+        for (MemcpyRecord &r : future->records) {
+            future->dst.push_back(r.dst);
+            r.dst = future->staging + total;
+            total += r.size;
+        }
+
+        jitc_memcpy_many_async(JitBackend::CUDA, future->records.data(), count);
+
+        ThreadState *ts = thread_state(JitBackend::CUDA);
+        scoped_set_context guard(ts->context);
+        cuda_check(cuEventCreate(&future->event, CU_EVENT_DISABLE_TIMING));
+        cuda_check(cuEventRecord(future->event, ts->stream));
+    } else {
+        jitc_memcpy_many_async(JitBackend::LLVM, future->records.data(), count);
+        future->task = jitc_task;
+        task_retain(future->task);
+    }
+
+    return future;
+}
+
+void jitc_read_future_wait(JitReadFuture *future) {
+    if (!future)
+        return;
+
+    {
+        unlock_guard guard(state.lock);
+        if (future->task) {
+            task_wait(future->task);
+        } else if (future->event) {
+            cuda_check(cuEventSynchronize(future->event));
+            for (size_t i = 0; i < future->records.size(); ++i)
+                memcpy(future->dst[i], future->records[i].dst,
+                       future->records[i].size);
+        }
+    }
+
+    if (future->task)
+        task_release(future->task);
+    if (future->event) {
+        scoped_set_context guard(thread_state(JitBackend::CUDA)->context);
+        cuda_check(cuEventDestroy(future->event));
+    }
+    if (future->staging)
+        jitc_free(future->staging);
+
+    delete future;
+}
+
 /// Reverse of jitc_var_read(). Copy 'dst' to a single element of a variable
 uint32_t jitc_var_write(uint32_t index, size_t offset, const void *src) {
     Variable *v = jitc_var(index);
-    if (v->is_dirty() || v->ref_count > 1) {
+    if (v->is_dirty() || v->ref_count > 1 ||
+        (unlikely(jitc_file_mapping_count) && v->is_data() &&
+         jitc_file_read_only(v->data))) {
         // Not safe to directly write to 'v'
         index = jitc_var_copy(index);
     } else {
@@ -1572,6 +2006,7 @@ uint32_t jitc_var_reduce(uint32_t index, ReduceOp reduce_op) {
                 case VarType::UInt32:  jitc_var_reduce_scalar<uint32_t>(size, &value); break;
                 case VarType::Int64:   jitc_var_reduce_scalar<int64_t> (size, &value); break;
                 case VarType::UInt64:  jitc_var_reduce_scalar<uint64_t>(size, &value); break;
+                case VarType::Float16: jitc_var_reduce_scalar<half>    (size, &value); break;
                 case VarType::Float32: jitc_var_reduce_scalar<float>   (size, &value); break;
                 case VarType::Float64: jitc_var_reduce_scalar<double>  (size, &value); break;
                 default: jitc_raise("jit_var_reduce(): unsupported operand type!");
@@ -15,6 +15,7 @@
 enum VarKind : uint32_t;
 
 struct Variable;
+struct JitReadFuture;
 
 /// Look up a variable by its ID
 extern Variable *jitc_var(uint32_t index);
@@ -140,6 +141,19 @@ const char *jitc_var_str(uint32_t index);
 /// Read a single element of a variable and write it to 'dst'
 extern void jitc_var_read(uint32_t index, size_t offset, void *dst);
 
+/// Read a single element of multiple variables with a single synchronization
+extern void jitc_var_read_many(uint32_t n, const uint32_t *indices,
+                               const size_t *offsets, void **dst);
+
+/// Asynchronous version of jitc_var_read_many()
+extern JitReadFuture *jitc_var_read_many_async(uint32_t n,
+                                               const uint32_t *indices,
+                                               const size_t *offsets,
+                                               void **dst);
+
+/// Wait for an asynchronous read to finish and release the handle
+extern void jitc_read_future_wait(JitReadFuture *future);
+
 /// Reverse of jitc_var_read(). Copy 'src' to a single element of a variable
 extern uint32_t jitc_var_write(uint32_t index, size_t offset, const void *src);
 
@@ -170,6 +184,9 @@ extern void jitc_lvn_put(uint32_t index, const Variable *v);
 /// Append the given variable to the instruction trace and return its ID
 extern uint32_t jitc_var_new(Variable &v, bool disable_lvn = false);
 
+/// Operation count that triggers automatic evaluation (0: disabled), see jit_set_auto_eval_threshold()
+extern uint32_t jitc_auto_eval_threshold;
+
 /// Query the current (or future, if not yet evaluated) allocation flavor of a variable
 extern AllocType jitc_var_alloc_type(uint32_t index);
 
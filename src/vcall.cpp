@@ -699,62 +699,45 @@ void jitc_var_vcall_assemble(VCall *vcall, uint32_t self_reg, uint32_t mask_reg,
 void jitc_var_vcall_collect_data(tsl::robin_map<uint64_t, uint32_t, UInt64Hasher> &data_map,
                                  uint32_t &data_offset, uint32_t inst_id,
                                  uint32_t index, bool &use_self, bool &use_optix) {
-    uint64_t key = (uint64_t) index + (((uint64_t) inst_id) << 32);
-    auto it_and_status = data_map.emplace(key, (uint32_t) -1);
-    if (!it_and_status.second)
-        return;
+    // 'data_map' also records visited variables (with an offset of -1)
+    auto enter = [&](uint32_t index, const Variable *v) {
+        uint64_t key = (uint64_t) index + (((uint64_t) inst_id) << 32);
+        auto it_and_status = data_map.emplace(key, (uint32_t) -1);
+        if (!it_and_status.second)
+            return false;
 
-    const Variable *v = jitc_var(index);
-
-    if ((VarKind) v->kind == VarKind::VCallSelf)
-        use_self = true;
+        if ((VarKind) v->kind == VarKind::VCallSelf)
+            use_self = true;
 
 #if defined(DRJIT_ENABLE_OPTIX)
-    if ((JitBackend) v->backend == JitBackend::CUDA)
-        use_optix |= v->optix;
+        if ((JitBackend) v->backend == JitBackend::CUDA)
+            use_optix |= v->optix;
 #endif
 
-    if (v->vcall_iface) {
-        return;
-    } else if (v->is_data() || (VarType) v->type == VarType::Pointer) {
-        uint32_t tsize = type_size[v->type];
-        uint32_t offset = (data_offset + tsize - 1) / tsize * tsize;
-        it_and_status.first.value() = offset;
-        data_offset = offset + tsize;
+        if (v->vcall_iface) {
+            return false;
+        } else if (v->is_data() || (VarType) v->type == VarType::Pointer) {
+            uint32_t tsize = type_size[v->type];
+            uint32_t offset = (data_offset + tsize - 1) / tsize * tsize;
+            it_and_status.first.value() = offset;
+            data_offset = offset + tsize;
+
+            if (v->size != 1)
+                jitc_raise(
+                    "jit_var_vcall(): the virtual function call associated with "
+                    "instance %u accesses an evaluated variable r%u of type "
+                    "%s and size %u. However, only *scalar* (size == 1) "
+                    "evaluated variables can be accessed while recording "
+                    "virtual function calls",
+                    inst_id, index, type_name[v->type], v->size);
+
+            return false;
+        }
 
-        if (v->size != 1)
-            jitc_raise(
-                "jit_var_vcall(): the virtual function call associated with "
-                "instance %u accesses an evaluated variable r%u of type "
-                "%s and size %u. However, only *scalar* (size == 1) "
-                "evaluated variables can be accessed while recording "
-                "virtual function calls",
-                inst_id, index, type_name[v->type], v->size);
-    } else {
-        for (uint32_t i = 0; i < 4; ++i) {
-            uint32_t index_2 = v->dep[i];
-            if (!index_2)
-                break;
+        return true;
+    };
 
-            jitc_var_vcall_collect_data(data_map, data_offset, inst_id, index_2,
-                                        use_self, use_optix);
-        }
-        if (unlikely(v->extra)) {
-            auto it = state.extra.find(index);
-            if (it == state.extra.end())
-                jitc_fail("jit_var_vcall_collect_data(): could not find "
-                          "matching 'extra' record!");
-
-            const Extra &extra = it->second;
-            for (uint32_t i = 0; i < extra.n_dep; ++i) {
-                uint32_t index_2 = extra.dep[i];
-                if (index_2 == 0)
-                    continue; // not break
-                jitc_var_vcall_collect_data(data_map, data_offset, inst_id,
-                                            index_2, use_self, use_optix);
-            }
-        }
-    }
+    jitc_var_dfs(index, enter, [](uint32_t, const Variable *) { });
 }
 
 void jitc_vcall_upload(ThreadState *ts) {
@@ -3,10 +3,13 @@
 #endif
 
 #include "test.h"
+#include <drjit-core/texture.h>
 #include <initializer_list>
 #include <cmath>
 #include <cstring>
+#include <limits>
 #include <typeinfo>
+#include <thread>
 
 TEST_BOTH(01_creation_destruction_cse) {
     // Test CSE involving normal and evaluated constant literals
@@ -156,7 +159,7 @@ const char *op_name[(int) JitOp::Count] {
     // Fast approximations
     "rcp", "rsqrt",
 
-    // Multi-function generator (CUDA)
+    // Transcendental functions (CUDA: multi-function generator)
     "sin", "cos", "exp2", "log2",
 };
 
@@ -646,3 +649,578 @@ TEST_BOTH(08_printf) {
     jit_eval();
 }
 #endif
+
+TEST_LLVM(09_profile_dump) {
+    jit_profile_clear();
+    jit_profile_start();
+
+    UInt32 x = arange<UInt32>(100000) * 3;
+    jit_var_schedule(x.index());
+    jit_eval();
+    jit_assert(hsum(x).read(0) == 3 * (99999u * 100000u / 2));
+
+    jit_profile_stop();
+
+    const char *fname = "profile_test.json";
+    jit_assert(jit_profile_dump(fname) == 1);
+
+    FILE *f = fopen(fname, "r");
+    jit_assert(f != nullptr);
+    char buf[4096];
+    size_t size = fread(buf, 1, sizeof(buf) - 1, f);
+    buf[size] = '\0';
+    fclose(f);
+    remove(fname);
+
+    jit_assert(strstr(buf, "\"traceEvents\"") != nullptr);
+    jit_assert(strstr(buf, "\"jit_eval\"") != nullptr);
+    jit_assert(strstr(buf, "\"cat\": \"kernel\"") != nullptr);
+    jit_profile_clear();
+}
+
+TEST_BOTH(10_kernel_stats) {
+    jit_kernel_stats_clear();
+    jit_set_flag(JitFlag::KernelStats, true);
+    jit_kernel_history_configure(2, 0);
+    jit_set_flag(JitFlag::KernelHistory, true);
+
+    for (int i = 0; i < 5; ++i) {
+        UInt32 x = arange<UInt32>(1000) * 7;
+        jit_var_schedule(x.index());
+        jit_eval();
+    }
+    jit_sync_thread();
+
+    size_t count = 0;
+    KernelStats *stats = jit_kernel_stats(&count);
+    jit_assert(count == 1 && stats);
+    jit_assert(stats->type == KernelType::JIT && stats->launches == 5 &&
+               stats->cache_hits + stats->cache_misses == 5 &&
+               stats->cache_hits >= 4 && stats->size == 5000 &&
+               stats->timed_launches == 5);
+    jit_assert(stats->execution_time_min <= stats->execution_time_p50 &&
+               stats->execution_time_p50 <= stats->execution_time_p99 &&
+               stats->execution_time_p99 <= stats->execution_time_max);
+    free(stats);
+
+    // Bounded history without IR only retains the two most recent launches
+    KernelHistoryEntry *history = jit_kernel_history();
+    jit_assert(history && history[0].ir == nullptr &&
+               history[1].backend == Backend &&
+               history[2].backend == JitBackend::Invalid);
+    free(history);
+
+    jit_set_flag(JitFlag::KernelHistory, false);
+    jit_kernel_history_configure(0, 1);
+    jit_set_flag(JitFlag::KernelStats, false);
+    jit_kernel_stats_clear();
+    stats = jit_kernel_stats(&count);
+    jit_assert(count == 0 && !stats);
+}
+
+TEST_BOTH(11_read_many) {
+    jit_kernel_stats_clear();
+    jit_set_flag(JitFlag::KernelStats, true);
+
+    UInt32 a = arange<UInt32>(1000) * 3, b = a + 5, c(42);
+    Float d = Float(a) * .5f;
+    uint32_t indices[4] = { a.index(), b.index(), c.index(), d.index() };
+    size_t offsets[4] = { 10, 999, 7, 3 };
+
+    // Unevaluated variables are computed by a single kernel
+    uint32_t va = 0, vb = 0, vc = 0;
+    float vd = 0.f;
+    void *dst[4] = { &va, &vb, &vc, &vd };
+    jit_var_read_many(4, indices, offsets, dst);
+    jit_assert(va == 30 && vb == 3002 && vc == 42 && vd == 4.5f);
+
+    size_t count = 0;
+    KernelStats *stats = jit_kernel_stats(&count);
+    jit_assert(count == 1 && stats->launches == 1);
+    free(stats);
+    jit_set_flag(JitFlag::KernelStats, false);
+    jit_kernel_stats_clear();
+
+    // The variables may be released before the asynchronous read finishes
+    va = vb = vc = 0;
+    vd = 0.f;
+    UInt32 e = a + 1;
+    indices[1] = e.index();
+    offsets[0] = 999;
+    JitReadFuture *future = jit_var_read_many_async(4, indices, offsets, dst);
+    a = UInt32();
+    e = UInt32();
+    jit_read_future_wait(future);
+    jit_assert(va == 2997 && vb == 2998 && vc == 42 && vd == 4.5f);
+}
+
+template <typename Value> bool test_transcendental(bool fast) {
+    constexpr JitBackend Backend = JitBackend::LLVM;
+    constexpr bool IsDouble = std::is_same<Value, double>::value;
+    constexpr VarType Type = IsDouble ? VarType::Float64 : VarType::Float32;
+    constexpr uint32_t Size = 1000;
+
+    struct Case { JitOp op; double lo, hi, floor; } cases[] = {
+        { JitOp::Sin, -100.0, 100.0, 1.0 },
+        { JitOp::Cos, -100.0, 100.0, 1.0 },
+        { JitOp::Exp2, fast ? -120.0 : -140.0, 120.0,
+          (double) std::numeric_limits<Value>::min() },
+        { JitOp::Log2, fast ? -120.0 : -140.0, 120.0, 1.0 }
+    };
+
+    double tol = fast ? (IsDouble ? 1e-6 : 2e-5) : (IsDouble ? 1e-14 : 2e-6);
+
+    bool fail = false;
+    for (const Case &c : cases) {
+        Value in[Size], out[Size];
+        for (uint32_t i = 0; i < Size; ++i) {
+            double t = c.lo + (c.hi - c.lo) * i / (Size - 1);
+            in[i] = (Value) (c.op == JitOp::Log2 ? std::exp2(t) : t);
+        }
+
+        uint32_t index = jit_var_mem_copy(Backend, AllocType::Host, Type, in, Size),
+                 result = jit_var_op(c.op, &index);
+        jit_var_eval(result);
+        jit_memcpy(Backend, out, jit_var_ptr(result), Size * sizeof(Value));
+        jit_var_dec_ref(index);
+        jit_var_dec_ref(result);
+
+        for (uint32_t i = 0; i < Size; ++i) {
+            double x = (double) in[i], ref;
+            switch (c.op) {
+                case JitOp::Sin:  ref = std::sin(x); break;
+                case JitOp::Cos:  ref = std::cos(x); break;
+                case JitOp::Exp2: ref = std::exp2(x); break;
+                default:          ref = std::log2(x); break;
+            }
+            ref = (double) (Value) ref;
+
+            double err = std::abs((double) out[i] - ref);
+            if (!(err <= tol * std::max(std::abs(ref), c.floor))) {
+                fprintf(stderr, "Mismatch: %s(%.17g) == %.17g vs %.17g\n",
+                        op_name[(int) c.op], x, (double) out[i], ref);
+                fail = true;
+                break;
+            }
+        }
+    }
+
+    if (!fast) {
+        // Special cases
+        const Value inf = std::numeric_limits<Value>::infinity(),
+                    nan = std::numeric_limits<Value>::quiet_NaN();
+        Value in[6] = { inf, -inf, nan, 0, -1, 0 }, out[4][6];
+        uint32_t index = jit_var_mem_copy(Backend, AllocType::Host, Type, in, 6);
+        JitOp ops[4] = { JitOp::Sin, JitOp::Cos, JitOp::Exp2, JitOp::Log2 };
+        for (int k = 0; k < 4; ++k) {
+            uint32_t result = jit_var_op(ops[k], &index);
+            jit_var_eval(result);
+            jit_memcpy(Backend, out[k], jit_var_ptr(result), sizeof(out[k]));
+            jit_var_dec_ref(result);
+        }
+        jit_var_dec_ref(index);
+
+        fail |= !(std::isnan(out[0][0]) && std::isnan(out[1][1]) &&
+                  std::isnan(out[0][2]) && out[0][3] == 0 && out[1][3] == 1);
+        fail |= !(out[2][0] == inf && out[2][1] == 0 &&
+                  std::isnan(out[2][2]) && out[2][3] == 1);
+        fail |= !(out[3][0] == inf && std::isnan(out[3][1]) &&
+                  std::isnan(out[3][2]) && out[3][3] == -inf &&
+                  std::isnan(out[3][4]));
+    }
+
+    return fail;
+}
+
+TEST_LLVM(12_transcendental) {
+    bool fail = false;
+    for (int fast = 0; fast < 2; ++fast) {
+        jit_set_flag(JitFlag::FastMath, fast);
+        fail |= test_transcendental<float>(fast);
+        fail |= test_transcendental<double>(fast);
+    }
+    jit_set_flag(JitFlag::FastMath, false);
+    jit_assert(!fail);
+
+    // Literal operands are folded at trace time
+    Float x(2.f);
+    uint32_t x_index = x.index();
+    Float y = Float::steal(jit_var_op(JitOp::Exp2, &x_index));
+    jit_assert(jit_var_is_literal(y.index()) && y.read(0) == 4.f);
+}
+
+TEST_LLVM(13_float16) {
+    // Half precision bit patterns of 1, 2, 0.5, -3, and 4
+    const uint16_t data[5] = { 0x3c00, 0x4000, 0x3800, 0xc200, 0x4400 };
+    uint16_t one_h = 0x3c00, half_h = 0x3800, zero_h = 0, out = 0;
+    uint32_t x = jit_var_mem_copy(Backend, AllocType::Host, VarType::Float16, data, 5),
+             one = jit_var_literal(Backend, VarType::Float16, &one_h),
+             half_l = jit_var_literal(Backend, VarType::Float16, &half_h);
+
+    // Arithmetic with literal operands, followed by a cast
+    uint32_t y = jit_var_fma(x, x, one);
+    Float yf = Float::steal(jit_var_cast(y, VarType::Float32, 0));
+    jit_assert(yf.read(0) == 2.f && yf.read(1) == 5.f && yf.read(2) == 1.25f &&
+               yf.read(3) == 10.f && yf.read(4) == 17.f);
+
+    uint32_t r = jit_var_rcp(x);
+    jit_var_read(r, 2, &out);
+    jit_assert(out == 0x4000);
+
+    // Literal operands are folded at trace time
+    uint32_t s = jit_var_add(one, half_l);
+    jit_var_read(s, 0, &out);
+    jit_assert(jit_var_is_literal(s) && out == 0x3e00);
+
+    // Reductions
+    const uint16_t expected[3] = { 0x4480, 0x4400, 0xc200 };
+    const ReduceOp ops[3] = { ReduceOp::Add, ReduceOp::Max, ReduceOp::Min };
+    for (int i = 0; i < 3; ++i) {
+        uint32_t red = jit_var_reduce(x, ops[i]);
+        jit_var_read(red, 0, &out);
+        jit_assert(out == expected[i]);
+        jit_var_dec_ref(red);
+    }
+
+    // Gathers and atomic scatter-additions
+    UInt32 index = arange<UInt32>(5) % 2;
+    Mask mask(true);
+    uint32_t target = jit_var_literal(Backend, VarType::Float16, &zero_h, 2, 1),
+             result = jit_var_scatter(target, x, index.index(), mask.index(),
+                                      ReduceOp::Add),
+             gathered = jit_var_gather(result, index.index(), mask.index());
+    jit_var_read(gathered, 3, &out);
+    jit_assert(out == 0xbc00);
+    jit_var_read(gathered, 4, &out);
+    jit_assert(out == 0x4580);
+
+    for (uint32_t i : { x, one, half_l, y, r, s, target, result, gathered })
+        jit_var_dec_ref(i);
+}
+
+/// Reference implementation of a texture lookup for TEST_LLVM(14_texture)
+static void tex_ref(size_t ndim, const size_t *shape, size_t channels,
+                    const float *data, int linear, int wrap, const float *pos,
+                    float *out) {
+    auto wrap_index = [wrap](int i, int size) {
+        if (wrap == 1)
+            return std::min(std::max(i, 0), size - 1);
+        int period = wrap == 0 ? size : 2 * size,
+            t = ((i % period) + period) % period;
+        return t < size ? t : 2 * size - 1 - t;
+    };
+
+    int idx[3][2] = { }; float wgt[3][2] = { { 1, 0 }, { 1, 0 }, { 1, 0 } };
+    for (size_t k = 0; k < ndim; ++k) {
+        float u = pos[k] * shape[k] - (linear ? .5f : 0.f),
+              u_floor = std::floor(u);
+        int i = (int) u_floor;
+        idx[k][0] = wrap_index(i, (int) shape[k]);
+        idx[k][1] = wrap_index(i + 1, (int) shape[k]);
+        if (linear) {
+            wgt[k][1] = u - u_floor;
+            wgt[k][0] = 1.f - wgt[k][1];
+        }
+    }
+
+    for (size_t c = 0; c < channels; ++c) {
+        float sum = 0.f;
+        for (int z = 0; z < 2; ++z)
+            for (int y = 0; y < 2; ++y)
+                for (int x = 0; x < 2; ++x) {
+                    size_t offset =
+                        ((idx[2][z] * shape[1] + idx[1][y]) *
+                             shape[0] + idx[0][x]) * channels + c;
+                    sum += wgt[0][x] * wgt[1][y] * wgt[2][z] * data[offset];
+                }
+        out[c] = sum;
+    }
+}
+
+TEST_LLVM(14_texture) {
+    const size_t shapes[3][3] = { { 5, 1, 1 }, { 3, 4, 1 }, { 3, 2, 2 } };
+    const float coords[] = { -0.7f, -0.1f, 0.f, 0.13f, 0.4f, 0.5f,
+                             0.77f, 0.99f, 1.f,  1.3f,  2.6f, -1.45f };
+    const size_t n = sizeof(coords) / sizeof(float);
+
+    for (size_t ndim = 1; ndim <= 3; ++ndim) {
+        for (size_t channels : { 1, 2, 3, 5 }) {
+            const size_t *shape = shapes[ndim - 1];
+            size_t n_texels = shape[0] * shape[1] * shape[2];
+
+            float *data = new float[n_texels * channels],
+                  *data_2 = new float[n_texels * channels];
+            for (size_t i = 0; i < n_texels * channels; ++i)
+                data[i] = (float) ((i * 7) % 11) - 3.f;
+
+            // Positions along each axis (rotated to decorrelate the axes)
+            float pos_host[3][n];
+            uint32_t pos[3];
+            for (size_t k = 0; k < ndim; ++k) {
+                for (size_t i = 0; i < n; ++i)
+                    pos_host[k][i] = coords[(i + 5 * k) % n];
+                pos[k] = jit_var_mem_copy(Backend, AllocType::Host,
+                                          VarType::Float32, pos_host[k], n);
+            }
+
+            for (int filter = 0; filter < 2; ++filter) {
+                for (int wrap = 0; wrap < 3; ++wrap) {
+                    void *tex = jit_llvm_tex_create(ndim, shape, channels,
+                                                    filter, wrap);
+                    jit_llvm_tex_memcpy_d2t(ndim, shape, data, tex);
+
+                    memset(data_2, 0, sizeof(float) * n_texels * channels);
+                    jit_llvm_tex_memcpy_t2d(ndim, shape, tex, data_2);
+                    jit_assert(memcmp(data, data_2, sizeof(float) *
+                                                        n_texels * channels) == 0);
+
+                    uint32_t out[5];
+                    jit_llvm_tex_lookup(ndim, tex, pos, out);
+                    jit_llvm_tex_destroy(tex);
+
+                    float result[5][n];
+                    for (size_t c = 0; c < channels; ++c) {
+                        for (size_t i = 0; i < n; ++i)
+                            jit_var_read(out[c], i, &result[c][i]);
+                        jit_var_dec_ref(out[c]);
+                    }
+
+                    for (size_t i = 0; i < n; ++i) {
+                        float p[3], ref[5];
+                        for (size_t k = 0; k < ndim; ++k)
+                            p[k] = pos_host[k][i];
+                        tex_ref(ndim, shape, channels, data, filter, wrap, p, ref);
+                        for (size_t c = 0; c < channels; ++c) {
+                            if (std::abs(result[c][i] - ref[c]) > 1e-4f) {
+                                fprintf(stderr, "ndim=%zu, channels=%zu, filter=%i, "
+                                        "wrap=%i, i=%zu, c=%zu: %f vs %f\n", ndim,
+                                        channels, filter, wrap, i, c,
+                                        result[c][i], ref[c]);
+                                jit_fail("Mismatch!");
+                            }
+                        }
+                    }
+                }
+            }
+
+            for (size_t k = 0; k < ndim; ++k)
+                jit_var_dec_ref(pos[k]);
+            delete[] data;
+            delete[] data_2;
+        }
+    }
+}
+
+TEST_LLVM(15_gather_prefetch) {
+    const uint32_t n = 1001;
+    Float table = arange<Float>(1000) * 0.5f;
+    UInt32 counter = arange<UInt32>(n),
+           index = (counter * 7919u) % 334u;
+    table.eval();
+    index.eval();
+
+    for (uint32_t distance : { 1u, 8u, 1000u }) {
+        for (bool packet_split : { false, true }) {
+            jit_set_flag(JitFlag::GatherPrefetch, true);
+            jit_set_flag(JitFlag::PacketSplit, packet_split);
+            jit_llvm_set_prefetch_distance(distance);
+
+            // Index computed from an input, and from the lane counter
+            Float a = gather(table, UInt32(index * 3u + 1u)),
+                  b = gather(table, UInt32((counter >> 1u) + 200u));
+
+            // Index that refers to the same operand twice
+            UInt32 t = counter + 1u;
+            Float c = gather(table, UInt32((t * t) & UInt32(511)));
+            a.schedule();
+            b.schedule();
+            c.schedule();
+            jit_eval();
+
+            for (uint32_t i = 0; i < n; i += 97) {
+                uint32_t j = (i * 7919u) % 334u;
+                jit_assert(a.read(i) == (j * 3 + 1) * 0.5f);
+                jit_assert(b.read(i) == ((i >> 1) + 200) * 0.5f);
+                jit_assert(c.read(i) == (((i + 1) * (i + 1)) & 511) * 0.5f);
+            }
+        }
+    }
+
+    jit_set_flag(JitFlag::GatherPrefetch, false);
+    jit_set_flag(JitFlag::PacketSplit, false);
+    jit_llvm_set_prefetch_distance(8);
+}
+
+TEST_BOTH(16_kernel_split) {
+    const uint32_t n = 1001;
+
+    auto compute = [n]() {
+        Float x = arange<Float>(n) * 0.001f, a = x, b = x + 1.f, c = x * 2.f;
+        UInt32 counter = arange<UInt32>(n);
+
+        // Three interleaved recurrences: every cut must carry their state
+        for (int i = 0; i < 100; ++i) {
+            a = fmadd(a, Float(0.5f), b * 0.25f);
+            b = b * 0.75f + c * 0.125f;
+            c = c - a * 0.125f + Float(counter & UInt32(7u)) * 0.01f;
+        }
+
+        return a + b + c;
+    };
+
+    Float ref = compute();
+    ref.schedule();
+    jit_eval();
+
+    jit_kernel_history_clear();
+    jit_set_flag(JitFlag::KernelHistory, true);
+    jit_set_kernel_op_budget(200);
+
+    Float value = compute();
+    value.schedule();
+    jit_eval();
+    jit_sync_thread();
+
+    jit_set_kernel_op_budget(0);
+    jit_set_flag(JitFlag::KernelHistory, false);
+
+    uint32_t kernels = 0;
+    KernelHistoryEntry *history = jit_kernel_history();
+    for (KernelHistoryEntry *e = history; e->backend != JitBackend::Invalid; ++e) {
+        if (e->type != KernelType::JIT)
+            continue;
+        jit_assert(e->size == n && e->operation_count < 400);
+        kernels++;
+    }
+    free(history);
+    jit_assert(kernels >= 4);
+
+    for (uint32_t i = 0; i < n; i += 50) {
+        float v0 = ref.read(i), v1 = value.read(i);
+        jit_assert(std::abs(v0 - v1) <= 1e-5f * std::abs(v0) + 1e-5f);
+    }
+}
+
+TEST_BOTH(17_auto_eval) {
+    const uint32_t n = 1001;
+
+    jit_kernel_history_clear();
+    jit_set_flag(JitFlag::KernelHistory, true);
+    jit_set_auto_eval_threshold(100);
+
+    // The trace of another thread is not evaluated on its behalf
+    Float z;
+    std::thread([&]() {
+        z = arange<Float>(n);
+        for (int i = 0; i < 30; ++i)
+            z = z * 0.5f + 1.f;
+    }).join();
+
+    // A long chain of operations that is never explicitly evaluated
+    Float x = arange<Float>(n), y = x;
+    for (int i = 0; i < 500; ++i)
+        y = y * 0.5f + x;
+
+    // Only the most recent part of the trace remains unevaluated
+    jit_assert(!jit_var_is_evaluated(y.index()));
+    jit_assert(!jit_var_is_evaluated(z.index()));
+    uint32_t kernels = 0;
+    KernelHistoryEntry *history = jit_kernel_history();
+    for (KernelHistoryEntry *e = history; e->backend != JitBackend::Invalid; ++e)
+        kernels += e->type == KernelType::JIT;
+    free(history);
+    jit_assert(kernels >= 5);
+
+    jit_set_auto_eval_threshold(0);
+    jit_set_flag(JitFlag::KernelHistory, false);
+
+    // y converges to 2 * x
+    for (uint32_t i = 0; i < n; i += 100) {
+        jit_assert(std::abs(y.read(i) - 2.f * i) <= 1e-5f * i);
+        jit_assert(std::abs(z.read(i) - 2.f) <= 1e-5f);
+    }
+}
+
+TEST_BOTH(18_free_callback) {
+    /* Free callbacks run while other variables are still queued for release,
+       and (unless internal) without holding the global lock */
+    struct Payload {
+        uint32_t x_index;
+        uint32_t calls;
+    } payload { 0, 0 };
+
+    Float x = arange<Float>(1000);
+    payload.x_index = x.index();
+
+    Float q = x + 1.f, z = x * 2.f;
+    jit_var_set_callback(
+        z.index(),
+        [](uint32_t, int free, void *ptr) {
+            if (!free)
+                return;
+            Payload *p = (Payload *) ptr;
+            p->calls++;
+
+            // 'q' is queued for release, this must create a new variable
+            jit_var_inc_ref(p->x_index);
+            Float r = Float::steal(p->x_index) + 1.f;
+            jit_assert(r.read(999) == 1000.f);
+
+            // Another thread creates and releases variables meanwhile
+            std::thread([]() {
+                Float a = arange<Float>(100);
+                for (int i = 0; i < 10000; ++i)
+                    a = a * 0.5f + 1.f;
+                jit_assert(std::abs(a.read(99) - 2.f) < 1e-5f);
+            }).join();
+        },
+        &payload);
+
+    // Releasing 'w' queues 'z' and 'q', then processes 'z' first
+    Float w = q + z;
+    q = Float();
+    z = Float();
+    w = Float();
+
+    jit_assert(payload.calls == 1);
+    Float r = x + 1.f;
+    jit_assert(r.read(999) == 1000.f);
+}
+
+TEST_LLVM(19_profile_concurrent) {
+    // Clearing and dumping must not interfere with threads that record events
+    const char *fname = "profile_test.json";
+    jit_profile_clear();
+    jit_profile_start();
+
+    std::thread worker([]() {
+        for (uint32_t i = 0; i < 200; ++i) {
+            UInt32 x = arange<UInt32>(1000) + i;
+            jit_var_schedule(x.index());
+            jit_eval();
+            jit_assert(x.read(999) == 999 + i);
+        }
+    });
+
+    for (int i = 0; i < 20; ++i) {
+        jit_profile_clear();
+        jit_assert(jit_profile_dump(fname) == 1);
+    }
+    worker.join();
+    jit_profile_stop();
+
+    // Events recorded before the last clear are no longer reported
+    jit_profile_clear();
+    jit_assert(jit_profile_dump(fname) == 1);
+
+    FILE *f = fopen(fname, "r");
+    jit_assert(f != nullptr);
+    char buf[4096];
+    size_t size = fread(buf, 1, sizeof(buf) - 1, f);
+    buf[size] = '\0';
+    fclose(f);
+    remove(fname);
+
+    jit_assert(strstr(buf, "\"traceEvents\"") != nullptr);
+    jit_assert(strstr(buf, "\"jit_eval\"") == nullptr);
+}
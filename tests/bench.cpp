@@ -0,0 +1,512 @@
+/*
+    tests/bench.cpp -- Benchmark suite of the LLVM backend (drjit-core-bench)
+
+    Measures the cost of tracing, jit_eval() on kernel cache hits, cold
+    compilation and disk cache loads, the throughput of the parallel
+    primitives (reduce, prefix sum, compress, mkperm) as a function of size
+    and thread count, the memory bandwidth of half vs. single precision
+    storage, virtual function call dispatch, recorded loops, and random
+    gathers with software prefetching. The latter also calibrates the prefetch
+    distance (see jit_llvm_set_prefetch_distance()).
+
+    Usage: drjit-core-bench [output.json]
+
+    The results are written as JSON (to standard output if no filename is
+    given) so that they can be compared across commits. Every record has the
+    form {"name", "size", "threads", "value", "unit"}; timings report the best
+    of several repetitions.
+
+    Copyright (c) 2021 Wenzel Jakob <wenzel.jakob@epfl.ch>
+
+    All rights reserved. Use of this source code is governed by a BSD-style
+    license that can be found in the LICENSE file.
+*/
+
+#include <drjit-core/array.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "traits.h"
+#include "ekloop.h"
+
+using namespace drjit;
+
+using Float  = LLVMArray<float>;
+using UInt32 = LLVMArray<uint32_t>;
+using Mask   = LLVMArray<bool>;
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    std::string name;
+    uint64_t size;
+    uint32_t threads;
+    double value;
+    const char *unit;
+};
+
+static std::vector<Result> results;
+static uint32_t thread_count = 0;
+
+static void report(const std::string &name, uint64_t size, double value,
+                   const char *unit, uint32_t threads = 0) {
+    if (threads == 0)
+        threads = thread_count;
+    fprintf(stderr, "%-28s size=%-10llu threads=%-3u %12.4f %s\n",
+            name.c_str(), (unsigned long long) size, threads, value, unit);
+    results.push_back(Result{ name, size, threads, value, unit });
+}
+
+static double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/// Return the best time (ms) of 'reps' invocations of 'func'
+template <typename Func> double best_of(int reps, Func func) {
+    double best = 1e30;
+    for (int i = 0; i < reps; ++i) {
+        auto t0 = Clock::now();
+        func();
+        best = std::min(best, ms_since(t0));
+    }
+    return best;
+}
+
+// ==========================================================================
+//                                 Tracing
+// ==========================================================================
+
+/// Per-operation cost of recording and releasing a chain of operations
+static void bench_trace(uint32_t ops) {
+    Float y = arange<Float>(1024);
+    double trace_ms = 1e30, release_ms = 1e30;
+
+    for (int rep = 0; rep < 5; ++rep) {
+        auto t0 = Clock::now();
+        Float x = y;
+        for (uint32_t i = 0; i < ops; ++i)
+            x = x + y;
+        trace_ms = std::min(trace_ms, ms_since(t0));
+
+        auto t1 = Clock::now();
+        x = Float();
+        release_ms = std::min(release_ms, ms_since(t1));
+    }
+
+    report("trace.add", ops, trace_ms * 1e6 / ops, "ns/op");
+    report("trace.release", ops, release_ms * 1e6 / ops, "ns/op");
+}
+
+/// jit_eval() on a kernel cache hit: a single deep chain of operations
+static void bench_eval_deep(uint32_t depth) {
+    auto run = [&] {
+        Float x = arange<Float>(1024);
+        for (uint32_t i = 0; i < depth; ++i)
+            x = x * 0.5f + 1.f;
+        auto t0 = Clock::now();
+        x.eval();
+        return ms_since(t0);
+    };
+
+    run(); // compile
+    double best = 1e30;
+    for (int rep = 0; rep < 5; ++rep)
+        best = std::min(best, run());
+    report("eval.cache_hit.deep", 2 * depth, best, "ms");
+}
+
+/// jit_eval() on a kernel cache hit: many outputs sharing a subexpression
+static void bench_eval_wide(uint32_t width) {
+    auto run = [&] {
+        Float x = arange<Float>(1024) * 2.f + 1.f;
+        std::vector<Float> out;
+        out.reserve(width);
+        for (uint32_t i = 0; i < width; ++i)
+            out.push_back(x * (float) i + 1.f);
+        for (Float &o : out)
+            jit_var_schedule(o.index());
+        auto t0 = Clock::now();
+        jit_eval();
+        return ms_since(t0);
+    };
+
+    run(); // compile
+    double best = 1e30;
+    for (int rep = 0; rep < 5; ++rep)
+        best = std::min(best, run());
+    report("eval.cache_hit.wide", width, best, "ms");
+}
+
+// ==========================================================================
+//                              Compilation
+// ==========================================================================
+
+/// Build a kernel with 'ops' operations, made unique by 'seed'
+static Float make_kernel(uint32_t ops, float seed) {
+    Float x = arange<Float>(4096);
+    for (uint32_t i = 0; i < ops; ++i)
+        x = x * seed + (float) i;
+    return x;
+}
+
+/// Cold compilation time vs. IR size, and the latency of disk cache loads
+static void bench_compile(uint32_t ops) {
+    // A literal that differs between runs ensures a miss in the disk cache
+    float seed = 1.f + (float) (Clock::now().time_since_epoch().count() %
+                                1000000) * 1e-7f;
+
+    jit_kernel_history_clear();
+    jit_set_flag(JitFlag::KernelHistory, true);
+
+    make_kernel(ops, seed).eval();
+
+    // Drop the in-memory cache, the next launch loads the kernel from disk
+    jit_flush_kernel_cache();
+    make_kernel(ops, seed).eval();
+
+    jit_set_flag(JitFlag::KernelHistory, false);
+    KernelHistoryEntry *history = jit_kernel_history();
+    if (!history)
+        return;
+
+    for (KernelHistoryEntry *e = history; e->backend != JitBackend::Invalid; ++e) {
+        if (e->type != KernelType::JIT)
+            continue;
+        if (!e->cache_hit) {
+            report("compile.cold.ir", ops, e->ir ? (double) strlen(e->ir) : 0.0, "bytes");
+            report("compile.cold.codegen", ops, e->codegen_time, "ms");
+            report("compile.cold.backend", ops, e->backend_time, "ms");
+        } else if (e->cache_disk) {
+            report("compile.disk_load.codegen", ops, e->codegen_time, "ms");
+        }
+    }
+
+    for (KernelHistoryEntry *e = history; e->backend != JitBackend::Invalid; ++e)
+        free(e->ir);
+    free(history);
+
+    // Total latency of a launch that is served by the disk cache
+    double ms = best_of(3, [&] {
+        jit_flush_kernel_cache();
+        make_kernel(ops, seed).eval();
+    });
+    report("compile.disk_load.total", ops, ms, "ms");
+}
+
+// ==========================================================================
+//                           Parallel primitives
+// ==========================================================================
+
+static void bench_primitives(uint32_t size, uint32_t threads) {
+    jit_llvm_set_thread_count(threads);
+
+    uint32_t *values = (uint32_t *) jit_malloc(AllocType::Host, size * sizeof(uint32_t)),
+             *out    = (uint32_t *) jit_malloc(AllocType::Host, (size + 1) * sizeof(uint32_t)),
+             *offsets = (uint32_t *) jit_malloc(AllocType::Host, (16 * 4 + 1) * sizeof(uint32_t));
+    uint8_t *mask = (uint8_t *) jit_malloc(AllocType::Host, size);
+
+    for (uint32_t i = 0; i < size; ++i) {
+        values[i] = (i * 2654435761u) >> 28; // 16 buckets
+        mask[i] = (uint8_t) (values[i] & 1);
+    }
+
+    auto throughput = [&](const char *name, double ms) {
+        report(name, size, size / (ms * 1e3), "Melem/s", threads);
+    };
+
+    throughput("reduce.sum.u32", best_of(5, [&] {
+        jit_reduce(JitBackend::LLVM, VarType::UInt32, ReduceOp::Add, values,
+                   size, out);
+        jit_sync_thread();
+    }));
+
+    throughput("prefix_sum.u32", best_of(5, [&] {
+        jit_prefix_sum(JitBackend::LLVM, VarType::UInt32, 1, values, size, out);
+        jit_sync_thread();
+    }));
+
+    throughput("compress", best_of(5, [&] {
+        jit_compress(JitBackend::LLVM, mask, size, out);
+    }));
+
+    throughput("mkperm.16", best_of(5, [&] {
+        jit_mkperm(JitBackend::LLVM, values, size, 16, out, offsets);
+        jit_sync_thread();
+    }));
+
+    throughput("argsort.u32", best_of(5, [&] {
+        jit_argsort(JitBackend::LLVM, VarType::UInt32, values, size, out);
+        jit_sync_thread();
+    }));
+
+    jit_free(values);
+    jit_free(out);
+    jit_free(offsets);
+    jit_free(mask);
+}
+
+// ==========================================================================
+//                     Half vs. single precision storage
+// ==========================================================================
+
+/// Bandwidth of a streaming kernel and of a reduction for a storage type
+static void bench_storage(uint32_t size, VarType type, const char *suffix) {
+    uint32_t isize = type == VarType::Float16 ? 2 : 4;
+    Float xf = arange<Float>(size) * (1.f / size), af(.5f), bf(1.f);
+    uint32_t x = jit_var_cast(xf.index(), type, 0),
+             a = jit_var_cast(af.index(), type, 0),
+             b = jit_var_cast(bf.index(), type, 0);
+    jit_var_eval(x);
+
+    auto bandwidth = [&](const char *name, double bytes, double ms) {
+        report(std::string(name) + suffix, size, bytes / (ms * 1e6), "GB/s");
+    };
+
+    auto stream = [&] {
+        uint32_t y = jit_var_fma(x, a, b);
+        jit_var_eval(y);
+        jit_sync_thread();
+        jit_var_dec_ref(y);
+    };
+    stream(); // compile
+    bandwidth("stream.fma.", 2.0 * size * isize, best_of(5, stream));
+
+    bandwidth("reduce.sum.", (double) size * isize, best_of(5, [&] {
+        jit_var_dec_ref(jit_var_reduce(x, ReduceOp::Add));
+        jit_sync_thread();
+    }));
+
+    jit_var_dec_ref(x);
+    jit_var_dec_ref(a);
+    jit_var_dec_ref(b);
+}
+
+// ==========================================================================
+//                      Gathers with software prefetching
+// ==========================================================================
+
+/**
+ * Throughput of random gathers from a table that does not fit into the cache
+ * as a function of the prefetch distance (0: JitFlag::GatherPrefetch is
+ * disabled). The fastest distance is adopted for the rest of the session.
+ */
+static void bench_gather_prefetch(uint32_t table_size, uint32_t size) {
+    Float table = arange<Float>(table_size);
+    UInt32 index = (arange<UInt32>(size) * 2654435761u) % table_size;
+    table.schedule();
+    index.schedule();
+    jit_eval();
+
+    uint32_t best_distance = 0;
+    double best_ms = 1e30;
+    for (uint32_t distance : { 0u, 1u, 2u, 4u, 8u, 16u, 32u, 64u }) {
+        jit_set_flag(JitFlag::GatherPrefetch, distance != 0);
+        if (distance)
+            jit_llvm_set_prefetch_distance(distance);
+
+        auto gather_kernel = [&] {
+            Float y = gather(table, UInt32(index + 1u)) * 2.f;
+            y.eval();
+            jit_sync_thread();
+        };
+        gather_kernel(); // compile
+
+        double ms = best_of(5, gather_kernel);
+        report("gather.prefetch." + std::to_string(distance), size,
+               size / (ms * 1e3), "Melem/s");
+        if (ms < best_ms) {
+            best_ms = ms;
+            best_distance = distance;
+        }
+    }
+
+    report("gather.prefetch.best", size, best_distance, "packets");
+    jit_set_flag(JitFlag::GatherPrefetch, best_distance != 0);
+    if (best_distance)
+        jit_llvm_set_prefetch_distance(best_distance);
+}
+
+// ==========================================================================
+//                         Virtual function calls
+// ==========================================================================
+
+struct Base {
+    virtual ~Base() = default;
+    virtual Float f(const Float &x) = 0;
+};
+
+struct Impl : Base {
+    float scale;
+    Impl(float scale) : scale(scale) { }
+    Float f(const Float &x) override { return x * scale + 1.f; }
+};
+
+/// Record a call of Base::f() on the instances referenced by 'self'
+static Float vcall_f(uint32_t n_inst, const LLVMArray<Base *> &self,
+                     const Float &x) {
+    jit_new_scope(JitBackend::LLVM);
+
+    Mask mask = true;
+    Float x_wrapped = Float::steal(jit_var_wrap_vcall(x.index()));
+
+    // jit_var_vcall() expects an extra reference to each input
+    dr_index_vector indices_in, indices_out_all;
+    indices_in.push_back(x_wrapped.index());
+    dr_vector<uint32_t> state(n_inst + 1, 0), inst_id(n_inst, 0);
+
+    detail::JitState<JitBackend::LLVM> jit_state;
+    jit_state.begin_recording();
+    state[0] = jit_record_checkpoint(JitBackend::LLVM);
+
+    for (uint32_t i = 1; i <= n_inst; ++i) {
+        Base *base = (Base *) jit_registry_get_ptr(JitBackend::LLVM, "Base", i);
+        jit_state.set_self(i);
+
+        Mask vcall_mask = Mask::steal(jit_var_vcall_mask(JitBackend::LLVM));
+        jit_state.set_mask(vcall_mask.index());
+        indices_out_all.push_back(base->f(x_wrapped).index());
+        jit_state.clear_mask();
+
+        state[i] = jit_record_checkpoint(JitBackend::LLVM);
+        inst_id[i - 1] = i;
+    }
+
+    uint32_t index_out = 0;
+    uint32_t se = jit_var_vcall(
+        "Base", self.index(), mask.index(), n_inst, inst_id.data(), 1,
+        indices_in.data(), (uint32_t) indices_out_all.size(), indices_out_all.data(),
+        state.data(), &index_out);
+
+    jit_state.end_recording();
+    jit_var_mark_side_effect(se);
+    jit_new_scope(JitBackend::LLVM);
+
+    return Float::steal(index_out);
+}
+
+/// Dispatch to 'n_inst' instances (recording + evaluation on a cache hit)
+static void bench_vcall(uint32_t n_inst, uint32_t size) {
+    std::vector<Impl *> inst;
+    for (uint32_t i = 0; i < n_inst; ++i) {
+        inst.push_back(new Impl((float) (i + 1)));
+        jit_registry_put(JitBackend::LLVM, "Base", inst.back());
+    }
+
+    UInt32 index = arange<UInt32>(size);
+    LLVMArray<Base *> self = index % n_inst + 1;
+    Float x = Float(index);
+    jit_var_schedule(self.index());
+    jit_var_schedule(x.index());
+    jit_eval();
+
+    auto run = [&] {
+        Float y = vcall_f(n_inst, self, x);
+        y.eval();
+        jit_sync_thread();
+    };
+
+    run(); // compile
+    report("vcall.dispatch", n_inst, best_of(5, run), "ms");
+
+    for (Impl *i : inst) {
+        jit_registry_remove(JitBackend::LLVM, i);
+        delete i;
+    }
+}
+
+// ==========================================================================
+//                             Recorded loops
+// ==========================================================================
+
+static void bench_loop(uint32_t size, uint32_t iterations) {
+    auto run = [&] {
+        UInt32 i = arange<UInt32>(size) % iterations;
+        Float x = 0.f;
+
+        Loop<Mask> loop("Bench", i, x);
+        while (loop(i < iterations)) {
+            x = x * 0.5f + Float(i);
+            i += 1;
+        }
+        x.eval();
+        jit_sync_thread();
+    };
+
+    run(); // compile
+    report("loop.recorded", size, best_of(5, run), "ms");
+}
+
+// ==========================================================================
+
+static void write_json(FILE *f) {
+    fprintf(f, "{\n  \"backend\": \"llvm\",\n  \"threads\": %u,\n"
+               "  \"results\": [\n", thread_count);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &r = results[i];
+        fprintf(f,
+                "    {\"name\": \"%s\", \"size\": %llu, \"threads\": %u, "
+                "\"value\": %.6g, \"unit\": \"%s\"}%s\n",
+                r.name.c_str(), (unsigned long long) r.size, r.threads,
+                r.value, r.unit, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+}
+
+int main(int argc, char **argv) {
+    jit_set_log_level_stderr(LogLevel::Warn);
+    jit_init((uint32_t) JitBackend::LLVM);
+    if (!jit_has_backend(JitBackend::LLVM)) {
+        fprintf(stderr, "LLVM backend is unavailable.\n");
+        return 1;
+    }
+
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+    bench_trace(100000);
+    bench_eval_deep(20000);
+    bench_eval_wide(2000);
+
+    for (uint32_t ops : { 16u, 256u, 4096u })
+        bench_compile(ops);
+
+    std::vector<uint32_t> threads = { 1 };
+    for (uint32_t t = 4; t < thread_count; t *= 4)
+        threads.push_back(t);
+    if (thread_count > 1)
+        threads.push_back(thread_count);
+
+    for (uint32_t t : threads)
+        for (uint32_t size : { 1u << 16, 1u << 20, 1u << 24 })
+            bench_primitives(size, t);
+    jit_llvm_set_thread_count(thread_count);
+
+    bench_storage(1u << 24, VarType::Float16, "f16");
+    bench_storage(1u << 24, VarType::Float32, "f32");
+
+    for (uint32_t n_inst : { 1u, 4u, 16u, 64u })
+        bench_vcall(n_inst, 1u << 20);
+
+    bench_loop(1u << 20, 64);
+
+    bench_gather_prefetch(1u << 26, 1u << 22);
+
+    if (argc > 1) {
+        FILE *f = fopen(argv[1], "w");
+        if (!f) {
+            fprintf(stderr, "Could not open \"%s\".\n", argv[1]);
+            return 1;
+        }
+        write_json(f);
+        fclose(f);
+    } else {
+        write_json(stdout);
+    }
+
+    jit_shutdown();
+    return 0;
+}
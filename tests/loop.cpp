@@ -347,3 +347,67 @@ TEST_BOTH(10_eval_side_effect_in_loop) {
         jit_assert(strcmp(j.str(), "[12, 13, 11]") == 0);
     }
 }
+
+TEST_LLVM(11_loop_refill) {
+    // Loop with strongly divergent trip counts, evaluated with lane refilling
+    for (uint32_t i = 0; i < 3; ++i) {
+        jit_set_flag(JitFlag::LoopRecord, true);
+        jit_set_flag(JitFlag::LoopOptimize, i == 2);
+        jit_set_flag(JitFlag::LoopRefill, i != 0);
+
+        UInt32 x = arange<UInt32>(1000) + 1, count = 0;
+        Float z = 0.f;
+
+        Loop<Mask> loop("Collatz", x, count, z);
+        while (loop(neq(x, 1))) {
+            Mask is_even = eq(x & UInt32(1), 0);
+            x = select(is_even, x / 2, x*3 + 1);
+            count += 1;
+            z += 0.5f;
+        }
+
+        UInt32 w = count * 2 + arange<UInt32>(1000);
+        jit_var_schedule(count.index());
+        jit_var_schedule(z.index());
+        jit_var_schedule(w.index());
+        jit_eval();
+
+        jit_assert(strcmp(count.str(), "[0, 1, 7, 2, 5, .. 990 skipped .., 49, 49, 49, 49, 111]") == 0);
+        jit_assert(hmax(count) == UInt32(178));
+        jit_assert(Float(count) * .5f == z);
+        jit_assert(w == count * 2 + arange<UInt32>(1000));
+    }
+    jit_set_flag(JitFlag::LoopRefill, false);
+}
+
+TEST_LLVM(12_loop_packet_split) {
+    /* Loop within a kernel that is split into full packets and a masked
+       tail. The tail renders the loop (labels, phi nodes) a second time */
+    UInt32 ref;
+    for (uint32_t i = 0; i < 3; ++i) {
+        jit_set_flag(JitFlag::LoopRecord, true);
+        jit_set_flag(JitFlag::LoopOptimize, i == 2);
+        jit_set_flag(JitFlag::PacketSplit, i != 0);
+
+        UInt32 x = arange<UInt32>(1003) + 1, count = 0,
+               target = zero<UInt32>(1003);
+
+        Loop<Mask> loop("Collatz", x, count);
+        while (loop(neq(x, 1))) {
+            scatter_reduce(ReduceOp::Add, target, UInt32(1), arange<UInt32>(1003));
+            Mask is_even = eq(x & UInt32(1), 0);
+            x = select(is_even, x / 2, x*3 + 1);
+            count += 1;
+        }
+
+        jit_var_schedule(count.index());
+        jit_eval();
+
+        if (i == 0)
+            ref = count;
+        jit_assert(hmax(count) == UInt32(178));
+        jit_assert(count == ref);
+        jit_assert(target == count);
+    }
+    jit_set_flag(JitFlag::PacketSplit, false);
+}
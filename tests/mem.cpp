@@ -1,5 +1,7 @@
 #include "test.h"
+#include <algorithm>
 #include <cstring>
+#include <vector>
 
 TEST_BOTH(01_gather) {
     Int32 r = arange<Int32>(100) + 100;
@@ -232,3 +234,369 @@ TEST_BOTH(15_gather_symbolic_multiple_mask) {
     Float buf_2 = gather<Float>(buf_1, index_2, mask_2);
     jit_assert(strcmp(buf_2.str(), "[1, 2, 0, 0]") == 0);
 }
+
+/// Gather in reverse order and scatter to every other entry (tests 16 and 17)
+static void gather_scatter_check(uint32_t size) {
+    using Float = FloatL;
+    using UInt32 = UInt32L;
+
+    UInt32 index = arange<UInt32>(size);
+    Float source = Float(index) * 2.f;
+    jit_var_schedule(source.index());
+    jit_eval();
+
+    Float result = gather<Float>(source, UInt32(size - 1) - index) + 1.f;
+    UInt32 target = zero<UInt32>(size + 1);
+    scatter(target, index + 1, index, neq(index & UInt32(1), 0));
+    jit_var_schedule(result.index());
+    jit_var_schedule(target.index());
+    jit_eval();
+
+    jit_assert(result == Float(UInt32(size - 1) - index) * 2.f + 1.f);
+    jit_assert(gather<UInt32>(target, index) ==
+               select(neq(index & UInt32(1), 0), index + 1, UInt32(0)));
+    jit_assert(gather<UInt32>(target, UInt32(size)) == UInt32(0));
+}
+
+TEST_LLVM(16_gather_scatter_packet_split) {
+    /* Main loop over full packets and masked tail. The sizes cover kernels
+       without full packets, without a tail, and with both */
+    jit_set_flag(JitFlag::PacketSplit, true);
+    uint32_t sizes[] = { 3, 16, 64, 67, 1001 };
+    for (uint32_t size : sizes)
+        gather_scatter_check(size);
+    jit_set_flag(JitFlag::PacketSplit, false);
+}
+
+TEST_LLVM(17_gather_scatter_autotune) {
+    /* The first launches of this kernel alternate between the candidate
+       vector widths, after which the fastest variant is pinned */
+    uint32_t candidates = 0;
+    for (uint32_t w = jit_llvm_vector_width(); w >= 4 && candidates < 3; w /= 2)
+        candidates++;
+
+    jit_kernel_history_clear();
+    jit_set_flag(JitFlag::KernelHistory, true);
+    jit_set_flag(JitFlag::KernelAutotune, true);
+    for (uint32_t i = 0; i < 12; ++i)
+        gather_scatter_check(1001);
+    jit_set_flag(JitFlag::KernelAutotune, false);
+    jit_set_flag(JitFlag::KernelHistory, false);
+
+    // Collect the variants of the gather/scatter kernel in launch order
+    std::vector<uint64_t> launches;
+    KernelHistoryEntry *history = jit_kernel_history();
+    for (KernelHistoryEntry *e = history; e->backend != JitBackend::Invalid; ++e) {
+        if (e->type == KernelType::JIT && e->size == 1001 && e->output_count == 2)
+            launches.push_back(e->hash[0]);
+        free(e->ir);
+    }
+    free(history);
+
+    jit_assert(launches.size() == 12);
+    std::vector<uint64_t> variants = launches;
+    std::sort(variants.begin(), variants.end());
+    variants.erase(std::unique(variants.begin(), variants.end()), variants.end());
+
+    if (variants.size() == 1) {
+        // The width was pinned by an earlier session ('.llvm.tune' record)
+        return;
+    }
+
+    // Each candidate is timed DRJIT_AUTOTUNE_LAUNCHES (3) times, then pinned
+    jit_assert(variants.size() == candidates);
+    for (uint32_t i = 0; i + 1 < 3 * candidates; ++i)
+        jit_assert(launches[i] != launches[i + 1]);
+    for (uint32_t i = 3 * candidates; i < 12; ++i)
+        jit_assert(launches[i] == launches[11]);
+}
+
+TEST_LLVM(18_alloc_profile) {
+    jit_alloc_profile_start();
+
+    jit_prefix_push(Backend, "stage");
+    void *ptr = jit_malloc(AllocType::Host, 1000);
+    jit_prefix_pop(Backend);
+
+    // Every distinct prefix receives its own tag
+    jit_prefix_push(Backend, "other");
+    void *ptr_2 = jit_malloc(AllocType::Host, 2000);
+    jit_prefix_pop(Backend);
+
+    UInt32 value = arange<UInt32>(1000);
+    value.eval();
+
+    size_t count = 0, kernel_live = 0, stage_live = 0, stage_peak = 0,
+           other_live = 0;
+    AllocProfileEntry *entries = jit_alloc_profile(&count);
+    for (size_t i = 0; i < count; ++i) {
+        if (entries[i].kernel) {
+            jit_assert(strncmp(entries[i].tag, "kernel ", 7) == 0);
+            kernel_live += entries[i].live;
+        } else if (strncmp(entries[i].tag, "stage", 5) == 0) {
+            stage_live = entries[i].live;
+            stage_peak = entries[i].peak;
+        } else if (strncmp(entries[i].tag, "other", 5) == 0) {
+            other_live = entries[i].live;
+        }
+    }
+    free(entries);
+
+    jit_assert(stage_live == 1024 && stage_peak == 1024 && other_live == 2048);
+    jit_free(ptr_2);
+    jit_assert(kernel_live >= 4000);
+
+    // Released memory is attributed to the allocation cache
+    size_t cache_before = 0, cache_after = 0, cache_peak = 0;
+    jit_alloc_profile_cache(&cache_before, nullptr);
+    jit_free(ptr);
+    jit_alloc_profile_cache(&cache_after, &cache_peak);
+    jit_assert(cache_after == cache_before + 1024 && cache_peak >= cache_after);
+
+    entries = jit_alloc_profile(&count);
+    for (size_t i = 0; i < count; ++i) {
+        if (strncmp(entries[i].tag, "stage", 5) == 0)
+            jit_assert(entries[i].live == 0 && entries[i].peak == 1024 &&
+                       entries[i].count == 1);
+    }
+    free(entries);
+
+    jit_assert(jit_alloc_profile_dump("alloc_profile.json") == 1);
+    FILE *f = fopen("alloc_profile.json", "r");
+    jit_assert(f);
+    char buf[512];
+    size_t size = fread(buf, 1, sizeof(buf) - 1, f);
+    buf[size] = '\0';
+    fclose(f);
+    jit_assert(buf[0] == '{' && strstr(buf, "\"pinned\": {") != nullptr);
+    remove("alloc_profile.json");
+
+    jit_alloc_profile_stop();
+    jit_alloc_profile_clear();
+}
+
+TEST_LLVM(19_numa) {
+    /* Kernels must produce the same results when their blocks are reordered
+       by the NUMA mode (this is a no-op on machines with a single node) */
+    jit_llvm_set_numa(1);
+    jit_assert(jit_llvm_numa_node_count() >= 1);
+    jit_assert(jit_llvm_numa() == (jit_llvm_numa_node_count() > 1 ? 1 : 0));
+
+    uint32_t size = 3000000;
+    UInt32 index = arange<UInt32>(size);
+    Float value = Float(index) * 2.f;
+    jit_var_schedule(value.index());
+    jit_eval();
+
+    UInt32 check = UInt32(gather<Float>(value, index) * .5f);
+    jit_assert(all(eq(check, index)));
+
+    jit_llvm_set_numa(0);
+    jit_assert(jit_llvm_numa() == 0);
+}
+
+TEST_LLVM(20_map_file) {
+    const char *filename = "test_map_file.bin";
+    const uint32_t size = 1024;
+
+    // Produce a file with a header of 64 bytes followed by 'size' floats
+    Float value = Float(arange<UInt32>(size)) * 2.f;
+    jit_var_eval_to_file(value.index(), filename, 64);
+    jit_assert(jit_var_is_evaluated(value.index()));
+
+    // Evaluating an array that is already evaluated copies it once
+    UInt32 index = arange<UInt32>(size);
+    index.eval();
+    jit_var_eval_to_file(index.index(), filename, 64 + size * sizeof(float));
+    jit_sync_thread();
+
+    {
+        Float value_2 = Float::steal(jit_var_map_file(
+            Backend, VarType::Float32, filename, 64, size, JitFileMode::Read));
+        UInt32 index_2 = UInt32::steal(
+            jit_var_map_file(Backend, VarType::UInt32, filename,
+                             64 + size * sizeof(float), size, JitFileMode::Read));
+        jit_assert(all(eq(value_2, Float(index) * 2.f)));
+        jit_assert(all(eq(index_2, index)));
+
+        // Read-only mappings are copied before being modified
+        UInt32 reversed = UInt32(size - 1) - arange<UInt32>(size);
+        jit_assert(all(eq(gather<Float>(value_2, reversed) * .5f,
+                          Float(reversed))));
+        scatter(value_2, Float(-1.f), UInt32(0));
+        jit_assert(all(eq(gather<Float>(value_2, UInt32(0, 1)), Float(-1.f, 2.f))));
+
+        // Copy-on-write mappings may be modified without affecting the file
+        Float value_3 = Float::steal(jit_var_map_file(
+            Backend, VarType::Float32, filename, 64, size, JitFileMode::CopyOnWrite));
+        float five = 5.f, result = 0.f;
+        Float value_4 = Float::steal(jit_var_write(value_3.index(), 1, &five));
+        jit_var_read(value_4.index(), 1, &result);
+        jit_assert(result == 5.f);
+    }
+
+    value = Float();
+    index = UInt32();
+    jit_sync_thread();
+
+    FILE *f = fopen(filename, "rb");
+    jit_assert(f);
+    float data[size];
+    jit_assert(fseek(f, 64, SEEK_SET) == 0);
+    jit_assert(fread(data, sizeof(float), size, f) == size);
+    fclose(f);
+    remove(filename);
+
+    for (uint32_t i = 0; i < size; ++i)
+        jit_assert(data[i] == i * 2.f);
+}
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <exception>
+
+TEST_BOTH(21_save_load) {
+    const char *filename = "test_save_load.bin";
+    int fd = open(filename, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    jit_assert(fd >= 0);
+
+    // Multi-chunk arrays with compressible and incompressible contents
+    uint32_t size = 3000000;
+    UInt32 a = arange<UInt32>(size) / 1000,
+           b = arange<UInt32>(size) * 2654435761u;
+    Float c = Float(arange<UInt32>(size)) * .25f;
+    Mask d = eq(arange<UInt32>(123) & UInt32(1), UInt32(0));
+
+    jit_var_save(a.index(), fd, 1);
+    jit_var_save(b.index(), fd, 1);
+    jit_var_save(c.index(), fd, 0);
+    jit_var_save(d.index(), fd, 1);
+    close(fd);
+
+    fd = open(filename, O_RDONLY);
+    jit_assert(fd >= 0);
+    UInt32 a2 = UInt32::steal(jit_var_load(Backend, fd)),
+           b2 = UInt32::steal(jit_var_load(Backend, fd));
+    Float c2 = Float::steal(jit_var_load(Backend, fd));
+    Mask d2 = Mask::steal(jit_var_load(Backend, fd));
+
+    // Reading past the end of the file fails
+    bool failed = false;
+    try {
+        jit_var_load(Backend, fd);
+    } catch (const std::exception &) {
+        failed = true;
+    }
+    jit_assert(failed);
+    close(fd);
+    remove(filename);
+
+    jit_assert(jit_var_size(a2.index()) == size &&
+               jit_var_type(c2.index()) == VarType::Float32 &&
+               jit_var_size(d2.index()) == 123);
+    jit_assert(all(eq(a, a2)) && all(eq(b, b2)) && all(eq(c, c2)) &&
+               all(eq(d, d2)));
+}
+#endif
+
+TEST_LLVM(22_malloc_budget) {
+    jit_flush_malloc_cache();
+    jit_alloc_profile_start();
+    jit_malloc_set_budget(AllocType::Host, 1024 * 1024 * 1024);
+
+    // Populate the cache, the 16 KiB block is released first
+    const int order[8] = { 4, 0, 1, 2, 3, 5, 6, 7 };
+    void *ptrs[8];
+    for (int i = 0; i < 8; ++i)
+        ptrs[i] = jit_malloc(AllocType::Host, (size_t) 1024 << i);
+    for (int i = 0; i < 8; ++i)
+        jit_free(ptrs[order[i]]);
+
+    size_t cache = 0;
+    jit_alloc_profile_cache(&cache, nullptr);
+    jit_assert(cache == 255 * 1024);
+
+    // Least recently released blocks are evicted until 3/4 of the budget remain
+    jit_malloc_set_budget(AllocType::Host, 200 * 1024);
+    jit_assert(jit_malloc_budget(AllocType::Host) == 200 * 1024);
+    jit_alloc_profile_cache(&cache, nullptr);
+    jit_assert(cache == 128 * 1024);
+
+    // Exceeding the budget trims the cache, but the allocation still succeeds
+    void *ptr = jit_malloc(AllocType::Host, 256 * 1024);
+    jit_alloc_profile_cache(&cache, nullptr);
+    jit_assert(ptr && cache == 0);
+    jit_free(ptr);
+
+    // Large cached host blocks are released lazily and can still be reused
+    jit_malloc_set_budget(AllocType::Host, 5 * 1024 * 1024);
+    ptr = jit_malloc(AllocType::Host, 4 * 1024 * 1024);
+    jit_free(ptr);
+    void *ptr_2 = jit_malloc(AllocType::Host, 2 * 1024 * 1024);
+    void *ptr_3 = jit_malloc(AllocType::Host, 4 * 1024 * 1024);
+    jit_assert(ptr_3 == ptr);
+    memset(ptr_3, 1, 4 * 1024 * 1024);
+    jit_assert(((uint8_t *) ptr_3)[12345] == 1);
+    jit_free(ptr_2);
+    jit_free(ptr_3);
+
+    jit_malloc_set_budget(AllocType::Host, 0);
+    jit_alloc_profile_stop();
+    jit_flush_malloc_cache();
+}
+
+TEST_LLVM(23_map_file_partial_packet) {
+    /* Regions whose size is not a multiple of the packet size. The bytes
+       following the region must be preserved, and the last packet may not
+       fault when the region ends close to a page boundary. */
+    using UInt8 = Array<uint8_t>;
+    using UInt64 = Array<uint64_t>;
+    const char *filename = "test_map_file_partial_packet.bin";
+    uint8_t pattern[1024];
+    for (uint32_t i = 0; i < 1024; ++i)
+        pattern[i] = (uint8_t) (i * 7 + 3);
+
+    FILE *f = fopen(filename, "wb");
+    jit_assert(f && fwrite(pattern, 1, 1024, f) == 1024);
+    fclose(f);
+
+    Float value = Float(arange<UInt32>(100)) + 1.f;
+    jit_var_eval_to_file(value.index(), filename, 0);
+    value = Float();
+    jit_sync_thread();
+
+    uint8_t data[1024];
+    f = fopen(filename, "rb");
+    jit_assert(f && fread(data, 1, 1024, f) == 1024);
+    fclose(f);
+    for (uint32_t i = 0; i < 100; ++i) {
+        float expected = i + 1.f;
+        jit_assert(memcmp(data + i * 4, &expected, 4) == 0);
+    }
+    jit_assert(memcmp(data + 400, pattern + 400, 1024 - 400) == 0);
+    remove(filename);
+
+    // Region (and file) ending 16 bytes before a page boundary
+    const uint32_t size = 502;
+    UInt64 value_2 = UInt64(arange<UInt32>(size)) * 3u;
+    jit_var_eval_to_file(value_2.index(), filename, 64);
+    value_2 = UInt64();
+    jit_sync_thread();
+
+    UInt64 value_3 = UInt64::steal(jit_var_map_file(
+        Backend, VarType::UInt64, filename, 64, size, JitFileMode::Read));
+    jit_assert(all(eq(value_3, UInt64(arange<UInt32>(size)) * 3u)));
+    value_3 = UInt64();
+
+    // Gathers from an 8-bit array at the end of a page read 4 bytes
+    f = fopen(filename, "ab");
+    jit_assert(f && fwrite(pattern, 1, 16, f) == 16);
+    fclose(f);
+    UInt8 last = UInt8::steal(jit_var_map_file(
+        Backend, VarType::UInt8, filename, 64 + size * 8 + 15, 1, JitFileMode::Read));
+    jit_assert(gather<UInt8>(last, UInt32(0)).read(0) == pattern[15]);
+    last = UInt8();
+    jit_sync_thread();
+    remove(filename);
+}
@@ -1,5 +1,10 @@
 #include "test.h"
 #include <algorithm>
+#include <vector>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <thread>
 
 TEST_BOTH(01_all_any) {
     using Bool = Array<bool>;
@@ -329,3 +334,324 @@ TEST_BOTH(12_block_ops) {
     jit_log(Info, "block_sum:  %s\n", block_sum(a, 3).str());
 }
 #endif
+
+struct TileCheck {
+    uint32_t calls = 0;
+    std::vector<float> values;
+};
+
+TEST_BOTH(13_eval_tiled) {
+    uint32_t size = 100000;
+    Float source = Float(arange<UInt32>(size)) * 2.f;
+    source.eval();
+
+    UInt32 index = arange<UInt32>(size);
+    Float value = gather<Float>(source, UInt32(size - 1) - index) + 1.f;
+
+    TileCheck check;
+    check.values.resize(size);
+
+    auto sink = [](void *payload, uint32_t offset, uint32_t size,
+                   const uint32_t *tiles) {
+        TileCheck *c = (TileCheck *) payload;
+        c->calls++;
+        jit_memcpy(Backend, c->values.data() + offset, jit_var_ptr(tiles[0]),
+                   size * sizeof(float));
+    };
+
+    // Unrelated pending work is not evaluated along with the tiles
+    Float unrelated = source + 3.f;
+    jit_var_schedule(unrelated.index());
+
+    uint32_t value_index = value.index();
+    jit_var_eval_tiled(1, &value_index, 4096, sink, &check);
+    jit_assert(!jit_var_is_evaluated(unrelated.index()));
+    jit_eval();
+    jit_assert(jit_var_is_evaluated(unrelated.index()) &&
+               unrelated.read(5) == 13.f);
+
+    jit_assert(check.calls == (size + 4095) / 4096);
+    for (uint32_t i = 0; i < size; ++i)
+        jit_assert(check.values[i] == (float) (2 * (size - 1 - i) + 1));
+
+    // The original variable was not materialized
+    jit_assert(!jit_var_is_evaluated(value_index));
+
+    // Reductions of tiles are combined
+    UInt32 expr = arange<UInt32>(50000) * 3 + 1;
+    UInt32 sum = UInt32::steal(
+        jit_var_reduce_tiled(expr.index(), ReduceOp::Add, 1000));
+    UInt32 max = UInt32::steal(
+        jit_var_reduce_tiled(expr.index(), ReduceOp::Max, 1000));
+    jit_assert(sum.read(0) == 3749975000u);
+    jit_assert(max.read(0) == 149998u);
+
+    /* Variables with callbacks can't be split into tiles and are
+       evaluated as a single tile */
+    UInt32 shifted = index + 1;
+    jit_var_set_callback(shifted.index(), [](uint32_t, int, void *) { },
+                         nullptr);
+    uint32_t shifted_index = shifted.index();
+    check.calls = 0;
+    jit_var_eval_tiled(1, &shifted_index, 4096,
+                       [](void *payload, uint32_t offset, uint32_t size,
+                          const uint32_t *) {
+                           TileCheck *c = (TileCheck *) payload;
+                           c->calls++;
+                           jit_assert(offset == 0 && size == 100000);
+                       }, &check);
+    jit_assert(check.calls == 1 && shifted.read(7) == 8);
+}
+
+template <typename T> void test_sort(VarType type, uint32_t size) {
+    T *keys = (T *) jit_malloc(AllocType::Host, size * sizeof(T)),
+      *sorted = (T *) jit_malloc(AllocType::Host, size * sizeof(T));
+    uint32_t *perm = (uint32_t *) jit_malloc(AllocType::Host, size * sizeof(uint32_t)),
+             *payload = (uint32_t *) jit_malloc(AllocType::Host, size * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < size; ++i) {
+        uint64_t r = ((uint64_t) rand() << 32) ^ ((uint64_t) rand() << 8) ^ (uint64_t) rand();
+        if constexpr (std::is_floating_point<T>::value)
+            keys[i] = (T) ((double) (int64_t) (r % 2000001) - 1000000.0) * (T) 0.37;
+        else
+            keys[i] = (T) r;
+        payload[i] = size - i;
+    }
+
+    // Duplicate keys must retain their order
+    if (size > 10)
+        keys[3] = keys[7] = keys[size - 1];
+
+    std::vector<uint32_t> ref(size);
+    for (uint32_t i = 0; i < size; ++i)
+        ref[i] = i;
+    std::stable_sort(ref.begin(), ref.end(),
+                     [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+
+    jit_argsort(JitBackend::LLVM, type, keys, size, perm);
+    jit_sort(JitBackend::LLVM, type, keys, sorted, payload, payload, size);
+    jit_sync_thread();
+
+    for (uint32_t i = 0; i < size; ++i) {
+        jit_assert(perm[i] == ref[i]);
+        jit_assert(sorted[i] == keys[ref[i]]);
+        jit_assert(payload[i] == size - ref[i]);
+    }
+
+    // In-place sort without payload
+    jit_sort(JitBackend::LLVM, type, keys, keys, nullptr, nullptr, size);
+    jit_sync_thread();
+    jit_assert(memcmp(keys, sorted, size * sizeof(T)) == 0);
+
+    jit_free(keys);
+    jit_free(sorted);
+    jit_free(perm);
+    jit_free(payload);
+}
+
+TEST_LLVM(14_sort) {
+    srand(0);
+    for (uint32_t size : { 1u, 10u, 1000u, 100000u, 300001u }) {
+        test_sort<uint32_t>(VarType::UInt32, size);
+        test_sort<int32_t>(VarType::Int32, size);
+        test_sort<float>(VarType::Float32, size);
+        test_sort<uint64_t>(VarType::UInt64, size);
+        test_sort<int64_t>(VarType::Int64, size);
+        test_sort<double>(VarType::Float64, size);
+        test_sort<int8_t>(VarType::Int8, size);
+        test_sort<uint16_t>(VarType::UInt16, size);
+    }
+
+    // Keys that only differ in a few digits, special floating point values
+    float values[6] = { 1.f, -0.f, -INFINITY, 0.f, INFINITY, -2.f },
+          expected[6] = { -INFINITY, -2.f, -0.f, 0.f, 1.f, INFINITY };
+    jit_sort(JitBackend::LLVM, VarType::Float32, values, values, nullptr,
+             nullptr, 6);
+    jit_sync_thread();
+    jit_assert(memcmp(values, expected, sizeof(values)) == 0);
+
+    /* Sort on a thread that has not used the LLVM backend before. The
+       result must be available right after jit_sync_thread() */
+    std::thread([] {
+        uint32_t size = 100000;
+        uint32_t *keys = (uint32_t *) jit_malloc(AllocType::Host, size * sizeof(uint32_t));
+        for (uint32_t i = 0; i < size; ++i)
+            keys[i] = size - 1 - i;
+        jit_sort(JitBackend::LLVM, VarType::UInt32, keys, keys, nullptr,
+                 nullptr, size);
+        jit_sync_thread();
+        for (uint32_t i = 0; i < size; ++i)
+            jit_assert(keys[i] == i);
+        jit_free(keys);
+    }).join();
+}
+
+TEST_LLVM(15_segmented) {
+    srand(0);
+
+    // Skewed segment lengths: many short and empty segments, a few long ones
+    std::vector<uint32_t> offsets { 5 };
+    for (uint32_t i = 0; i < 2000; ++i) {
+        uint32_t r = rand() % 100, length = r < 20 ? 0 : (r < 98 ? r : 100000 + r);
+        offsets.push_back(offsets.back() + length);
+    }
+    uint32_t n = (uint32_t) offsets.size() - 1, size = offsets.back() + 3;
+
+    uint32_t *offsets_p = (uint32_t *) jit_malloc(AllocType::Host, (n + 1) * sizeof(uint32_t));
+    memcpy(offsets_p, offsets.data(), (n + 1) * sizeof(uint32_t));
+
+    int32_t *in = (int32_t *) jit_malloc(AllocType::Host, size * sizeof(int32_t)),
+            *out = (int32_t *) jit_malloc(AllocType::Host, size * sizeof(int32_t));
+    for (uint32_t i = 0; i < size; ++i)
+        in[i] = rand() % 1000 - 500;
+
+    for (ReduceOp op : { ReduceOp::Add, ReduceOp::Min, ReduceOp::Or }) {
+        auto apply = [op](int32_t a, int32_t b) {
+            return op == ReduceOp::Add ? a + b : (op == ReduceOp::Min ? std::min(a, b) : (a | b));
+        };
+        int32_t identity = op == ReduceOp::Min ? std::numeric_limits<int32_t>::max() : 0;
+
+        jit_segmented_reduce(JitBackend::LLVM, VarType::Int32, op, in, offsets_p, n, out);
+        jit_sync_thread();
+        for (uint32_t i = 0; i < n; ++i) {
+            int32_t ref = identity;
+            for (uint32_t j = offsets[i]; j < offsets[i + 1]; ++j)
+                ref = apply(ref, in[j]);
+            jit_assert(out[i] == ref);
+        }
+
+        for (int exclusive = 0; exclusive < 2; ++exclusive) {
+            for (uint32_t i = 0; i < size; ++i)
+                out[i] = 12345;
+
+            jit_segmented_prefix_sum(JitBackend::LLVM, VarType::Int32, op,
+                                     exclusive, in, offsets_p, n, out);
+            jit_sync_thread();
+
+            jit_assert(out[0] == 12345 && out[size - 1] == 12345);
+            for (uint32_t i = 0; i < n; ++i) {
+                int32_t accum = identity;
+                for (uint32_t j = offsets[i]; j < offsets[i + 1]; ++j) {
+                    int32_t next = apply(accum, in[j]);
+                    jit_assert(out[j] == (exclusive ? accum : next));
+                    accum = next;
+                }
+            }
+        }
+    }
+
+    jit_free(offsets_p);
+    jit_free(in);
+    jit_free(out);
+}
+
+TEST_LLVM(16_segmented_mkperm) {
+    /* Reduce the buckets found by jit_mkperm(). Its offsets are quadruples
+       (bucket, start, size, unused), whose 'start' fields along with the
+       total size form the offset array expected by jit_segmented_reduce() */
+    srand(1);
+    uint32_t size = 200000, bucket_count = 1000;
+
+    uint32_t *values = (uint32_t *) jit_malloc(AllocType::Host, size * sizeof(uint32_t)),
+             *perm = (uint32_t *) jit_malloc(AllocType::Host, size * sizeof(uint32_t)),
+             *quad = (uint32_t *) jit_malloc(AllocType::Host, (bucket_count * 4 + 1) * sizeof(uint32_t));
+    std::vector<uint32_t> ref(bucket_count, 0);
+    for (uint32_t i = 0; i < size; ++i) {
+        values[i] = (uint32_t) rand() % bucket_count;
+        ref[values[i]] += i;
+    }
+
+    uint32_t n = jit_mkperm(JitBackend::LLVM, values, size, bucket_count,
+                            perm, quad);
+    jit_assert(n > 0 && n <= bucket_count);
+
+    uint32_t *offsets = (uint32_t *) jit_malloc(AllocType::Host, (n + 1) * sizeof(uint32_t)),
+             *offsets_async = (uint32_t *) jit_malloc(AllocType::Host, (n + 1) * sizeof(uint32_t)),
+             *out = (uint32_t *) jit_malloc(AllocType::Host, n * sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; ++i)
+        offsets[i] = quad[i * 4 + 1];
+    offsets[n] = size;
+
+    // Use a single block, and several blocks that are combined afterwards
+    for (uint32_t threads : { 1u, 4u }) {
+        jit_llvm_set_thread_count(threads);
+
+        /* The offsets are produced by a queued copy, the reduction must not
+           read them before the copy has run */
+        memset(offsets_async, 0, (n + 1) * sizeof(uint32_t));
+        jit_memcpy_async(JitBackend::LLVM, offsets_async, offsets,
+                         (n + 1) * sizeof(uint32_t));
+
+        // The permutation itself is the array being reduced (sums of indices)
+        jit_segmented_reduce(JitBackend::LLVM, VarType::UInt32, ReduceOp::Add,
+                             perm, offsets_async, n, out);
+        jit_sync_thread();
+
+        for (uint32_t i = 0; i < n; ++i)
+            jit_assert(out[i] == ref[quad[i * 4]]);
+    }
+    jit_llvm_set_thread_count(std::thread::hardware_concurrency());
+
+    jit_free(values);
+    jit_free(perm);
+    jit_free(quad);
+    jit_free(offsets);
+    jit_free(offsets_async);
+    jit_free(out);
+}
+
+template <typename T> void test_prefix_sum_blocks(VarType type, uint32_t size) {
+    T *in = (T *) jit_malloc(AllocType::Host, size * sizeof(T)),
+      *out = (T *) jit_malloc(AllocType::Host, size * sizeof(T));
+
+    // Small integers, so that floating point sums are exact
+    for (uint32_t i = 0; i < size; ++i)
+        in[i] = (T) (rand() % 3);
+
+    for (int exclusive = 0; exclusive < 2; ++exclusive) {
+        jit_prefix_sum(JitBackend::LLVM, type, exclusive, in, size, out);
+        jit_sync_thread();
+
+        T accum = T(0);
+        for (uint32_t i = 0; i < size; ++i) {
+            T next = accum + in[i];
+            jit_assert(out[i] == (exclusive ? accum : next));
+            accum = next;
+        }
+    }
+
+    jit_free(in);
+    jit_free(out);
+}
+
+TEST_LLVM(17_prefix_sum_blocks) {
+    /* With several worker threads, the scan and compress operations process
+       blocks of DRJIT_POOL_BLOCK_SIZE (16384) entries that look back at the
+       sums of their predecessors */
+    srand(2);
+    jit_llvm_set_thread_count(4);
+    uint32_t size = 5 * 16384 + 123;
+
+    test_prefix_sum_blocks<uint32_t>(VarType::UInt32, size);
+    test_prefix_sum_blocks<uint64_t>(VarType::UInt64, size);
+    test_prefix_sum_blocks<float>(VarType::Float32, size);
+    test_prefix_sum_blocks<double>(VarType::Float64, size);
+
+    uint8_t *mask = (uint8_t *) jit_malloc(AllocType::Host, size);
+    uint32_t *out = (uint32_t *) jit_malloc(AllocType::Host, size * sizeof(uint32_t));
+    std::vector<uint32_t> ref;
+    for (uint32_t i = 0; i < size; ++i) {
+        // Runs of active and inactive entries that cross block boundaries
+        mask[i] = (uint8_t) ((i / 5000) % 3 != 0 && rand() % 4 != 0);
+        if (mask[i])
+            ref.push_back(i);
+    }
+
+    uint32_t count = jit_compress(JitBackend::LLVM, mask, size, out);
+    jit_assert(count == (uint32_t) ref.size());
+    jit_assert(memcmp(out, ref.data(), count * sizeof(uint32_t)) == 0);
+
+    jit_free(mask);
+    jit_free(out);
+    jit_llvm_set_thread_count(std::thread::hardware_concurrency());
+}